@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "calendar_queue.h"
+#include "entry_list.h"
+#include "mem.h"
+
+static int wheel_slot(day_t day);
+static bool in_wheel(CalendarQueue *calendar, day_t day);
+static CalendarBucket *create_bucket(day_t day, EntryList *entry_list);
+static CalendarBucket *find_bucket(CalendarQueue *calendar, day_t day);
+static void insert_bucket(CalendarQueue *calendar, CalendarBucket *bucket);
+static void overflow_insert(CalendarQueue *calendar, CalendarBucket *bucket);
+static int deliver_bucket(CalendarQueue *calendar, CalendarBucket *bucket, EntryList *dest);
+
+CalendarQueue create_calendar_queue(day_t cursor) {
+    CalendarQueue calendar = {
+        .cursor = cursor,
+        .size = 0,
+        .overflow = NULL
+    };
+    for (int i = 0; i < CALENDAR_WHEEL_SLOTS; i++) {
+        calendar.wheel[i] = NULL;
+    }
+    return calendar;
+}
+
+void free_calendar_queue(CalendarQueue *calendar) {
+    CalendarBucket *bucket = calendar_queue_first(calendar);
+    while (bucket != NULL) {
+        CalendarBucket *next = calendar_queue_next(calendar, bucket);
+        free_entry_list(&bucket->entry_list);
+        mem_free(bucket);
+        bucket = next;
+    }
+    *calendar = create_calendar_queue(calendar->cursor);
+}
+
+bool calendar_queue_empty(CalendarQueue *calendar) {
+    return calendar->size == 0;
+}
+
+int calendar_queue_entry_count(CalendarQueue *calendar) {
+    int count = 0;
+    CalendarBucket *bucket;
+    for (bucket = calendar_queue_first(calendar); bucket != NULL; bucket = calendar_queue_next(calendar, bucket)) {
+        count += bucket->entry_list.size;
+    }
+    return count;
+}
+
+EntryList *calendar_queue_get(CalendarQueue *calendar, day_t day) {
+    CalendarBucket *bucket = find_bucket(calendar, day);
+    if (bucket == NULL) {
+        EntryList entry_list = create_entry_list();
+        bucket = create_bucket(day, &entry_list);
+        insert_bucket(calendar, bucket);
+    }
+    return &bucket->entry_list;
+}
+
+void calendar_queue_push(CalendarQueue *calendar, day_t day, char *entry) {
+    entry_list_push(calendar_queue_get(calendar, day), entry);
+}
+
+void calendar_queue_insert(CalendarQueue *calendar, day_t day, EntryList *entry_list) {
+    CalendarBucket *bucket = find_bucket(calendar, day);
+    if (bucket != NULL) {
+        entry_list_concat(&bucket->entry_list, entry_list);
+        return;
+    }
+    insert_bucket(calendar, create_bucket(day, entry_list));
+}
+
+int calendar_queue_advance(CalendarQueue *calendar, day_t day, EntryList *dest) {
+    day_t prev_cursor = calendar->cursor;
+    if (day <= prev_cursor) {
+        return 0;
+    }
+    int delivered = 0;
+    // overdue buckets (scheduled on or before the previous cursor) sort first in overflow
+    while (calendar->overflow != NULL && calendar->overflow->day <= prev_cursor) {
+        CalendarBucket *bucket = calendar->overflow;
+        calendar->overflow = bucket->next;
+        delivered += deliver_bucket(calendar, bucket, dest);
+    }
+    // wheel slots for (prev_cursor, day]. At most one trip around the wheel
+    int span = day - prev_cursor;
+    if (span > CALENDAR_WHEEL_SLOTS - 1) {
+        span = CALENDAR_WHEEL_SLOTS - 1;
+    }
+    for (day_t d = prev_cursor + 1; d <= prev_cursor + span; d++) {
+        int slot = wheel_slot(d);
+        CalendarBucket *bucket = calendar->wheel[slot];
+        if (bucket != NULL && bucket->day == d) {
+            calendar->wheel[slot] = NULL;
+            delivered += deliver_bucket(calendar, bucket, dest);
+        }
+    }
+    calendar->cursor = day;
+    // overflow buckets that came due
+    while (calendar->overflow != NULL && calendar->overflow->day <= day) {
+        CalendarBucket *bucket = calendar->overflow;
+        calendar->overflow = bucket->next;
+        delivered += deliver_bucket(calendar, bucket, dest);
+    }
+    // overflow buckets now within the wheel horizon
+    while (calendar->overflow != NULL && in_wheel(calendar, calendar->overflow->day)) {
+        CalendarBucket *bucket = calendar->overflow;
+        calendar->overflow = bucket->next;
+        bucket->next = NULL;
+        calendar->wheel[wheel_slot(bucket->day)] = bucket;
+    }
+    return delivered;
+}
+
+/*
+Iteration order: wheel buckets by day, then overflow buckets by day
+(the overflow list may begin with overdue buckets)
+*/
+CalendarBucket *calendar_queue_first(CalendarQueue *calendar) {
+    for (day_t d = calendar->cursor + 1; d < calendar->cursor + CALENDAR_WHEEL_SLOTS; d++) {
+        CalendarBucket *bucket = calendar->wheel[wheel_slot(d)];
+        if (bucket != NULL) {
+            return bucket;
+        }
+    }
+    return calendar->overflow;
+}
+
+CalendarBucket *calendar_queue_next(CalendarQueue *calendar, CalendarBucket *bucket) {
+    if (!in_wheel(calendar, bucket->day) || calendar->wheel[wheel_slot(bucket->day)] != bucket) {
+        // overflow bucket
+        return bucket->next;
+    }
+    for (day_t d = bucket->day + 1; d < calendar->cursor + CALENDAR_WHEEL_SLOTS; d++) {
+        CalendarBucket *next = calendar->wheel[wheel_slot(d)];
+        if (next != NULL) {
+            return next;
+        }
+    }
+    return calendar->overflow;
+}
+
+CalendarBucket *create_bucket(day_t day, EntryList *entry_list) {
+    CalendarBucket *bucket = mem_alloc(MEM_MODULO, sizeof(CalendarBucket));
+    bucket->day = day;
+    bucket->entry_list = *entry_list;
+    bucket->next = NULL;
+    return bucket;
+}
+
+CalendarBucket *find_bucket(CalendarQueue *calendar, day_t day) {
+    if (in_wheel(calendar, day)) {
+        return calendar->wheel[wheel_slot(day)];
+    }
+    CalendarBucket *bucket;
+    for (bucket = calendar->overflow; bucket != NULL && bucket->day <= day; bucket = bucket->next) {
+        if (bucket->day == day) {
+            return bucket;
+        }
+    }
+    return NULL;
+}
+
+void insert_bucket(CalendarQueue *calendar, CalendarBucket *bucket) {
+    if (in_wheel(calendar, bucket->day)) {
+        calendar->wheel[wheel_slot(bucket->day)] = bucket;
+    } else {
+        overflow_insert(calendar, bucket);
+    }
+    calendar->size++;
+}
+
+void overflow_insert(CalendarQueue *calendar, CalendarBucket *bucket) {
+    CalendarBucket **link = &calendar->overflow;
+    while (*link != NULL && (*link)->day < bucket->day) {
+        link = &(*link)->next;
+    }
+    bucket->next = *link;
+    *link = bucket;
+}
+
+int deliver_bucket(CalendarQueue *calendar, CalendarBucket *bucket, EntryList *dest) {
+    int delivered = bucket->entry_list.size;
+    // concat keeps the newer send_date so a delivered-only list still has one
+    entry_list_concat(dest, &bucket->entry_list);
+    mem_free(bucket);
+    calendar->size--;
+    return delivered;
+}
+
+bool in_wheel(CalendarQueue *calendar, day_t day) {
+    return day > calendar->cursor && day < calendar->cursor + CALENDAR_WHEEL_SLOTS;
+}
+
+int wheel_slot(day_t day) {
+    return ((day % CALENDAR_WHEEL_SLOTS) + CALENDAR_WHEEL_SLOTS) % CALENDAR_WHEEL_SLOTS;
+}
\ No newline at end of file
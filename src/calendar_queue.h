@@ -0,0 +1,76 @@
+#ifndef CALENDAR_QUEUE_H
+#define CALENDAR_QUEUE_H
+
+#include <stdbool.h>
+
+#include "entry_list.h"
+#include "time_types.h"
+
+#define CALENDAR_QUEUE_DELIVER_DAY "deliver_day"
+
+/*
+Number of days covered by the timing wheel (including the current day slot).
+Buckets scheduled further out than this live in the sorted overflow list
+and migrate into the wheel as the cursor advances.
+*/
+#define CALENDAR_WHEEL_SLOTS 64
+
+/*
+CalendarBucket:
+The entries to be delivered on a single (future) day
+*/
+typedef struct CalendarBucket {
+    day_t day;
+    EntryList entry_list;
+    struct CalendarBucket *next;
+} CalendarBucket;
+
+/*
+CalendarQueue: 
+A timing wheel of EntryLists keyed by delivery day
+
+             cursor
+               v
+wheel: [ ][ ][ ][x][ ][x][ ] ... (day % CALENDAR_WHEEL_SLOTS)
+overflow: x -> x -> x           (sorted by day)
+
+- The wheel holds buckets for days in (cursor, cursor + CALENDAR_WHEEL_SLOTS)
+  so each slot holds at most one bucket
+- Everything else (far future or overdue) lives in the sorted overflow list
+
+Advancing the cursor by any number of days visits at most CALENDAR_WHEEL_SLOTS
+slots plus the due buckets, independent of how many entries are pending.
+*/
+typedef struct CalendarQueue {
+    /* the current day */
+    day_t cursor;
+    /* number of pending buckets */
+    int size;
+    CalendarBucket *wheel[CALENDAR_WHEEL_SLOTS];
+    CalendarBucket *overflow;
+} CalendarQueue;
+
+CalendarQueue create_calendar_queue(day_t cursor);
+void free_calendar_queue(CalendarQueue *calendar);
+
+bool calendar_queue_empty(CalendarQueue *calendar);
+int calendar_queue_entry_count(CalendarQueue *calendar);
+
+// get the EntryList for day (created if it doesn't exist yet)
+EntryList *calendar_queue_get(CalendarQueue *calendar, day_t day);
+// push entry onto the EntryList for day
+void calendar_queue_push(CalendarQueue *calendar, day_t day, char *entry);
+// move an EntryList into the queue, merging with an existing bucket for day
+void calendar_queue_insert(CalendarQueue *calendar, day_t day, EntryList *entry_list);
+
+/*
+Moves the cursor forward to day and appends every entry due on or before day to dest
+returns the number of entries delivered
+*/
+int calendar_queue_advance(CalendarQueue *calendar, day_t day, EntryList *dest);
+
+// iterate pending buckets (wheel in day order, then overflow)
+CalendarBucket *calendar_queue_first(CalendarQueue *calendar);
+CalendarBucket *calendar_queue_next(CalendarQueue *calendar, CalendarBucket *bucket);
+
+#endif
\ No newline at end of file
@@ -2,10 +2,14 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include "cli.h"
 #include "time_utils.h"
 #include "command.h"
+#include "calendar_queue.h"
+#include "writer.h"
+#include "mem.h"
 
 
 /*
@@ -19,8 +23,17 @@ static void cli_gets(char *buffer, size_t buf_size);
 static void clear_stdin();
 
 static void cli_print_wakeup_error_message(char *wakeup);
-static void cli_print_entry(EntryList *entry_list, int index);
+static void cli_write_entry_list(Writer *writer, EntryList *entry_list);
+static void cli_write_entries(Writer *writer, EntryList *entry_list);
+static void cli_write_entry(Writer *writer, int number, Entry *entry);
+static void cli_write_heading(Writer *writer, char *heading, int number);
+static void cli_write_slots(Writer *writer, EntryList *entry_list, int *slots, int count);
+
+#define CLI_RULE "------------------------------------------\n"
 static void cli_print_history_queue_summary(HistoryQueue *history);
+static bool recurring_empty_message(RecurrenceHeap *recurring);
+static char *day_to_string(char *buf, size_t buf_size, day_t day);
+static char *duration_to_string(char *buf, size_t buf_size, int64_t seconds);
 
 static void string_tolower(char *str);
 static bool length_ok(char *string, int max_length);
@@ -53,6 +66,7 @@ void cli_print_preferences(Modulo *modulo) {
     printf_time("    2. wakeup_earliest: %s\n", modulo->wakeup_earliest);
     printf_time("    3. wakeup_latest: %s\n", modulo->wakeup_latest);
     printf("    4. entry_delimiter: %s\n", modulo->entry_delimiter);
+    printf("    5. carry_over: %s\n", carry_over_to_string(modulo->carry_over));
 }
 
 void cli_print_wakeup_success(Modulo *modulo) {
@@ -60,7 +74,7 @@ void cli_print_wakeup_success(Modulo *modulo) {
     printf("Good morning %s!\n\n", modulo->username);
     cli_print_time_status(modulo);
     printf("\n");
-    int new_entries = modulo->today.size;
+    int new_entries = entry_list_live_count(&modulo->today);
     if (new_entries > 0) {
         printf("You have %d new entries to review today!\n", new_entries);
         printf("Run `modulo today` to view them or run `modulo tomorrow` to start journaling your thoughts for tomorrow.\n");
@@ -71,29 +85,110 @@ void cli_print_wakeup_success(Modulo *modulo) {
 }
 
 void cli_print_wakeup_failure(Modulo *modulo) {
+    char now_string[FORMAT_TIME_BUF_SIZE];
+    char range_string[FORMAT_RANGE_BUF_SIZE];
     printf("It's too early for that!\n\n");
-    printf("The current time is: %s\n", utc_to_string(utc_now(), false));
-    printf("Your next wakeup range is scheduled for %s\n", wakeup_range_to_string(modulo));
+    printf("The current time is: %s\n", utc_to_string(now_string, sizeof now_string, utc_now(), false));
+    printf("Your next wakeup range is scheduled for %s\n", wakeup_range_to_string(range_string, sizeof range_string, modulo));
     printf("\nRun `modulo set wakeup_earliest` or `modulo set preferences` to configure your wakeup range\n");
 }
 
 void cli_print_today_entries(Modulo *modulo) {
     EntryList *today = &modulo->today;
-    if (today->size == 0) {
+    if (entry_list_empty(today)) {
         printf("No entries to review today.\n");
         return;
     }
-    printf("You have %d new entries to review today\n", today->size);
-    cli_print_entry_list(today);
+    printf("You have %d new entries to review today\n", entry_list_live_count(today));
+    Writer *writer = create_writer(stdout, OUTPUT_TEXT);
+    cli_write_entry_list(writer, today);
+    free_writer(writer);
+}
+
+void cli_print_tomorrow_entries(Modulo *modulo) {
+    EntryList *tomorrow = &modulo->tomorrow;
+    int live_count = entry_list_live_count(tomorrow);
+    if (live_count == 0) {
+        printf("No entries written for tomorrow yet.\n");
+        printf("Run `modulo tomorrow` to start journaling your thoughts for tomorrow.\n");
+        return;
+    }
+    printf("You've written %d entries for tomorrow\n\n", live_count);
+    Writer *writer = create_writer(stdout, OUTPUT_TEXT);
+    cli_write_entries(writer, tomorrow);
+    free_writer(writer);
 }
 
-void cli_print_entry_list(EntryList *entry_list) {
-    printf("sent: %s\n", utc_to_string(entry_list->send_date, true));
-    printf("recv: %s\n\n", utc_to_string(entry_list->recv_date, true));
-    int entry_count = entry_list->size;
-    for (int i = 0; i < entry_count; i++) {
-        cli_print_entry(entry_list, i);
+/*
+    Entry lists are written through a Writer (see writer.h) instead of printf:
+    entry text goes out by reference and the whole listing takes a few writev calls
+*/
+void cli_write_entry_list(Writer *writer, EntryList *entry_list) {
+    char date_string[FORMAT_TIME_BUF_SIZE];
+    writer_write_string(writer, "sent: ");
+    writer_write_string(writer, utc_to_string(date_string, sizeof date_string, entry_list->send_date, true));
+    writer_write_string(writer, "\nrecv: ");
+    writer_write_string(writer, utc_to_string(date_string, sizeof date_string, entry_list->recv_date, true));
+    writer_write_string(writer, "\n\n");
+    cli_write_entries(writer, entry_list);
+}
+
+void cli_write_entries(Writer *writer, EntryList *entry_list) {
+    int entry_number = 0;
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->flags & ENTRY_REMOVED) {
+            continue;
+        }
+        cli_write_entry(writer, ++entry_number, entry);
+    }
+}
+
+void cli_write_entry(Writer *writer, int number, Entry *entry) {
+    writer_write_string(writer, "Entry ");
+    writer_write_uint(writer, number);
+    writer_write_string(writer, " [id ");
+    writer_write_uint(writer, entry->id);
+    writer_write_string(writer, (entry->flags & ENTRY_DONE) ? "] (done)\n---------\n" : "]\n---------\n");
+    writer_write_ref(writer, entry->text, entry->length);
+    writer_write_string(writer, "\n\n");
+}
+
+// the entries at slots keep the numbers they have in the full listing
+void cli_write_slots(Writer *writer, EntryList *entry_list, int *slots, int count) {
+    for (int i = 0; i < count; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, slots[i]);
+        cli_write_entry(writer, entry_list_entry_number(entry_list, slots[i]), entry);
+    }
+}
+
+void cli_print_tagged_today(EntryList *today, char *tag, int *slots, int count) {
+    if (count == 0) {
+        printf("No entries tagged %s to review today.\n", tag);
+        return;
     }
+    printf("You have %d entries tagged %s to review today\n\n", count, tag);
+    Writer *writer = create_writer(stdout, OUTPUT_TEXT);
+    cli_write_slots(writer, today, slots, count);
+    free_writer(writer);
+}
+
+void cli_print_tagged_history_item(EntryList *entry_list, int item_number, int *slots, int count) {
+    Writer *writer = create_writer(stdout, OUTPUT_TEXT);
+    cli_write_heading(writer, "History queue item", item_number);
+    cli_write_slots(writer, entry_list, slots, count);
+    free_writer(writer);
+}
+
+// heading followed by number, if it isn't 0
+void cli_write_heading(Writer *writer, char *heading, int number) {
+    writer_write_string(writer, CLI_RULE);
+    writer_write_string(writer, heading);
+    if (number > 0) {
+        writer_write_string(writer, " ");
+        writer_write_uint(writer, number);
+    }
+    writer_write_string(writer, "\n");
 }
 
 void cli_print_history_status(HistoryQueue *history) {
@@ -108,14 +203,85 @@ void cli_print_history_status(HistoryQueue *history) {
 void cli_print_history_item(HistoryQueue *history, int entry_list_index) {
     EntryList *entry_list = history_queue_get(history, entry_list_index);
     printf("Reviewing history queue item %d\n", entry_list_index + 1);
-    cli_print_entry_list(entry_list);
+    Writer *writer = create_writer(stdout, OUTPUT_TEXT);
+    cli_write_entry_list(writer, entry_list);
+    free_writer(writer);
+}
+
+void cli_print_history_all(HistoryQueue *history) {
+    if (history->size == 0) {
+        printf("Your history queue is empty!\n");
+        return;
+    }
+    Writer *writer = create_writer(stdout, OUTPUT_TEXT);
+    for (int i = 0; i < history->size; i++) {
+        cli_write_heading(writer, "History queue item", i+1);
+        cli_write_entry_list(writer, history_queue_get(history, i));
+    }
+    free_writer(writer);
+}
+
+void cli_print_export(Modulo *modulo) {
+    Writer *writer = create_writer(stdout, OUTPUT_TEXT);
+    cli_write_heading(writer, "Today", 0);
+    cli_write_entry_list(writer, modulo_get_today(modulo));
+    cli_write_heading(writer, "Tomorrow", 0);
+    cli_write_entry_list(writer, modulo_get_tomorrow(modulo));
+    HistoryQueue *history = modulo_get_history(modulo);
+    for (int i = 0; i < history->size; i++) {
+        cli_write_heading(writer, "History queue item", i+1);
+        cli_write_entry_list(writer, history_queue_get(history, i));
+    }
+    CalendarQueue *scheduled = modulo_get_scheduled(modulo);
+    char date_string[FORMAT_TIME_BUF_SIZE];
+    for (CalendarBucket *bucket = calendar_queue_first(scheduled); bucket != NULL; bucket = calendar_queue_next(scheduled, bucket)) {
+        time_t deliver_utc = day_to_utc(bucket->day, modulo_get_wakeup_latest(modulo));
+        writer_write_string(writer, CLI_RULE "Scheduled for ");
+        writer_write_string(writer, utc_to_string(date_string, sizeof date_string, deliver_utc, true));
+        writer_write_string(writer, "\n\n");
+        cli_write_entries(writer, &bucket->entry_list);
+    }
+    free_writer(writer);
+}
+
+void cli_print_recurring(Modulo *modulo) {
+    RecurrenceHeap *recurring = modulo_get_recurring(modulo);
+    if (recurring_empty_message(recurring)) {
+        return;
+    }
+    printf("You have %d recurring entries.\n", recurring->size);
+    char date_string[FORMAT_TIME_BUF_SIZE];
+    int *indices = recurrence_heap_sorted_indices(recurring);
+    for (int i = 0; i < recurring->size; i++) {
+        Recurrence *recurrence = &recurring->items[indices[i]];
+        time_t next_utc = day_to_utc(recurrence->next_day, modulo_get_wakeup_latest(modulo));
+        printf("\n");
+        switch (recurrence->rule) {
+            case RECUR_WEEKLY:
+                printf("%d. every %s\n", i+1, weekday_to_string(recurrence->param));
+                break;
+            case RECUR_MONTHLY:
+                printf("%d. monthly on day %d\n", i+1, recurrence->param);
+                break;
+            default:
+                printf("%d. daily\n", i+1);
+        }
+        printf("next: %s\n", utc_to_string(date_string, sizeof date_string, next_utc, true));
+        printf("---------\n");
+        printf("%s\n", recurrence->entry);
+    }
+    mem_free(indices);
+    printf("\nRun `modulo recur remove <number>` to stop a recurring entry.\n");
 }
 
-void cli_print_entry(EntryList *entry_list, int index) {
-    int entry_number = index + 1;
-    printf("Entry %d\n", entry_number);
-    printf("---------\n");
-    printf("%s\n\n", entry_list_get(entry_list, index));
+bool recurring_empty_message(RecurrenceHeap *recurring) {
+    if (!recurrence_heap_empty(recurring)) {
+        return false;
+    }
+    printf("You have no recurring entries.\n");
+    printf("Run `modulo recur daily <entry>`, `modulo recur weekly <weekday> <entry>`\n");
+    printf("or `modulo recur monthly <day> <entry>` to add one.\n");
+    return true;
 }
 
 void cli_prompt_day_ptr(Modulo *modulo, time_t recent_wakeup_earliest, time_t recent_wakeup_latest) {
@@ -159,7 +325,7 @@ Selection cli_prompt_preference_selection() {
             return DONE;
         } else if (strlen(input) != 1) {
             fprintf(stderr, "Bad input: %s.\n", input);
-            fprintf(stderr, "Pick a numer in the range 1-4 or type done.\n");
+            fprintf(stderr, "Pick a numer in the range 1-5 or type done.\n");
             continue;
         }
         int item_number = atoi(input);
@@ -172,8 +338,10 @@ Selection cli_prompt_preference_selection() {
                 return PREFERENCE_WAKEUP_LATEST;
             case 4:
                 return PREFERENCE_ENTRY_DELIMITER;
+            case 5:
+                return PREFERENCE_CARRY_OVER;
             default:
-                printf("%s is not a valid preference selection. Pick a number in the range 1-4.\n", input);
+                printf("%s is not a valid preference selection. Pick a number in the range 1-5.\n", input);
         }
     }
 }
@@ -222,6 +390,21 @@ void cli_prompt_entry_delimiter(Modulo *modulo, bool show_prev) {
     } while (cli_set_entry_delimiter(modulo, entry_delimiter, true));
 }
 
+void cli_prompt_carry_over(Modulo *modulo, bool show_prev) {
+    char carry_over[MAX_INPUT_LENGTH+1];
+    printf("\nWhich entries should carry over to the next day? (%s, %s or %s)\n", 
+        CARRY_OVER_NONE, CARRY_OVER_UNREAD, CARRY_OVER_UNFINISHED);
+    do {
+        cli_prompt_input_token(
+            "carry_over: ", 
+            carry_over, 
+            MAX_INPUT_LENGTH
+        );
+        printf("\n");
+        string_tolower(carry_over);
+    } while (cli_set_carry_over(modulo, carry_over, show_prev) == -1);
+}
+
 void cli_prompt_input_token(char *prompt, char *input_buffer, size_t max_input_length) {
     do {
         printf("\n");
@@ -267,7 +450,6 @@ int cli_set_wakeup_earliest(Modulo *modulo, char *wakeup, bool show_prev) {
 
 int cli_set_wakeup_latest(Modulo *modulo, char *wakeup, bool show_prev) {
     clk_time_t wakeup_latest;
-    clk_time_t wakeup_earliest = modulo_get_wakeup_earliest(modulo);
     if ((wakeup_latest = parse_time(wakeup)) == -1) {
         cli_print_wakeup_error_message(wakeup);
         return -1;
@@ -275,13 +457,7 @@ int cli_set_wakeup_latest(Modulo *modulo, char *wakeup, bool show_prev) {
     // get a copy of prev wakeup_latest before overwriting
     // then update
     clk_time_t prev_wakeup_latest = modulo_get_wakeup_latest(modulo);
-    modulo_set_wakeup_latest(modulo, wakeup_latest);
-
-    // set new_day_pointer to wakeup_latest occurring before next wakeup_earliest
-    time_t day_ptr = modulo_get_day_ptr(modulo);
-    time_t next_wakeup_earliest = time_to_utc_next(wakeup_earliest, day_ptr);
-    time_t new_day_ptr = time_to_utc_prev(wakeup_latest, next_wakeup_earliest);
-    modulo_set_day_ptr(modulo, new_day_ptr);
+    modulo_move_wakeup_latest(modulo, wakeup_latest);
 
     printf_time("Successfully set latest wakeup to %s!\n", wakeup_latest);
     if (show_prev) {
@@ -311,6 +487,29 @@ int cli_set_entry_delimiter(Modulo *modulo, char *entry_delimiter, bool show_pre
     return 0;
 }
 
+int cli_set_carry_over(Modulo *modulo, char *carry_over, bool show_prev) {
+    CarryOver policy = parse_carry_over(carry_over);
+    if (policy == CARRY_INVALID) {
+        fprintf(
+            stderr, 
+            "Oops, \"%.15s\" isn't a carry over policy! Use one of %s, %s or %s.\n",
+            carry_over,
+            CARRY_OVER_NONE,
+            CARRY_OVER_UNREAD,
+            CARRY_OVER_UNFINISHED
+        );
+        return -1;
+    }
+    CarryOver prev_policy = modulo_get_carry_over(modulo);
+    modulo_set_carry_over(modulo, policy);
+
+    printf("Successfully updated carry_over to %s!\n", carry_over_to_string(policy));
+    if (show_prev) {
+        printf("Previous carry_over: %s\n", carry_over_to_string(prev_policy));
+    }
+    return 0;
+}
+
 int cli_get_input_token(char *input_buffer, size_t max_input_length) {
     size_t buf_idx = 0;
     char c;
@@ -451,25 +650,99 @@ void cli_print_wakeup_error_message(char *wakeup) {
     fprintf(stderr,"i.e. '9am', '009:00 AM', '9:00am', and '9 : 00' are all valid.\n");
 }
 
+void cli_print_stats(UsageStats *stats, day_t today, int days) {
+    if (stats->size == 0) {
+        printf("No stats yet, they start with the first entry you write.\n");
+        return;
+    }
+    char day_string[FORMAT_TIME_BUF_SIZE];
+    char duration_string[FORMAT_TIME_BUF_SIZE];
+    printf("Since %s you've written %" PRIu64 " entries", day_to_string(day_string, sizeof day_string, stats->days[0].day), stats->written);
+    if (stats->written > 0) {
+        printf(", %" PRIu64 " characters long on average", stats->length / stats->written);
+    }
+    printf(".\n");
+    if (stats->delivered > 0) {
+        printf("You read your entries on %u of the %u days they were waiting for you (%u%%).\n",
+               stats->read, stats->delivered, stats->read * 100 / stats->delivered);
+    }
+    if (stats->received > 0) {
+        printf("Entries waited %s on average from when you wrote them to the day they arrived.\n",
+               duration_to_string(duration_string, sizeof duration_string, stats->latency / stats->received));
+    }
+    uint32_t streak = stats_current_streak(stats, today);
+    printf("Your streak is %u day%s, your longest was %u.\n", streak, streak == 1 ? "" : "s", stats->longest_streak);
+
+    printf("\n");
+    printf("%-16s %7s %10s %5s %8s\n", "day", "written", "avg length", "read", "waited");
+    int count;
+    DayRollup *rollup = stats_range(stats, today - days + 1, today, &count);
+    DayRollup *end = rollup + count;
+    for (day_t day = today - days + 1; day <= today; day++) {
+        DayRollup empty = { .day = day };
+        DayRollup *day_rollup = rollup < end && rollup->day == day ? rollup++ : &empty;
+        char *read = "-";
+        if (day_rollup->flags & STATS_DAY_DELIVERED) {
+            read = day_rollup->flags & STATS_DAY_READ ? "yes" : "no";
+        }
+        char length_string[24] = "-";
+        if (day_rollup->written > 0) {
+            snprintf(length_string, sizeof length_string, "%" PRIu64, day_rollup->length / day_rollup->written);
+        }
+        char *waited = "-";
+        if (day_rollup->received > 0) {
+            waited = duration_to_string(duration_string, sizeof duration_string, day_rollup->latency / day_rollup->received);
+        }
+        printf("%-16s %7u %10s %5s %8s\n", day_to_string(day_string, sizeof day_string, day), day_rollup->written, length_string, read, waited);
+    }
+}
+
+// e.g. Mon 2026-10-12
+char *day_to_string(char *buf, size_t buf_size, day_t day) {
+    int year, month, mday;
+    day_to_date(day, &year, &month, &mday);
+    char *weekday = weekday_to_string(day_to_weekday(day));
+    snprintf(buf, buf_size, "%c%.2s %04d-%02d-%02d", toupper(weekday[0]), weekday + 1, year, month, mday);
+    return buf;
+}
+
+// e.g. 2d 3h, 14h 20m or 35m
+char *duration_to_string(char *buf, size_t buf_size, int64_t seconds) {
+    int64_t minutes = seconds / 60;
+    if (minutes >= 24*60) {
+        snprintf(buf, buf_size, "%" PRId64 "d %" PRId64 "h", minutes / (24*60), minutes / 60 % 24);
+    } else if (minutes >= 60) {
+        snprintf(buf, buf_size, "%" PRId64 "h %" PRId64 "m", minutes / 60, minutes % 60);
+    } else {
+        snprintf(buf, buf_size, "%" PRId64 "m", minutes);
+    }
+    return buf;
+}
+
 void cli_print_time_status(Modulo *modulo) {
-    printf("It's currently %s.\n", utc_to_string(utc_now(), false));
-    printf("Your next wakeup is scheduled for %s.\n", wakeup_range_to_string(modulo));
+    char now_string[FORMAT_TIME_BUF_SIZE];
+    char range_string[FORMAT_RANGE_BUF_SIZE];
+    printf("It's currently %s.\n", utc_to_string(now_string, sizeof now_string, utc_now(), false));
+    printf("Your next wakeup is scheduled for %s.\n", wakeup_range_to_string(range_string, sizeof range_string, modulo));
 }
 
 void cli_print_entry_lists_status(Modulo *modulo) {
     printf("Entry List Status\n");
     printf("-----------------\n");
-    printf("today    (inbox):  %d entries to review today\n", modulo->today.size);
-    printf("tomorrow (outbox): %d entries written for tomorrow\n", modulo->tomorrow.size);
+    printf("today    (inbox):  %d entries to review today\n", entry_list_live_count(&modulo->today));
+    printf("tomorrow (outbox): %d entries written for tomorrow\n", entry_list_live_count(&modulo->tomorrow));
+    printf("scheduled:         %d entries written for later days\n", calendar_queue_entry_count(&modulo->scheduled));
+    printf("recurring:         %d recurring entries\n", modulo->recurring.size);
     printf("history: \n");
     cli_print_history_queue_summary(&modulo->history);
 }
 
 void cli_print_history_queue_summary(HistoryQueue *history) {
+    char date_string[FORMAT_TIME_BUF_SIZE];
     for (size_t i = 0; i < HISTORY_QUEUE_LENGTH; i++) {
         if (i < history->size) {
             EntryList *entry_list = &history->entry_lists[i];
-            printf("    %d. %s (sent)\n", i+1, utc_to_string(entry_list->send_date, false));
+            printf("    %d. %s (sent)\n", i+1, utc_to_string(date_string, sizeof date_string, entry_list->send_date, false));
         } else {
             printf("    %d. -\n", i+1);
         }
@@ -28,9 +28,20 @@ void cli_print_wakeup_failure(Modulo *modulo);
 void cli_print_time_status(Modulo *modulo);
 void cli_print_entry_lists_status(Modulo *modulo);
 void cli_print_today_entries(Modulo *modulo);
+void cli_print_tomorrow_entries(Modulo *modulo);
+// the entries at slots (see tag_index_select), numbered as in the full list
+void cli_print_tagged_today(EntryList *today, char *tag, int *slots, int count);
+void cli_print_tagged_history_item(EntryList *entry_list, int item_number, int *slots, int count);
 
 void cli_print_history_status(HistoryQueue *history);
 void cli_print_history_item(HistoryQueue *history, int entry_list_index);
+void cli_print_history_all(HistoryQueue *history);
+// every entry list: today, tomorrow, the history queue and the scheduled days
+void cli_print_export(Modulo *modulo);
+// the totals, then a row for each of the last days days (today included)
+void cli_print_stats(UsageStats *stats, day_t today, int days);
+
+void cli_print_recurring(Modulo *modulo);
 
 Selection cli_prompt_preference_selection();
 
@@ -41,10 +52,12 @@ void cli_prompt_username(Modulo *modulo, bool show_prev);
 void cli_prompt_wakeup_earliest(Modulo *modulo, bool show_prev);
 void cli_prompt_wakeup_latest(Modulo *modulo, bool show_prev);
 void cli_prompt_entry_delimiter(Modulo *modulo, bool show_prev);
+void cli_prompt_carry_over(Modulo *modulo, bool show_prev);
 
 int cli_set_username(Modulo *modulo, char *username, bool show_prev);
 int cli_set_wakeup_earliest(Modulo *modulo, char *wakeup, bool show_prev);
 int cli_set_wakeup_latest(Modulo *modulo, char *wakeup, bool show_prev);
 int cli_set_entry_delimiter(Modulo *modulo, char *entry_delimiter, bool show_prev);
+int cli_set_carry_over(Modulo *modulo, char *carry_over, bool show_prev);
 
 #endif
\ No newline at end of file
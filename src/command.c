@@ -1,23 +1,60 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
 #include <cjson/cJSON.h>
 
 #include "command.h"
 #include "filesystem.h"
+#include "tags.h"
 #include "time_utils.h"
 #include "modulo.h"
 #include "cli.h"
 #include "editor/entry_editor.h"
+#include "editor/replay.h"
+#include "editor/reader.h"
+#include "records.h"
+#include "writer.h"
+#include "watch.h"
+#include "trace.h"
+#include "mem.h"
 
 static void command_set_wakeup_boundary(char *boundary, char *wakeup);
+static uint64_t parse_entry_id(char *entry_id);
+static int parse_positive_int(char *string);
 
 /*
     reads from disk (or initializes) a modulo struct. 
     Then syncs out-of-date data via modulo->wakeup time if necessary
     optionally persists 'changes' (initialization or synchronization) to disk
+    write commands take the store lock first, read commands never persist anything
 */
 static Modulo *load_synced_modulo(OSContext *c, bool write_updates_to_disk);
+static bool use_reader(bool reader, EntryList *entry_list);
+static void print_today_tagged(OSContext *c, Modulo *modulo, char *tag);
+static void close_tag_index(TagIndex *index, OSContext *c);
+static void print_lock_wait(OSContext *c);
+/*
+    commands that wait on the user (a prompt, the reader or the editor) let go
+    of the lock first, so other commands aren't kept waiting. What the user did
+    is applied to the store reloaded under the lock afterwards
+*/
+static void release_store_lock();
+static void apply_preferences(Modulo *latest, Modulo *modulo, bool *changed);
+static int minutes_until_wakeup(Modulo *modulo);
+
+/* --json / --ndjson, read commands write records (see records.h) instead of text */
+static OutputFormat output_format = OUTPUT_TEXT;
+static bool structured_output();
+
+static CommandIntent command_intent = INTENT_WRITE;
+/* the store lock of a write command, taken by the first load */
+static int store_lock = -1;
 
 void command_root() {
     // display usage hints
@@ -25,14 +62,18 @@ void command_root() {
     printf("It allows you to offload end-of-day thoughts, motivations, and goals onto tomorrows to-do list.\n"); 
     printf("\n"); 
     printf("Run `modulo set preferences` to setup your user preferences.\n");
-    printf("Then run `modulo tomorrow` to start journaling your thoughts for tomorrow!\n\n");
+    printf("Then run `modulo tomorrow` to start journaling your thoughts for tomorrow!\n");
+    printf("Run `modulo help` to see every command.\n\n");
 }
 
 void command_init() {
     OSContext *c = get_context();
     char *username = get_system_username(c);
     Modulo *modulo = create_default_modulo(username);
-    check_init(modulo);
+    if (modulo == NULL) {
+        fprintf(stderr, "Oops, the username \"%.15s...\" is too long! Usernames must be %d characters or less.\n", username, USER_NAME_MAX_LEN);
+        exit(EXIT_FAILURE);
+    }
 
     // print init message
     cli_print_init_hello(username);
@@ -58,21 +99,27 @@ void command_init() {
     cli_print_init_goodbye(modulo);
     // clean up
     save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_set_preferences() {
     OSContext *c = get_context();
     Modulo *modulo = load_synced_modulo(c, false);
     check_init(modulo);
+    // the prompts change this copy, what changed is applied to the store once the user is done
+    release_store_lock();
 
     printf("This utility helps you update your user preferences.\nType `done` at any time to abort\n\n");
 
     bool done = false;
+    bool changed[PREFERENCE_CARRY_OVER + 1] = { false };
     while (!done) {
         cli_print_preferences(modulo);
         Selection selection = cli_prompt_preference_selection();
+        if (selection > DONE && selection <= PREFERENCE_CARRY_OVER) {
+            changed[selection] = true;
+        }
         switch (selection) {
             case PREFERENCE_USERNAME:
                 cli_prompt_username(modulo, true);
@@ -86,6 +133,9 @@ void command_set_preferences() {
             case PREFERENCE_ENTRY_DELIMITER:
                 cli_prompt_entry_delimiter(modulo, true);
                 break;
+            case PREFERENCE_CARRY_OVER:
+                cli_prompt_carry_over(modulo, true);
+                break;
             case DONE:
                 done = true;
                 break;
@@ -94,9 +144,32 @@ void command_set_preferences() {
                 exit(EXIT_FAILURE);
         }
     }
-    save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    Modulo *latest = load_synced_modulo(c, false);
+    check_init(latest);
+    apply_preferences(latest, modulo, changed);
+    save_modulo_or_exit(latest, c);
+    free_modulo(latest);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+// the preferences picked in the prompts, copied over to the store as it is now
+void apply_preferences(Modulo *latest, Modulo *modulo, bool *changed) {
+    if (changed[PREFERENCE_USERNAME]) {
+        modulo_set_username(latest, modulo_get_username(modulo));
+    }
+    if (changed[PREFERENCE_WAKEUP_EARLIEST]) {
+        modulo_set_wakeup_earliest(latest, modulo_get_wakeup_earliest(modulo));
+    }
+    if (changed[PREFERENCE_WAKEUP_LATEST]) {
+        modulo_move_wakeup_latest(latest, modulo_get_wakeup_latest(modulo));
+    }
+    if (changed[PREFERENCE_ENTRY_DELIMITER]) {
+        modulo_set_entry_delimiter(latest, modulo_get_entry_delimiter(modulo));
+    }
+    if (changed[PREFERENCE_CARRY_OVER]) {
+        modulo_set_carry_over(latest, modulo_get_carry_over(modulo));
+    }
 }
 
 void command_set_username(char *username) {
@@ -107,8 +180,8 @@ void command_set_username(char *username) {
         exit(EXIT_FAILURE);
     }
     save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_set_wakeup_earliest(char *wakeup) {
@@ -131,8 +204,8 @@ void command_set_wakeup_boundary(char *boundary, char *wakeup) {
     }
 
     save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_set_entry_delimiter(char *entry_delimiter) {
@@ -140,12 +213,25 @@ void command_set_entry_delimiter(char *entry_delimiter) {
     Modulo *modulo = load_synced_modulo(c, false);
     check_init(modulo);
 
-    if (cli_set_entry_delimiter(entry_delimiter, modulo, true) == -1) {
+    if (cli_set_entry_delimiter(modulo, entry_delimiter, true) == -1) {
         exit(1);
     }
     save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_set_carry_over(char *carry_over) {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, false);
+    check_init(modulo);
+
+    if (cli_set_carry_over(modulo, carry_over, true) == -1) {
+        exit(1);
+    }
+    save_modulo_or_exit(modulo, c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_get_preferences() {
@@ -153,11 +239,16 @@ void command_get_preferences() {
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
 
-    cli_print_preferences(modulo);
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_preferences(writer, modulo);
+        free_writer(writer);
+    } else {
+        cli_print_preferences(modulo);
+    }
 
-    save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_get_username() {
@@ -165,11 +256,16 @@ void command_get_username() {
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
 
-    printf("Current username: %s\n", modulo_get_username(modulo));
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_preference(writer, modulo, PREFERENCE_USERNAME);
+        free_writer(writer);
+    } else {
+        printf("Current username: %s\n", modulo_get_username(modulo));
+    }
 
-    save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_get_wakeup_earliest() {
@@ -186,17 +282,26 @@ void command_get_wakeup_boundary(char *boundary) {
     check_init(modulo);
 
     // wakeup time in minutes
-    int *wakeup_time;
+    clk_time_t wakeup_time;
     if (strcmp(boundary, WAKEUP_BOUNDARY_EARLIEST) == 0) {
         wakeup_time = modulo_get_wakeup_earliest(modulo);
     } else {
         wakeup_time = modulo_get_wakeup_latest(modulo);
     }
-    printf("Current wakeup_%s: %s\n", boundary, time_to_string(wakeup_time));
+    if (structured_output()) {
+        Selection preference = strcmp(boundary, WAKEUP_BOUNDARY_EARLIEST) == 0 
+            ? PREFERENCE_WAKEUP_EARLIEST 
+            : PREFERENCE_WAKEUP_LATEST;
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_preference(writer, modulo, preference);
+        free_writer(writer);
+    } else {
+        char time_string[FORMAT_TIME_BUF_SIZE];
+        printf("Current wakeup_%s: %s\n", boundary, time_to_string(time_string, sizeof time_string, wakeup_time));
+    }
 
-    save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_get_entry_delimiter() {
@@ -204,10 +309,33 @@ void command_get_entry_delimiter() {
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
 
-    printf("Current entry_delimiter: %s\n", modulo_get_entry_delimiter(modulo));
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_preference(writer, modulo, PREFERENCE_ENTRY_DELIMITER);
+        free_writer(writer);
+    } else {
+        printf("Current entry_delimiter: %s\n", modulo_get_entry_delimiter(modulo));
+    }
 
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_get_carry_over() {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, true);
+    check_init(modulo);
+
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_preference(writer, modulo, PREFERENCE_CARRY_OVER);
+        free_writer(writer);
+    } else {
+        printf("Current carry_over: %s\n", carry_over_to_string(modulo_get_carry_over(modulo)));
+    }
+
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_status() {
@@ -215,14 +343,20 @@ void command_status() {
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
 
-    printf("------------------------------------------\n");
-    cli_print_time_status(modulo);
-    printf("\n");
-    cli_print_entry_lists_status(modulo);
-    printf("\n");
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_status(writer, modulo);
+        free_writer(writer);
+    } else {
+        printf("------------------------------------------\n");
+        cli_print_time_status(modulo);
+        printf("\n");
+        cli_print_entry_lists_status(modulo);
+        printf("\n");
+    }
 
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_tomorrow() {
@@ -230,21 +364,111 @@ void command_tomorrow() {
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
 
+    // the editor takes the lock itself as each entry is submitted
+    release_store_lock();
     entry_editor_start(modulo, c);
 
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+/*
+    modulo edit <n>
+    opens entry n of tomorrow's list (numbered as in the editor's summary) in the editor
+*/
+void command_edit(char *selection) {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, true);
+    check_init(modulo);
+
+    EntryList *tomorrow = modulo_get_tomorrow(modulo);
+    int live_count = entry_list_live_count(tomorrow);
+    int item_number = 0;
+    sscanf(selection, "%d", &item_number);
+    if (item_number < 1 || item_number > live_count) {
+        printf("You have %d entries for tomorrow.\n", live_count);
+        printf("Can't edit entry number: %s\n", selection);
+        exit(EXIT_FAILURE);
+    }
+    // entry numbers skip removed entries
+    int slot = -1;
+    for (int seen = 0; seen < item_number;) {
+        slot++;
+        if (!(entry_list_get_entry(tomorrow, slot)->flags & ENTRY_REMOVED)) {
+            seen++;
+        }
+    }
+    // the editor takes the lock itself as the entry is submitted
+    release_store_lock();
+    uint64_t id = entry_list_get_entry(tomorrow, slot)->id;
+    entry_editor_edit(modulo, c, entry_list_get_entry(tomorrow, slot), item_number);
+    // emptying the entry in the editor removes it
+    EntryRef ref = modulo_find_entry(modulo, id);
+    if (ref.entry_list == NULL || (entry_list_get_entry(ref.entry_list, ref.slot)->flags & ENTRY_REMOVED)) {
+        printf("Removed entry %" PRIu64 ".\n", id);
+    }
+
+    free_modulo(modulo);
+    free_context(c);
+}
+
+// the reader needs a terminal, piped output and empty lists are printed as usual
+void command_set_output_format(OutputFormat format) {
+    output_format = format;
+}
+
+bool structured_output() {
+    return output_format != OUTPUT_TEXT;
+}
+
+void command_set_intent(CommandIntent intent) {
+    command_intent = intent;
 }
 
-void command_today() {
+bool use_reader(bool reader, EntryList *entry_list) {
+    return reader
+        && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO)
+        && entry_list_live_count(entry_list) > 0;
+}
+
+void command_today(bool reader, char *tag) {
     OSContext *c = get_context();
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
 
-    cli_print_today_entries(modulo);  
+    EntryList *today = modulo_get_today(modulo);
+    if (tag != NULL) {
+        print_today_tagged(c, modulo, tag);
+    } else if (structured_output()) {
+        // records are read by scripts, not the user: entries stay unread for carry over
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_entry_list(writer, RECORD_LIST_TODAY, 0, today, true);
+        free_writer(writer);
+    } else {
+        bool same_day = true;
+        if (use_reader(reader, today)) {
+            time_t day_ptr = modulo_get_day_ptr(modulo);
+            release_store_lock();
+            entry_reader_start(today, "Reviewing today's entries");
+            free_modulo(modulo);
+            modulo = load_synced_modulo(c, true);
+            check_init(modulo);
+            today = modulo_get_today(modulo);
+            // a wakeup while the reader was open, the list that was read is in history now
+            same_day = modulo_get_day_ptr(modulo) == day_ptr;
+        } else {
+            cli_print_today_entries(modulo);
+        }
+
+        // entries shown here no longer count as unread for carry over
+        bool had_receipt = entry_list_get_read_receipt(today);
+        if (same_day && (entry_list_mark_read(today) > 0 || !had_receipt)) {
+            save_modulo_or_exit(modulo, c);
+        }
+    }
 
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 /* 
@@ -256,31 +480,37 @@ void command_wakeup() {
     Modulo *modulo = load_synced_modulo(c, false);
     check_init(modulo);
 
-    // times quoted in seconds from day_ptr
-    offset_t now = utc_to_offset(modulo, utc_now());
-    offset_t wakeup_earliest = time_to_offset(modulo, modulo->wakeup_earliest);
-
-    // hours until wakeup earliest
-    int minutes_until_next_wakeup = (wakeup_earliest - now) / 60;
-    if (minutes_until_next_wakeup <= 0) {
-        wakeup_success(modulo);
-    } else if (minutes_until_next_wakeup <= 2*60) {
+    int minutes_until_next_wakeup = minutes_until_wakeup(modulo);
+    bool wakeup = minutes_until_next_wakeup <= 0;
+    if (!wakeup && minutes_until_next_wakeup <= 2*60) {
         printf_time("The current time %s is pretty early for your usual wakeup range:\n", utc_to_time(time(NULL)));
         printf_time("%s - ", modulo->wakeup_earliest);
         printf_time("%s\n\n", modulo->wakeup_latest);
         printf("Are you sure you want to wakeup?\n\n");
+        release_store_lock();
         bool is_yes = cli_prompt_yes_or_no();
-        if (is_yes) {
-            wakeup_success(modulo);
-        } else {
-            wakeup_failure(modulo);
-        }
+        // decide again on the store as it is now, another wakeup may have started the day meanwhile
+        free_modulo(modulo);
+        modulo = load_synced_modulo(c, false);
+        check_init(modulo);
+        minutes_until_next_wakeup = minutes_until_wakeup(modulo);
+        wakeup = minutes_until_next_wakeup <= 0 || (is_yes && minutes_until_next_wakeup <= 2*60);
+    }
+    if (wakeup) {
+        wakeup_success(modulo);
     } else {
         wakeup_failure(modulo);
     }
     save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+// times quoted in seconds from day_ptr
+int minutes_until_wakeup(Modulo *modulo) {
+    offset_t now = utc_to_offset(modulo, utc_now());
+    offset_t wakeup_earliest = time_to_offset(modulo, modulo->wakeup_earliest);
+    return (wakeup_earliest - now) / 60;
 }
 
 void wakeup_success(Modulo *modulo) {
@@ -292,15 +522,141 @@ void wakeup_failure(Modulo *modulo) {
     cli_print_wakeup_failure(modulo);
 }
 
-void command_peek() {
+// a look at what's been written for tomorrow so far, nothing is marked read
+void command_peek(bool reader) {
     OSContext *c = get_context();
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
-    free(modulo);
-    free(c);
+
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_entry_list(writer, RECORD_LIST_TOMORROW, 0, modulo_get_tomorrow(modulo), true);
+        free_writer(writer);
+    } else if (use_reader(reader, modulo_get_tomorrow(modulo))) {
+        entry_reader_start(modulo_get_tomorrow(modulo), "Peeking at tomorrow's entries");
+    } else {
+        cli_print_tomorrow_entries(modulo);
+    }
+
+    free_modulo(modulo);
+    free_context(c);
 }
 
-void command_history(char *selection) {
+/*
+    Adds an entry without opening the editor
+    delivered tomorrow by default, or on a later day with --in or --on
+*/
+void command_add(char *entry, char *delivery_offset, char *delivery_date) {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, false);
+    check_init(modulo);
+
+    day_t today = modulo_get_day(modulo);
+    day_t delivery_day = today + 1;
+    if (delivery_offset != NULL) {
+        int days = parse_day_offset(delivery_offset);
+        if (days < 1) {
+            fprintf(stderr, "Error parsing delivery offset: %s\n", delivery_offset);
+            fprintf(stderr, "Use a positive number of days or weeks, e.g. `--in 7d` or `--in 2w`\n");
+            exit(EXIT_FAILURE);
+        }
+        delivery_day = today + days;
+    } else if (delivery_date != NULL) {
+        delivery_day = parse_date(delivery_date);
+        if (delivery_day == -1) {
+            fprintf(stderr, "Error parsing delivery date: %s\n", delivery_date);
+            fprintf(stderr, "Dates must use the YYYY-MM-DD format, e.g. `--on 2024-03-01`\n");
+            exit(EXIT_FAILURE);
+        }
+        if (delivery_day <= today) {
+            fprintf(stderr, "Error: delivery date %s must be after today\n", delivery_date);
+            exit(EXIT_FAILURE);
+        }
+    }
+    char *entry_copy = mem_alloc(MEM_ENTRY_LIST, strlen(entry) + 1);
+    strcpy(entry_copy, entry);
+    modulo_schedule(modulo, entry_copy, delivery_day);
+
+    char date_string[FORMAT_TIME_BUF_SIZE];
+    time_t delivery_utc = day_to_utc(delivery_day, modulo_get_wakeup_latest(modulo));
+    printf("Entry scheduled for delivery %s.\n", utc_to_string(date_string, sizeof date_string, delivery_utc, true));
+
+    save_modulo_or_exit(modulo, c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_recur_list() {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, true);
+    check_init(modulo);
+
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_recurring(writer, modulo);
+        free_writer(writer);
+    } else {
+        cli_print_recurring(modulo);
+    }
+
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_recur_add(char *rule_str, char *param_str, char *entry) {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, false);
+    check_init(modulo);
+
+    RecurrenceRule rule = parse_recurrence_rule(rule_str);
+    int param = 0;
+    if (rule == RECUR_WEEKLY && (param = parse_weekday(param_str)) == -1) {
+        fprintf(stderr, "Error parsing weekday: %s\n", param_str);
+        fprintf(stderr, "Use a day of the week like monday or mon\n");
+        exit(EXIT_FAILURE);
+    }
+    if (rule == RECUR_MONTHLY && (sscanf(param_str, "%d", &param) != 1 || !recurrence_param_valid(rule, param))) {
+        fprintf(stderr, "Error parsing day of the month: %s\n", param_str);
+        fprintf(stderr, "Use a number in the range 1-31 (short months deliver on their last day)\n");
+        exit(EXIT_FAILURE);
+    }
+    char *entry_copy = mem_alloc(MEM_ENTRY_LIST, strlen(entry) + 1);
+    strcpy(entry_copy, entry);
+    modulo_add_recurring(modulo, entry_copy, rule, param);
+
+    printf("Added %s recurring entry.\n", rule_str);
+    cli_print_recurring(modulo);
+
+    save_modulo_or_exit(modulo, c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_recur_remove(char *selection) {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, false);
+    check_init(modulo);
+
+    RecurrenceHeap *recurring = modulo_get_recurring(modulo);
+    int item_number = 0;
+    sscanf(selection, "%d", &item_number);
+    if (item_number < 1 || item_number > recurring->size) {
+        printf("You have %d recurring entries.\n", recurring->size);
+        printf("Can't remove item number: %s\n", selection);
+        exit(EXIT_FAILURE);
+    }
+    // item numbers follow the listing order (by next delivery day)
+    int *indices = recurrence_heap_sorted_indices(recurring);
+    modulo_remove_recurring(modulo, indices[item_number-1]);
+    mem_free(indices);
+
+    printf("Removed recurring entry %d.\n", item_number);
+    save_modulo_or_exit(modulo, c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_history(char *selection, bool reader, char *tag) {
     OSContext *c = get_context();
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
@@ -311,19 +667,91 @@ void command_history(char *selection) {
 
     HistoryQueue *history = &modulo->history;
     uint8_t size = history->size;
-    if (size == 0) {
+    if (structured_output()) {
+        // an empty or out of range selection writes no records
+        Writer *writer = create_writer(stdout, output_format);
+        if (item_number >= 1 && item_number <= size && tag != NULL) {
+            TagIndex *index = load_synced_tag_index(c, modulo);
+            EntryList *entry_list = history_queue_get(history, item_number-1);
+            int count;
+            int *slots = tag_index_select(index, modulo, tag, entry_list, &count);
+            records_write_entries(writer, RECORD_LIST_HISTORY, item_number, entry_list, slots, count);
+            mem_free(slots);
+            close_tag_index(index, c);
+        } else if (item_number >= 1 && item_number <= size) {
+            records_write_entry_list(writer, RECORD_LIST_HISTORY, item_number, history_queue_get(history, item_number-1), true);
+        } else {
+            fprintf(stderr, "Can't get history item number: %d (%d items saved)\n", item_number, size);
+        }
+        free_writer(writer);
+    } else if (size == 0) {
         printf("Your history queue is empty!\n", size);
         printf("Come back after you've used modulo a bit longer!\n");
     } else if (item_number > size || item_number < 1) {
         printf("You have %d old entry lists saved to your history queue.\n", size);
         printf("Can't get item number: %d\n", item_number);
+    } else if (tag != NULL) {
+        TagIndex *index = load_synced_tag_index(c, modulo);
+        EntryList *entry_list = history_queue_get(history, item_number-1);
+        int count;
+        int *slots = tag_index_select(index, modulo, tag, entry_list, &count);
+        if (count == 0) {
+            printf("No entries tagged %s in history queue item %d.\n", tag, item_number);
+        } else {
+            cli_print_tagged_history_item(entry_list, item_number, slots, count);
+        }
+        mem_free(slots);
+        close_tag_index(index, c);
     } else {
         int index = item_number-1;
-        cli_print_history_item(history, index);
+        EntryList *entry_list = history_queue_get(history, index);
+        if (use_reader(reader, entry_list)) {
+            char title[HEADER_MAX_LINE_LENGTH];
+            snprintf(title, sizeof title, "Reviewing history queue item %d", item_number);
+            entry_reader_start(entry_list, title);
+        } else {
+            cli_print_history_item(history, index);
+        }
+    }
+
+    free_modulo(modulo);
+    free_context(c);
+}
+
+/*
+    The entries tagged tag in every history queue item
+    found through the tag index, no entry text is searched
+*/
+void command_history_tagged(char *tag) {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, true);
+    check_init(modulo);
+
+    TagIndex *index = load_synced_tag_index(c, modulo);
+    HistoryQueue *history = modulo_get_history(modulo);
+    Writer *writer = structured_output() ? create_writer(stdout, output_format) : NULL;
+    int total = 0;
+    for (int i = 0; i < history->size; i++) {
+        EntryList *entry_list = history_queue_get(history, i);
+        int count;
+        int *slots = tag_index_select(index, modulo, tag, entry_list, &count);
+        if (writer != NULL) {
+            records_write_entries(writer, RECORD_LIST_HISTORY, i+1, entry_list, slots, count);
+        } else if (count > 0) {
+            cli_print_tagged_history_item(entry_list, i+1, slots, count);
+        }
+        total += count;
+        mem_free(slots);
+    }
+    if (writer != NULL) {
+        free_writer(writer);
+    } else if (total == 0) {
+        printf("No entries tagged %s in your history queue.\n", tag);
     }
 
-    free(modulo);
-    free(c);
+    close_tag_index(index, c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
 void command_history_status() {
@@ -331,19 +759,214 @@ void command_history_status() {
     Modulo *modulo = load_synced_modulo(c, true);
     check_init(modulo);
 
-    cli_print_history_status(&modulo->history);
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_history(writer, &modulo->history, false);
+        free_writer(writer);
+    } else {
+        cli_print_history_status(&modulo->history);
+    }
 
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
 }
 
-void command_remove(char *entry_number) {
+void command_history_all() {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, true);
+    check_init(modulo);
+
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_history(writer, &modulo->history, true);
+        free_writer(writer);
+    } else {
+        cli_print_history_all(&modulo->history);
+    }
+
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_export() {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, true);
+    check_init(modulo);
+
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_export(writer, modulo);
+        free_writer(writer);
+    } else {
+        cli_print_export(modulo);
+    }
+
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_stats(char *days) {
+    int day_count = STATS_REPORT_DAYS;
+    if (days != NULL && (day_count = parse_positive_int(days)) == 0) {
+        fprintf(stderr, "Error: stats expects a positive number of days, got %s\n", days);
+        exit(EXIT_FAILURE);
+    }
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, true);
+    check_init(modulo);
+
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_stats(writer, modulo_get_stats(modulo), modulo_get_day(modulo), day_count);
+        free_writer(writer);
+    } else {
+        cli_print_stats(modulo_get_stats(modulo), modulo_get_day(modulo), day_count);
+    }
+
+    free_modulo(modulo);
+    free_context(c);
+}
+
+/*
+    Streams changes to the store until interrupted
+    Always ndjson, a --json array would never be closed
+*/
+void command_watch() {
+    OSContext *c = get_context();
+    // not synced: the watch reports the store as it is on disk
+    Modulo *modulo = load_modulo(c);
+    check_init(modulo);
+
+    Writer *writer = create_writer(stdout, OUTPUT_NDJSON);
+    int status = watch_store(c, modulo, writer);
+    free_writer(writer);
+    free_context(c);
+    if (status == -1) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+    Marks an entry as done
+    done entries are not carried over with the unfinished policy
+*/
+void command_done(char *entry_id) {
     OSContext *c = get_context();
     Modulo *modulo = load_synced_modulo(c, false);
     check_init(modulo);
+
+    uint64_t id = parse_entry_id(entry_id);
+    EntryRef ref = modulo_find_entry(modulo, id);
+    if (ref.entry_list == NULL) {
+        fprintf(stderr, "Error: no entry with id %s\n", entry_id);
+        fprintf(stderr, "Entry ids are listed by `modulo today`\n");
+        exit(EXIT_FAILURE);
+    }
+    Entry *entry = entry_list_get_entry(ref.entry_list, ref.slot);
+    entry_list_set_flags(ref.entry_list, ref.slot, entry->flags | ENTRY_DONE);
+
+    printf("Marked entry %" PRIu64 " as done.\n", id);
     save_modulo_or_exit(modulo, c);
-    free(modulo);
-    free(c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+void command_remove(char *entry_id) {
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, false);
+    check_init(modulo);
+
+    uint64_t id = parse_entry_id(entry_id);
+    if (modulo_remove_entry(modulo, id) == -1) {
+        fprintf(stderr, "Error: no entry with id %s\n", entry_id);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Removed entry %" PRIu64 ".\n", id);
+    save_modulo_or_exit(modulo, c);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+/*
+    modulo debug replay <script> [--size <rows>x<cols>] [--repeat <n>]
+    plays the script through a headless editor on the synced store without saving
+*/
+void command_debug_replay(char *script_path, char *size, char *repeat) {
+    int rows = REPLAY_DEFAULT_ROWS;
+    int cols = REPLAY_DEFAULT_COLS;
+    if (size != NULL) {
+        char *x = strchr(size, 'x');
+        if (x == NULL) {
+            fprintf(stderr, "Error: --size expects <rows>x<cols>, e.g. 24x80\n");
+            exit(EXIT_FAILURE);
+        }
+        *x = '\0';
+        rows = parse_positive_int(size);
+        cols = parse_positive_int(x + 1);
+        if (rows == 0 || cols == 0) {
+            fprintf(stderr, "Error: --size expects <rows>x<cols>, e.g. 24x80\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    int repeat_count = repeat != NULL ? parse_positive_int(repeat) : 1;
+    if (repeat_count == 0) {
+        fprintf(stderr, "Error: --repeat expects a positive integer\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t script_size;
+    char *script = read_text_data(script_path, &script_size);
+    if (script == NULL) {
+        fprintf(stderr, "Error: can't read replay script %s\n", script_path);
+        exit(EXIT_FAILURE);
+    }
+    int key_count;
+    KeyInput *keys = replay_parse_script(script, &key_count);
+    mem_free(script);
+    if (keys == NULL) {
+        exit(EXIT_FAILURE);
+    }
+
+    OSContext *c = get_context();
+    Modulo *modulo = load_synced_modulo(c, false);
+    check_init(modulo);
+
+    ReplayStats stats;
+    if (entry_editor_replay(modulo, keys, key_count, repeat_count, rows, cols, &stats) == -1) {
+        fprintf(stderr, "Error: failed to set up a headless terminal (%s)\n", REPLAY_TERM);
+        exit(EXIT_FAILURE);
+    }
+    replay_print_stats(&stats);
+
+    mem_free(keys);
+    free_modulo(modulo);
+    free_context(c);
+}
+
+// returns 0 (never a valid id) if entry_id isn't a positive integer
+uint64_t parse_entry_id(char *entry_id) {
+    char *end;
+    if (entry_id[0] < '0' || entry_id[0] > '9') {
+        return 0;
+    }
+    unsigned long long id = strtoull(entry_id, &end, 10);
+    if (*end != '\0') {
+        return 0;
+    }
+    return (uint64_t) id;
+}
+
+// returns 0 if string isn't a positive int
+int parse_positive_int(char *string) {
+    char *end;
+    if (string[0] < '0' || string[0] > '9') {
+        return 0;
+    }
+    long value = strtol(string, &end, 10);
+    if (*end != '\0' || value > INT_MAX) {
+        return 0;
+    }
+    return (int) value;
 }
 
 /*
@@ -369,11 +992,23 @@ void command_remove(char *entry_number) {
     Finally the modulo struct is returned to the calling function
 */
 Modulo *load_synced_modulo(OSContext *c, bool write_updates_to_disk) {
+    if (command_intent == INTENT_READ) {
+        // saves are atomic renames, a read never sees a partial store and doesn't need the lock
+        write_updates_to_disk = false;
+    } else if (store_lock == -1) {
+        store_lock = lock_modulo(c, print_lock_wait);
+        if (store_lock == -2) {
+            fprintf(stderr, "Failed to lock %s: %s\n", c->lock_filepath, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
     Modulo *modulo = load_modulo(c);
     if (modulo == NULL) {
         return NULL;
     } 
+    trace_ns_t span = trace_begin();
     bool sync_occurred = modulo_check_sync(modulo);
+    trace_end("check_sync", span);
     if (!sync_occurred) {
         // Modulo exists and is already synced (disk is already up to date)
         write_updates_to_disk = false;
@@ -387,6 +1022,54 @@ Modulo *load_synced_modulo(OSContext *c, bool write_updates_to_disk) {
     return modulo;
 }
 
+/*
+    today's entries tagged tag, found through the tag index
+    only the entries shown are marked read, the list's read receipt is left alone
+*/
+void print_today_tagged(OSContext *c, Modulo *modulo, char *tag) {
+    TagIndex *index = load_synced_tag_index(c, modulo);
+    EntryList *today = modulo_get_today(modulo);
+    int count;
+    int *slots = tag_index_select(index, modulo, tag, today, &count);
+    if (structured_output()) {
+        Writer *writer = create_writer(stdout, output_format);
+        records_write_entries(writer, RECORD_LIST_TODAY, 0, today, slots, count);
+        free_writer(writer);
+    } else {
+        cli_print_tagged_today(today, tag, slots, count);
+        bool newly_read = false;
+        for (int i = 0; i < count; i++) {
+            Entry *entry = entry_list_get_entry(today, slots[i]);
+            if (!(entry->flags & ENTRY_READ)) {
+                entry_list_set_flags(today, slots[i], entry->flags | ENTRY_READ);
+                newly_read = true;
+            }
+        }
+        if (newly_read) {
+            save_modulo_or_exit(modulo, c);
+        }
+    }
+    mem_free(slots);
+    close_tag_index(index, c);
+}
+
+void print_lock_wait(OSContext *c) {
+    fprintf(stderr, "Waiting for another modulo command to finish...\n");
+}
+
+void release_store_lock() {
+    unlock_modulo(store_lock);
+    store_lock = -1;
+}
+
+// a failed write only costs a resync next time
+void close_tag_index(TagIndex *index, OSContext *c) {
+    if (index->dirty) {
+        save_tag_index(index, c);
+    }
+    free_tag_index(index);
+}
+
 /*
     Helper function to check if modulo is initialized 
     If not, prompt user to run `modulo init` and exit
@@ -407,5 +1090,6 @@ void save_modulo_or_exit(Modulo *modulo, OSContext *c) {
     if (save_modulo(modulo, c) == -1) {
         char *filepath = c->modulo_json_filepath;
         fprintf(stderr, "Failure to save modulo data to %s\n", filepath);
+        exit(EXIT_FAILURE);
     }
 }
@@ -1,6 +1,10 @@
 #ifndef COMMAND_H
 #define COMMAND_H
 
+#include <stdbool.h>
+
+#include "writer.h"
+
 #define WAKEUP_BOUNDARY_EARLIEST "earliest"
 #define WAKEUP_BOUNDARY_LATEST "latest"
 
@@ -9,31 +13,72 @@ typedef enum {
     PREFERENCE_USERNAME,
     PREFERENCE_WAKEUP_EARLIEST,
     PREFERENCE_WAKEUP_LATEST,
-    PREFERENCE_ENTRY_DELIMITER
+    PREFERENCE_ENTRY_DELIMITER,
+    PREFERENCE_CARRY_OVER
 } Selection;
 
 void command_root();
 
+/*
+    What a command does with the store, from the router's command table.
+    INTENT_READ commands load without the lock and never save (the next write
+    persists any sync they computed), INTENT_WRITE commands hold the store
+    lock (see lock_modulo) from load until they exit. Those that wait on the
+    user (prompts, the reader, the editor) let go of it while they wait and
+    reload under the lock to apply what the user did
+*/
+typedef enum CommandIntent {
+    INTENT_READ,
+    INTENT_WRITE
+} CommandIntent;
+
+// set by the router from --json / --ndjson before the command runs
+void command_set_output_format(OutputFormat format);
+// set by the router before the command runs, INTENT_WRITE by default
+void command_set_intent(CommandIntent intent);
+
+void command_init();
+void command_status();
+
 void command_set_preferences();
 void command_set_username(char *username);
 void command_set_wakeup_earliest(char *wakeup);
 void command_set_wakeup_latest(char *wakeup);
 void command_set_entry_delimiter(char *entry_delimiter);
+void command_set_carry_over(char *carry_over);
 
 void command_get_preferences();
 void command_get_username();
 void command_get_wakeup_earliest();
 void command_get_wakeup_latest();
 void command_get_entry_delimiter();
+void command_get_carry_over();
 
 void command_tomorrow();
-void command_today();
-void command_peek();
+void command_edit(char *entry_number);
+// reader opens the entries in the interactive reader instead of printing them
+void command_today(bool reader, char *tag);
+void command_peek(bool reader);
 void command_wakeup();
-void command_remove(char *entry_number);
+void command_remove(char *entry_id);
+void command_done(char *entry_id);
+void command_add(char *entry, char *delivery_offset, char *delivery_date);
+
+void command_recur_list();
+void command_recur_add(char *rule, char *param, char *entry);
+void command_recur_remove(char *item_number);
 
-void command_history(char *item_number);
+void command_history(char *item_number, bool reader, char *tag);
+void command_history_tagged(char *tag);
 void command_history_status();
+void command_history_all();
+
+void command_export();
+void command_watch();
+// days is the number of days to show, NULL for the last STATS_REPORT_DAYS
+void command_stats(char *days);
+
+void command_debug_replay(char *script_path, char *size, char *repeat);
 
 
 #endif
\ No newline at end of file
@@ -6,28 +6,40 @@
 #include "command_router.h"
 #include "json.h"
 #include "command.h"
+#include "completion.h"
+#include "recurring.h"
+#include "mem.h"
 
 
-static void route_set(int argc, char **argv);
-static void route_set_preferences(int argc, char **argv);
-static void route_set_preference(int argc, char **argv);
-
-static void route_get(int argc, char **argv);
-static void route_get_preferences(int argc, char **argv);
-static void route_get_preference(int argc, char **argv);
-
-static void route_status(int argc, char **argv);
-
-static void route_tomorrow(int argc, char **argv);
 static void route_today(int argc, char **argv);
 static void route_peek(int argc, char **argv);
-static void route_wakeup(int argc, char **argv);
-static void route_remove(int argc, char **argv);
+static void route_add(int argc, char **argv);
+static void route_recur_daily(int argc, char **argv);
+static void route_recur_on(int argc, char **argv);
 
 static void route_history(int argc, char **argv);
+static void route_stats(int argc, char **argv);
+
+static void route_help();
+static void route_completion(char *shell);
+
+static void route_debug_mem(int argc, char **argv);
+static void route_debug_replay(int argc, char **argv);
+static void route_debug_hash();
+
+static Route *find_route(int argc, char **argv, int *sub_cmds);
+static Route *lookup_route(char *name);
+static bool index_routes(uint32_t seed);
+static bool is_route_group(char *word);
+static void print_route_group(char *group);
 
 static void check_argc(int argc, char **argv, int sub_cmds, int args);
+static bool take_flag(int *argc, char **argv, char *flag, char *short_flag);
+static char *take_option(int *argc, char **argv, char *option);
+static void check_reader_tag(bool reader, char *tag);
+static void route_output_format(int *argc, char **argv);
 static void unknown_sub_command(char **argv, char *sub_cmd, int parent_cmds);
+static void print_cmd_stderr(char **argv, int sub_cmds);
 
 /*
     Lesson: separation of concerns
@@ -39,181 +51,296 @@ static void unknown_sub_command(char **argv, char *sub_cmd, int parent_cmds);
 
 */
 
+#define READ_FLAGS OPTION_JSON " " OPTION_NDJSON
+
+static Route routes[] = {
+    { COMMAND_INIT, INTENT_WRITE, command_init, NULL, NULL, "", "", "Configure modulo for your schedule" },
+    { COMMAND_STATUS, INTENT_READ, command_status, NULL, NULL, "", READ_FLAGS, "Show the time, your wakeup range and entry counts" },
+    { COMMAND_TOMORROW, INTENT_WRITE, command_tomorrow, NULL, NULL, "", "", "Write entries for tomorrow in the editor" },
+    { COMMAND_EDIT, INTENT_WRITE, NULL, command_edit, NULL, "<number>", "", "Reopen one of tomorrow's entries in the editor" },
+    { COMMAND_ADD, INTENT_WRITE, NULL, NULL, route_add, "<entry> [--in <N>d | --on <YYYY-MM-DD>]", OPTION_IN " " OPTION_ON, "Add an entry for tomorrow or a later day" },
+    { COMMAND_PEEK, INTENT_READ, NULL, NULL, route_peek, "[-r]", OPTION_READER_SHORT " " OPTION_READER " " READ_FLAGS, "Show what you've written for tomorrow so far" },
+    { COMMAND_WAKEUP, INTENT_WRITE, command_wakeup, NULL, NULL, "", "", "Start the next day" },
+    { COMMAND_TODAY, INTENT_WRITE, NULL, NULL, route_today, "[-r | --tag <tag>]", OPTION_READER_SHORT " " OPTION_READER " " OPTION_TAG " " READ_FLAGS, "Review today's entries" },
+    { COMMAND_DONE, INTENT_WRITE, NULL, command_done, NULL, "<id>", "", "Mark an entry as done" },
+    { COMMAND_REMOVE, INTENT_WRITE, NULL, command_remove, NULL, "<id>", "", "Remove an entry" },
+    { COMMAND_RECUR, INTENT_READ, command_recur_list, NULL, NULL, "", READ_FLAGS, "List recurring entries" },
+    { COMMAND_RECUR " " RECURRENCE_DAILY, INTENT_WRITE, NULL, NULL, route_recur_daily, "<entry>", "", "Add an entry delivered every day" },
+    { COMMAND_RECUR " " RECURRENCE_WEEKLY, INTENT_WRITE, NULL, NULL, route_recur_on, "<weekday> <entry>", "", "Add an entry delivered every week" },
+    { COMMAND_RECUR " " RECURRENCE_MONTHLY, INTENT_WRITE, NULL, NULL, route_recur_on, "<day> <entry>", "", "Add an entry delivered every month" },
+    { COMMAND_RECUR " " COMMAND_REMOVE, INTENT_WRITE, NULL, command_recur_remove, NULL, "<number>", "", "Stop a recurring entry" },
+    { COMMAND_HISTORY, INTENT_READ, NULL, NULL, route_history, "[<n> [-r] | -a] [--tag <tag>]", OPTION_ALL_SHORT " " OPTION_ALL " " OPTION_READER_SHORT " " OPTION_READER " " OPTION_TAG " " READ_FLAGS, "Review the history queue" },
+    { COMMAND_EXPORT, INTENT_READ, command_export, NULL, NULL, "", READ_FLAGS, "Print every entry list" },
+    { COMMAND_STATS, INTENT_READ, NULL, NULL, route_stats, "[<days>]", READ_FLAGS, "Show how much you write and read, and your streak" },
+    { COMMAND_WATCH, INTENT_READ, command_watch, NULL, NULL, "", "", "Stream changes to your entries as ndjson" },
+    { COMMAND_SET " " COMMAND_PREFERENCES, INTENT_WRITE, command_set_preferences, NULL, NULL, "", "", "Update your preferences interactively" },
+    { COMMAND_SET " " COMMAND_USERNAME, INTENT_WRITE, NULL, command_set_username, NULL, "<username>", "", "Set your username" },
+    { COMMAND_SET " " COMMAND_WAKEUP_EARLIEST, INTENT_WRITE, NULL, command_set_wakeup_earliest, NULL, "<time>", "", "Set the earliest you wake up" },
+    { COMMAND_SET " " COMMAND_WAKEUP_LATEST, INTENT_WRITE, NULL, command_set_wakeup_latest, NULL, "<time>", "", "Set the latest you wake up" },
+    { COMMAND_SET " " COMMAND_ENTRY_DELIMITER, INTENT_WRITE, NULL, command_set_entry_delimiter, NULL, "<delimiter>", "", "Set the editor's entry delimiter" },
+    { COMMAND_SET " " COMMAND_CARRY_OVER, INTENT_WRITE, NULL, command_set_carry_over, NULL, "<none|unread|unfinished>", "", "Set which entries carry over" },
+    { COMMAND_GET " " COMMAND_PREFERENCES, INTENT_READ, command_get_preferences, NULL, NULL, "", READ_FLAGS, "Show your preferences" },
+    { COMMAND_GET " " COMMAND_USERNAME, INTENT_READ, command_get_username, NULL, NULL, "", READ_FLAGS, "Show your username" },
+    { COMMAND_GET " " COMMAND_WAKEUP_EARLIEST, INTENT_READ, command_get_wakeup_earliest, NULL, NULL, "", READ_FLAGS, "Show the earliest you wake up" },
+    { COMMAND_GET " " COMMAND_WAKEUP_LATEST, INTENT_READ, command_get_wakeup_latest, NULL, NULL, "", READ_FLAGS, "Show the latest you wake up" },
+    { COMMAND_GET " " COMMAND_ENTRY_DELIMITER, INTENT_READ, command_get_entry_delimiter, NULL, NULL, "", READ_FLAGS, "Show the editor's entry delimiter" },
+    { COMMAND_GET " " COMMAND_CARRY_OVER, INTENT_READ, command_get_carry_over, NULL, NULL, "", READ_FLAGS, "Show which entries carry over" },
+    { COMMAND_HELP, INTENT_READ, route_help, NULL, NULL, "", "", "List every command" },
+    { COMMAND_COMPLETION, INTENT_READ, NULL, route_completion, NULL, "<bash|zsh|fish>", "", "Print a shell completion script" },
+    { COMMAND_DEBUG " " COMMAND_MEM, INTENT_READ, NULL, NULL, route_debug_mem, "<command>", "", "Run a command and report its memory use" },
+    { COMMAND_DEBUG " " COMMAND_REPLAY, INTENT_READ, NULL, NULL, route_debug_replay, "<script> [--size <rows>x<cols>] [--repeat <n>]", OPTION_SIZE " " OPTION_REPEAT, "Time the editor on a keystroke script" },
+    { COMMAND_DEBUG " " COMMAND_HASH, INTENT_READ, route_debug_hash, NULL, NULL, "", "", "Check the command table's hash" },
+};
+
+#define ROUTE_COUNT ((int)(sizeof routes / sizeof routes[0]))
+
+/* index into routes + 1 for every hash slot, 0 for empty slots */
+static uint8_t route_slots[ROUTE_HASH_SIZE];
+static bool routes_indexed = false;
+/* the table collided under ROUTE_HASH_SEED, lookups scan routes instead */
+static bool routes_collide = false;
+
 void command_router(int argc, char **argv) {
     if (argc == 1) {
         command_root();
-        return 0;
-    }
-    char *sub_cmd = argv[1];
-    if (strcmp(sub_cmd, COMMAND_INIT) == 0) {
-        route_init(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_SET) == 0) {
-        route_set(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_GET) == 0) {
-        route_get(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_STATUS) == 0) {
-        route_status(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_TOMORROW) == 0) {
-        route_tomorrow(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_TODAY) == 0) {
-        route_today(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_WAKEUP) == 0) {
-        route_wakeup(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_PEEK) == 0) {
-        route_peek(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_REMOVE) == 0) {
-        route_remove(argc, argv);
-    } else if (strcmp(sub_cmd, COMMAND_HISTORY) == 0) {
-        route_history(argc, argv);
+        return;
+    }
+    route_output_format(&argc, argv);
+    int sub_cmds;
+    Route *route = find_route(argc, argv, &sub_cmds);
+    command_set_intent(route->intent);
+    if (route->run != NULL) {
+        check_argc(argc, argv, sub_cmds, 0);
+        route->run();
+    } else if (route->run_arg != NULL) {
+        check_argc(argc, argv, sub_cmds, 1);
+        route->run_arg(argv[1 + sub_cmds]);
     } else {
-        int parent_cmds = 0;
-        unknown_sub_command(argv, sub_cmd, parent_cmds);
+        route->route(argc, argv);
     }
 }
 
-void route_init(int argc, char **argv) {
-    int sub_cmds = 1;
-    int args = 0;
-    check_argc(argc, argv, sub_cmds, args);
-    command_init();
+Route *command_routes(int *count) {
+    *count = ROUTE_COUNT;
+    return routes;
 }
 
-void route_set(int argc, char **argv) {
-    if (argc < 3) {
-        fprintf(stderr, "modulo set requires a subcommand.\n");
-        fprintf(stderr, "Try `modulo set preferences` to set all preferences`.\n");
+/*
+    the route named by the first two words of argv, or else the first.
+    Unknown commands exit with an error
+*/
+Route *find_route(int argc, char **argv, int *sub_cmds) {
+    if (argc >= 3 && strlen(argv[1]) + strlen(argv[2]) + 2 <= ROUTE_NAME_MAX) {
+        char name[ROUTE_NAME_MAX];
+        snprintf(name, sizeof name, "%s %s", argv[1], argv[2]);
+        Route *route = lookup_route(name);
+        if (route != NULL) {
+            *sub_cmds = 2;
+            return route;
+        }
+    }
+    Route *route = lookup_route(argv[1]);
+    bool group = is_route_group(argv[1]);
+    // e.g. `modulo recur dayly`: a group's own command doesn't take arguments
+    if (route != NULL && !(group && argc >= 3 && route->run != NULL)) {
+        *sub_cmds = 1;
+        return route;
+    }
+    if (group && argc < 3) {
+        print_route_group(argv[1]);
         exit(1);
     }
-    char *sub_cmd = argv[2];
-    if (strcmp(sub_cmd, COMMAND_PREFERENCES) == 0) {
-        route_set_preferences(argc, argv);
-    } else {
-        route_set_preference(argc, argv);
+    if (group) {
+        int parent_cmds = 1;
+        unknown_sub_command(argv, argv[2], parent_cmds);
     }
+    int parent_cmds = 0;
+    unknown_sub_command(argv, argv[1], parent_cmds);
+    return NULL;
 }
 
-void route_set_preferences(int argc, char **argv) {
-    int sub_cmds = 2;
-    int args = 0;
-    check_argc(argc, argv, sub_cmds, args);
-    command_set_preferences();
+uint32_t route_hash(char *name, uint32_t seed) {
+    // FNV-1a
+    uint32_t hash = 2166136261u ^ seed;
+    for (unsigned char *c = (unsigned char *)name; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 16);
 }
 
-void route_set_preference(int argc, char **argv) {
-    char *sub_cmd = argv[2];
-    int sub_cmds = 2;
-    int args = 1;
-    if (strcmp(sub_cmd, COMMAND_USERNAME) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_set_username(argv[3]);
-    } else if (strcmp(sub_cmd, COMMAND_WAKEUP_EARLIEST) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_set_wakeup_earliest(argv[3]);
-    } else if (strcmp(sub_cmd, COMMAND_WAKEUP_LATEST) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_set_wakeup_latest(argv[3]);
-    } else if (strcmp(sub_cmd, COMMAND_ENTRY_DELIMITER) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_set_entry_delimiter(argv[3]);
-    } else {
-        int parent_cmds = 1;
-        unknown_sub_command(argv, sub_cmd, parent_cmds);
+/*
+    fills route_slots for seed. returns false (leaving the slots half filled) if two routes collide
+*/
+bool index_routes(uint32_t seed) {
+    memset(route_slots, 0, sizeof route_slots);
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        uint32_t slot = route_hash(routes[i].name, seed) & (ROUTE_HASH_SIZE - 1);
+        if (route_slots[slot] != 0) {
+            return false;
+        }
+        route_slots[slot] = i + 1;
     }
+    return true;
 }
 
-void route_get(int argc, char **argv) {
-    if (argc < 3) {
-        fprintf(stderr, "modulo get requires a subcommand.\n");
-        fprintf(stderr, "Try `modulo get preferences` to see your current preferences`.\n");
-        exit(1);
+Route *lookup_route(char *name) {
+    if (!routes_indexed) {
+        routes_collide = !index_routes(ROUTE_HASH_SEED);
+        routes_indexed = true;
     }
-    char *sub_cmd = argv[2];
-    if (strcmp(sub_cmd, COMMAND_PREFERENCES) == 0) {
-        route_get_preferences(argc, argv);
-    } else {
-        route_get_preference(argc, argv);
+    if (routes_collide) {
+        for (int i = 0; i < ROUTE_COUNT; i++) {
+            if (strcmp(routes[i].name, name) == 0) {
+                return &routes[i];
+            }
+        }
+        return NULL;
+    }
+    uint8_t index = route_slots[route_hash(name, ROUTE_HASH_SEED) & (ROUTE_HASH_SIZE - 1)];
+    if (index == 0 || strcmp(routes[index - 1].name, name) != 0) {
+        return NULL;
     }
+    return &routes[index - 1];
 }
 
-void route_get_preferences(int argc, char **argv) {
-    int sub_cmds = 2;
-    int args = 0;
-    check_argc(argc, argv, sub_cmds, args);
-    command_set_preferences();
+// word has sub commands, e.g. "set"
+bool is_route_group(char *word) {
+    size_t length = strlen(word);
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        if (strncmp(routes[i].name, word, length) == 0 && routes[i].name[length] == ' ') {
+            return true;
+        }
+    }
+    return false;
 }
 
-void route_get_preference(int argc, char **argv) {
-    char *sub_cmd = argv[2];
-    int sub_cmds = 2;
-    int args = 0;
-    if (strcmp(sub_cmd, COMMAND_USERNAME) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_get_username();
-    } else if (strcmp(sub_cmd, COMMAND_WAKEUP_EARLIEST) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_get_wakeup_earliest();
-    } else if (strcmp(sub_cmd, COMMAND_WAKEUP_LATEST) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_get_wakeup_latest();
-    } else if (strcmp(sub_cmd, COMMAND_ENTRY_DELIMITER) == 0) {
-        check_argc(argc, argv, sub_cmds, args);
-        command_get_entry_delimiter();
-    } else {
-        int parent_cmds = 1;
-        unknown_sub_command(argv, sub_cmd, parent_cmds);
+void print_route_group(char *group) {
+    size_t length = strlen(group);
+    fprintf(stderr, "modulo %s requires a subcommand:\n", group);
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        Route *route = &routes[i];
+        if (strncmp(route->name, group, length) == 0 && route->name[length] == ' ') {
+            fprintf(stderr, "    modulo %s%s%s\n", route->name, route->usage[0] != '\0' ? " " : "", route->usage);
+        }
     }
 }
 
-void route_status(int argc, char **argv) {
-    int sub_cmds = 1;
-    int args = 0;
-    check_argc(argc, argv, sub_cmds, args);
-    command_status();
+void route_help() {
+    printf("usage: modulo <command> [arguments]\n\n");
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        Route *route = &routes[i];
+        char command[ROUTE_NAME_MAX + 64];
+        snprintf(command, sizeof command, "%s%s%s", route->name, route->usage[0] != '\0' ? " " : "", route->usage);
+        printf("    %-44s %s\n", command, route->help);
+    }
+    printf("\nRead commands (status, today, peek, history, export, recur, get) take %s or %s for machine readable output.\n", OPTION_JSON, OPTION_NDJSON);
 }
 
-void route_tomorrow(int argc, char **argv) {
-    int sub_cmds = 1;
-    int args = 0;
-    check_argc(argc, argv, sub_cmds, args);
-    command_tomorrow();
+void route_completion(char *shell) {
+    if (completion_print(shell, routes, ROUTE_COUNT) == -1) {
+        fprintf(stderr, "Error: no completions for shell \"%s\"\n", shell);
+        fprintf(stderr, "usage: modulo %s <bash|zsh|fish>\n", COMMAND_COMPLETION);
+        exit(1);
+    }
 }
 
+// modulo today [-r | --reader]
 void route_today(int argc, char **argv) {
+    bool reader = take_flag(&argc, argv, OPTION_READER, OPTION_READER_SHORT);
+    char *tag = take_option(&argc, argv, OPTION_TAG);
+    check_reader_tag(reader, tag);
     int sub_cmds = 1;
     int args = 0;
     check_argc(argc, argv, sub_cmds, args);
-    command_today();
+    command_today(reader, tag);
 }
 
-void route_wakeup(int argc, char **argv) {
+// modulo peek [-r | --reader]
+void route_peek(int argc, char **argv) {
+    bool reader = take_flag(&argc, argv, OPTION_READER, OPTION_READER_SHORT);
     int sub_cmds = 1;
     int args = 0;
     check_argc(argc, argv, sub_cmds, args);
-    command_wakeup();
+    command_peek(reader);
 }
 
-void route_peek(int argc, char **argv) {
-    int sub_cmds = 1;
-    int args = 0;
-    check_argc(argc, argv, sub_cmds, args);
-    command_peek();
+/*
+    modulo add <entry> [--in <N>d | --on <YYYY-MM-DD>]
+    options may appear before or after the entry
+*/
+void route_add(int argc, char **argv) {
+    char *entry = NULL;
+    char *delivery_offset = NULL;
+    char *delivery_date = NULL;
+    for (int i = 2; i < argc; i++) {
+        bool is_in = strcmp(argv[i], OPTION_IN) == 0;
+        bool is_on = strcmp(argv[i], OPTION_ON) == 0;
+        if ((is_in || is_on) && i+1 >= argc) {
+            fprintf(stderr, "Error: option %s requires a value\n", argv[i]);
+            exit(1);
+        }
+        if (is_in) {
+            delivery_offset = argv[++i];
+        } else if (is_on) {
+            delivery_date = argv[++i];
+        } else if (entry == NULL) {
+            entry = argv[i];
+        } else {
+            fprintf(stderr, "Error: too many positional arguments for command `modulo add`\n");
+            fprintf(stderr, "Use double-quotes to add a multi-word entry.\n");
+            exit(1);
+        }
+    }
+    if (entry == NULL) {
+        fprintf(stderr, "Error: not enough positional arguments for command `modulo add`\n");
+        fprintf(stderr, "usage: modulo add <entry> [--in <N>d | --on <YYYY-MM-DD>]\n");
+        exit(1);
+    }
+    if (delivery_offset != NULL && delivery_date != NULL) {
+        fprintf(stderr, "Error: `modulo add` accepts either %s or %s, not both\n", OPTION_IN, OPTION_ON);
+        exit(1);
+    }
+    command_add(entry, delivery_offset, delivery_date);
 }
 
-void route_remove(int argc, char **argv) {
-    int sub_cmds = 1;
-    int args = 1;
-    check_argc(argc, argv, sub_cmds, args);
-    char *entry_number = argv[2];
-    command_remove(entry_number);
+/*
+    modulo recur daily <entry>
+    modulo recur weekly <weekday> <entry>
+    modulo recur monthly <day> <entry>
+*/
+void route_recur_daily(int argc, char **argv) {
+    int sub_cmds = 2;
+    check_argc(argc, argv, sub_cmds, 1);
+    command_recur_add(argv[2], NULL, argv[3]);
+}
+
+void route_recur_on(int argc, char **argv) {
+    int sub_cmds = 2;
+    check_argc(argc, argv, sub_cmds, 2);
+    command_recur_add(argv[2], argv[3], argv[4]);
 }
 
+// modulo history [<n> [-r | --reader] | -a | --all]
 void route_history(int argc, char **argv) {
+    bool reader = take_flag(&argc, argv, OPTION_READER, OPTION_READER_SHORT);
+    bool all = take_flag(&argc, argv, OPTION_ALL, OPTION_ALL_SHORT);
+    char *tag = take_option(&argc, argv, OPTION_TAG);
+    check_reader_tag(reader, tag);
     int sub_cmds = 1;
-    if (argc >= 3) {
+    if (tag != NULL && (all || argc < 3)) {
+        int args = 0;
+        check_argc(argc, argv, sub_cmds, args);
+        command_history_tagged(tag);
+    } else if (all) {
+        int args = 0;
+        check_argc(argc, argv, sub_cmds, args);
+        command_history_all();
+    } else if (argc >= 3) {
         int args = 1;
         check_argc(argc, argv, sub_cmds, args);
         char *selection = argv[2];
-        command_history(selection);
+        command_history(selection, reader, tag);
     } else {
         int args = 0;
         check_argc(argc, argv, sub_cmds, args);
@@ -221,6 +348,99 @@ void route_history(int argc, char **argv) {
     }
 }
 
+// modulo stats [<days>]
+void route_stats(int argc, char **argv) {
+    int sub_cmds = 1;
+    if (argc >= 3) {
+        int args = 1;
+        check_argc(argc, argv, sub_cmds, args);
+        command_stats(argv[2]);
+    } else {
+        int args = 0;
+        check_argc(argc, argv, sub_cmds, args);
+        command_stats(NULL);
+    }
+}
+
+/*
+    modulo debug hash
+
+    prints the slot of every command under ROUTE_HASH_SEED.
+    If two commands collide, searches for a seed that separates them
+*/
+void route_debug_hash() {
+    printf("%d commands, %d slots, seed 0x%x\n", ROUTE_COUNT, ROUTE_HASH_SIZE, ROUTE_HASH_SEED);
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        uint32_t slot = route_hash(routes[i].name, ROUTE_HASH_SEED) & (ROUTE_HASH_SIZE - 1);
+        printf("%4u  %s\n", slot, routes[i].name);
+    }
+    if (index_routes(ROUTE_HASH_SEED)) {
+        printf("no collisions\n");
+        return;
+    }
+    printf("collisions, commands are looked up by scanning the table\n");
+    for (uint32_t seed = 1; seed < (1u << 24); seed++) {
+        if (index_routes(seed)) {
+            printf("set ROUTE_HASH_SEED to 0x%x in command_router.h\n", seed);
+            index_routes(ROUTE_HASH_SEED);
+            return;
+        }
+    }
+    printf("no collision free seed found, raise ROUTE_HASH_BITS\n");
+    index_routes(ROUTE_HASH_SEED);
+}
+
+/*
+    modulo debug mem <command...>
+
+    runs <command> as if it had been typed on its own and prints
+    the allocator report on stderr when the process exits
+*/
+void route_debug_mem(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Error: not enough positional arguments for command `modulo debug mem`\n");
+        fprintf(stderr, "usage: modulo debug mem <command>\n");
+        exit(1);
+    }
+    mem_report_at_exit();
+    // drop "debug mem" so argv[1] is the command to run
+    command_router(argc - 2, argv + 2);
+}
+
+/*
+    modulo debug replay <script> [--size <rows>x<cols>] [--repeat <n>]
+    options may appear before or after the script
+*/
+void route_debug_replay(int argc, char **argv) {
+    char *script_path = NULL;
+    char *size = NULL;
+    char *repeat = NULL;
+    for (int i = 3; i < argc; i++) {
+        bool is_size = strcmp(argv[i], OPTION_SIZE) == 0;
+        bool is_repeat = strcmp(argv[i], OPTION_REPEAT) == 0;
+        if ((is_size || is_repeat) && i+1 >= argc) {
+            fprintf(stderr, "Error: option %s requires a value\n", argv[i]);
+            exit(1);
+        }
+        if (is_size) {
+            size = argv[++i];
+        } else if (is_repeat) {
+            repeat = argv[++i];
+        } else if (script_path == NULL) {
+            script_path = argv[i];
+        } else {
+            fprintf(stderr, "Error: too many positional arguments for command `modulo debug replay`\n");
+            exit(1);
+        }
+    }
+    if (script_path == NULL) {
+        fprintf(stderr, "Error: not enough positional arguments for command `modulo debug replay`\n");
+        fprintf(stderr, "usage: modulo debug replay <script> [%s <rows>x<cols>] [%s <n>]\n", OPTION_SIZE, OPTION_REPEAT);
+        exit(1);
+    }
+    command_debug_replay(script_path, size, repeat);
+}
+
 void unknown_sub_command(char **argv, char *sub_cmd, int parent_cmds) {
     fprintf(stderr, "Error: unknown command \"%s\" for \"", sub_cmd);
     fprintf(stderr, "modulo");
@@ -258,6 +478,72 @@ void check_argc(int argc, char **argv, int sub_cmds, int expected_args) {
     }
 }
 
+/*
+    --json and --ndjson apply to any read command, so they're taken out
+    of argv before routing
+*/
+void route_output_format(int *argc, char **argv) {
+    bool json = take_flag(argc, argv, OPTION_JSON, NULL);
+    bool ndjson = take_flag(argc, argv, OPTION_NDJSON, NULL);
+    if (json && ndjson) {
+        fprintf(stderr, "Error: %s and %s can't be used together\n", OPTION_JSON, OPTION_NDJSON);
+        exit(1);
+    }
+    if (json) {
+        command_set_output_format(OUTPUT_JSON);
+    } else if (ndjson) {
+        command_set_output_format(OUTPUT_NDJSON);
+    }
+}
+
+/*
+    removes flag (or its short form, NULL if it has none) from argv wherever it appears
+    so the positional arguments can be checked as if it weren't there
+*/
+bool take_flag(int *argc, char **argv, char *flag, char *short_flag) {
+    bool found = false;
+    int kept = 0;
+    for (int i = 0; i < *argc; i++) {
+        if (i > 1 && (strcmp(argv[i], flag) == 0 || (short_flag != NULL && strcmp(argv[i], short_flag) == 0))) {
+            found = true;
+            continue;
+        }
+        argv[kept++] = argv[i];
+    }
+    *argc = kept;
+    return found;
+}
+
+/*
+    removes option and its value from argv, returning the value (NULL if option isn't given)
+    a repeated option keeps the last value
+*/
+char *take_option(int *argc, char **argv, char *option) {
+    char *value = NULL;
+    int kept = 0;
+    for (int i = 0; i < *argc; i++) {
+        if (i > 1 && strcmp(argv[i], option) == 0) {
+            if (i+1 >= *argc) {
+                fprintf(stderr, "Error: option %s requires a value\n", option);
+                exit(1);
+            }
+            value = argv[++i];
+            continue;
+        }
+        argv[kept++] = argv[i];
+    }
+    *argc = kept;
+    return value;
+}
+
+// the reader pages through a whole list, a tag filter prints
+void check_reader_tag(bool reader, char *tag) {
+    if (reader && tag != NULL) {
+        fprintf(stderr, "Error: %s can't be combined with %s\n", OPTION_TAG, OPTION_READER);
+        exit(1);
+    }
+}
+
 void print_cmd_stderr(char **argv, int sub_cmds) {
     fprintf(stderr, "`modulo");
     for (int i = 0; i < sub_cmds; i++) {
@@ -1,6 +1,10 @@
 #ifndef COMMAND_ROUTER_H
 #define COMMAND_ROUTER_H
 
+#include <stdint.h>
+
+#include "command.h"
+
 /* modulo command keywords */
 #define COMMAND_INIT "init"
 #define COMMAND_SET "set"
@@ -10,18 +14,87 @@
 #define COMMAND_WAKEUP_EARLIEST "wakeup_earliest"
 #define COMMAND_WAKEUP_LATEST "wakeup_latest"
 #define COMMAND_ENTRY_DELIMITER "entry_delimiter"
+#define COMMAND_CARRY_OVER "carry_over"
 
 #define COMMAND_STATUS "status"
 
 #define COMMAND_TOMORROW "tomorrow"
+#define COMMAND_EDIT "edit"
 #define COMMAND_PEEK "peek"
 #define COMMAND_WAKEUP "wakeup"
 #define COMMAND_TODAY "today"
 #define COMMAND_REMOVE "remove"
+#define COMMAND_DONE "done"
+#define COMMAND_ADD "add"
+#define COMMAND_RECUR "recur"
 
 #define COMMAND_HISTORY "history"
+#define COMMAND_EXPORT "export"
+#define COMMAND_WATCH "watch"
+#define COMMAND_STATS "stats"
+
+#define COMMAND_HELP "help"
+#define COMMAND_COMPLETION "completion"
+
+#define COMMAND_DEBUG "debug"
+#define COMMAND_MEM "mem"
+#define COMMAND_REPLAY "replay"
+#define COMMAND_HASH "hash"
+
+/* modulo command options */
+#define OPTION_IN "--in"
+#define OPTION_ON "--on"
+#define OPTION_SIZE "--size"
+#define OPTION_REPEAT "--repeat"
+#define OPTION_READER "--reader"
+#define OPTION_READER_SHORT "-r"
+#define OPTION_ALL "--all"
+#define OPTION_ALL_SHORT "-a"
+#define OPTION_TAG "--tag"
+#define OPTION_JSON "--json"
+#define OPTION_NDJSON "--ndjson"
+
+/*
+Route:
+One command of the table in command_router.c. name is the command's words
+("status", "set username"), exactly one of the handlers is set:
 
+    run      takes no positional arguments
+    run_arg  takes exactly one
+    route    gets the whole argv and checks it itself (options, flags, groups)
+
+Commands are found by hashing the name (the first two words of argv, then
+the first) into a slot table with no collisions for ROUTE_HASH_SEED, so a
+lookup is one hash and one strcmp. Adding a command is one line in the
+table; if it collides, `modulo debug hash` prints a seed that doesn't.
+
+The shell completions (`modulo completion bash|zsh|fish`) and `modulo help`
+are generated from the same table.
+*/
+
+typedef struct Route {
+    char *name;
+    CommandIntent intent;
+    void (*run)();
+    void (*run_arg)(char *arg);
+    void (*route)(int argc, char **argv);
+    /* arguments after the name, e.g. "<entry> [--in <N>d | --on <YYYY-MM-DD>]" */
+    char *usage;
+    /* options offered by the shell completions, space separated */
+    char *flags;
+    char *help;
+} Route;
+
+#define ROUTE_HASH_BITS 7
+#define ROUTE_HASH_SIZE (1 << ROUTE_HASH_BITS)
+#define ROUTE_HASH_SEED 0x46
+// longest name looked up, two words
+#define ROUTE_NAME_MAX 48
 
 void command_router(int argc, char **argv);
 
+// the command table, in help order
+Route *command_routes(int *count);
+uint32_t route_hash(char *name, uint32_t seed);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "completion.h"
+
+static void print_bash(Route *routes, int count);
+static void print_zsh(Route *routes, int count);
+static void print_fish(Route *routes, int count);
+
+static size_t first_word_length(char *name);
+static bool is_first_use(Route *routes, int index);
+static Route *find_command(Route *routes, int count, char *word, size_t length);
+static bool in_group(Route *route, char *word, size_t length);
+static void print_escaped(char *text, bool escape_colon);
+
+int completion_print(char *shell, Route *routes, int count) {
+    if (strcmp(shell, COMPLETION_BASH) == 0) {
+        print_bash(routes, count);
+    } else if (strcmp(shell, COMPLETION_ZSH) == 0) {
+        print_zsh(routes, count);
+    } else if (strcmp(shell, COMPLETION_FISH) == 0) {
+        print_fish(routes, count);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+    The table lists a group's commands after each other but nothing depends on it:
+    every helper below works on the first word of each name
+*/
+
+size_t first_word_length(char *name) {
+    char *space = strchr(name, ' ');
+    return space != NULL ? (size_t)(space - name) : strlen(name);
+}
+
+// the route is the first with its first word
+bool is_first_use(Route *routes, int index) {
+    char *name = routes[index].name;
+    size_t length = first_word_length(name);
+    for (int i = 0; i < index; i++) {
+        if (first_word_length(routes[i].name) == length && strncmp(routes[i].name, name, length) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the one word command named word, NULL for groups without one (set, get)
+Route *find_command(Route *routes, int count, char *word, size_t length) {
+    for (int i = 0; i < count; i++) {
+        if (strlen(routes[i].name) == length && strncmp(routes[i].name, word, length) == 0) {
+            return &routes[i];
+        }
+    }
+    return NULL;
+}
+
+bool in_group(Route *route, char *word, size_t length) {
+    return strncmp(route->name, word, length) == 0 && route->name[length] == ' ';
+}
+
+// text for inside single quotes, ':' separates a zsh _describe item from its help
+void print_escaped(char *text, bool escape_colon) {
+    for (char *c = text; *c != '\0'; c++) {
+        if (*c == '\'') {
+            fputs("'\\''", stdout);
+        } else if (*c == ':' && escape_colon) {
+            fputs("\\:", stdout);
+        } else {
+            putchar(*c);
+        }
+    }
+}
+
+void print_bash(Route *routes, int count) {
+    printf("# modulo bash completion, generated by `modulo completion bash`\n");
+    printf("_modulo() {\n");
+    printf("    local cur=${COMP_WORDS[COMP_CWORD]}\n");
+    printf("    local words=\"\"\n");
+    printf("    if [ \"$COMP_CWORD\" -eq 1 ]; then\n");
+    printf("        words=\"");
+    for (int i = 0, first = 1; i < count; i++) {
+        if (is_first_use(routes, i)) {
+            printf(first ? "%.*s" : " %.*s", (int)first_word_length(routes[i].name), routes[i].name);
+            first = 0;
+        }
+    }
+    printf("\"\n");
+    printf("    else\n");
+    printf("        case \"${COMP_WORDS[1]}\" in\n");
+    for (int i = 0; i < count; i++) {
+        if (!is_first_use(routes, i)) {
+            continue;
+        }
+        char *word = routes[i].name;
+        size_t length = first_word_length(word);
+        Route *command = find_command(routes, count, word, length);
+        printf("            %.*s)\n", (int)length, word);
+        printf("                words=\"%s\"\n", command != NULL ? command->flags : "");
+        bool group = false;
+        for (int j = 0; j < count; j++) {
+            if (in_group(&routes[j], word, length)) {
+                if (!group) {
+                    printf("                [ \"$COMP_CWORD\" -eq 2 ] && words=\"$words");
+                    group = true;
+                }
+                printf(" %s", routes[j].name + length + 1);
+            }
+        }
+        if (group) {
+            printf("\"\n");
+        }
+        printf("                ;;\n");
+    }
+    printf("        esac\n");
+    printf("        if [ \"$COMP_CWORD\" -ge 3 ]; then\n");
+    printf("            case \"${COMP_WORDS[1]} ${COMP_WORDS[2]}\" in\n");
+    for (int i = 0; i < count; i++) {
+        if (strchr(routes[i].name, ' ') != NULL && routes[i].flags[0] != '\0') {
+            printf("                \"%s\") words=\"%s\";;\n", routes[i].name, routes[i].flags);
+        }
+    }
+    printf("            esac\n");
+    printf("        fi\n");
+    printf("    fi\n");
+    printf("    COMPREPLY=($(compgen -W \"$words\" -- \"$cur\"))\n");
+    printf("}\n");
+    printf("complete -F _modulo modulo\n");
+}
+
+void print_zsh(Route *routes, int count) {
+    printf("#compdef modulo\n");
+    printf("# modulo zsh completion, generated by `modulo completion zsh`\n");
+    printf("_modulo() {\n");
+    printf("    local -a commands\n");
+    printf("    if (( CURRENT == 2 )); then\n");
+    printf("        commands=(\n");
+    for (int i = 0; i < count; i++) {
+        if (!is_first_use(routes, i)) {
+            continue;
+        }
+        size_t length = first_word_length(routes[i].name);
+        Route *command = find_command(routes, count, routes[i].name, length);
+        printf("            '%.*s:", (int)length, routes[i].name);
+        print_escaped(command != NULL ? command->help : "subcommands", true);
+        printf("'\n");
+    }
+    printf("        )\n");
+    printf("        _describe 'command' commands\n");
+    printf("        return\n");
+    printf("    fi\n");
+    printf("    case $words[2] in\n");
+    for (int i = 0; i < count; i++) {
+        if (!is_first_use(routes, i)) {
+            continue;
+        }
+        char *word = routes[i].name;
+        size_t length = first_word_length(word);
+        Route *command = find_command(routes, count, word, length);
+        printf("        %.*s)\n", (int)length, word);
+        bool group = false;
+        for (int j = 0; j < count; j++) {
+            if (!in_group(&routes[j], word, length)) {
+                continue;
+            }
+            if (!group) {
+                printf("            if (( CURRENT == 3 )); then\n");
+                printf("                commands=(\n");
+                group = true;
+            }
+            printf("                    '%s:", routes[j].name + length + 1);
+            print_escaped(routes[j].help, true);
+            printf("'\n");
+        }
+        if (group) {
+            printf("                )\n");
+            printf("                _describe '%.*s command' commands\n", (int)length, word);
+            printf("            fi\n");
+        }
+        if (command != NULL && command->flags[0] != '\0') {
+            printf("            compadd -- %s\n", command->flags);
+        }
+        printf("            ;;\n");
+    }
+    printf("    esac\n");
+    printf("    if (( CURRENT > 3 )); then\n");
+    printf("        case \"$words[2] $words[3]\" in\n");
+    for (int i = 0; i < count; i++) {
+        if (strchr(routes[i].name, ' ') != NULL && routes[i].flags[0] != '\0') {
+            printf("            \"%s\") compadd -- %s ;;\n", routes[i].name, routes[i].flags);
+        }
+    }
+    printf("        esac\n");
+    printf("    fi\n");
+    printf("}\n");
+    printf("_modulo \"$@\"\n");
+}
+
+void print_fish(Route *routes, int count) {
+    printf("# modulo fish completion, generated by `modulo completion fish`\n");
+    printf("complete -c modulo -f\n");
+    for (int i = 0; i < count; i++) {
+        if (!is_first_use(routes, i)) {
+            continue;
+        }
+        size_t length = first_word_length(routes[i].name);
+        Route *command = find_command(routes, count, routes[i].name, length);
+        printf("complete -c modulo -n __fish_use_subcommand -a %.*s -d '", (int)length, routes[i].name);
+        print_escaped(command != NULL ? command->help : "subcommands", false);
+        printf("'\n");
+    }
+    for (int i = 0; i < count; i++) {
+        Route *route = &routes[i];
+        char *space = strchr(route->name, ' ');
+        // the condition that the command's words have been typed
+        char condition[ROUTE_NAME_MAX * 2 + 96];
+        if (space == NULL) {
+            snprintf(condition, sizeof condition, "__fish_seen_subcommand_from %s", route->name);
+        } else {
+            int length = (int)(space - route->name);
+            printf("complete -c modulo -n '__fish_seen_subcommand_from %.*s; and test (count (commandline -opc)) -eq 2' -a %s -d '", length, route->name, space + 1);
+            print_escaped(route->help, false);
+            printf("'\n");
+            snprintf(condition, sizeof condition, "__fish_seen_subcommand_from %.*s; and __fish_seen_subcommand_from %s", length, route->name, space + 1);
+        }
+        // one line per flag, --long as -l and -s as -s
+        char flags[128];
+        snprintf(flags, sizeof flags, "%s", route->flags);
+        for (char *flag = strtok(flags, " "); flag != NULL; flag = strtok(NULL, " ")) {
+            if (flag[1] == '-') {
+                printf("complete -c modulo -n '%s' -l %s\n", condition, flag + 2);
+            } else {
+                printf("complete -c modulo -n '%s' -s %s\n", condition, flag + 1);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef COMPLETION_H
+#define COMPLETION_H
+
+#include "command_router.h"
+
+#define COMPLETION_BASH "bash"
+#define COMPLETION_ZSH "zsh"
+#define COMPLETION_FISH "fish"
+
+/*
+Shell completion scripts generated from the command table, e.g.
+
+    modulo completion bash > /etc/bash_completion.d/modulo
+    modulo completion zsh > "${fpath[1]}/_modulo"
+    modulo completion fish > ~/.config/fish/completions/modulo.fish
+
+Commands complete at the first word, sub commands of a group (set, get,
+recur, debug) at the second and each command's flags after that.
+*/
+
+// prints the completion script for shell, returns -1 if the shell isn't supported
+int completion_print(char *shell, Route *routes, int count);
+
+#endif
\ No newline at end of file
@@ -7,48 +7,132 @@
 #include "entry_doc.h"
 #include "../modulo.h"
 #include "../time_utils.h"
+#include "../mem.h"
+#include "../utf8.h"
+#include "search.h"
 
 static void entry_doc_insert_line(EntryDoc *entry_doc, Line *line, size_t index);
 static Line entry_doc_remove_line(EntryDoc *entry_doc, size_t index);
 static void entry_doc_move_cursor(EntryDoc *entry_doc, int i, int j);
 
+static void doc_insert_bytes(EntryDoc *entry_doc, int i, int j, char *bytes, size_t count);
+static void doc_remove_bytes(EntryDoc *entry_doc, int i, int j, size_t count);
+static void doc_split_line(EntryDoc *entry_doc, int i, int j);
+static void doc_join_line(EntryDoc *entry_doc, int i);
+
 Header create_header(Modulo *modulo);
+static Header create_edit_header(Modulo *modulo, int entry_number);
 
 static Line create_line(size_t capacity);
-static void line_insert_char(Line *line, char c, size_t index);
+static void line_insert_bytes(Line *line, char *bytes, size_t count, size_t index);
 static void line_cat(Line *dest, Line *src);
 static Line line_slice(Line *line, size_t index);
-static void line_remove_char(Line *line, size_t index);
+static void line_remove_range(Line *line, size_t start, size_t end);
 static Line create_empty_line();
+static Line create_line_from(const char *chars, size_t length);
 
 static void check_line_capacity(EntryDoc *entry_doc);
 static void check_char_capacity(Line *line, size_t required);
 static void free_line(Line *line);
+static void line_invalidate_caches(Line *line);
+static void line_build_columns(Line *line);
+static int line_next_row_start(Line *line, int start, int width);
 
 static int min(int a, int b);
 static int max(int a, int b);
 
 EntryDoc *create_entry_doc(Modulo *modulo) {
-    EntryDoc *entry_doc = malloc(sizeof(EntryDoc));
+    EntryDoc *entry_doc = mem_alloc(MEM_EDITOR, sizeof(EntryDoc));
     entry_doc->capacity = INIT_LINE_COUNT_CAP;
     entry_doc->line_count = 1;
-    entry_doc->lines = malloc(INIT_LINE_COUNT_CAP * sizeof(Line));
+    entry_doc->lines = mem_alloc(MEM_EDITOR, INIT_LINE_COUNT_CAP * sizeof(Line));
     entry_doc->lines[0] = create_empty_line();
     entry_doc->cursor = (Index) { .i = 0, .j = 0 };
     entry_doc->scroll = (Index) { .i = 0, .j = 0 };
+    entry_doc->soft_wrap = false;
+    entry_doc->scroll_row = 0;
+    entry_doc->undo = create_undo_log(0);
+    entry_doc->search = create_doc_search();
+    entry_doc->pending = NULL;
+    entry_doc->pending_end = NULL;
+    entry_doc->entry_id = 0;
+    entry_doc->entry_number = 0;
+    entry_doc->trailing_newline = true;
+    entry_doc->vocab = NULL;
+    entry_doc->tags = NULL;
     entry_doc->header = create_header(modulo);
     return entry_doc;
 }
 
+/*
+Only the first line is built here, the rest waits in pending.
+Entries written by the editor end every line with a newline, the last one
+is dropped and trailing_newline puts it back, so saving an unchanged entry
+gives back the same text whether or not it had one (`modulo add` doesn't).
+*/
+EntryDoc *create_entry_doc_for_entry(Modulo *modulo, Entry *entry, int entry_number) {
+    EntryDoc *entry_doc = create_entry_doc(modulo);
+    free_line(&entry_doc->lines[0]);
+    entry_doc->line_count = 0;
+    size_t length = entry->length;
+    entry_doc->trailing_newline = length > 0 && entry->text[length-1] == '\n';
+    if (entry_doc->trailing_newline) {
+        length--;
+    }
+    entry_doc->pending = entry->text;
+    entry_doc->pending_end = entry->text + length;
+    entry_doc->entry_id = entry->id;
+    entry_doc->entry_number = entry_number;
+    entry_doc->header = create_edit_header(modulo, entry_number);
+    entry_doc_load_lines(entry_doc, 1);
+    return entry_doc;
+}
+
+void entry_doc_load_lines(EntryDoc *entry_doc, size_t count) {
+    while (entry_doc->line_count < count && entry_doc->pending != NULL) {
+        const char *start = entry_doc->pending;
+        const char *end = entry_doc->pending_end;
+        const char *newline = memchr(start, '\n', end - start);
+        Line line;
+        if (newline == NULL) {
+            line = create_line_from(start, end - start);
+            entry_doc->pending = NULL;
+            entry_doc->pending_end = NULL;
+        } else {
+            line = create_line_from(start, newline - start);
+            entry_doc->pending = newline + 1;
+        }
+        check_line_capacity(entry_doc);
+        entry_doc->lines[entry_doc->line_count++] = line;
+    }
+}
+
+bool entry_doc_fully_loaded(EntryDoc *entry_doc) {
+    return entry_doc->pending == NULL;
+}
+
 Header create_header(Modulo *modulo) {
     Header header = { .line_count = 0 };
+    char range_string[FORMAT_RANGE_BUF_SIZE];
     header_printf(&header, "Modulo Entry Editor");
     header_printf(&header, "");
     header_printf(&header, "Type `%s` and press enter to submit.", modulo->entry_delimiter);
     header_printf(&header, "Enter `%s%s` when you're done to save and exit.", modulo->entry_delimiter, modulo->entry_delimiter);
     header_printf(&header, "");
     header_printf(&header, "Entries:     %d written", modulo->tomorrow.size);
-    header_printf(&header, "Next Wakeup: %s", wakeup_range_to_string(modulo));
+    header_printf(&header, "Next Wakeup: %s", wakeup_range_to_string(range_string, sizeof range_string, modulo));
+    return header;
+}
+
+Header create_edit_header(Modulo *modulo, int entry_number) {
+    Header header = { .line_count = 0 };
+    char range_string[FORMAT_RANGE_BUF_SIZE];
+    header_printf(&header, "Modulo Entry Editor");
+    header_printf(&header, "");
+    header_printf(&header, "Enter `%s` and press enter to save and exit.", modulo->entry_delimiter);
+    header_printf(&header, "");
+    header_printf(&header, "Editing:     entry %d of %d", entry_number, entry_list_live_count(&modulo->tomorrow));
+    header_printf(&header, "Next Wakeup: %s", wakeup_range_to_string(range_string, sizeof range_string, modulo));
     return header;
 }
 
@@ -63,13 +147,12 @@ Line create_empty_line() {
     return create_line(INIT_LINE_LENGTH_CAP);
 }
 
-void line_insert_char(Line *line, char c, size_t index) {
-    check_char_capacity(line, 1);
-    for (size_t i = line->length; i > index; i--) {
-        line->chars[i] = line->chars[i-1];
-    }
-    line->chars[index] = c;
-    line->length++;
+void line_insert_bytes(Line *line, char *bytes, size_t count, size_t index) {
+    check_char_capacity(line, count);
+    memmove(&line->chars[index + count], &line->chars[index], (line->length - index) * sizeof(char));
+    memcpy(&line->chars[index], bytes, count * sizeof(char));
+    line->length += count;
+    line_invalidate_caches(line);
 }
 
 void check_char_capacity(Line *line, size_t required) {
@@ -82,7 +165,7 @@ void check_char_capacity(Line *line, size_t required) {
     while (new_cap < required_cap) {
         new_cap *= 2;
     } 
-    line->chars = realloc(line->chars, new_cap * sizeof(char));
+    line->chars = mem_realloc(MEM_EDITOR, line->chars, new_cap * sizeof(char));
     line->capacity = new_cap;
 }
 
@@ -92,6 +175,7 @@ void line_cat(Line *dest, Line *src) {
     char *src_chars = src->chars;
     memcpy(dest_chars + dest->length, src_chars, src->length * sizeof(char));
     dest->length += src->length;
+    line_invalidate_caches(dest);
 }
 
 /*
@@ -112,19 +196,36 @@ Line line_slice(Line *line, size_t index) {
     return slice;
 }
 
+Line create_line_from(const char *chars, size_t length) {
+    size_t capacity = INIT_LINE_LENGTH_CAP;
+    while (capacity <= length) {
+        capacity *= 2;
+    }
+    Line line = create_line(capacity);
+    memcpy(line.chars, chars, length * sizeof(char));
+    line.length = length;
+    return line;
+}
+
 Line create_line(size_t capacity) {
     return (Line) {
         .capacity = capacity,
         .length = 0,
-        .chars = malloc(capacity * sizeof(char))
+        .chars = mem_alloc(MEM_EDITOR, capacity * sizeof(char)),
+        .wrap = { .width = 0, .row_count = 0, .capacity = 0, .row_starts = NULL },
+        .columns = { .valid = false, .capacity = 0, .bytes = NULL, .columns = NULL }
     };
 }
 
-void entry_doc_insert_char(EntryDoc *entry_doc, char c) {
+void entry_doc_insert_char(EntryDoc *entry_doc, uint32_t c) {
+    char bytes[UTF8_MAX_BYTES];
+    int count = utf8_encode(c, bytes);
+    if (count == 0) {
+        return;
+    }
     Index cursor = entry_doc_get_effective_cursor(entry_doc);
-    Line *line = entry_doc_get_line(entry_doc, cursor.i);
-    line_insert_char(line, c, cursor.j);
-    entry_doc_cursor_right(entry_doc);
+    undo_log_record_insert(entry_doc->undo, cursor.i, cursor.j, bytes, count);
+    doc_insert_bytes(entry_doc, cursor.i, cursor.j, bytes, count);
 }
 
 void entry_doc_backspace(EntryDoc *entry_doc) {
@@ -136,38 +237,137 @@ void entry_doc_backspace(EntryDoc *entry_doc) {
     }
     if (cursor.j == 0) {
         // line start
-        Line removed = entry_doc_remove_line(entry_doc, cursor.i);
         Line *prev_line = entry_doc_get_line(entry_doc, cursor.i-1);
-        entry_doc_move_cursor(entry_doc, cursor.i-1, prev_line->length);
-        line_cat(prev_line, &removed);
-        free_line(&removed);
+        undo_log_record_join(entry_doc->undo, cursor.i-1, prev_line->length);
+        doc_join_line(entry_doc, cursor.i-1);
         return;
     } 
-    // delete char
+    // delete the code point before the cursor
     Line *line = entry_doc_get_line(entry_doc, cursor.i);
-    entry_doc_cursor_left(entry_doc);
-    line_remove_char(line, cursor.j-1);
+    int start = utf8_prev(line->chars, cursor.j);
+    undo_log_record_delete(entry_doc->undo, cursor.i, start, &line->chars[start], cursor.j - start);
+    doc_remove_bytes(entry_doc, cursor.i, start, cursor.j - start);
 }
 
-void line_remove_char(Line *line, size_t index) {
-    if (index >= line->length || index < 0) {
-        fprintf(stderr, "Can't remove character at index %zu from line of length %zu\n", index, line->length);
+// removes bytes [start, end)
+void line_remove_range(Line *line, size_t start, size_t end) {
+    if (start > end || end > line->length) {
+        fprintf(stderr, "Can't remove characters %zu to %zu from line of length %zu\n", start, end, line->length);
         exit(EXIT_FAILURE);
     }
-    for (size_t i = index+1; i < line->length; i++) {
-        line->chars[i-1] = line->chars[i];
-    }
-    line->length--;
+    memmove(&line->chars[start], &line->chars[end], (line->length - end) * sizeof(char));
+    line->length -= end - start;
+    line_invalidate_caches(line);
 }
 
 void entry_doc_enter(EntryDoc *entry_doc) {
     Index cursor = entry_doc_get_effective_cursor(entry_doc);
+    undo_log_record_split(entry_doc->undo, cursor.i, cursor.j);
+    doc_split_line(entry_doc, cursor.i, cursor.j);
+}
+
+/*
+The edit primitives below don't touch the undo log, undo and redo replay
+ops through them. Each leaves the cursor where typing would have.
+*/
+void doc_insert_bytes(EntryDoc *entry_doc, int i, int j, char *bytes, size_t count) {
+    line_insert_bytes(entry_doc_get_line(entry_doc, i), bytes, count, j);
+    entry_doc_move_cursor(entry_doc, i, j + count);
+}
+
+void doc_remove_bytes(EntryDoc *entry_doc, int i, int j, size_t count) {
+    line_remove_range(entry_doc_get_line(entry_doc, i), j, j + count);
+    entry_doc_move_cursor(entry_doc, i, j);
+}
+
+void doc_split_line(EntryDoc *entry_doc, int i, int j) {
+    Line *line = entry_doc_get_line(entry_doc, i);
+    Line slice = line_slice(line, j);
+    line->length = j;
+    line_invalidate_caches(line);
+    entry_doc_insert_line(entry_doc, &slice, i+1);
+    entry_doc_move_cursor(entry_doc, i+1, 0);
+}
+
+// joins line i+1 onto the end of line i
+void doc_join_line(EntryDoc *entry_doc, int i) {
+    Line removed = entry_doc_remove_line(entry_doc, i+1);
+    Line *line = entry_doc_get_line(entry_doc, i);
+    entry_doc_move_cursor(entry_doc, i, line->length);
+    line_cat(line, &removed);
+    free_line(&removed);
+}
+
+bool entry_doc_undo(EntryDoc *entry_doc) {
+    UndoOp *op = undo_log_undo(entry_doc->undo);
+    if (op == NULL) {
+        return false;
+    }
+    switch (op->type) {
+        case UNDO_INSERT:
+            doc_remove_bytes(entry_doc, op->i, op->j, op->length);
+            break;
+        case UNDO_DELETE:
+            doc_insert_bytes(entry_doc, op->i, op->j, op->text, op->length);
+            break;
+        case UNDO_SPLIT:
+            doc_join_line(entry_doc, op->i);
+            break;
+        case UNDO_JOIN:
+            doc_split_line(entry_doc, op->i, op->j);
+            break;
+    }
+    return true;
+}
+
+bool entry_doc_redo(EntryDoc *entry_doc) {
+    UndoOp *op = undo_log_redo(entry_doc->undo);
+    if (op == NULL) {
+        return false;
+    }
+    switch (op->type) {
+        case UNDO_INSERT:
+            doc_insert_bytes(entry_doc, op->i, op->j, op->text, op->length);
+            break;
+        case UNDO_DELETE:
+            doc_remove_bytes(entry_doc, op->i, op->j, op->length);
+            break;
+        case UNDO_SPLIT:
+            doc_split_line(entry_doc, op->i, op->j);
+            break;
+        case UNDO_JOIN:
+            doc_join_line(entry_doc, op->i);
+            break;
+    }
+    return true;
+}
 
+void entry_doc_seal_undo(EntryDoc *entry_doc) {
+    undo_log_seal(entry_doc->undo);
+}
+
+// only at the end of a word, completing from the middle of one would split it
+size_t entry_doc_get_completion(EntryDoc *entry_doc, char *out) {
+    if (entry_doc->vocab == NULL) {
+        return 0;
+    }
+    Index cursor = entry_doc_get_effective_cursor(entry_doc);
     Line *line = entry_doc_get_line(entry_doc, cursor.i);
-    Line slice = line_slice(line, cursor.j);
-    line->length = cursor.j;
-    entry_doc_insert_line(entry_doc, &slice, cursor.i+1);
-    entry_doc_move_cursor(entry_doc, cursor.i+1, 0);
+    if ((size_t) cursor.j < line->length && vocab_is_word_byte(line->chars[cursor.j])) {
+        return 0;
+    }
+    int start = cursor.j;
+    while (start > 0 && vocab_is_word_byte(line->chars[start-1])) {
+        start--;
+    }
+    size_t prefix_length = cursor.j - start;
+    char word[VOCAB_MAX_WORD + 1];
+    size_t length = vocab_complete(entry_doc->vocab, &line->chars[start], prefix_length, word);
+    if (length == 0) {
+        return 0;
+    }
+    memcpy(out, &word[prefix_length], length - prefix_length + 1);
+    return length - prefix_length;
 }
 
 
@@ -192,11 +392,12 @@ void check_line_capacity(EntryDoc *entry_doc) {
         return;
     }
     size_t new_cap = cap * 2; 
-    entry_doc->lines = realloc(entry_doc->lines, new_cap * sizeof(Line));
+    entry_doc->lines = mem_realloc(MEM_EDITOR, entry_doc->lines, new_cap * sizeof(Line));
     entry_doc->capacity = new_cap;
 }
 
 Line *entry_doc_get_line(EntryDoc *entry_doc, size_t index) {
+    entry_doc_load_lines(entry_doc, index+1);
     size_t line_count = entry_doc->line_count;
     if (index >= line_count) {
         fprintf(stderr, "Can't get line at index %zu from document with %zu lines\n", index, line_count);
@@ -243,29 +444,35 @@ void entry_doc_cursor_up(EntryDoc *entry_doc) {
 
 void entry_doc_cursor_down(EntryDoc *entry_doc) {
     Index cursor = entry_doc_get_effective_cursor(entry_doc);
+    entry_doc_load_lines(entry_doc, cursor.i+2);
     entry_doc->cursor.i = min(entry_doc->line_count-1, cursor.i+1);
 }
 
 void entry_doc_cursor_left(EntryDoc *entry_doc) {
     Index cursor = entry_doc_get_effective_cursor(entry_doc);
-    entry_doc->cursor.j = max(0, cursor.j-1);
+    Line *line = entry_doc_get_line(entry_doc, cursor.i);
+    entry_doc->cursor.j = utf8_prev(line->chars, cursor.j);
 }
 
 void entry_doc_cursor_right(EntryDoc *entry_doc) {
     Index cursor = entry_doc_get_effective_cursor(entry_doc);
     Line *line = entry_doc_get_line(entry_doc, cursor.i);
-    entry_doc->cursor.j = min(line->length, cursor.j+1);
+    entry_doc->cursor.j = utf8_next(line->chars, line->length, cursor.j);
 }
 
 /*
 Returns the physical cursor location in the document
 limits the logical cursor (entry_doc->cursor) column index by the current line length
+and moves it back to the start of the code point it lands in
 */
 Index entry_doc_get_effective_cursor(EntryDoc *entry_doc) {
     Index cursor = entry_doc->cursor;
-    size_t line_length = entry_doc_get_line(entry_doc, cursor.i)->length;
-    if (cursor.j > line_length) {
-        cursor.j = line_length;
+    Line *line = entry_doc_get_line(entry_doc, cursor.i);
+    if (cursor.j > line->length) {
+        cursor.j = line->length;
+    }
+    while (cursor.j > 0 && (size_t) cursor.j < line->length && UTF8_IS_CONTINUATION(line->chars[cursor.j])) {
+        cursor.j--;
     }
     return cursor;
 }
@@ -288,26 +495,232 @@ void entry_doc_move_cursor(EntryDoc *entry_doc, int i, int j) {
 }
 
 void entry_doc_clear(Modulo *modulo, EntryDoc *entry_doc) {
+    entry_doc->pending = NULL;
+    entry_doc->pending_end = NULL;
     entry_doc->cursor = (Index) { .i = 0, .j = 0 };
     entry_doc->scroll = (Index) { .i = 0, .j = 0 };
     for (size_t i = 1; i < entry_doc->line_count; i++) {
         free_line(entry_doc_get_line(entry_doc, i));
     }
     entry_doc->line_count = 1;
-    entry_doc_get_line(entry_doc, 0)->length = 0;
+    entry_doc->scroll_row = 0;
+    Line *first_line = entry_doc_get_line(entry_doc, 0);
+    first_line->length = 0;
+    line_invalidate_caches(first_line);
+    // a submitted entry can't be edited anymore
+    undo_log_clear(entry_doc->undo);
     entry_doc->header = create_header(modulo);
 }
 
+void entry_doc_toggle_soft_wrap(EntryDoc *entry_doc) {
+    entry_doc->soft_wrap = !entry_doc->soft_wrap;
+    // the next scroll check brings the cursor back into view
+    entry_doc->scroll = (Index) { .i = entry_doc->scroll.i, .j = 0 };
+    entry_doc->scroll_row = 0;
+}
+
+int wrap_width(int content_width) {
+    return max(1, min(content_width, WRAP_MAX_WIDTH));
+}
+
+int line_wrap_rows(Line *line, int width) {
+    WrapCache *wrap = &line->wrap;
+    if (wrap->width == width) {
+        return wrap->row_count;
+    }
+    if (wrap->row_starts == NULL) {
+        wrap->capacity = WRAP_INIT_ROW_CAP;
+        wrap->row_starts = mem_alloc(MEM_EDITOR, wrap->capacity * sizeof(int));
+    }
+    int row_count = 0;
+    int start = 0;
+    do {
+        if (row_count == wrap->capacity) {
+            wrap->capacity *= 2;
+            wrap->row_starts = mem_realloc(MEM_EDITOR, wrap->row_starts, wrap->capacity * sizeof(int));
+        }
+        wrap->row_starts[row_count++] = start;
+        start = line_next_row_start(line, start, width);
+    } while (start < (int) line->length);
+    wrap->row_count = row_count;
+    wrap->width = width;
+    return row_count;
+}
+
+/*
+The last row runs to the end of the line, every other row ends after the
+last space that fits in width columns (the space stays at the end of the row).
+Returns line->length when the rest of the line fits on one row.
+*/
+int line_next_row_start(Line *line, int start, int width) {
+    int length = line->length;
+    int start_column = line_column_of(line, start);
+    if (line_display_width(line) - start_column <= width) {
+        return length;
+    }
+    int end = line_byte_at_column(line, start_column + width);
+    if (end == start) {
+        // a single character wider than the row
+        return utf8_next(line->chars, length, start);
+    }
+    for (int k = end; k > start; k--) {
+        if (line->chars[k-1] == ' ') {
+            return k;
+        }
+    }
+    // a word longer than a row, break it at the width
+    return end;
+}
+
+int line_row_start(Line *line, int row) {
+    return line->wrap.row_starts[row];
+}
+
+int line_row_end(Line *line, int row) {
+    if (row + 1 == line->wrap.row_count) {
+        return line->length;
+    }
+    return line->wrap.row_starts[row+1];
+}
+
+// the row whose [start, end) holds j, the end of the line belongs to the last row
+int line_row_of(Line *line, int j, int width) {
+    int row_count = line_wrap_rows(line, width);
+    int *row_starts = line->wrap.row_starts;
+    // last row starting at or before j
+    int lo = 0;
+    int hi = row_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (row_starts[mid] <= j) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+int entry_doc_row_distance(EntryDoc *entry_doc, int width, Index from, Index to) {
+    int distance = 0;
+    for (int i = from.i; i < to.i; i++) {
+        distance += line_wrap_rows(entry_doc_get_line(entry_doc, i), width);
+    }
+    return distance - from.j + to.j;
+}
+
+void line_invalidate_caches(Line *line) {
+    line->wrap.width = 0;
+    line->columns.valid = false;
+}
+
+void line_build_columns(Line *line) {
+    ColumnCache *columns = &line->columns;
+    columns->valid = true;
+    columns->ascii = true;
+    for (size_t i = 0; i < line->length; i++) {
+        unsigned char c = line->chars[i];
+        if (c >= 0x80 || c < 0x20) {
+            columns->ascii = false;
+            break;
+        }
+    }
+    if (columns->ascii) {
+        columns->width = line->length;
+        columns->count = line->length;
+        return;
+    }
+    // at most one code point per byte, plus the end of the line
+    int required = line->length + 1;
+    if (columns->capacity < required) {
+        columns->capacity = max(required, 2 * columns->capacity);
+        columns->bytes = mem_realloc(MEM_EDITOR, columns->bytes, columns->capacity * sizeof(int));
+        columns->columns = mem_realloc(MEM_EDITOR, columns->columns, columns->capacity * sizeof(int));
+    }
+    int count = 0;
+    int column = 0;
+    size_t byte = 0;
+    while (byte < line->length) {
+        int size;
+        uint32_t code_point = utf8_decode(&line->chars[byte], line->length - byte, &size);
+        columns->bytes[count] = byte;
+        columns->columns[count] = column;
+        count++;
+        column += utf8_code_point_width(code_point);
+        byte += size;
+    }
+    columns->bytes[count] = line->length;
+    columns->columns[count] = column;
+    columns->count = count;
+    columns->width = column;
+}
+
+int line_display_width(Line *line) {
+    if (!line->columns.valid) {
+        line_build_columns(line);
+    }
+    return line->columns.width;
+}
+
+int line_column_of(Line *line, int byte) {
+    ColumnCache *columns = &line->columns;
+    if (!columns->valid) {
+        line_build_columns(line);
+    }
+    if (columns->ascii) {
+        return byte;
+    }
+    // last code point starting at or before byte
+    int lo = 0;
+    int hi = columns->count;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (columns->bytes[mid] <= byte) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return columns->columns[lo];
+}
+
+int line_byte_at_column(Line *line, int column) {
+    ColumnCache *columns = &line->columns;
+    if (!columns->valid) {
+        line_build_columns(line);
+    }
+    if (columns->ascii) {
+        return max(0, min(column, line->length));
+    }
+    // last boundary at or before column
+    int lo = 0;
+    int hi = columns->count;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (columns->columns[mid] <= column) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return columns->bytes[lo];
+}
+
 void free_entry_doc(EntryDoc *entry_doc) {
     for (size_t i = 0; i < entry_doc->line_count; i++) {
         free_line(entry_doc_get_line(entry_doc, i));
     }
-    free(entry_doc->lines);
-    free(entry_doc);
+    mem_free(entry_doc->lines);
+    free_undo_log(entry_doc->undo);
+    free_doc_search(entry_doc->search);
+    mem_free(entry_doc);
 }
 
 void free_line(Line *line) {
-    free(line->chars);
+    mem_free(line->chars);
+    mem_free(line->wrap.row_starts);
+    mem_free(line->columns.bytes);
+    mem_free(line->columns.columns);
 }
 
 int min(int a, int b) { return a < b ? a : b; }
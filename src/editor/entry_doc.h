@@ -3,8 +3,12 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "../modulo.h"
+#include "../vocab.h"
+#include "../tags.h"
+#include "undo.h"
 
 typedef struct Index {
     int i;
@@ -22,12 +26,76 @@ typedef struct Header {
     char lines[HEADER_MAX_LINES][HEADER_MAX_LINE_LENGTH];
 } Header;
 
+// appends a line to header
+void header_printf(Header *header, char *format, ...);
+
+#define WRAP_INIT_ROW_CAP 4
+/* a row of 4 byte characters has to fit the view's line buffer (DOC_LINE_BUF_SIZE) */
+#define WRAP_MAX_WIDTH 511
+
+/*
+WrapCache:
+Where a line breaks into visual rows in soft wrap mode. Rows break after
+the last space that fits, or at the width if a word is longer than a row.
+Computed lazily for one width, editing a line only invalidates its own cache.
+*/
+typedef struct WrapCache {
+    /* width the rows were computed for, 0 if the line changed since */
+    int width;
+    int row_count;
+    int capacity;
+    /* index of the first char of each row */
+    int *row_starts;
+} WrapCache;
+
+/*
+ColumnCache:
+Byte offset and display column of every code point in a line, so mapping
+between the two is a binary search instead of a rescan of the line.
+Plain ASCII lines (a byte per column) skip the arrays.
+Built lazily, editing a line invalidates it.
+*/
+typedef struct ColumnCache {
+    bool valid;
+    bool ascii;
+    /* display width of the whole line */
+    int width;
+    int count;
+    int capacity;
+    /* count+1 entries, the last one is the end of the line */
+    int *bytes;
+    int *columns;
+} ColumnCache;
+
+/*
+Line:
+chars holds UTF-8 and isn't null terminated. Cursor and row positions are
+byte indexes that always sit on a code point boundary.
+*/
 typedef struct Line {
     size_t capacity;
     size_t length;
     char *chars;
+    WrapCache wrap;
+    ColumnCache columns;
 } Line;
 
+/*
+In soft wrap mode scroll.i is the first visible line and scroll_row the first
+visible row of that line (scroll.j stays 0), so positions are (line, row)
+pairs and mapping the cursor to the screen only walks the lines between
+scroll.i and the cursor.
+
+A document opened on an existing entry isn't split into lines up front.
+lines holds the lines built so far and [pending, pending_end) the rest of
+the text, one line per newline. Lines are built as the view reaches them
+(entry_doc_load_lines) or when asked for (entry_doc_get_line), so opening
+an entry costs the same no matter how long it is. The pending text is
+borrowed from the entry and has to outlive the document.
+*/
+// see search.h
+typedef struct DocSearch DocSearch;
+
 typedef struct EntryDoc {
     Header header;
     size_t capacity;
@@ -35,14 +103,49 @@ typedef struct EntryDoc {
     Line *lines;
     Index cursor;
     Index scroll;
+    bool soft_wrap;
+    int scroll_row;
+    UndoLog *undo;
+    DocSearch *search;
+    /* NULL once every line has been built */
+    const char *pending;
+    const char *pending_end;
+    /* the entry being edited and its number in tomorrow's list, 0 for a new entry */
+    uint64_t entry_id;
+    int entry_number;
+    /* the edited entry's text ended in a newline, saving keeps it that way */
+    bool trailing_newline;
+    /* completion words, borrowed from the editor. NULL turns completion off */
+    Vocab *vocab;
+    /* tag index, borrowed from the editor and updated as entries are submitted. may be NULL */
+    TagIndex *tags;
 } EntryDoc;
 
 EntryDoc *create_entry_doc(Modulo *modulo);
+// a document for editing an existing entry, text isn't copied (see pending)
+EntryDoc *create_entry_doc_for_entry(Modulo *modulo, Entry *entry, int entry_number);
 
-void entry_doc_insert_char(EntryDoc *entry_doc, char c);
+// builds lines until there are count of them or the text runs out
+void entry_doc_load_lines(EntryDoc *entry_doc, size_t count);
+bool entry_doc_fully_loaded(EntryDoc *entry_doc);
+
+// inserts a code point at the cursor
+void entry_doc_insert_char(EntryDoc *entry_doc, uint32_t c);
 void entry_doc_backspace(EntryDoc *entry_doc);
 void entry_doc_enter(EntryDoc *entry_doc);
 
+// revert or reapply the last edit and put the cursor where it happened, false if there was nothing to do
+bool entry_doc_undo(EntryDoc *entry_doc);
+bool entry_doc_redo(EntryDoc *entry_doc);
+// ends the current typing or backspace run, e.g. when the cursor moves
+void entry_doc_seal_undo(EntryDoc *entry_doc);
+
+/*
+    completion for the word ending at the cursor: the rest of the vocab's most frequent word it starts
+    writes it to out (VOCAB_MAX_WORD+1 bytes) and returns its length, 0 if there's nothing to complete
+*/
+size_t entry_doc_get_completion(EntryDoc *entry_doc, char *out);
+
 void entry_doc_cursor_up(EntryDoc *entry_doc);
 void entry_doc_cursor_down(EntryDoc *entry_doc);
 void entry_doc_cursor_left(EntryDoc *entry_doc);
@@ -51,6 +154,23 @@ void entry_doc_cursor_right(EntryDoc *entry_doc);
 Index entry_doc_get_effective_cursor(EntryDoc *entry_doc);
 Line *entry_doc_get_line(EntryDoc *entry_doc, size_t index);
 
+void entry_doc_toggle_soft_wrap(EntryDoc *entry_doc);
+
+// display column of the code point at byte, and the last code point boundary at or before column
+int line_column_of(Line *line, int byte);
+int line_byte_at_column(Line *line, int column);
+int line_display_width(Line *line);
+
+// width rows wrap at for a content area content_width wide
+int wrap_width(int content_width);
+// soft wrap rows, line_row_start and line_row_end are valid after line_wrap_rows for the same width
+int line_wrap_rows(Line *line, int width);
+int line_row_start(Line *line, int row);
+int line_row_end(Line *line, int row);
+int line_row_of(Line *line, int j, int width);
+// visual rows from row from.j of line from.i to row to.j of line to.i (to must not be before from)
+int entry_doc_row_distance(EntryDoc *entry_doc, int width, Index from, Index to);
+
 void entry_doc_clear(Modulo *modulo, EntryDoc *entry_doc);
 void free_entry_doc(EntryDoc *entry_doc);
 
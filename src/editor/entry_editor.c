@@ -1,13 +1,18 @@
 #include <ncurses.h>
 #include <ctype.h>
 #include <string.h>
+#include <locale.h>
+#include <wctype.h>
+#include <stdlib.h>
 
 #include "../modulo.h"
 #include "../filesystem.h"
+#include "../vocab.h"
 #include "entry_editor.h"
 #include "entry_doc.h"
 #include "screen_model.h"
 #include "view.h"
+#include "search.h"
 
 
 /*
@@ -17,90 +22,247 @@ Lesson: input -> Document -> check_scroll(Document, Screen) -> WINDOW -> Termina
 Another example of chronological separation 
 */
 
-static void screen_init(int *screen_h, int *screen_w);
+static void screen_init();
 static void screen_exit(WINDOW *doc_win, WINDOW *summary_win);
 
-static EditorEvent get_user_event(WINDOW *doc_win, Modulo *modulo, EntryDoc *entry_doc);
+static void run_editor(Modulo *modulo, OSContext *c, EntryDoc *entry_doc, KeySource *keys, FrameRecorder *recorder);
+static Vocab *open_vocab(Modulo *modulo, OSContext *c);
+static void close_vocab(Vocab *vocab, OSContext *c);
+static void close_tags(TagIndex *tags, OSContext *c);
+static void render_frame(WINDOW *doc_win, WINDOW *summary_win, Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
+static void handle_event(EditorEvent event, Modulo *modulo, OSContext *c, ScreenModel *screen_model, EntryDoc *entry_doc);
+static EditorEvent get_user_event(WINDOW *doc_win, KeySource *keys, Modulo *modulo, EntryDoc *entry_doc);
+static EditorEvent get_search_event(KeyInput input);
 static EventType get_enter_event_type(Modulo *modulo, EntryDoc *entry_doc);
-static bool is_char_input(int c);
+static bool is_char_input(uint32_t c);
 
 
+void entry_editor_set_locale() {
+    // LC_CTYPE only, number formatting in the json stays in the C locale
+    setlocale(LC_CTYPE, "");
+    if (MB_CUR_MAX == 1) {
+        setlocale(LC_CTYPE, "C.UTF-8");
+    }
+}
+
 void entry_editor_start(Modulo *modulo, OSContext *c) {
+    entry_editor_set_locale();
+    screen_init();
+    KeySource keys = { .keys = NULL };
+    entry_editor_run(modulo, c, &keys, NULL);
+    endwin();
+}
+
+void entry_editor_edit(Modulo *modulo, OSContext *c, Entry *entry, int entry_number) {
+    entry_editor_set_locale();
+    screen_init();
+    KeySource keys = { .keys = NULL };
+    run_editor(modulo, c, create_entry_doc_for_entry(modulo, entry, entry_number), &keys, NULL);
+    endwin();
+}
+
+void entry_editor_run(Modulo *modulo, OSContext *c, KeySource *keys, FrameRecorder *recorder) {
+    run_editor(modulo, c, create_entry_doc(modulo), keys, recorder);
+}
+
+// takes ownership of entry_doc
+void run_editor(Modulo *modulo, OSContext *c, EntryDoc *entry_doc, KeySource *keys, FrameRecorder *recorder) {
     int screen_h, screen_w;
-    screen_init(&screen_h, &screen_w);
+    getmaxyx(stdscr, screen_h, screen_w);
+
+    Vocab *vocab = open_vocab(modulo, c);
+    entry_doc->vocab = vocab;
+    TagIndex *tags = load_synced_tag_index(c, modulo);
+    entry_doc->tags = tags;
 
-    EntryDoc *entry_doc = create_entry_doc(modulo);
-    ScreenModel *screen_model = create_screen_model(entry_doc, screen_h, screen_w);
+    ScreenModel *screen_model = create_screen_model(&entry_doc->header, screen_h, screen_w);
 
     WINDOW *doc_win = view_init_doc_window(screen_model);
     WINDOW *summary_win = view_init_summary_window(screen_model);
-    
-    while (true) { 
-        // update view from model
-        view_update(doc_win, summary_win, modulo, screen_model, entry_doc);
-        // Render view to terminal
-        view_render(doc_win, summary_win, entry_doc);
-
-        // Reset size and content update flags
-        model_reset(screen_model);
 
+    if (recorder != NULL) {
+        frame_recorder_begin(recorder);
+    }
+    model_check_scroll(screen_model, entry_doc);
+    render_frame(doc_win, summary_win, modulo, screen_model, entry_doc);
+    if (recorder != NULL) {
+        frame_recorder_end(recorder);
+    }
+    while (true) { 
         // get user input
-        EditorEvent event = get_user_event(doc_win, modulo, entry_doc);
+        EditorEvent event = get_user_event(doc_win, keys, modulo, entry_doc);
+        if (event.type == INPUT_END) {
+            break;
+        }
         if (event.type == EXIT) {
             model_handle_exit(modulo, c, entry_doc);
             break;
         }
-        switch (event.type) {
-            case ENTRY_SUBMIT:
-                model_handle_entry_submit(modulo, c, screen_model, entry_doc);
-                break;
-            case RESIZE:
-                model_handle_resize(modulo, screen_model, entry_doc);
-                break;
-            case BACKSPACE:
-                model_handle_backspace(modulo, screen_model, entry_doc);
-                break;
-            case ENTER:
-                model_handle_enter(modulo, screen_model, entry_doc);
-                break;
-            case CURSOR_MOVE:
-                model_handle_cursor_move(modulo, screen_model, entry_doc, event.input);
-                break;
-            case CHAR_INPUT:
-                model_handle_char_input(modulo, screen_model, entry_doc, event.input);
-                break;
-            case NONE:
-                model_handle_no_event(screen_model);
-                break;
-            default:
-                // shouldn't happen
-                fprintf(stderr, "unexpected event type %d\n", event.type);
-                exit(EXIT_FAILURE);
+        if (event.type == ENTRY_SUBMIT && entry_doc->entry_id != 0) {
+            model_handle_edit_submit(modulo, c, entry_doc);
+            break;
+        }
+        if (recorder != NULL) {
+            frame_recorder_begin(recorder);
         }
+        handle_event(event, modulo, c, screen_model, entry_doc);
         model_check_scroll(screen_model, entry_doc);
+        render_frame(doc_win, summary_win, modulo, screen_model, entry_doc);
+        if (recorder != NULL) {
+            frame_recorder_end(recorder);
+        }
     }
     free_screen_model(screen_model);
     free_entry_doc(entry_doc);
+    close_vocab(vocab, c);
+    close_tags(tags, c);
     screen_exit(doc_win, summary_win);
 }
 
-EditorEvent get_user_event(WINDOW *doc_win, Modulo *modulo, EntryDoc *entry_doc) {
-    int c = wgetch(doc_win);
+/*
+The saved vocab only lacks entries added since it was written (e.g. by
+`modulo add`), syncing adds just those. Without a saved one, or when
+replaying (c == NULL), it's built from every entry in the store.
+*/
+Vocab *open_vocab(Modulo *modulo, OSContext *c) {
+    Vocab *vocab = c != NULL ? load_vocab(c) : NULL;
+    if (vocab == NULL) {
+        vocab = create_vocab();
+    }
+    vocab_sync(vocab, modulo);
+    return vocab;
+}
+
+// a failed write only costs a rebuild next time
+void close_vocab(Vocab *vocab, OSContext *c) {
+    if (c != NULL && vocab->dirty) {
+        save_vocab(vocab, c);
+    }
+    free_vocab(vocab);
+}
+
+void close_tags(TagIndex *tags, OSContext *c) {
+    if (c != NULL && tags->dirty) {
+        save_tag_index(tags, c);
+    }
+    free_tag_index(tags);
+}
+
+void render_frame(WINDOW *doc_win, WINDOW *summary_win, Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc) {
+    // update view from model
+    view_update(doc_win, summary_win, modulo, screen_model, entry_doc);
+    // Render view to terminal
+    view_render(doc_win, summary_win, entry_doc);
+
+    // Reset size and content update flags
+    model_reset(screen_model);
+}
+
+void handle_event(EditorEvent event, Modulo *modulo, OSContext *c, ScreenModel *screen_model, EntryDoc *entry_doc) {
+    switch (event.type) {
+        case ENTRY_SUBMIT:
+            model_handle_entry_submit(modulo, c, screen_model, entry_doc);
+            break;
+        case RESIZE:
+            model_handle_resize(modulo, screen_model, entry_doc);
+            break;
+        case BACKSPACE:
+            model_handle_backspace(modulo, screen_model, entry_doc);
+            break;
+        case ENTER:
+            model_handle_enter(modulo, screen_model, entry_doc);
+            break;
+        case CURSOR_MOVE:
+            model_handle_cursor_move(modulo, screen_model, entry_doc, event.input);
+            break;
+        case CHAR_INPUT:
+            model_handle_char_input(modulo, screen_model, entry_doc, event.input);
+            break;
+        case TOGGLE_WRAP:
+            model_handle_toggle_wrap(modulo, screen_model, entry_doc);
+            break;
+        case UNDO:
+            model_handle_undo(modulo, screen_model, entry_doc);
+            break;
+        case REDO:
+            model_handle_redo(modulo, screen_model, entry_doc);
+            break;
+        case SEARCH_START:
+        case SEARCH_INPUT:
+        case SEARCH_BACKSPACE:
+        case SEARCH_NEXT:
+        case SEARCH_PREV:
+        case SEARCH_ACCEPT:
+        case SEARCH_CANCEL:
+            model_handle_search(modulo, screen_model, entry_doc, event.type, event.input);
+            break;
+        case COMPLETE:
+            model_handle_complete(modulo, screen_model, entry_doc);
+            break;
+        case NONE:
+            model_handle_no_event(screen_model);
+            break;
+        default:
+            // shouldn't happen
+            fprintf(stderr, "unexpected event type %d\n", event.type);
+            exit(EXIT_FAILURE);
+    }
+}
+
+EditorEvent get_user_event(WINDOW *doc_win, KeySource *keys, Modulo *modulo, EntryDoc *entry_doc) {
+    KeyInput input = key_source_next(keys, doc_win);
+    if (input.type == KEY_SOURCE_END) {
+        return (EditorEvent) { .type = INPUT_END };
+    }
+    if (entry_doc->search->active) {
+        return get_search_event(input);
+    }
+    int c = input.key;
+    if (input.type == KEY_CODE_YES) {
+        // function keys
+        switch (c) {
+            case KEY_ENTER:
+                return (EditorEvent) { .type = get_enter_event_type(modulo, entry_doc) };
+            case KEY_BACKSPACE:
+                return (EditorEvent) { .type = BACKSPACE };
+            case KEY_UP:
+            case KEY_DOWN:
+            case KEY_LEFT:
+            case KEY_RIGHT:
+                return (EditorEvent) { .type = CURSOR_MOVE, .input = c };
+            case KEY_RESIZE:
+                return (EditorEvent) { .type = RESIZE };
+            case KEY_UNDO:
+                return (EditorEvent) { .type = UNDO };
+            case KEY_REDO:
+                return (EditorEvent) { .type = REDO };
+            case KEY_FIND:
+                return (EditorEvent) { .type = SEARCH_START };
+        }
+        return (EditorEvent) { .type = NONE };
+    }
+    if (input.type != OK) {
+        return (EditorEvent) { .type = NONE };
+    }
     switch (c) {
-        case KEY_ENTER:
         case '\n':
         case '\r':
-            EventType type = get_enter_event_type(modulo, entry_doc);
-            return (EditorEvent) { .type = type };
-        case KEY_BACKSPACE:
-            return (EditorEvent) { .type = BACKSPACE };
-        case KEY_UP:
-        case KEY_DOWN:
-        case KEY_LEFT:
-        case KEY_RIGHT:
-            return (EditorEvent) { .type = CURSOR_MOVE, .input = c };
-        case KEY_RESIZE:
-            return (EditorEvent) { .type = RESIZE };
+            return (EditorEvent) { .type = get_enter_event_type(modulo, entry_doc) };
+        case KEY_TOGGLE_WRAP:
+            return (EditorEvent) { .type = TOGGLE_WRAP };
+        case KEY_UNDO_EDIT:
+            return (EditorEvent) { .type = UNDO };
+        case KEY_REDO_EDIT:
+            return (EditorEvent) { .type = REDO };
+        case KEY_SEARCH:
+            return (EditorEvent) { .type = SEARCH_START };
+        case KEY_COMPLETE: {
+            char completion[VOCAB_MAX_WORD + 1];
+            if (entry_doc_get_completion(entry_doc, completion) > 0) {
+                return (EditorEvent) { .type = COMPLETE };
+            }
+            break;
+        }
     }
     if (is_char_input(c)) {
         return (EditorEvent) { .type = CHAR_INPUT, .input = c };
@@ -108,6 +270,48 @@ EditorEvent get_user_event(WINDOW *doc_win, Modulo *modulo, EntryDoc *entry_doc)
     return (EditorEvent) { .type = NONE };
 }
 
+/*
+While searching keys edit the query instead of the document:
+enter accepts the match, Ctrl-G or escape cancels,
+down and Ctrl-F go to the next match, up to the previous one
+*/
+EditorEvent get_search_event(KeyInput input) {
+    int c = input.key;
+    if (input.type == KEY_CODE_YES) {
+        switch (c) {
+            case KEY_ENTER:
+                return (EditorEvent) { .type = SEARCH_ACCEPT };
+            case KEY_BACKSPACE:
+                return (EditorEvent) { .type = SEARCH_BACKSPACE };
+            case KEY_DOWN:
+            case KEY_FIND:
+                return (EditorEvent) { .type = SEARCH_NEXT };
+            case KEY_UP:
+                return (EditorEvent) { .type = SEARCH_PREV };
+            case KEY_RESIZE:
+                return (EditorEvent) { .type = RESIZE };
+        }
+        return (EditorEvent) { .type = NONE };
+    }
+    if (input.type != OK) {
+        return (EditorEvent) { .type = NONE };
+    }
+    switch (c) {
+        case '\n':
+        case '\r':
+            return (EditorEvent) { .type = SEARCH_ACCEPT };
+        case KEY_SEARCH:
+            return (EditorEvent) { .type = SEARCH_NEXT };
+        case KEY_SEARCH_CANCEL:
+        case KEY_ESCAPE:
+            return (EditorEvent) { .type = SEARCH_CANCEL };
+    }
+    if (is_char_input(c) && c != '\t') {
+        return (EditorEvent) { .type = SEARCH_INPUT, .input = c };
+    }
+    return (EditorEvent) { .type = NONE };
+}
+
 EventType get_enter_event_type(Modulo *modulo, EntryDoc *entry_doc) {
     Index cursor = entry_doc_get_effective_cursor(entry_doc);
     char *entry_delim = modulo_get_entry_delimiter(modulo);
@@ -130,19 +334,22 @@ EventType get_enter_event_type(Modulo *modulo, EntryDoc *entry_doc) {
     return EXIT;
 }
 
-bool is_char_input(int c) {
-    return isalnum(c) || ispunct(c) || isspace(c);
+// c is a code point
+bool is_char_input(uint32_t c) {
+    if (c < 0x80) {
+        return isalnum(c) || ispunct(c) || isspace(c);
+    }
+    return iswprint((wint_t) c);
 }
 
-void screen_init(int *screen_h, int *screen_w) {
+void screen_init() {
     initscr();
     cbreak();
     noecho();
-    getmaxyx(stdscr, *screen_h, *screen_w);
 }
 
+// endwin is left to whoever set up the screen
 void screen_exit(WINDOW *doc_win, WINDOW *summary_win) {
     delwin(doc_win);
     delwin(summary_win);
-    endwin();
 }
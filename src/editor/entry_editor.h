@@ -5,6 +5,7 @@
 
 #include "../modulo.h"
 #include "../filesystem.h"
+#include "replay.h"
 
 /*
 typedef struct EditorEvent {
@@ -21,14 +22,47 @@ typedef enum EventType {
     ENTER,
     CURSOR_MOVE, 
     CHAR_INPUT,
-    NONE
+    TOGGLE_WRAP,
+    UNDO,
+    REDO,
+    SEARCH_START,
+    SEARCH_INPUT,
+    SEARCH_BACKSPACE,
+    SEARCH_NEXT,
+    SEARCH_PREV,
+    SEARCH_ACCEPT,
+    SEARCH_CANCEL,
+    COMPLETE,
+    NONE,
+    /* a replayed key script ran out */
+    INPUT_END
 } EventType;
 
+#define CTRL_KEY(c) ((c) & 0x1f)
+#define KEY_TOGGLE_WRAP CTRL_KEY('w')
+// ncurses already has KEY_UNDO and KEY_REDO for the function keys, those work too
+#define KEY_UNDO_EDIT CTRL_KEY('u')
+#define KEY_REDO_EDIT CTRL_KEY('r')
+#define KEY_SEARCH CTRL_KEY('f')
+#define KEY_SEARCH_CANCEL CTRL_KEY('g')
+#define KEY_ESCAPE 27
+// completes the word at the cursor, a plain tab when there's nothing to complete
+#define KEY_COMPLETE '\t'
+
 typedef struct EditorEvent {
     EventType type;
     int input;
 } EditorEvent;
 
+// UTF-8 character handling for ncurses, falls back to C.UTF-8 if the environment's locale isn't UTF-8
+void entry_editor_set_locale();
 void entry_editor_start(Modulo *modulo, OSContext *c);
+// opens an entry of tomorrow's list, entry_number is its position as shown in the summary
+void entry_editor_edit(Modulo *modulo, OSContext *c, Entry *entry, int entry_number);
+/*
+    runs the editor on the current ncurses screen until exit
+    c == NULL skips saving, recorder may be NULL
+*/
+void entry_editor_run(Modulo *modulo, OSContext *c, KeySource *keys, FrameRecorder *recorder);
 
 #endif
\ No newline at end of file
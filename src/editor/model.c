@@ -7,14 +7,28 @@
 #include "../time_utils.h"
 #include "entry_doc.h"
 #include "screen_model.h"
+#include "../mem.h"
+#include "../utf8.h"
+#include "../vocab.h"
+#include "../tags.h"
+#include "search.h"
+#include "entry_editor.h"
 
 static void remove_exit_delim(Modulo *modulo, EntryDoc *entry_doc);
 static void remove_entry_delim(Modulo *modulo, EntryDoc *entry_doc);
+static void commit_entry(Modulo *modulo, OSContext *c, EntryDoc *entry_doc);
 static void submit_entry(Modulo *modulo, EntryDoc *entry_doc);
+static void save_edited_entry(Modulo *modulo, EntryDoc *entry_doc);
+static void learn_words(Modulo *modulo, EntryDoc *entry_doc, char *entry);
+static void forget_words(EntryDoc *entry_doc, char *entry);
+static void index_tags(Modulo *modulo, EntryDoc *entry_doc, uint64_t entry_id, char *entry);
 static void log_doc_update(ScreenModel *screen_model);
+static void log_cursor_update(ScreenModel *screen_model);
 static void log_summary_update(ScreenModel *screen_model);
 static void save_modulo_or_exit(Modulo *modulo, OSContext *c);
 
+static void check_scroll_wrapped(EntryDoc *entry_doc, int content_height, int content_width);
+
 static bool is_empty(EntryDoc *entry_doc);
 static char *entry_doc_to_string(EntryDoc *entry_doc);
 static int max(int a, int b);
@@ -24,23 +38,29 @@ void model_reset(ScreenModel *screen_model) {
     SummaryModel *summary_model = &screen_model->summary_model;
     doc_model->content_update = false;
     doc_model->size_update = false;
+    doc_model->lines_update = false;
     summary_model->content_update = false;
     summary_model->size_update = false;
 }
 
 void model_handle_exit(Modulo *modulo, OSContext *c, EntryDoc *entry_doc) {
     remove_exit_delim(modulo, entry_doc);
-    if (is_empty(entry_doc)) {
+    // a new entry left empty isn't added, an edited one emptied is removed (see save_edited_entry)
+    if (is_empty(entry_doc) && entry_doc->entry_id == 0) {
         return;
     }
-    submit_entry(modulo, entry_doc);
-    save_modulo_or_exit(modulo, c);
+    commit_entry(modulo, c, entry_doc);
+}
+
+// editing an existing entry, a single delimiter saves and exits as well
+void model_handle_edit_submit(Modulo *modulo, OSContext *c, EntryDoc *entry_doc) {
+    remove_entry_delim(modulo, entry_doc);
+    commit_entry(modulo, c, entry_doc);
 }
 
 void model_handle_entry_submit(Modulo *modulo, OSContext *c, ScreenModel *screen_model, EntryDoc *entry_doc) {
     remove_entry_delim(modulo, entry_doc);
-    submit_entry(modulo, entry_doc);
-    save_modulo_or_exit(modulo, c);
+    commit_entry(modulo, c, entry_doc);
     entry_doc_clear(modulo, entry_doc);
     log_doc_update(screen_model);
     log_summary_update(screen_model);
@@ -49,7 +69,7 @@ void model_handle_entry_submit(Modulo *modulo, OSContext *c, ScreenModel *screen
 void model_handle_resize(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc) {
     int screen_h, screen_w;
     getmaxyx(stdscr, screen_h, screen_w);
-    screen_model_resize(screen_model, entry_doc, screen_h, screen_w);
+    screen_model_resize(screen_model, &entry_doc->header, screen_h, screen_w);
 }
 
 void model_handle_backspace(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc) {
@@ -81,14 +101,76 @@ void model_handle_cursor_move(Modulo *modulo, ScreenModel *screen_model, EntryDo
             fprintf(stderr, "Unrecognized cursor move event\n");
             exit(EXIT_FAILURE);
     }
-    log_doc_update(screen_model);
+    // typing after a move starts a new undo step
+    entry_doc_seal_undo(entry_doc);
+    log_cursor_update(screen_model);
 }
 
-void model_handle_char_input(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc, char input) {
+void model_handle_char_input(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc, uint32_t input) {
     entry_doc_insert_char(entry_doc, input);
     log_doc_update(screen_model);
 }
 
+void model_handle_toggle_wrap(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc) {
+    entry_doc_toggle_soft_wrap(entry_doc);
+    log_doc_update(screen_model);
+}
+
+void model_handle_undo(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc) {
+    if (entry_doc_undo(entry_doc)) {
+        log_doc_update(screen_model);
+    }
+}
+
+void model_handle_redo(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc) {
+    if (entry_doc_redo(entry_doc)) {
+        log_doc_update(screen_model);
+    }
+}
+
+void model_handle_search(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc, int type, int input) {
+    DocSearch *search = entry_doc->search;
+    switch (type) {
+        case SEARCH_START:
+            search_start(search, entry_doc);
+            break;
+        case SEARCH_INPUT:
+            search_push_char(search, entry_doc, input);
+            break;
+        case SEARCH_BACKSPACE:
+            search_pop_char(search, entry_doc);
+            break;
+        case SEARCH_NEXT:
+            search_next(search, entry_doc);
+            break;
+        case SEARCH_PREV:
+            search_prev(search, entry_doc);
+            break;
+        case SEARCH_ACCEPT:
+        case SEARCH_CANCEL:
+            search_end(search, entry_doc, type == SEARCH_CANCEL);
+            break;
+    }
+    // the cursor jumped, typing afterwards starts a new undo step
+    entry_doc_seal_undo(entry_doc);
+    // highlights and the search prompt change with every key
+    log_doc_update(screen_model);
+}
+
+// inserted a code point at a time so it joins the typing run in the undo log
+void model_handle_complete(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc) {
+    char completion[VOCAB_MAX_WORD + 1];
+    size_t length = entry_doc_get_completion(entry_doc, completion);
+    size_t i = 0;
+    while (i < length) {
+        int size;
+        uint32_t c = utf8_decode(&completion[i], length - i, &size);
+        entry_doc_insert_char(entry_doc, c);
+        i += size;
+    }
+    log_doc_update(screen_model);
+}
+
 void model_handle_no_event(ScreenModel *screen_model) { return; }
 
 void model_check_scroll(ScreenModel *screen_model, EntryDoc *entry_doc) {
@@ -97,14 +179,93 @@ void model_check_scroll(ScreenModel *screen_model, EntryDoc *entry_doc) {
     SubWindow *entry_doc_content = &screen_model->doc_model.entry_content;
     int content_height = entry_doc_content->height;
     int content_width = entry_doc_content->width;
-    // scroll <= cursor && scroll >= (cursor.i-(height-1), cursor.j-(width-1)) 
+    if (entry_doc->soft_wrap) {
+        check_scroll_wrapped(entry_doc, content_height, content_width);
+        // a line is at least a row
+        entry_doc_load_lines(entry_doc, scroll->i + content_height);
+        return;
+    }
+    // scroll.j and the cursor column are display columns
+    int cursor_column = line_column_of(entry_doc_get_line(entry_doc, cursor.i), cursor.j);
+    // scroll <= cursor && scroll >= (cursor.i-(height-1), cursor column-(width-1)) 
     scroll->i = min(cursor.i, max(scroll->i, cursor.i - (content_height-1)));
-    scroll->j = min(cursor.j, max(scroll->j, cursor.j - (content_width-1)));
+    scroll->j = min(cursor_column, max(scroll->j, cursor_column - (content_width-1)));
+    // build the lines coming into view
+    entry_doc_load_lines(entry_doc, scroll->i + content_height);
+}
+
+/*
+Same rule as the unwrapped scroll, in visual rows:
+scroll <= cursor row && cursor row - scroll < height
+Only the lines between the scroll position and the cursor are measured.
+*/
+void check_scroll_wrapped(EntryDoc *entry_doc, int content_height, int content_width) {
+    int width = wrap_width(content_width);
+    int height = max(1, content_height);
+    Index cursor = entry_doc_get_effective_cursor(entry_doc);
+    Line *cursor_line = entry_doc_get_line(entry_doc, cursor.i);
+    Index cursor_row = { .i = cursor.i, .j = line_row_of(cursor_line, cursor.j, width) };
+
+    Index *scroll = &entry_doc->scroll;
+    // a resize can leave fewer rows in the scroll line
+    Line *scroll_line = entry_doc_get_line(entry_doc, scroll->i);
+    entry_doc->scroll_row = min(entry_doc->scroll_row, line_wrap_rows(scroll_line, width) - 1);
+    scroll->j = 0;
+
+    bool above = cursor_row.i < scroll->i || (cursor_row.i == scroll->i && cursor_row.j < entry_doc->scroll_row);
+    if (above) {
+        scroll->i = cursor_row.i;
+        entry_doc->scroll_row = cursor_row.j;
+        return;
+    }
+    Index scroll_row = { .i = scroll->i, .j = entry_doc->scroll_row };
+    int distance = entry_doc_row_distance(entry_doc, width, scroll_row, cursor_row);
+    // advance the scroll position row by row until the cursor is on screen
+    for (int excess = distance - (height-1); excess > 0; excess--) {
+        Line *line = entry_doc_get_line(entry_doc, scroll->i);
+        if (entry_doc->scroll_row + 1 < line_wrap_rows(line, width)) {
+            entry_doc->scroll_row++;
+        } else {
+            scroll->i++;
+            entry_doc->scroll_row = 0;
+        }
+    }
 }
 
 int max(int a, int b) { return a > b ? a : b; }
 int min(int a, int b) { return a < b ? a : b; }
     
+/*
+    c is NULL when the editor is replayed headless, nothing is written to disk.
+    Otherwise the store isn't locked while the editor is open: the entry is
+    submitted to the store reloaded under the lock, which then replaces the
+    editor's copy with whatever other commands wrote meanwhile
+*/
+void commit_entry(Modulo *modulo, OSContext *c, EntryDoc *entry_doc) {
+    if (c == NULL) {
+        submit_entry(modulo, entry_doc);
+        return;
+    }
+    int lock = lock_modulo(c, NULL);
+    Modulo *latest = lock == -2 ? NULL : load_modulo(c);
+    if (latest == NULL) {
+        fprintf(stderr, "An error occurred saving the last entry!\n");
+        exit(EXIT_FAILURE);
+    }
+    modulo_check_sync(latest);
+    // the completions and tags pick up entries written meanwhile before this one moves them past
+    if (entry_doc->vocab != NULL) {
+        vocab_sync(entry_doc->vocab, latest);
+    }
+    if (entry_doc->tags != NULL) {
+        tag_index_sync(entry_doc->tags, latest);
+    }
+    submit_entry(latest, entry_doc);
+    save_modulo_or_exit(latest, c);
+    unlock_modulo(lock);
+    modulo_replace(modulo, latest);
+}
+
 void save_modulo_or_exit(Modulo *modulo, OSContext *c) {
     if (save_modulo(modulo, c) == -1) {
         fprintf(stderr, "An error occurred saving the last entry!\n");
@@ -113,41 +274,120 @@ void save_modulo_or_exit(Modulo *modulo, OSContext *c) {
 }
 
 void submit_entry(Modulo *modulo, EntryDoc *entry_doc) {
+    if (entry_doc->entry_id != 0) {
+        save_edited_entry(modulo, entry_doc);
+        return;
+    }
     char *entry = entry_doc_to_string(entry_doc);
     modulo_push_tomorrow(modulo, entry);
+    EntryList *tomorrow = modulo_get_tomorrow(modulo);
+    entry_list_set_send_date(tomorrow, utc_now());
+    learn_words(modulo, entry_doc, entry);
+    index_tags(modulo, entry_doc, entry_list_get_entry(tomorrow, tomorrow->size-1)->id, entry);
+}
+
+/*
+    the entry is replaced in place, keeping its id, slot and flags. Emptied, it's
+    removed as by `modulo remove`. Either way its old words and tags are dropped
+*/
+void save_edited_entry(Modulo *modulo, EntryDoc *entry_doc) {
+    EntryRef ref = modulo_find_entry(modulo, entry_doc->entry_id);
+    if (ref.entry_list == NULL || (entry_list_get_entry(ref.entry_list, ref.slot)->flags & ENTRY_REMOVED)) {
+        fprintf(stderr, "The entry being edited no longer exists!\n");
+        exit(EXIT_FAILURE);
+    }
+    forget_words(entry_doc, entry_list_get(ref.entry_list, ref.slot));
+    if (is_empty(entry_doc)) {
+        entry_list_tombstone(ref.entry_list, ref.slot);
+        index_tags(modulo, entry_doc, entry_doc->entry_id, "");
+        return;
+    }
+    char *entry = entry_doc_to_string(entry_doc);
+    if (!entry_doc->trailing_newline) {
+        // entry_doc_to_string ends every line with a newline
+        entry[strlen(entry) - 1] = '\0';
+    }
+    // the document's pending text points into the old text, drop it before that's freed
+    entry_doc->pending = NULL;
+    entry_doc->pending_end = NULL;
+    modulo_set_entry_text(modulo, entry_doc->entry_id, entry);
     entry_list_set_send_date(modulo_get_tomorrow(modulo), utc_now());
+    learn_words(modulo, entry_doc, entry);
+    index_tags(modulo, entry_doc, entry_doc->entry_id, entry);
+}
+
+// the vocab is kept up to date here so it never has to rescan the store for the editor's own entries
+void learn_words(Modulo *modulo, EntryDoc *entry_doc, char *entry) {
+    Vocab *vocab = entry_doc->vocab;
+    if (vocab == NULL) {
+        return;
+    }
+    vocab_add_text(vocab, entry);
+    vocab->next_entry_id = modulo_get_next_entry_id(modulo);
+}
+
+void forget_words(EntryDoc *entry_doc, char *entry) {
+    if (entry_doc->vocab == NULL) {
+        return;
+    }
+    vocab_remove_text(entry_doc->vocab, entry);
+}
+
+// tags are parsed once, as the entry is submitted. an edit replaces the entry's old tags
+void index_tags(Modulo *modulo, EntryDoc *entry_doc, uint64_t entry_id, char *entry) {
+    TagIndex *tags = entry_doc->tags;
+    if (tags == NULL) {
+        return;
+    }
+    tag_index_set_entry(tags, entry_id, entry);
+    tags->next_entry_id = modulo_get_next_entry_id(modulo);
+    // the edit that bumped the generation is this one, indexed just now
+    tags->edit_generation = modulo_get_edit_generation(modulo);
 }
 
 void log_doc_update(ScreenModel *screen_model) {
     screen_model->doc_model.content_update = true;
+    screen_model->doc_model.lines_update = true;
+}
+
+// the text is unchanged, the view may only have to move the cursor or scroll
+void log_cursor_update(ScreenModel *screen_model) {
+    screen_model->doc_model.content_update = true;
 }
 
 void log_summary_update(ScreenModel *screen_model) {
     screen_model->summary_model.content_update = true;
 }
 
+// backspace removes a code point at a time
 void remove_exit_delim(Modulo *modulo, EntryDoc *entry_doc) {
-    size_t entry_delim_length = strlen(modulo->entry_delimiter);
+    size_t entry_delim_length = utf8_code_point_count(modulo->entry_delimiter);
     for (size_t i = 0; i < 2*entry_delim_length; i++) {
         entry_doc_backspace(entry_doc);
     }
 }
 
 void remove_entry_delim(Modulo *modulo, EntryDoc *entry_doc) {
-    size_t entry_delim_length = strlen(modulo->entry_delimiter);
+    size_t entry_delim_length = utf8_code_point_count(modulo->entry_delimiter);
     for (size_t i = 0; i < entry_delim_length; i++) {
         entry_doc_backspace(entry_doc);
     }
 }
 
+// lines that were never built are copied straight from the pending text
 char *entry_doc_to_string(EntryDoc *entry_doc) {
     size_t line_count = entry_doc->line_count;
     size_t char_count = 0;
     for (size_t i = 0; i < line_count; i++) {
         char_count += entry_doc_get_line(entry_doc, i)->length;
     }
-    // strlen = char_count + line_count (newlines) + 1 (null terminator)
-    char *entry_string = malloc((line_count + char_count + 1) * sizeof(char));
+    size_t pending_length = 0;
+    if (!entry_doc_fully_loaded(entry_doc)) {
+        // pending text + its last newline
+        pending_length = entry_doc->pending_end - entry_doc->pending + 1;
+    }
+    // strlen = char_count + line_count (newlines) + pending_length + 1 (null terminator)
+    char *entry_string = mem_alloc(MEM_ENTRY_LIST, (line_count + char_count + pending_length + 1) * sizeof(char));
     size_t start = 0;
     for (size_t i = 0; i < line_count; i++) {
         Line *line = entry_doc_get_line(entry_doc, i);
@@ -156,10 +396,15 @@ char *entry_doc_to_string(EntryDoc *entry_doc) {
         entry_string[start+length] = '\n';
         start += length+1;
     }
+    if (pending_length > 0) {
+        memcpy(&entry_string[start], entry_doc->pending, pending_length - 1);
+        entry_string[start + pending_length - 1] = '\n';
+        start += pending_length;
+    }
     entry_string[start] = '\0';
     return entry_string;
 }
 
 bool is_empty(EntryDoc *entry_doc) {
-    return entry_doc->line_count == 1 && entry_doc_get_line(entry_doc, 0)->length == 0;
+    return entry_doc_fully_loaded(entry_doc) && entry_doc->line_count == 1 && entry_doc_get_line(entry_doc, 0)->length == 0;
 }
\ No newline at end of file
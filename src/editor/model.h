@@ -9,12 +9,20 @@
 void model_reset(ScreenModel *screen_model);
 
 void model_handle_exit(Modulo *modulo, OSContext *c, EntryDoc *entry_doc);
+void model_handle_edit_submit(Modulo *modulo, OSContext *c, EntryDoc *entry_doc);
 void model_handle_entry_submit(Modulo *modulo, OSContext *c, ScreenModel *screen_model, EntryDoc *entry_doc);
 void model_handle_resize(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
 void model_handle_backspace(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
 void model_handle_enter(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
 void model_handle_cursor_move(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc, int dir);
-void model_handle_char_input(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc, char input);
+void model_handle_char_input(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc, uint32_t input);
+void model_handle_toggle_wrap(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
+void model_handle_undo(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
+void model_handle_redo(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
+// type is one of the SEARCH_ events, input the character for SEARCH_INPUT
+void model_handle_search(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc, int type, int input);
+// inserts the rest of the word the cursor is at the end of
+void model_handle_complete(Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
 void model_handle_no_event(ScreenModel *screen_model);
 
 void model_check_scroll(ScreenModel *screen_model, EntryDoc *entry_doc);
@@ -0,0 +1,429 @@
+#include <ncurses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../modulo.h"
+#include "../entry_list.h"
+#include "../time_utils.h"
+#include "../utf8.h"
+#include "../mem.h"
+#include "reader.h"
+#include "entry_doc.h"
+#include "entry_editor.h"
+#include "screen_model.h"
+#include "view.h"
+#include "replay.h"
+
+static Header create_reader_header(EntryList *entry_list, char *title);
+
+static bool reader_handle_key(Reader *reader, ScreenModel *screen_model, KeyInput input);
+static void reader_resize(Reader *reader, ScreenModel *screen_model);
+static void resize_windows(WINDOW *doc_win, WINDOW *summary_win, ScreenModel *screen_model);
+static void reader_scroll_down(Reader *reader, int rows);
+static void reader_scroll_up(Reader *reader, int rows);
+static void reader_clamp_scroll(Reader *reader);
+static int step_down(Reader *reader, Index *index, int rows);
+static int step_up(Reader *reader, Index *index, int rows);
+
+static EntryLayout *reader_get_layout(Reader *reader, int index);
+static int entry_rows(Reader *reader, int index);
+static void layout_entry(EntryLayout *layout, const char *text, size_t length, int width);
+static void layout_push_row(EntryLayout *layout, size_t start);
+
+static void reader_render(Reader *reader, WINDOW *doc_win, WINDOW *summary_win, ScreenModel *screen_model);
+static void print_reader_header(Reader *reader, WINDOW *doc_win, SubWindow *header, int last_entry);
+static int print_reader_content(Reader *reader, WINDOW *doc_win, SubWindow *entry_content);
+static void print_reader_keys(WINDOW *summary_win, SubWindow *entry_list_summary);
+static void print_row(WINDOW *win, int y, int x, const char *text, size_t start, size_t end);
+static int digit_count(int n);
+static int max(int a, int b);
+
+Reader *create_reader(EntryList *entry_list, char *title) {
+    Reader *reader = mem_alloc(MEM_EDITOR, sizeof(Reader));
+    reader->entry_list = entry_list;
+    reader->header = create_reader_header(entry_list, title);
+    reader->count = 0;
+    reader->slots = mem_alloc(MEM_EDITOR, max(entry_list->size, 1) * sizeof(int));
+    for (int i = 0; i < entry_list->size; i++) {
+        if (!(entry_list_get_entry(entry_list, i)->flags & ENTRY_REMOVED)) {
+            reader->slots[reader->count++] = i;
+        }
+    }
+    reader->layouts = mem_calloc(MEM_EDITOR, max(reader->count, 1), sizeof(EntryLayout));
+    reader->label_width = digit_count(reader->count) + 2;
+    reader->wrap_width = 0;
+    reader->height = 0;
+    reader->scroll = (Index) { .i = 0, .j = 0 };
+    return reader;
+}
+
+void free_reader(Reader *reader) {
+    for (int i = 0; i < reader->count; i++) {
+        mem_free(reader->layouts[i].row_starts);
+    }
+    mem_free(reader->layouts);
+    mem_free(reader->slots);
+    mem_free(reader);
+}
+
+Header create_reader_header(EntryList *entry_list, char *title) {
+    Header header = { .line_count = 0 };
+    char date_string[FORMAT_TIME_BUF_SIZE];
+    header_printf(&header, "%s", title);
+    header_printf(&header, "");
+    header_printf(&header, "Sent:     %s", utc_to_string(date_string, sizeof date_string, entry_list->send_date, true));
+    if (entry_list->recv_date != 0) {
+        header_printf(&header, "Received: %s", utc_to_string(date_string, sizeof date_string, entry_list->recv_date, true));
+    }
+    return header;
+}
+
+void entry_reader_start(EntryList *entry_list, char *title) {
+    entry_editor_set_locale();
+    initscr();
+    cbreak();
+    noecho();
+    curs_set(0);
+    Reader *reader = create_reader(entry_list, title);
+    KeySource keys = { .keys = NULL };
+    entry_reader_run(reader, &keys);
+    free_reader(reader);
+    endwin();
+}
+
+void entry_reader_run(Reader *reader, KeySource *keys) {
+    int screen_h, screen_w;
+    getmaxyx(stdscr, screen_h, screen_w);
+    ScreenModel *screen_model = create_screen_model(&reader->header, screen_h, screen_w);
+    WINDOW *doc_win = view_init_doc_window(screen_model);
+    WINDOW *summary_win = view_init_summary_window(screen_model);
+    reader_resize(reader, screen_model);
+    reader_render(reader, doc_win, summary_win, screen_model);
+    while (true) {
+        KeyInput input = key_source_next(keys, doc_win);
+        if (input.type == KEY_SOURCE_END || !reader_handle_key(reader, screen_model, input)) {
+            break;
+        }
+        if (input.type == KEY_CODE_YES && input.key == KEY_RESIZE) {
+            resize_windows(doc_win, summary_win, screen_model);
+        }
+        reader_render(reader, doc_win, summary_win, screen_model);
+    }
+    delwin(doc_win);
+    delwin(summary_win);
+    free_screen_model(screen_model);
+}
+
+// returns false to quit
+bool reader_handle_key(Reader *reader, ScreenModel *screen_model, KeyInput input) {
+    int page = max(reader->height - 1, 1);
+    int c = input.key;
+    if (input.type == KEY_CODE_YES) {
+        switch (c) {
+            case KEY_DOWN:
+                reader_scroll_down(reader, 1);
+                break;
+            case KEY_UP:
+                reader_scroll_up(reader, 1);
+                break;
+            case KEY_NPAGE:
+                reader_scroll_down(reader, page);
+                break;
+            case KEY_PPAGE:
+                reader_scroll_up(reader, page);
+                break;
+            case KEY_HOME:
+                reader->scroll = (Index) { .i = 0, .j = 0 };
+                break;
+            case KEY_END:
+                reader->scroll = (Index) { .i = max(reader->count - 1, 0), .j = 0 };
+                reader_scroll_down(reader, entry_rows(reader, reader->scroll.i));
+                break;
+            case KEY_RESIZE:
+                reader_resize(reader, screen_model);
+                break;
+        }
+        return true;
+    }
+    if (input.type != OK) {
+        return true;
+    }
+    switch (c) {
+        case KEY_READER_QUIT:
+        case KEY_ESCAPE:
+            return false;
+        case KEY_READER_DOWN:
+            reader_scroll_down(reader, 1);
+            break;
+        case KEY_READER_UP:
+            reader_scroll_up(reader, 1);
+            break;
+        case KEY_READER_PAGE_DOWN:
+            reader_scroll_down(reader, page);
+            break;
+        case KEY_READER_PAGE_UP:
+            reader_scroll_up(reader, page);
+            break;
+        case KEY_READER_NEXT:
+            if (reader->scroll.i + 1 < reader->count) {
+                reader->scroll = (Index) { .i = reader->scroll.i + 1, .j = 0 };
+                reader_clamp_scroll(reader);
+            }
+            break;
+        case KEY_READER_PREV:
+            if (reader->scroll.j > 0) {
+                reader->scroll.j = 0;
+            } else if (reader->scroll.i > 0) {
+                reader->scroll = (Index) { .i = reader->scroll.i - 1, .j = 0 };
+            }
+            break;
+        case KEY_READER_TOP:
+            reader->scroll = (Index) { .i = 0, .j = 0 };
+            break;
+        case KEY_READER_END:
+            reader->scroll = (Index) { .i = max(reader->count - 1, 0), .j = 0 };
+            reader_scroll_down(reader, entry_rows(reader, reader->scroll.i));
+            break;
+    }
+    return true;
+}
+
+// layouts for the old width are redone as entries come back into view
+void reader_resize(Reader *reader, ScreenModel *screen_model) {
+    int screen_h, screen_w;
+    getmaxyx(stdscr, screen_h, screen_w);
+    screen_model_resize(screen_model, &reader->header, screen_h, screen_w);
+    SubWindow *entry_content = &screen_model->doc_model.entry_content;
+    reader->height = max(entry_content->height, 0);
+    reader->wrap_width = max(entry_content->width - reader->label_width, 1);
+    if (reader->count > 0 && reader->scroll.j >= entry_rows(reader, reader->scroll.i)) {
+        reader->scroll.j = entry_rows(reader, reader->scroll.i) - 1;
+    }
+    reader_clamp_scroll(reader);
+}
+
+void resize_windows(WINDOW *doc_win, WINDOW *summary_win, ScreenModel *screen_model) {
+    DocModel *doc_model = &screen_model->doc_model;
+    SummaryModel *summary_model = &screen_model->summary_model;
+    wresize(doc_win, doc_model->height, doc_model->width);
+    mvwin(doc_win, doc_model->pos_y, doc_model->pos_x);
+    wresize(summary_win, summary_model->height, max(summary_model->width, 1));
+}
+
+void reader_scroll_down(Reader *reader, int rows) {
+    step_down(reader, &reader->scroll, rows);
+    reader_clamp_scroll(reader);
+}
+
+void reader_scroll_up(Reader *reader, int rows) {
+    step_up(reader, &reader->scroll, rows);
+}
+
+// keeps the screen full: the last row of the last entry never goes above the bottom of the content area
+void reader_clamp_scroll(Reader *reader) {
+    if (reader->count == 0) {
+        return;
+    }
+    Index bottom = reader->scroll;
+    int below = step_down(reader, &bottom, reader->height - 1);
+    if (below < reader->height - 1) {
+        step_up(reader, &reader->scroll, reader->height - 1 - below);
+    }
+}
+
+// moves index down up to rows rows, returns how many it moved
+int step_down(Reader *reader, Index *index, int rows) {
+    int moved = 0;
+    while (moved < rows) {
+        if (index->j + 1 < entry_rows(reader, index->i)) {
+            index->j++;
+        } else if (index->i + 1 < reader->count) {
+            index->i++;
+            index->j = 0;
+        } else {
+            break;
+        }
+        moved++;
+    }
+    return moved;
+}
+
+int step_up(Reader *reader, Index *index, int rows) {
+    int moved = 0;
+    while (moved < rows) {
+        if (index->j > 0) {
+            index->j--;
+        } else if (index->i > 0) {
+            index->i--;
+            index->j = entry_rows(reader, index->i) - 1;
+        } else {
+            break;
+        }
+        moved++;
+    }
+    return moved;
+}
+
+// rows of entry index, with the blank row that follows every entry but the last
+int entry_rows(Reader *reader, int index) {
+    if (reader->count == 0) {
+        return 1;
+    }
+    int rows = reader_get_layout(reader, index)->row_count;
+    return index + 1 < reader->count ? rows + 1 : rows;
+}
+
+EntryLayout *reader_get_layout(Reader *reader, int index) {
+    EntryLayout *layout = &reader->layouts[index];
+    if (layout->width != reader->wrap_width) {
+        Entry *entry = entry_list_get_entry(reader->entry_list, reader->slots[index]);
+        layout_entry(layout, entry->text, entry->length, reader->wrap_width);
+    }
+    return layout;
+}
+
+/*
+Rows break at the last space that fits (the space stays at the end of the
+row) or mid word when there is none. Newlines end a row, a trailing one
+doesn't start another.
+*/
+void layout_entry(EntryLayout *layout, const char *text, size_t length, int width) {
+    layout->width = width;
+    layout->row_count = 0;
+    size_t start = 0;
+    while (true) {
+        layout_push_row(layout, start);
+        int column = 0;
+        size_t end = start;
+        size_t space = 0;
+        bool has_space = false;
+        while (end < length && text[end] != '\n') {
+            int size;
+            uint32_t c = utf8_decode(&text[end], length - end, &size);
+            int char_width = c < 0x20 ? 1 : utf8_code_point_width(c);
+            // a character wider than the row still goes on one by itself
+            if (column + char_width > width && end > start) {
+                break;
+            }
+            if (c == ' ') {
+                space = end;
+                has_space = true;
+            }
+            column += char_width;
+            end += size;
+        }
+        if (end >= length) {
+            return;
+        }
+        if (text[end] == '\n') {
+            start = end + 1;
+            if (start >= length) {
+                return;
+            }
+        } else {
+            start = has_space ? space + 1 : end;
+        }
+    }
+}
+
+void layout_push_row(EntryLayout *layout, size_t start) {
+    if (layout->row_count == layout->capacity) {
+        layout->capacity = layout->capacity == 0 ? READER_INIT_ROW_CAP : 2 * layout->capacity;
+        layout->row_starts = mem_realloc(MEM_EDITOR, layout->row_starts, layout->capacity * sizeof(uint32_t));
+    }
+    layout->row_starts[layout->row_count++] = start;
+}
+
+/*
+The doc window is erased and drawn every frame, only the rows on screen
+are visited and ncurses sends the terminal just what changed.
+*/
+void reader_render(Reader *reader, WINDOW *doc_win, WINDOW *summary_win, ScreenModel *screen_model) {
+    DocModel *doc_model = &screen_model->doc_model;
+    SummaryModel *summary_model = &screen_model->summary_model;
+    werase(doc_win);
+    box(doc_win, 0, 0);
+    int last_entry = print_reader_content(reader, doc_win, &doc_model->entry_content);
+    print_reader_header(reader, doc_win, &doc_model->header, last_entry);
+    wnoutrefresh(doc_win);
+    if (summary_model->width > 0) {
+        werase(summary_win);
+        box(summary_win, 0, 0);
+        print_modulo_logo(summary_win, &summary_model->logo);
+        print_reader_keys(summary_win, &summary_model->entry_list_summary);
+        wnoutrefresh(summary_win);
+    }
+    doupdate();
+}
+
+void print_reader_header(Reader *reader, WINDOW *doc_win, SubWindow *header, int last_entry) {
+    int y = header->pos_y + header->top;
+    int x = header->pos_x + header->left;
+    size_t line_count = reader->header.line_count;
+    for (size_t i = 0; i < line_count; i++) {
+        mvwaddnstr(doc_win, y + i, x, reader->header.lines[i], header->width);
+    }
+    wmove(doc_win, y + line_count, x);
+    whline(doc_win, ACS_HLINE, header->width);
+    if (reader->count == 0) {
+        mvwprintw(doc_win, y + line_count + 2, x, "No entries.");
+    } else {
+        mvwprintw(doc_win, y + line_count + 2, x, "Entries %d-%d of %d", reader->scroll.i + 1, last_entry + 1, reader->count);
+    }
+}
+
+// returns the index of the last entry on screen
+int print_reader_content(Reader *reader, WINDOW *doc_win, SubWindow *entry_content) {
+    int y = entry_content->pos_y + entry_content->top;
+    int x = entry_content->pos_x + entry_content->left;
+    Index row = reader->scroll;
+    for (int i = 0; i < reader->height && reader->count > 0; i++) {
+        EntryLayout *layout = reader_get_layout(reader, row.i);
+        if (row.j == 0) {
+            mvwprintw(doc_win, y + i, x, "%*d.", reader->label_width - 2, row.i + 1);
+        }
+        if (row.j < layout->row_count) {
+            Entry *entry = entry_list_get_entry(reader->entry_list, reader->slots[row.i]);
+            size_t end = row.j + 1 < layout->row_count ? layout->row_starts[row.j + 1] : entry->length;
+            print_row(doc_win, y + i, x + reader->label_width, entry->text, layout->row_starts[row.j], end);
+        }
+        if (i + 1 < reader->height && step_down(reader, &row, 1) == 0) {
+            break;
+        }
+    }
+    return row.i;
+}
+
+// control characters (tabs, a newline ending the row) would move the cursor, they're printed as spaces
+void print_row(WINDOW *win, int y, int x, const char *text, size_t start, size_t end) {
+    char buffer[DOC_LINE_BUF_SIZE];
+    size_t length = 0;
+    for (size_t k = start; k < end && length < DOC_LINE_BUF_SIZE - 1; k++) {
+        buffer[length++] = (unsigned char) text[k] < 0x20 ? ' ' : text[k];
+    }
+    buffer[length] = '\0';
+    mvwaddstr(win, y, x, buffer);
+}
+
+void print_reader_keys(WINDOW *summary_win, SubWindow *entry_list_summary) {
+    int y = entry_list_summary->pos_y + entry_list_summary->top;
+    int x = entry_list_summary->pos_x + entry_list_summary->left;
+    mvwaddstr(summary_win, y, x, "Keys:");
+    mvwaddstr(summary_win, y + 2, x, "j/k  scroll");
+    mvwaddstr(summary_win, y + 3, x, "spc/b page");
+    mvwaddstr(summary_win, y + 4, x, "n/p  entry");
+    mvwaddstr(summary_win, y + 5, x, "g/G  top/end");
+    mvwaddstr(summary_win, y + 6, x, "q    quit");
+}
+
+int digit_count(int n) {
+    int digits = 1;
+    while (n >= 10) {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+int max(int a, int b) { return a > b ? a : b; }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef READER_H
+#define READER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../modulo.h"
+#include "../entry_list.h"
+#include "entry_doc.h"
+#include "replay.h"
+
+/*
+Entry reader:
+A scrolling, read only view of an entry list for `modulo today`, `modulo
+history <n>` and `modulo peek` with -r/--reader. It uses the editor's
+screen layout (ScreenModel) with the list's dates in the header.
+
+Entries are shown numbered, wrapped at word boundaries, one blank row
+between them. Nothing is laid out up front: each entry gets an EntryLayout
+(the byte offset its wrapped rows start at) the first time it comes into
+view, and the layout is kept until the width changes. The scroll position
+is an (entry, row) pair like the editor's (line, row), so scrolling,
+paging and drawing step through the rows on screen only. Opening a list
+costs the same with ten entries or ten thousand, and so does a frame.
+*/
+
+#define READER_INIT_ROW_CAP 4
+
+#define KEY_READER_QUIT 'q'
+#define KEY_READER_DOWN 'j'
+#define KEY_READER_UP 'k'
+#define KEY_READER_PAGE_DOWN ' '
+#define KEY_READER_PAGE_UP 'b'
+#define KEY_READER_NEXT 'n'
+#define KEY_READER_PREV 'p'
+#define KEY_READER_TOP 'g'
+#define KEY_READER_END 'G'
+
+typedef struct EntryLayout {
+    /* width the rows were wrapped at, 0 if the entry hasn't been laid out */
+    int width;
+    int row_count;
+    int capacity;
+    /* byte offset of each row in the entry's text */
+    uint32_t *row_starts;
+} EntryLayout;
+
+typedef struct Reader {
+    EntryList *entry_list;
+    Header header;
+    /* live entries, tombstones are skipped */
+    int count;
+    int *slots;
+    /* one per live entry */
+    EntryLayout *layouts;
+    /* columns taken by the entry number, e.g. "12. " */
+    int label_width;
+    /* width entry text wraps at: the content width minus label_width */
+    int wrap_width;
+    /* content rows on screen */
+    int height;
+    /* the top row on screen, row scroll.j of entry scroll.i */
+    Index scroll;
+} Reader;
+
+// title heads the page, the list's dates go under it
+Reader *create_reader(EntryList *entry_list, char *title);
+void free_reader(Reader *reader);
+
+// opens the reader on the terminal until it's quit
+void entry_reader_start(EntryList *entry_list, char *title);
+// runs on the current ncurses screen until quit or keys run out (see KeySource)
+void entry_reader_run(Reader *reader, KeySource *keys);
+
+#endif
\ No newline at end of file
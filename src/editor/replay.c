@@ -0,0 +1,244 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <ncurses.h>
+
+#include "../modulo.h"
+#include "../mem.h"
+#include "../utf8.h"
+#include "entry_editor.h"
+#include "replay.h"
+
+#define FRAME_RECORDER_INIT_CAPACITY 256
+
+typedef struct ReplayKeyName {
+    char *name;
+    KeyInput input;
+} ReplayKeyName;
+
+static ReplayKeyName replay_key_names[] = {
+    { "<up>", { KEY_CODE_YES, KEY_UP } },
+    { "<down>", { KEY_CODE_YES, KEY_DOWN } },
+    { "<left>", { KEY_CODE_YES, KEY_LEFT } },
+    { "<right>", { KEY_CODE_YES, KEY_RIGHT } },
+    { "<bs>", { KEY_CODE_YES, KEY_BACKSPACE } },
+    { "<enter>", { OK, '\n' } },
+    { "<resize>", { KEY_CODE_YES, KEY_RESIZE } },
+    { "<C-w>", { OK, KEY_TOGGLE_WRAP } },
+    { "<C-u>", { OK, KEY_UNDO_EDIT } },
+    { "<C-r>", { OK, KEY_REDO_EDIT } },
+    { "<C-f>", { OK, KEY_SEARCH } },
+    { "<C-g>", { OK, KEY_SEARCH_CANCEL } },
+    { "<tab>", { OK, KEY_COMPLETE } },
+    { "<lt>", { OK, '<' } }
+};
+
+static long long now_ns();
+static long long out_size(int out_fd);
+static int compare_ns(const void *a, const void *b);
+static long long percentile(long long *sorted, int size, double p);
+static void compute_stats(FrameRecorder *recorder, ReplayStats *stats);
+
+KeyInput key_source_next(KeySource *source, WINDOW *win) {
+    if (source->keys == NULL) {
+        wint_t key;
+        int type = wget_wch(win, &key);
+        return (KeyInput) { .type = type, .key = (int) key };
+    }
+    if (source->pos == source->size) {
+        return (KeyInput) { .type = KEY_SOURCE_END };
+    }
+    return source->keys[source->pos++];
+}
+
+KeyInput *replay_parse_script(char *script, int *key_count) {
+    // every key takes at least one byte of the script
+    size_t script_length = strlen(script);
+    KeyInput *keys = mem_alloc(MEM_EDITOR, (script_length + 1) * sizeof(KeyInput));
+    int size = 0;
+    int name_count = sizeof replay_key_names / sizeof replay_key_names[0];
+    for (char *c = script; *c != '\0'; ) {
+        if (*c != '<') {
+            int bytes;
+            uint32_t code_point = utf8_decode(c, script_length - (c - script), &bytes);
+            keys[size++] = (KeyInput) { .type = OK, .key = (int) code_point };
+            c += bytes;
+            continue;
+        }
+        bool matched = false;
+        for (int i = 0; i < name_count; i++) {
+            size_t length = strlen(replay_key_names[i].name);
+            if (strncmp(c, replay_key_names[i].name, length) == 0) {
+                keys[size++] = replay_key_names[i].input;
+                c += length;
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            fprintf(stderr, "Error: unknown key at offset %td of replay script (use <lt> for a literal '<')\n", c - script);
+            mem_free(keys);
+            return NULL;
+        }
+    }
+    *key_count = size;
+    return keys;
+}
+
+/*
+The screen size comes from LINES and COLUMNS, ncurses reads them in newterm
+when the output isn't a terminal it can ask.
+*/
+int entry_editor_replay(Modulo *modulo, KeyInput *keys, int key_count, int repeat, int rows, int cols, ReplayStats *stats) {
+    FILE *out = tmpfile();
+    FILE *in = fopen("/dev/null", "r");
+    if (out == NULL || in == NULL) {
+        return -1;
+    }
+    char size_buf[16];
+    snprintf(size_buf, sizeof size_buf, "%d", rows);
+    setenv("LINES", size_buf, 1);
+    snprintf(size_buf, sizeof size_buf, "%d", cols);
+    setenv("COLUMNS", size_buf, 1);
+    entry_editor_set_locale();
+    SCREEN *screen = newterm(REPLAY_TERM, out, in);
+    if (screen == NULL) {
+        fclose(out);
+        fclose(in);
+        return -1;
+    }
+    set_term(screen);
+    cbreak();
+    noecho();
+
+    // the script played back to back repeat times
+    KeySource source = {
+        .keys = mem_alloc(MEM_EDITOR, (size_t) key_count * repeat * sizeof(KeyInput)),
+        .size = key_count * repeat,
+        .pos = 0
+    };
+    for (int i = 0; i < repeat; i++) {
+        memcpy(&source.keys[i * key_count], keys, key_count * sizeof(KeyInput));
+    }
+    FrameRecorder recorder = create_frame_recorder(fileno(out));
+
+    // NULL context, nothing the script submits is saved
+    entry_editor_run(modulo, NULL, &source, &recorder);
+    endwin();
+
+    compute_stats(&recorder, stats);
+    stats->key_count = source.size;
+
+    free_frame_recorder(&recorder);
+    mem_free(source.keys);
+    delscreen(screen);
+    fclose(out);
+    fclose(in);
+    return 0;
+}
+
+void replay_print_stats(ReplayStats *stats) {
+    printf("keys:          %d\n", stats->key_count);
+    printf("frames:        %d\n", stats->frames);
+    printf("latency p50:   %.1f us\n", stats->p50_ns / 1000.0);
+    printf("latency p90:   %.1f us\n", stats->p90_ns / 1000.0);
+    printf("latency p99:   %.1f us\n", stats->p99_ns / 1000.0);
+    printf("latency max:   %.1f us\n", stats->max_ns / 1000.0);
+    printf("latency mean:  %.1f us\n", stats->mean_ns / 1000.0);
+    printf("bytes emitted: %lld (%.1f per frame, max %lld)\n",
+        stats->total_bytes,
+        stats->frames > 0 ? (double) stats->total_bytes / stats->frames : 0.0,
+        stats->max_frame_bytes
+    );
+}
+
+/* FrameRecorder */
+FrameRecorder create_frame_recorder(int out_fd) {
+    FrameRecorder recorder = {
+        .out_fd = out_fd,
+        .frame_start_ns = 0,
+        .out_bytes = out_size(out_fd),
+        .size = 0,
+        .capacity = FRAME_RECORDER_INIT_CAPACITY,
+        .latency_ns = mem_alloc(MEM_EDITOR, FRAME_RECORDER_INIT_CAPACITY * sizeof(long long)),
+        .bytes = mem_alloc(MEM_EDITOR, FRAME_RECORDER_INIT_CAPACITY * sizeof(long long))
+    };
+    return recorder;
+}
+
+void free_frame_recorder(FrameRecorder *recorder) {
+    mem_free(recorder->latency_ns);
+    mem_free(recorder->bytes);
+}
+
+void frame_recorder_begin(FrameRecorder *recorder) {
+    recorder->frame_start_ns = now_ns();
+}
+
+void frame_recorder_end(FrameRecorder *recorder) {
+    long long end_ns = now_ns();
+    if (recorder->size == recorder->capacity) {
+        recorder->capacity *= 2;
+        recorder->latency_ns = mem_realloc(MEM_EDITOR, recorder->latency_ns, recorder->capacity * sizeof(long long));
+        recorder->bytes = mem_realloc(MEM_EDITOR, recorder->bytes, recorder->capacity * sizeof(long long));
+    }
+    long long out_bytes = out_size(recorder->out_fd);
+    recorder->latency_ns[recorder->size] = end_ns - recorder->frame_start_ns;
+    recorder->bytes[recorder->size] = out_bytes - recorder->out_bytes;
+    recorder->out_bytes = out_bytes;
+    recorder->size++;
+}
+
+long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+long long out_size(int out_fd) {
+    struct stat st;
+    if (fstat(out_fd, &st) == -1) {
+        return 0;
+    }
+    return (long long) st.st_size;
+}
+
+void compute_stats(FrameRecorder *recorder, ReplayStats *stats) {
+    int size = recorder->size;
+    *stats = (ReplayStats) { .frames = size };
+    if (size == 0) {
+        return;
+    }
+    long long total_ns = 0;
+    for (int i = 0; i < size; i++) {
+        total_ns += recorder->latency_ns[i];
+        stats->total_bytes += recorder->bytes[i];
+        if (recorder->bytes[i] > stats->max_frame_bytes) {
+            stats->max_frame_bytes = recorder->bytes[i];
+        }
+    }
+    qsort(recorder->latency_ns, size, sizeof(long long), compare_ns);
+    stats->p50_ns = percentile(recorder->latency_ns, size, 0.50);
+    stats->p90_ns = percentile(recorder->latency_ns, size, 0.90);
+    stats->p99_ns = percentile(recorder->latency_ns, size, 0.99);
+    stats->max_ns = recorder->latency_ns[size-1];
+    stats->mean_ns = total_ns / size;
+}
+
+// nearest rank percentile of a sorted array
+long long percentile(long long *sorted, int size, double p) {
+    int rank = (int) (p * size + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > size) rank = size;
+    return sorted[rank-1];
+}
+
+int compare_ns(const void *a, const void *b) {
+    long long x = *(const long long *) a;
+    long long y = *(const long long *) b;
+    return (x > y) - (x < y);
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <ncurses.h>
+
+#include "../modulo.h"
+
+/*
+Headless editor replay
+
+`modulo debug replay <script>` drives the entry editor from a recorded
+keystroke script instead of a terminal. ncurses runs on a newterm screen
+that writes to a temp file and reads from /dev/null, so every frame goes
+through the same get_user_event -> model_handle_* -> view_update ->
+view_render path as an interactive session, and the bytes ncurses emits can
+be counted. Submitted entries are never saved (the editor gets a NULL
+OSContext).
+
+Script format: characters (UTF-8) are typed as they appear, a newline is Enter,
+and special keys are written in angle brackets
+
+    <up> <down> <left> <right> <bs> <enter> <tab> <resize> <C-w> <C-u> <C-r> <C-f> <C-g> <lt> (a literal '<')
+
+e.g.
+    Call the bank<bs><bs><bs><bs>dentist%
+    Buy milk<left><left><left><left>oat %%%
+*/
+
+#define REPLAY_DEFAULT_ROWS 24
+#define REPLAY_DEFAULT_COLS 80
+#define REPLAY_TERM "xterm"
+
+/* KeyInput type once a script runs out */
+#define KEY_SOURCE_END -2
+
+/*
+KeyInput:
+One key the way wget_wch reports it. type is OK for a character (key is a
+code point), KEY_CODE_YES for a function key (key is KEY_UP, KEY_RESIZE, ...)
+and ERR when there was nothing to read.
+*/
+typedef struct KeyInput {
+    int type;
+    int key;
+} KeyInput;
+
+/*
+KeySource:
+Where the editor reads keys from. keys == NULL reads from the terminal.
+*/
+typedef struct KeySource {
+    KeyInput *keys;
+    int size;
+    int pos;
+} KeySource;
+
+/*
+FrameRecorder:
+Latency and terminal output per frame. A frame starts when the editor
+receives an event and ends when view_render has flushed the result.
+*/
+typedef struct FrameRecorder {
+    /* fd ncurses writes to, its size is the number of bytes emitted */
+    int out_fd;
+    long long frame_start_ns;
+    long long out_bytes;
+    int size;
+    int capacity;
+    long long *latency_ns;
+    long long *bytes;
+} FrameRecorder;
+
+typedef struct ReplayStats {
+    int key_count;
+    int frames;
+    long long p50_ns;
+    long long p90_ns;
+    long long p99_ns;
+    long long max_ns;
+    long long mean_ns;
+    long long total_bytes;
+    long long max_frame_bytes;
+} ReplayStats;
+
+KeyInput key_source_next(KeySource *source, WINDOW *win);
+
+// returns the keys in the script (size in key_count), NULL on a parse error
+KeyInput *replay_parse_script(char *script, int *key_count);
+
+// replays keys repeat times in one headless editor session, returns -1 if the terminal can't be set up
+int entry_editor_replay(Modulo *modulo, KeyInput *keys, int key_count, int repeat, int rows, int cols, ReplayStats *stats);
+void replay_print_stats(ReplayStats *stats);
+
+FrameRecorder create_frame_recorder(int out_fd);
+void free_frame_recorder(FrameRecorder *recorder);
+void frame_recorder_begin(FrameRecorder *recorder);
+void frame_recorder_end(FrameRecorder *recorder);
+
+#endif
\ No newline at end of file
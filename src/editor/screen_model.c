@@ -5,14 +5,15 @@
 
 #include "screen_model.h"
 #include "entry_doc.h"
+#include "../mem.h"
 
-static void init_window_models(ScreenModel *screen_model, EntryDoc *entry_doc, int screen_h, int screen_w);
+static void init_window_models(ScreenModel *screen_model, Header *header, int screen_h, int screen_w);
 static void init_doc_model(DocModel *doc_model);
 static void init_summary_model(SummaryModel *summary_model);
 
-static void resize_doc_model(DocModel *doc_model, EntryDoc *entry_doc, int screen_h, int screen_w, bool small_width);
-static void resize_doc_subwindows(DocModel *doc_model, EntryDoc *entry_doc);
-static void resize_doc_header(DocModel *doc_model, EntryDoc *entry_doc);
+static void resize_doc_model(DocModel *doc_model, Header *doc_header, int screen_h, int screen_w, bool small_width);
+static void resize_doc_subwindows(DocModel *doc_model, Header *doc_header);
+static void resize_doc_header(DocModel *doc_model, Header *doc_header);
 static void resize_doc_entry_content(DocModel *doc_model);
 
 static void resize_summary_model(SummaryModel *window_model, int screen_h, int screen_w, bool small_width);
@@ -26,20 +27,20 @@ static size_t line_wrap_count(size_t length, size_t width);
 
 bool check_small_width(int width);
 
-ScreenModel *create_screen_model(EntryDoc *entry_doc, int screen_h, int screen_w) {
-    ScreenModel *screen_model = malloc(sizeof(ScreenModel));
+ScreenModel *create_screen_model(Header *header, int screen_h, int screen_w) {
+    ScreenModel *screen_model = mem_alloc(MEM_EDITOR, sizeof(ScreenModel));
 
     screen_model->height = screen_h;
     screen_model->width = screen_w;
-    init_window_models(screen_model, entry_doc, screen_h, screen_w);
+    init_window_models(screen_model, header, screen_h, screen_w);
     return screen_model;
 }
 
 void free_screen_model(ScreenModel *screen_model) {
-    free(screen_model);
+    mem_free(screen_model);
 }
 
-void init_window_models(ScreenModel *screen_model, EntryDoc *entry_doc, int screen_h, int screen_w) {
+void init_window_models(ScreenModel *screen_model, Header *header, int screen_h, int screen_w) {
     DocModel *doc_model = &screen_model->doc_model;
     SummaryModel *summary_model = &screen_model->summary_model;
 
@@ -47,7 +48,7 @@ void init_window_models(ScreenModel *screen_model, EntryDoc *entry_doc, int scre
     init_summary_model(summary_model);
 
     bool is_small_width = check_small_width(screen_w);
-    resize_doc_model(doc_model, entry_doc, screen_h, screen_w, is_small_width);
+    resize_doc_model(doc_model, header, screen_h, screen_w, is_small_width);
     resize_summary_model(summary_model, screen_h, screen_w, is_small_width);
 }
 
@@ -71,6 +72,8 @@ void init_doc_model(DocModel *doc_model) {
     
     doc_model->content_update = true;
     doc_model->size_update = false;
+    doc_model->lines_update = true;
+    doc_model->painted = false;
 }
 
 void init_summary_model(SummaryModel *summary_model) {
@@ -98,7 +101,7 @@ void init_summary_model(SummaryModel *summary_model) {
     summary_model->size_update = false;
 }
 
-void resize_doc_model(DocModel *doc_model, EntryDoc *entry_doc, int screen_h, int screen_w, bool is_small_width) {
+void resize_doc_model(DocModel *doc_model, Header *doc_header, int screen_h, int screen_w, bool is_small_width) {
     doc_model->height = screen_h;
     doc_model->size_update = true;
     if (is_small_width) {
@@ -110,17 +113,17 @@ void resize_doc_model(DocModel *doc_model, EntryDoc *entry_doc, int screen_h, in
     }
     SubWindow *header = &doc_model->header;
     SubWindow *entry_content = &doc_model->entry_content;
-    resize_doc_subwindows(doc_model, entry_doc);
+    resize_doc_subwindows(doc_model, doc_header);
 }
 
-void resize_doc_subwindows(DocModel *doc_model, EntryDoc *entry_doc) {
+void resize_doc_subwindows(DocModel *doc_model, Header *doc_header) {
     // applying these in order matters
     // i.e. (header.height, header.width) => (entry_content.height, entry_conent.width)
-    resize_doc_header(doc_model, entry_doc);
+    resize_doc_header(doc_model, doc_header);
     resize_doc_entry_content(doc_model);
 }
 
-void resize_doc_header(DocModel *doc_model, EntryDoc *entry_doc) {
+void resize_doc_header(DocModel *doc_model, Header *doc_header) {
     SubWindow *header = &doc_model->header;
 
     header->width = doc_model->width - horizontal_margin(header);
@@ -130,8 +133,8 @@ void resize_doc_header(DocModel *doc_model, EntryDoc *entry_doc) {
     // easily could lead to undefined behavior I think
     // But coding this made it crystal clear to me that arrays, like structs, are values
     // -- not syntactic sugar for address/pointer
-    char (*header_lines)[HEADER_MAX_LINES][HEADER_MAX_LINE_LENGTH] = &entry_doc->header.lines;
-    int line_count = entry_doc->header.line_count;
+    char (*header_lines)[HEADER_MAX_LINES][HEADER_MAX_LINE_LENGTH] = &doc_header->lines;
+    int line_count = doc_header->line_count;
     for (size_t i = 0; i < line_count; i++) {
         size_t length = strlen((*header_lines)[i]);
         header_height += line_wrap_count(length, header->width);
@@ -196,9 +199,9 @@ void resize_summary_entry_list_summary(SummaryModel *summary_model) {
     entry_list_summary->height = container_height - vertical_margin(entry_list_summary);
 }
 
-void screen_model_resize(ScreenModel *screen_model, EntryDoc *entry_doc, int height, int width) {
+void screen_model_resize(ScreenModel *screen_model, Header *header, int height, int width) {
     bool is_small_width = check_small_width(width);
-    resize_doc_model(&screen_model->doc_model, entry_doc, height, width, is_small_width);
+    resize_doc_model(&screen_model->doc_model, header, height, width, is_small_width);
     resize_summary_model(&screen_model->summary_model, height, width, is_small_width);
 }
 
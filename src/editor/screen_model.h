@@ -66,6 +66,13 @@ typedef struct DocModel {
     SubWindow entry_content;
     bool content_update;
     bool size_update;
+    /* the text changed. content_update alone (a cursor move) lets the view scroll what's already drawn */
+    bool lines_update;
+    /* scroll position the content was last drawn at, kept by the view */
+    bool painted;
+    bool painted_soft_wrap;
+    Index painted_scroll;
+    int painted_scroll_row;
 } DocModel;
 
 typedef struct ScreenModel {
@@ -75,10 +82,11 @@ typedef struct ScreenModel {
     SummaryModel summary_model;
 } ScreenModel;
 
-ScreenModel *create_screen_model(EntryDoc *entry_doc, int screen_h, int screen_w);
+// the doc window's header is sized to fit header
+ScreenModel *create_screen_model(Header *header, int screen_h, int screen_w);
 void free_screen_model(ScreenModel *screen_model);
 
-void screen_model_resize(ScreenModel *screen_model, EntryDoc *entry_doc, int height, int width);
+void screen_model_resize(ScreenModel *screen_model, Header *header, int height, int width);
 bool screen_model_is_resize(ScreenModel *screen_model);
 void screen_model_set_resize(ScreenModel *screen_model, bool flag);
 
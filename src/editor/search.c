@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "search.h"
+#include "entry_doc.h"
+#include "../mem.h"
+#include "../utf8.h"
+
+static void full_scan(DocSearch *search, EntryDoc *entry_doc);
+static void filter_top_level(DocSearch *search, EntryDoc *entry_doc, size_t old_length);
+static SearchLevel *push_level(DocSearch *search, size_t length);
+static SearchLevel *top_level(DocSearch *search);
+static void add_match(SearchLevel *level, int i, int j);
+static void select_current(DocSearch *search, EntryDoc *entry_doc);
+static void step(DocSearch *search, EntryDoc *entry_doc, int direction);
+static void free_levels(DocSearch *search);
+static int compare_index(Index a, Index b);
+
+DocSearch *create_doc_search() {
+    DocSearch *search = mem_alloc(MEM_EDITOR, sizeof(DocSearch));
+    search->active = false;
+    search->length = 0;
+    search->level_count = 0;
+    search->current = -1;
+    search->last_length = 0;
+    for (int k = 0; k < SEARCH_MAX_QUERY; k++) {
+        search->levels[k] = (SearchLevel) { .length = 0, .count = 0, .capacity = 0, .matches = NULL };
+    }
+    return search;
+}
+
+void free_doc_search(DocSearch *search) {
+    free_levels(search);
+    mem_free(search);
+}
+
+void search_start(DocSearch *search, EntryDoc *entry_doc) {
+    search->active = true;
+    search->origin = entry_doc_get_effective_cursor(entry_doc);
+    search->anchor = search->origin;
+    search->length = 0;
+    search->level_count = 0;
+    search->current = -1;
+}
+
+void search_end(DocSearch *search, EntryDoc *entry_doc, bool cancel) {
+    if (search->length > 0) {
+        memcpy(search->last_query, search->query, search->length);
+        search->last_length = search->length;
+    }
+    if (cancel) {
+        entry_doc->cursor = search->origin;
+    }
+    search->active = false;
+    search->length = 0;
+    search->current = -1;
+    // match lists can be as long as the document, don't hold on to them
+    free_levels(search);
+}
+
+void search_push_char(DocSearch *search, EntryDoc *entry_doc, uint32_t c) {
+    char bytes[UTF8_MAX_BYTES];
+    int count = utf8_encode(c, bytes);
+    if (count == 0 || search->length + count > SEARCH_MAX_QUERY) {
+        return;
+    }
+    size_t old_length = search->length;
+    memcpy(&search->query[old_length], bytes, count);
+    search->length += count;
+    SearchLevel *top = top_level(search);
+    if (top != NULL && top->length == old_length) {
+        filter_top_level(search, entry_doc, old_length);
+    } else {
+        full_scan(search, entry_doc);
+    }
+    select_current(search, entry_doc);
+}
+
+void search_pop_char(DocSearch *search, EntryDoc *entry_doc) {
+    if (search->length == 0) {
+        return;
+    }
+    search->length = utf8_prev(search->query, search->length);
+    while (search->level_count > 0 && top_level(search)->length > search->length) {
+        search->level_count--;
+    }
+    SearchLevel *top = top_level(search);
+    if (search->length > 0 && (top == NULL || top->length != search->length)) {
+        full_scan(search, entry_doc);
+    }
+    select_current(search, entry_doc);
+}
+
+void search_next(DocSearch *search, EntryDoc *entry_doc) {
+    if (search->length == 0 && search->last_length > 0) {
+        memcpy(search->query, search->last_query, search->last_length);
+        search->length = search->last_length;
+        search->level_count = 0;
+        full_scan(search, entry_doc);
+        select_current(search, entry_doc);
+        return;
+    }
+    step(search, entry_doc, 1);
+}
+
+void search_prev(DocSearch *search, EntryDoc *entry_doc) {
+    step(search, entry_doc, -1);
+}
+
+int search_match_count(DocSearch *search) {
+    SearchLevel *top = top_level(search);
+    if (search->length == 0 || top == NULL) {
+        return 0;
+    }
+    return top->count;
+}
+
+int search_first_match_on_line(DocSearch *search, int i) {
+    int count = search_match_count(search);
+    if (count == 0) {
+        return 0;
+    }
+    Index *matches = top_level(search)->matches;
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (matches[mid].i < i) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < count && matches[lo].i != i) {
+        return count;
+    }
+    return lo;
+}
+
+Index search_get_match(DocSearch *search, int index) {
+    return top_level(search)->matches[index];
+}
+
+/*
+Boyer-Moore-Horspool: compare the window's last byte first, on a mismatch
+shift by how far that byte is from the end of the pattern (the whole pattern
+length if it isn't in it). Single bytes go to memchr.
+*/
+void horspool_build_skip(const char *pattern, size_t pattern_length, size_t skip[256]) {
+    for (int c = 0; c < 256; c++) {
+        skip[c] = pattern_length;
+    }
+    for (size_t k = 0; k + 1 < pattern_length; k++) {
+        skip[(unsigned char) pattern[k]] = pattern_length - 1 - k;
+    }
+}
+
+long horspool_find(const char *text, size_t text_length, const char *pattern, size_t pattern_length, const size_t skip[256], size_t from) {
+    if (pattern_length == 0 || from >= text_length || text_length - from < pattern_length) {
+        return -1;
+    }
+    if (pattern_length == 1) {
+        const char *hit = memchr(text + from, pattern[0], text_length - from);
+        return hit != NULL ? hit - text : -1;
+    }
+    unsigned char last = pattern[pattern_length-1];
+    size_t pos = from;
+    while (pos + pattern_length <= text_length) {
+        unsigned char c = text[pos + pattern_length - 1];
+        if (c == last && memcmp(text + pos, pattern, pattern_length - 1) == 0) {
+            return pos;
+        }
+        pos += skip[c];
+    }
+    return -1;
+}
+
+// the whole document is searched, lines that haven't been built yet are built first
+void full_scan(DocSearch *search, EntryDoc *entry_doc) {
+    entry_doc_load_lines(entry_doc, SIZE_MAX);
+    search->level_count = 0;
+    SearchLevel *level = push_level(search, search->length);
+    size_t skip[256];
+    horspool_build_skip(search->query, search->length, skip);
+    for (size_t i = 0; i < entry_doc->line_count; i++) {
+        Line *line = entry_doc_get_line(entry_doc, i);
+        long j = horspool_find(line->chars, line->length, search->query, search->length, skip, 0);
+        while (j != -1) {
+            add_match(level, i, j);
+            j = horspool_find(line->chars, line->length, search->query, search->length, skip, j + 1);
+        }
+    }
+}
+
+// keeps the top level's matches that go on with the new bytes, as a new level
+void filter_top_level(DocSearch *search, EntryDoc *entry_doc, size_t old_length) {
+    SearchLevel *prev = top_level(search);
+    SearchLevel *level = push_level(search, search->length);
+    const char *added = &search->query[old_length];
+    size_t added_length = search->length - old_length;
+    for (int k = 0; k < prev->count; k++) {
+        Index match = prev->matches[k];
+        Line *line = entry_doc_get_line(entry_doc, match.i);
+        size_t end = match.j + search->length;
+        if (end <= line->length && memcmp(&line->chars[match.j + old_length], added, added_length) == 0) {
+            add_match(level, match.i, match.j);
+        }
+    }
+}
+
+SearchLevel *push_level(DocSearch *search, size_t length) {
+    SearchLevel *level = &search->levels[search->level_count++];
+    level->length = length;
+    level->count = 0;
+    return level;
+}
+
+SearchLevel *top_level(DocSearch *search) {
+    if (search->level_count == 0) {
+        return NULL;
+    }
+    return &search->levels[search->level_count-1];
+}
+
+void add_match(SearchLevel *level, int i, int j) {
+    if (level->count == level->capacity) {
+        int new_cap = level->capacity > 0 ? level->capacity * 2 : SEARCH_INIT_MATCH_CAP;
+        level->matches = mem_realloc(MEM_EDITOR, level->matches, new_cap * sizeof(Index));
+        level->capacity = new_cap;
+    }
+    level->matches[level->count++] = (Index) { .i = i, .j = j };
+}
+
+// the first match at or after the anchor (wrapping around), the cursor goes back to the anchor if nothing matches
+void select_current(DocSearch *search, EntryDoc *entry_doc) {
+    int count = search_match_count(search);
+    if (count == 0) {
+        search->current = -1;
+        entry_doc->cursor = search->anchor;
+        return;
+    }
+    Index *matches = top_level(search)->matches;
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (compare_index(matches[mid], search->anchor) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    search->current = lo < count ? lo : 0;
+    entry_doc->cursor = matches[search->current];
+}
+
+void step(DocSearch *search, EntryDoc *entry_doc, int direction) {
+    int count = search_match_count(search);
+    if (count == 0) {
+        return;
+    }
+    search->current = (search->current + direction + count) % count;
+    search->anchor = search_get_match(search, search->current);
+    entry_doc->cursor = search->anchor;
+}
+
+void free_levels(DocSearch *search) {
+    for (int k = 0; k < SEARCH_MAX_QUERY; k++) {
+        mem_free(search->levels[k].matches);
+        search->levels[k] = (SearchLevel) { .length = 0, .count = 0, .capacity = 0, .matches = NULL };
+    }
+    search->level_count = 0;
+}
+
+int compare_index(Index a, Index b) {
+    if (a.i != b.i) {
+        return a.i < b.i ? -1 : 1;
+    }
+    return a.j < b.j ? -1 : (a.j > b.j ? 1 : 0);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "entry_doc.h"
+
+/*
+DocSearch:
+Incremental search over an EntryDoc's lines (Ctrl-F in the editor).
+
+Matches are kept per query length in levels, levels[k] holds every match of
+the query's first levels[k].length bytes, sorted by (line, byte). A match of
+a longer query starts where the shorter one matched, so a new character only
+filters the top level instead of rescanning the document, and backspace just
+drops the top level. A query that didn't grow from an existing level (reusing
+the last query, or backspacing below it) scans the document with a
+Boyer-Moore-Horspool skip table.
+
+Matches overlap ("aa" matches twice in "aaa") so the subset rule holds.
+The document can't be edited while a search is active, which keeps the
+match positions valid.
+*/
+
+#define SEARCH_MAX_QUERY 64
+#define SEARCH_INIT_MATCH_CAP 64
+
+typedef struct SearchLevel {
+    /* query bytes these matches are for */
+    size_t length;
+    int count;
+    int capacity;
+    Index *matches;
+} SearchLevel;
+
+struct DocSearch {
+    bool active;
+    /* cursor when the search started, restored on cancel */
+    Index origin;
+    /* matches at or after the anchor are preferred, next and prev move it */
+    Index anchor;
+    char query[SEARCH_MAX_QUERY];
+    size_t length;
+    int level_count;
+    SearchLevel levels[SEARCH_MAX_QUERY];
+    /* index of the current match in the top level, -1 if there are none */
+    int current;
+    /* the last query searched for, Ctrl-F on an empty query brings it back */
+    char last_query[SEARCH_MAX_QUERY];
+    size_t last_length;
+};
+
+DocSearch *create_doc_search();
+void free_doc_search(DocSearch *search);
+
+void search_start(DocSearch *search, EntryDoc *entry_doc);
+// ends the search, cancel puts the cursor back where it started
+void search_end(DocSearch *search, EntryDoc *entry_doc, bool cancel);
+
+// each of these moves the cursor to the current match
+void search_push_char(DocSearch *search, EntryDoc *entry_doc, uint32_t c);
+void search_pop_char(DocSearch *search, EntryDoc *entry_doc);
+// on an empty query next brings back the last query
+void search_next(DocSearch *search, EntryDoc *entry_doc);
+void search_prev(DocSearch *search, EntryDoc *entry_doc);
+
+int search_match_count(DocSearch *search);
+// index of the first match on line i (binary search), match_count if there are none
+int search_first_match_on_line(DocSearch *search, int i);
+Index search_get_match(DocSearch *search, int index);
+
+// first occurrence of pattern in text at or after from, -1 if there is none
+long horspool_find(const char *text, size_t text_length, const char *pattern, size_t pattern_length, const size_t skip[256], size_t from);
+void horspool_build_skip(const char *pattern, size_t pattern_length, size_t skip[256]);
+
+#endif
\ No newline at end of file
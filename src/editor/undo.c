@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "undo.h"
+#include "../mem.h"
+
+static UndoOp *op_at(UndoLog *log, size_t k);
+static UndoOp *last_op(UndoLog *log);
+static UndoOp *push_op(UndoLog *log, UndoOpType type, int i, int j, char *bytes, size_t count);
+static void op_reserve(UndoLog *log, UndoOp *op, size_t required);
+static void drop_redo(UndoLog *log);
+static void drop_oldest(UndoLog *log);
+static void enforce_budget(UndoLog *log);
+static void check_op_capacity(UndoLog *log);
+static void free_op(UndoLog *log, UndoOp *op);
+
+UndoLog *create_undo_log(size_t budget) {
+    UndoLog *log = mem_alloc(MEM_EDITOR, sizeof(UndoLog));
+    log->budget = budget > 0 ? budget : undo_budget_from_env();
+    log->bytes = 0;
+    log->capacity = UNDO_INIT_OP_CAP;
+    log->head = 0;
+    log->count = 0;
+    log->applied = 0;
+    log->sealed = false;
+    log->ops = mem_alloc(MEM_EDITOR, UNDO_INIT_OP_CAP * sizeof(UndoOp));
+    return log;
+}
+
+size_t undo_budget_from_env() {
+    char *value = getenv(UNDO_BUDGET_ENV_VAR);
+    if (value == NULL || value[0] == '\0') {
+        return UNDO_DEFAULT_BUDGET;
+    }
+    char *end;
+    unsigned long long budget = strtoull(value, &end, 10);
+    if (*end != '\0' || budget == 0) {
+        return UNDO_DEFAULT_BUDGET;
+    }
+    return (size_t) budget;
+}
+
+void undo_log_record_insert(UndoLog *log, int i, int j, char *bytes, size_t count) {
+    drop_redo(log);
+    UndoOp *last = last_op(log);
+    bool extends = last != NULL && !log->sealed && last->type == UNDO_INSERT
+        && last->i == i && (size_t) last->j + last->length == (size_t) j;
+    // a run is a word and the spaces after it
+    if (extends && last->text[last->length-1] == ' ' && bytes[0] != ' ') {
+        extends = false;
+    }
+    if (!extends) {
+        push_op(log, UNDO_INSERT, i, j, bytes, count);
+        enforce_budget(log);
+        return;
+    }
+    op_reserve(log, last, last->length + count);
+    memcpy(&last->text[last->length], bytes, count);
+    last->length += count;
+    enforce_budget(log);
+}
+
+void undo_log_record_delete(UndoLog *log, int i, int j, char *bytes, size_t count) {
+    drop_redo(log);
+    UndoOp *last = last_op(log);
+    bool extends = last != NULL && !log->sealed && last->type == UNDO_DELETE
+        && last->i == i && (size_t) j + count == (size_t) last->j;
+    if (!extends) {
+        push_op(log, UNDO_DELETE, i, j, bytes, count);
+        enforce_budget(log);
+        return;
+    }
+    // backspace deletes leftwards, the new bytes go in front of the run
+    op_reserve(log, last, last->length + count);
+    memmove(&last->text[count], last->text, last->length);
+    memcpy(last->text, bytes, count);
+    last->length += count;
+    last->j = j;
+    enforce_budget(log);
+}
+
+void undo_log_record_split(UndoLog *log, int i, int j) {
+    drop_redo(log);
+    push_op(log, UNDO_SPLIT, i, j, NULL, 0);
+    enforce_budget(log);
+}
+
+void undo_log_record_join(UndoLog *log, int i, int j) {
+    drop_redo(log);
+    push_op(log, UNDO_JOIN, i, j, NULL, 0);
+    enforce_budget(log);
+}
+
+void undo_log_seal(UndoLog *log) {
+    log->sealed = true;
+}
+
+UndoOp *undo_log_undo(UndoLog *log) {
+    log->sealed = true;
+    if (log->applied == 0) {
+        return NULL;
+    }
+    log->applied--;
+    return op_at(log, log->applied);
+}
+
+UndoOp *undo_log_redo(UndoLog *log) {
+    log->sealed = true;
+    if (log->applied == log->count) {
+        return NULL;
+    }
+    log->applied++;
+    return op_at(log, log->applied-1);
+}
+
+void undo_log_clear(UndoLog *log) {
+    for (size_t k = 0; k < log->count; k++) {
+        free_op(log, op_at(log, k));
+    }
+    log->head = 0;
+    log->count = 0;
+    log->applied = 0;
+    log->sealed = false;
+}
+
+void free_undo_log(UndoLog *log) {
+    undo_log_clear(log);
+    mem_free(log->ops);
+    mem_free(log);
+}
+
+UndoOp *op_at(UndoLog *log, size_t k) {
+    return &log->ops[(log->head + k) % log->capacity];
+}
+
+UndoOp *last_op(UndoLog *log) {
+    if (log->count == 0) {
+        return NULL;
+    }
+    return op_at(log, log->count-1);
+}
+
+UndoOp *push_op(UndoLog *log, UndoOpType type, int i, int j, char *bytes, size_t count) {
+    check_op_capacity(log);
+    UndoOp *op = op_at(log, log->count);
+    *op = (UndoOp) { .type = type, .i = i, .j = j, .length = 0, .capacity = 0, .text = NULL };
+    log->count++;
+    log->applied = log->count;
+    log->sealed = false;
+    log->bytes += sizeof(UndoOp);
+    if (bytes != NULL) {
+        op_reserve(log, op, count);
+        memcpy(op->text, bytes, count);
+        op->length = count;
+    }
+    return op;
+}
+
+void op_reserve(UndoLog *log, UndoOp *op, size_t required) {
+    if (op->capacity >= required) {
+        return;
+    }
+    size_t new_cap = op->capacity > 0 ? op->capacity : UNDO_INIT_TEXT_CAP;
+    while (new_cap < required) {
+        new_cap *= 2;
+    }
+    op->text = mem_realloc(MEM_EDITOR, op->text, new_cap);
+    log->bytes += new_cap - op->capacity;
+    op->capacity = new_cap;
+}
+
+void drop_redo(UndoLog *log) {
+    for (size_t k = log->applied; k < log->count; k++) {
+        free_op(log, op_at(log, k));
+    }
+    log->count = log->applied;
+}
+
+void drop_oldest(UndoLog *log) {
+    free_op(log, op_at(log, 0));
+    log->head = (log->head + 1) % log->capacity;
+    log->count--;
+    log->applied--;
+}
+
+// the newest op is kept even if it's over budget on its own
+void enforce_budget(UndoLog *log) {
+    while (log->bytes > log->budget && log->count > 1) {
+        drop_oldest(log);
+    }
+}
+
+// unrolls the ring into a buffer twice the size
+void check_op_capacity(UndoLog *log) {
+    if (log->count < log->capacity) {
+        return;
+    }
+    size_t new_cap = log->capacity * 2;
+    UndoOp *ops = mem_alloc(MEM_EDITOR, new_cap * sizeof(UndoOp));
+    for (size_t k = 0; k < log->count; k++) {
+        ops[k] = *op_at(log, k);
+    }
+    mem_free(log->ops);
+    log->ops = ops;
+    log->capacity = new_cap;
+    log->head = 0;
+}
+
+void free_op(UndoLog *log, UndoOp *op) {
+    log->bytes -= sizeof(UndoOp) + op->capacity;
+    mem_free(op->text);
+    op->text = NULL;
+    op->capacity = 0;
+    op->length = 0;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef UNDO_H
+#define UNDO_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+/*
+UndoLog:
+Edits are recorded as the operation and the bytes it touched, never as
+document snapshots, so the log grows with the edits and not with the
+document:
+
+    UNDO_INSERT  text was inserted at (i, j)
+    UNDO_DELETE  text was deleted starting at (i, j)
+    UNDO_SPLIT   line i was split at j (enter)
+    UNDO_JOIN    line i+1 was joined onto line i, j is where they met (backspace at line start)
+
+Consecutive keystrokes are coalesced into one run: typing extends the last
+insert until a word starts after a space, backspacing extends the last delete.
+A cursor move, undo or redo seals the run.
+
+ops is a ring buffer, [0, applied) can be undone and [applied, count) redone.
+A new edit drops the redo ops, and the oldest ops are dropped once the log's
+size (op structs plus text) goes over budget.
+*/
+
+#define UNDO_BUDGET_ENV_VAR "MODULO_UNDO_BUDGET"
+#define UNDO_DEFAULT_BUDGET (64 * 1024)
+#define UNDO_INIT_OP_CAP 32
+#define UNDO_INIT_TEXT_CAP 16
+
+typedef enum UndoOpType {
+    UNDO_INSERT,
+    UNDO_DELETE,
+    UNDO_SPLIT,
+    UNDO_JOIN
+} UndoOpType;
+
+typedef struct UndoOp {
+    UndoOpType type;
+    int i;
+    int j;
+    size_t length;
+    size_t capacity;
+    /* NULL for split and join */
+    char *text;
+} UndoOp;
+
+typedef struct UndoLog {
+    size_t budget;
+    size_t bytes;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    size_t applied;
+    /* the last op can't be extended */
+    bool sealed;
+    UndoOp *ops;
+} UndoLog;
+
+// budget is in bytes, 0 uses MODULO_UNDO_BUDGET or the default
+UndoLog *create_undo_log(size_t budget);
+size_t undo_budget_from_env();
+
+void undo_log_record_insert(UndoLog *log, int i, int j, char *bytes, size_t count);
+// bytes were deleted from [j, j+count), backspacing again extends the run
+void undo_log_record_delete(UndoLog *log, int i, int j, char *bytes, size_t count);
+void undo_log_record_split(UndoLog *log, int i, int j);
+void undo_log_record_join(UndoLog *log, int i, int j);
+void undo_log_seal(UndoLog *log);
+
+// the op to revert or reapply, NULL if there isn't one. The op stays owned by the log
+UndoOp *undo_log_undo(UndoLog *log);
+UndoOp *undo_log_redo(UndoLog *log);
+
+void undo_log_clear(UndoLog *log);
+void free_undo_log(UndoLog *log);
+
+#endif
\ No newline at end of file
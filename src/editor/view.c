@@ -10,6 +10,8 @@
 #include "../modulo.h"
 #include "screen_model.h"
 #include "view.h"
+#include "../utf8.h"
+#include "search.h"
 
 static bool stage_doc_for_updates(WINDOW *win, DocModel *win_model);
 static bool stage_summary_for_updates(WINDOW *win, SummaryModel *win_model);
@@ -17,13 +19,17 @@ static bool stage_for_updates(WINDOW *win, int pos_y, int pos_x, int height, int
 
 static void view_update_summary_window(WINDOW *summary_win, Modulo *modulo, SummaryModel *summary_model);
 static void view_update_doc_window(WINDOW *doc_win, Modulo *modulo, EntryDoc *entry_doc, DocModel *doc_model);
+static bool scroll_doc_content(WINDOW *doc_win, EntryDoc *entry_doc, DocModel *doc_model);
+static int painted_scroll_delta(EntryDoc *entry_doc, DocModel *doc_model, int max_rows);
+static void remember_painted_scroll(EntryDoc *entry_doc, DocModel *doc_model);
 
 static int min(int a, int b);
 static int max(int a, int b);
 
 static void print_entry_doc_header(WINDOW *doc_win, SubWindow *header, Modulo *modulo, EntryDoc *entry_doc);
-static void print_entry_doc_content(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc);
-static void print_modulo_logo(WINDOW *summary_win, SubWindow *logo);
+static void print_entry_doc_status(WINDOW *doc_win, SubWindow *header, Modulo *modulo, EntryDoc *entry_doc);
+static void print_entry_doc_content(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc, int start_y, int end_y);
+static void print_entry_doc_content_wrapped(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc, int start_y, int end_y);
 static void print_entry_summary(WINDOW *summary_win, SubWindow *entry_list_summary, Modulo *modulo);
 static char *get_entry_preview(const char *entry);
 static void printf_win(WINDOW *win, SubWindow *sub_win, int offset_y, int offset_x, const char *fmt, ...);
@@ -31,6 +37,7 @@ static void print_win(WINDOW *win, SubWindow *sub_win, int offset_y, int offset_
 static void print_dim(WINDOW *win, SubWindow *sub_win);
 static void hline_win(WINDOW *win, SubWindow *sub_win, int offset_y, int offset_x, int width);
 
+static void highlight_matches(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc, int y, int i, size_t start_j, size_t end_j);
 static void doc_move_cursor(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc);
 static void cpy_line_slice(char *buffer, size_t start_j, size_t end_j, char *line);
 
@@ -40,6 +47,8 @@ WINDOW *view_init_doc_window(ScreenModel *screen_model) {
     WINDOW *doc_win = newwin(doc_model->height, doc_model->width, doc_model->pos_y, doc_model->pos_x);
     // scrolling handled explicitly in data model
     scrollok(doc_win, false);
+    // let ncurses use the terminal's own scrolling for wscrl
+    idlok(doc_win, true);
     keypad(doc_win, true);
     return doc_win;
 }
@@ -110,7 +119,7 @@ void print_entry_previews(
     // print complete entry previews
     int y_offset = list_offset_y;
     for (int i = start_idx; i < end_idx-1; i++) {
-        char *entry_preview = get_entry_preview(tomorrow->entries[i]);
+        char *entry_preview = get_entry_preview(entry_list_get(tomorrow, i));
         printf_win(summary_win, entry_list_summary, y_offset, 0, "%d. %s", i+1, entry_preview);
         y_offset++;
     }
@@ -148,6 +157,13 @@ char *get_entry_preview(const char *entry) {
 }
 
 void view_update_doc_window(WINDOW *doc_win, Modulo *modulo, EntryDoc *entry_doc, DocModel *doc_model) {
+    if (scroll_doc_content(doc_win, entry_doc, doc_model)) {
+        // the completion hint follows the cursor
+        print_entry_doc_status(doc_win, &doc_model->header, modulo, entry_doc);
+        doc_move_cursor(doc_win, &doc_model->entry_content, entry_doc);
+        remember_painted_scroll(entry_doc, doc_model);
+        return;
+    }
     bool update_required = stage_doc_for_updates(doc_win, doc_model);
     if (!update_required) {
         return;
@@ -160,8 +176,79 @@ void view_update_doc_window(WINDOW *doc_win, Modulo *modulo, EntryDoc *entry_doc
     //printf_win(doc_win, header, 0, 0, "cursor i: %d, j: %d", cursor.i, cursor.j);
     //printf_win(doc_win, header, 1, 0, "scroll i: %d, j: %d", entry_doc->scroll.i, entry_doc->scroll.j);
     print_entry_doc_header(doc_win, &doc_model->header, modulo, entry_doc);
-    print_entry_doc_content(doc_win, &doc_model->entry_content, entry_doc);
+    print_entry_doc_content(doc_win, &doc_model->entry_content, entry_doc, 0, entry_content->height);
     doc_move_cursor(doc_win, entry_content, entry_doc);
+    remember_painted_scroll(entry_doc, doc_model);
+}
+
+/*
+When only the cursor moved the text on screen is still right, at most shifted
+by a few rows. Shift it with wscrl inside a scroll region covering the content
+area and paint just the rows that came into view, instead of erasing and
+reprinting the window. With idlok ncurses can send that as a terminal scroll.
+Returns false when the window needs a full redraw.
+*/
+bool scroll_doc_content(WINDOW *doc_win, EntryDoc *entry_doc, DocModel *doc_model) {
+    bool cursor_only = doc_model->content_update && !doc_model->lines_update && !doc_model->size_update;
+    if (!cursor_only || !doc_model->painted || doc_model->painted_soft_wrap != entry_doc->soft_wrap) {
+        return false;
+    }
+    SubWindow *entry_content = &doc_model->entry_content;
+    int height = entry_content->height;
+    int delta = painted_scroll_delta(entry_doc, doc_model, height);
+    if (delta == 0) {
+        return true;
+    }
+    if (abs(delta) >= height) {
+        return false;
+    }
+    int top = entry_content->pos_y + entry_content->top;
+    int bottom = top + height - 1;
+    if (wsetscrreg(doc_win, top, bottom) == ERR) {
+        return false;
+    }
+    scrollok(doc_win, true);
+    wscrl(doc_win, delta);
+    scrollok(doc_win, false);
+    wsetscrreg(doc_win, 0, getmaxy(doc_win) - 1);
+
+    int start_y = delta > 0 ? height - delta : 0;
+    int end_y = delta > 0 ? height : -delta;
+    print_entry_doc_content(doc_win, entry_content, entry_doc, start_y, end_y);
+    // the exposed rows came in blank, border included
+    box(doc_win, 0, 0);
+    return true;
+}
+
+/*
+Rows the content moved up since it was last painted, negative if it moved down.
+Returns max_rows when it's at least that far or scrolled sideways.
+*/
+int painted_scroll_delta(EntryDoc *entry_doc, DocModel *doc_model, int max_rows) {
+    Index from = doc_model->painted_scroll;
+    Index to = entry_doc->scroll;
+    if (from.j != to.j || abs(to.i - from.i) >= max_rows) {
+        return max_rows;
+    }
+    if (!entry_doc->soft_wrap) {
+        return to.i - from.i;
+    }
+    // the text didn't change, so the wrap caches still hold
+    int width = wrap_width(doc_model->entry_content.width);
+    Index from_row = { .i = from.i, .j = doc_model->painted_scroll_row };
+    Index to_row = { .i = to.i, .j = entry_doc->scroll_row };
+    bool down = from_row.i < to_row.i || (from_row.i == to_row.i && from_row.j <= to_row.j);
+    if (down) {
+        return entry_doc_row_distance(entry_doc, width, from_row, to_row);
+    }
+    return -entry_doc_row_distance(entry_doc, width, to_row, from_row);
+}
+
+void remember_painted_scroll(EntryDoc *entry_doc, DocModel *doc_model) {
+    doc_model->painted = true;
+    doc_model->painted_soft_wrap = entry_doc->soft_wrap;
+    doc_model->painted_scroll = entry_doc->scroll;
+    doc_model->painted_scroll_row = entry_doc->scroll_row;
 }
 
 void print_dim(WINDOW *win, SubWindow *sub_win) {
@@ -223,7 +310,33 @@ void print_entry_doc_header(WINDOW *doc_win, SubWindow *header, Modulo *modulo,
         print_win(doc_win, header, i, 0, entry_doc->header.lines[i]);
     }
     hline_win(doc_win, header, line_count, 0, header->width);
-    printf_win(doc_win, header, line_count+2, 0, "Entry %d.", modulo->tomorrow.size+1);
+    print_entry_doc_status(doc_win, header, modulo, entry_doc);
+}
+
+// the line under the header: entry number and completion hint, or the search prompt
+void print_entry_doc_status(WINDOW *doc_win, SubWindow *header, Modulo *modulo, EntryDoc *entry_doc) {
+    size_t line_count = entry_doc->header.line_count;
+    // blank it first, it's also redrawn on its own when the content only scrolled
+    int y = header->pos_y + header->top + line_count+2;
+    wmove(doc_win, y, header->pos_x + header->left);
+    whline(doc_win, ' ', header->width);
+    DocSearch *search = entry_doc->search;
+    if (search->active) {
+        int match_count = search_match_count(search);
+        printf_win(doc_win, header, line_count+2, 0, "Search: %.*s", (int) search->length, search->query);
+        if (search->length > 0 && match_count == 0) {
+            wprintw(doc_win, "  [no matches]");
+        } else if (search->length > 0) {
+            wprintw(doc_win, "  [%d/%d]", search->current + 1, match_count);
+        }
+        return;
+    }
+    int entry_number = entry_doc->entry_id != 0 ? entry_doc->entry_number : modulo->tomorrow.size+1;
+    printf_win(doc_win, header, line_count+2, 0, "Entry %d.%s", entry_number, entry_doc->soft_wrap ? "  [wrap]" : "");
+    char completion[VOCAB_MAX_WORD + 1];
+    if (entry_doc_get_completion(entry_doc, completion) > 0) {
+        wprintw(doc_win, "  tab: ...%s", completion);
+    }
 }
 
 void hline_win(WINDOW *win, SubWindow *sub_win, int offset_y, int offset_x, int width) {
@@ -233,27 +346,88 @@ void hline_win(WINDOW *win, SubWindow *sub_win, int offset_y, int offset_x, int
     whline(win, ACS_HLINE, width);
 }
 
-// TODO: max width and height
-void print_entry_doc_content(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc) {
+// prints content rows [start_y, end_y)
+void print_entry_doc_content(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc, int start_y, int end_y) {
     static char buffer[DOC_LINE_BUF_SIZE];
 
-    int height = entry_content->height;
+    if (entry_doc->soft_wrap) {
+        print_entry_doc_content_wrapped(doc_win, entry_content, entry_doc, start_y, end_y);
+        return;
+    }
     int width = entry_content->width;
     Index *scroll = &entry_doc->scroll;
 
     // get start and end (exclusive) line index
-    size_t start_i = scroll->i;
-    size_t end_i = min(scroll->i + height, entry_doc->line_count);
+    size_t start_i = scroll->i + start_y;
+    size_t end_i = min(scroll->i + end_y, entry_doc->line_count);
     for (size_t i = start_i; i < end_i; i++) {
-        // get start and end (exclusive) char index
+        // get start and end (exclusive) byte index of the visible columns
+        // scroll->j is a display column, a wide character cut by the left edge isn't drawn
         Line *line = entry_doc_get_line(entry_doc, i);
-        size_t start_j = scroll->j;
-        // TODO constrain(value, min, max)
-        size_t end_j = max(scroll->j, min(scroll->j + width, line->length));
+        size_t start_j = line_byte_at_column(line, scroll->j);
+        if (line_column_of(line, start_j) < scroll->j) {
+            start_j = utf8_next(line->chars, line->length, start_j);
+        }
+        size_t end_j = max(start_j, line_byte_at_column(line, scroll->j + width));
         // get visible slice and print to virt screen
         cpy_line_slice(buffer, start_j, end_j, line->chars);
         // TODO > (2)
-        print_win(doc_win, entry_content, i-start_i, 0, buffer);
+        print_win(doc_win, entry_content, i-scroll->i, 0, buffer);
+        highlight_matches(doc_win, entry_content, entry_doc, i-scroll->i, i, start_j, end_j);
+    }
+}
+
+// one visual row per screen row, starting at row scroll_row of line scroll.i
+void print_entry_doc_content_wrapped(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc, int start_y, int end_y) {
+    static char buffer[DOC_LINE_BUF_SIZE];
+
+    int width = wrap_width(entry_content->width);
+    int y = 0;
+    int row = entry_doc->scroll_row;
+    for (size_t i = entry_doc->scroll.i; i < entry_doc->line_count && y < end_y; i++) {
+        Line *line = entry_doc_get_line(entry_doc, i);
+        int row_count = line_wrap_rows(line, width);
+        for (; row < row_count && y < end_y; row++, y++) {
+            if (y < start_y) {
+                continue;
+            }
+            cpy_line_slice(buffer, line_row_start(line, row), line_row_end(line, row), line->chars);
+            print_win(doc_win, entry_content, y, 0, buffer);
+            highlight_matches(doc_win, entry_content, entry_doc, y, i, line_row_start(line, row), line_row_end(line, row));
+        }
+        row = 0;
+    }
+}
+
+/*
+Highlights the part of every search match on line i that falls in the bytes
+[start_j, end_j) printed on content row y, the current match in reverse video
+and the others underlined. Only printed rows get here, so the cost doesn't
+depend on how many matches the document has.
+*/
+void highlight_matches(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_doc, int y, int i, size_t start_j, size_t end_j) {
+    DocSearch *search = entry_doc->search;
+    if (!search->active || search->length == 0) {
+        return;
+    }
+    Line *line = entry_doc_get_line(entry_doc, i);
+    int row_y = entry_content->pos_y + entry_content->top + y;
+    int row_x = entry_content->pos_x + entry_content->left;
+    int start_column = line_column_of(line, start_j);
+    int match_count = search_match_count(search);
+    for (int k = search_first_match_on_line(search, i); k < match_count; k++) {
+        Index match = search_get_match(search, k);
+        if (match.i != i || (size_t) match.j >= end_j) {
+            break;
+        }
+        size_t match_end = match.j + search->length;
+        if (match_end <= start_j) {
+            continue;
+        }
+        int from = line_column_of(line, max(match.j, start_j)) - start_column;
+        int to = line_column_of(line, min(match_end, end_j)) - start_column;
+        attr_t attr = k == search->current ? A_REVERSE : A_UNDERLINE;
+        mvwchgat(doc_win, row_y, row_x + from, to - from, attr, 0, NULL);
     }
 }
 
@@ -262,13 +436,28 @@ void doc_move_cursor(WINDOW *doc_win, SubWindow *entry_content, EntryDoc *entry_
     Index scroll = entry_doc->scroll;
     int i = entry_content->pos_y + entry_content->top;
     int j = entry_content->pos_x + entry_content->left;
+    if (entry_doc->soft_wrap) {
+        int width = wrap_width(entry_content->width);
+        Line *line = entry_doc_get_line(entry_doc, cursor.i);
+        Index cursor_row = { .i = cursor.i, .j = line_row_of(line, cursor.j, width) };
+        Index scroll_row = { .i = scroll.i, .j = entry_doc->scroll_row };
+        int i_offset = entry_doc_row_distance(entry_doc, width, scroll_row, cursor_row);
+        int j_offset = line_column_of(line, cursor.j) - line_column_of(line, line_row_start(line, cursor_row.j));
+        wmove(doc_win, i + i_offset, j + j_offset);
+        return;
+    }
+    Line *line = entry_doc_get_line(entry_doc, cursor.i);
     int i_offset = cursor.i - scroll.i;
-    int j_offset = cursor.j - scroll.j;
+    int j_offset = line_column_of(line, cursor.j) - scroll.j;
     wmove(doc_win, i + i_offset, j + j_offset);
 }
 
+// start_j and end_j are byte indexes on code point boundaries
 void cpy_line_slice(char *buffer, size_t start_j, size_t end_j, char *line) {
     size_t length = end_j - start_j;
+    while (length > DOC_LINE_BUF_SIZE - 1) {
+        length = utf8_prev(line + start_j, length);
+    }
     memcpy(buffer, (line + start_j), length * sizeof(char));
     buffer[length] = '\0';
 }
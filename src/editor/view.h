@@ -8,7 +8,8 @@
 #include "../modulo.h"
 #include "screen_model.h"
 
-#define DOC_LINE_BUF_SIZE 512
+// a full row of 4 byte characters
+#define DOC_LINE_BUF_SIZE 2048
 
 #define ENTRY_PREVIEW_LENGTH 14
 
@@ -20,4 +21,7 @@ WINDOW *view_init_summary_window(ScreenModel *screen_model);
 void view_update(WINDOW *doc_win, WINDOW *summary_win, Modulo *modulo, ScreenModel *screen_model, EntryDoc *entry_doc);
 void view_render(WINDOW *doc_win, WINDOW *summary_win, EntryDoc *entry_doc);
 
+// also heads the reader's side panel
+void print_modulo_logo(WINDOW *summary_win, SubWindow *logo);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "entry_index.h"
+#include "mem.h"
+#include "panic.h"
+
+static uint64_t hash_id(uint64_t id);
+static EntryIndexSlot *find_slot(EntryIndex *index, uint64_t id);
+static void grow(EntryIndex *index);
+
+EntryIndex create_entry_index(int capacity) {
+    // round capacity up to a power of two
+    int pow2 = ENTRY_INDEX_INIT_CAPACITY;
+    while (pow2 < capacity) {
+        pow2 *= 2;
+    }
+    EntryIndex index = {
+        .capacity = pow2,
+        .size = 0,
+        .slots = mem_calloc(MEM_MODULO, pow2, sizeof(EntryIndexSlot))
+    };
+    return index;
+}
+
+void free_entry_index(EntryIndex *index) {
+    mem_free(index->slots);
+    index->slots = NULL;
+    index->capacity = 0;
+    index->size = 0;
+}
+
+bool entry_index_built(EntryIndex *index) {
+    return index->capacity > 0;
+}
+
+void entry_index_put(EntryIndex *index, uint64_t id, EntryList *entry_list, int slot) {
+    if (id == 0) {
+        panic("Can't index an entry without an id\n");
+    }
+    // keep the load factor under 3/4
+    if (4 * (index->size + 1) > 3 * index->capacity) {
+        grow(index);
+    }
+    EntryIndexSlot *index_slot = find_slot(index, id);
+    if (index_slot->id == 0) {
+        index_slot->id = id;
+        index->size++;
+    }
+    index_slot->ref.entry_list = entry_list;
+    index_slot->ref.slot = slot;
+}
+
+void entry_index_put_list(EntryIndex *index, EntryList *entry_list) {
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (!(entry->flags & ENTRY_REMOVED)) {
+            entry_index_put(index, entry->id, entry_list, i);
+        }
+    }
+}
+
+EntryRef *entry_index_get(EntryIndex *index, uint64_t id) {
+    if (index->capacity == 0 || id == 0) {
+        return NULL;
+    }
+    EntryIndexSlot *index_slot = find_slot(index, id);
+    if (index_slot->id == 0) {
+        return NULL;
+    }
+    return &index_slot->ref;
+}
+
+/*
+ids are sequential so they're mixed (splitmix64 finalizer) before masking,
+otherwise runs of ids would fill runs of neighbouring slots
+*/
+uint64_t hash_id(uint64_t id) {
+    id ^= id >> 30;
+    id *= 0xbf58476d1ce4e5b9ULL;
+    id ^= id >> 27;
+    id *= 0x94d049bb133111ebULL;
+    id ^= id >> 31;
+    return id;
+}
+
+// returns the slot holding id, or the empty slot where id would go
+EntryIndexSlot *find_slot(EntryIndex *index, uint64_t id) {
+    uint64_t mask = (uint64_t) index->capacity - 1;
+    uint64_t i = hash_id(id) & mask;
+    while (index->slots[i].id != 0 && index->slots[i].id != id) {
+        i = (i + 1) & mask;
+    }
+    return &index->slots[i];
+}
+
+void grow(EntryIndex *index) {
+    EntryIndex grown = create_entry_index(index->capacity * 2);
+    for (int i = 0; i < index->capacity; i++) {
+        EntryIndexSlot *index_slot = &index->slots[i];
+        if (index_slot->id != 0) {
+            *find_slot(&grown, index_slot->id) = *index_slot;
+            grown.size++;
+        }
+    }
+    mem_free(index->slots);
+    *index = grown;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef ENTRY_INDEX_H
+#define ENTRY_INDEX_H
+
+#include <stdint.h>
+
+#include "entry_list.h"
+
+#define ENTRY_INDEX_INIT_CAPACITY 64
+
+/*
+EntryRef:
+Where an entry lives - the EntryList that holds it and its slot in that list
+*/
+typedef struct EntryRef {
+    EntryList *entry_list;
+    int slot;
+} EntryRef;
+
+typedef struct EntryIndexSlot {
+    /* 0 marks an empty slot (entry ids start at 1) */
+    uint64_t id;
+    EntryRef ref;
+} EntryIndexSlot;
+
+/*
+EntryIndex:
+Open addressing hash table (linear probing) from entry id to EntryRef.
+
+Refs stay valid as long as entries don't change slots. Removing an entry
+leaves a tombstone in its list (see ENTRY_REMOVED) instead of shifting the
+entries behind it, so the only operations that invalidate the index are the
+ones that move whole lists around (day rollover and compaction).
+Ids are never deleted from the table, a lookup that lands on a removed
+entry is treated as a miss by the caller.
+*/
+typedef struct EntryIndex {
+    /* power of two, 0 if the index hasn't been built */
+    int capacity;
+    int size;
+    EntryIndexSlot *slots;
+} EntryIndex;
+
+EntryIndex create_entry_index(int capacity);
+void free_entry_index(EntryIndex *index);
+
+bool entry_index_built(EntryIndex *index);
+
+// insert or update the ref for id
+void entry_index_put(EntryIndex *index, uint64_t id, EntryList *entry_list, int slot);
+// index every live entry in entry_list
+void entry_index_put_list(EntryIndex *index, EntryList *entry_list);
+// returns NULL if id isn't indexed
+EntryRef *entry_index_get(EntryIndex *index, uint64_t id);
+
+#endif
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "entry_list.h"
+#include "mem.h"
+#include "panic.h"
 
 /* EntryList */
 EntryList create_entry_list() {
@@ -11,77 +14,245 @@ EntryList create_entry_list() {
         .read_receipt = false,
         .capacity = ENTRY_LIST_INIT_CAPACITY,
         .size = 0,
-        .entries = malloc(ENTRY_LIST_INIT_CAPACITY * sizeof(char *))
+        .read_count = 0,
+        .done_count = 0,
+        .removed_count = 0,
+        .entries = mem_alloc(MEM_ENTRY_LIST, ENTRY_LIST_INIT_CAPACITY * sizeof(Entry))
     };
     return entry_list;
 }
 
 void free_entry_list(EntryList *entry_list) {
     for (int i = 0; i < entry_list->size; i++) {
-        free(entry_list_get(entry_list, i));
+        mem_free(entry_list_get(entry_list, i));
     }
-    free(entry_list->entries);
+    mem_free(entry_list->entries);
 }
 
 bool entry_list_empty(EntryList *entry_list) {
-    return entry_list->size == 0;
+    return entry_list_live_count(entry_list) == 0;
+}
+
+int entry_list_live_count(EntryList *entry_list) {
+    return entry_list->size - entry_list->removed_count;
+}
+
+int entry_list_entry_number(EntryList *entry_list, int index) {
+    if (entry_list->removed_count == 0) {
+        return index + 1;
+    }
+    int number = 1;
+    for (int i = 0; i < index; i++) {
+        if (!(entry_list->entries[i].flags & ENTRY_REMOVED)) {
+            number++;
+        }
+    }
+    return number;
 }
 
 //setters
 void entry_list_set_send_date(EntryList *entry_list, time_t send_date) { entry_list->send_date = send_date; }
 void entry_list_set_recv_date(EntryList *entry_list, time_t recv_date) { entry_list->recv_date = recv_date; }
 
-void entry_list_set_read_receipt(EntryList *entry_list, bool read_receipt) {
-    if (read_receipt != true && read_receipt != false) {
-        fprintf(stderr, "read receipt must be either true or false.\n");
-    }
-    entry_list->read_receipt = read_receipt;
-}
+void entry_list_set_read_receipt(EntryList *entry_list, bool read_receipt) { entry_list->read_receipt = read_receipt; }
 
 // getters
 time_t entry_list_get_send_date(EntryList *entry_list) { return entry_list->send_date; }
 time_t entry_list_get_recv_date(EntryList *entry_list) { return entry_list->recv_date; }
 bool entry_list_get_read_receipt(EntryList *entry_list) { return entry_list->read_receipt; }
 
-// push to entry list and update send_date
+// push to entry list
 void entry_list_push(EntryList *entry_list, char *entry) {
-    char **entries = entry_list->entries;
+    Entry new_entry = {
+        .id = 0,
+        .created = 0,
+        .text = entry,
+        .length = strlen(entry),
+        .flags = 0
+    };
+    entry_list_push_entry(entry_list, new_entry);
+}
+
+void entry_list_push_entry(EntryList *entry_list, Entry entry) {
+    Entry *entries = entry_list->entries;
     int *capacity = &entry_list->capacity;
     int *size = &entry_list->size;
     if (*size == *capacity) {
-        int new_capacity = *capacity * 2;
+        int new_capacity = *capacity > 0 ? *capacity * 2 : ENTRY_LIST_INIT_CAPACITY;
         // reallocate entry_list
-        entries = realloc(entries, new_capacity * sizeof(char *));
-        // update capacity value
+        entries = mem_realloc(MEM_ENTRY_LIST, entries, new_capacity * sizeof(Entry));
+        // update entries and capacity value
+        entry_list->entries = entries;
         entry_list->capacity = new_capacity;
     }
+    // update flag counts
+    if (entry.flags & ENTRY_READ) entry_list->read_count++;
+    if (entry.flags & ENTRY_DONE) entry_list->done_count++;
+    if (entry.flags & ENTRY_REMOVED) entry_list->removed_count++;
     // push to entry list
     entries[(*size)++] = entry;
 }
 
 char *entry_list_get(EntryList *entry_list, int index) {
+    return entry_list_get_entry(entry_list, index)->text;
+}
+
+Entry *entry_list_get_entry(EntryList *entry_list, int index) {
     int size = entry_list->size;
     if (index < 0 || index > size-1) {
-        fprintf(stderr, "Can't get entry at index %d from EntryList of size %d\n", index, size);
-        exit(EXIT_FAILURE);
+        panic("Can't get entry at index %d from EntryList of size %d\n", index, size);
     }
-    return entry_list->entries[index];
+    return &entry_list->entries[index];
 }
 
 void entry_list_remove(EntryList *entry_list, int index) {
     int *size = &entry_list->size;
     if (index < 0 || index > *size-1) {
-        fprintf(stderr, "Can't remove from EntryList of size %d at index %d\n", *size, index);
-        exit(EXIT_FAILURE);
+        panic("Can't remove from EntryList of size %d at index %d\n", *size, index);
     }
-    free(entry_list_get(entry_list, index));
-    char **entries = entry_list->entries;
+    // clear flags so the counts stay correct
+    entry_list_set_flags(entry_list, index, 0);
+    mem_free(entry_list_get(entry_list, index));
+    Entry *entries = entry_list->entries;
     for (int i = index+1; i < *size; i++) {
         entries[i-1] = entries[i];
     }
     (*size)--;
 }
 
+void entry_list_set_flags(EntryList *entry_list, int index, uint8_t flags) {
+    Entry *entry = entry_list_get_entry(entry_list, index);
+    uint8_t changed = entry->flags ^ flags;
+    if (changed & ENTRY_READ) entry_list->read_count += (flags & ENTRY_READ) ? 1 : -1;
+    if (changed & ENTRY_DONE) entry_list->done_count += (flags & ENTRY_DONE) ? 1 : -1;
+    if (changed & ENTRY_REMOVED) entry_list->removed_count += (flags & ENTRY_REMOVED) ? 1 : -1;
+    entry->flags = flags;
+}
+
+void entry_list_set_text(EntryList *entry_list, int index, char *text) {
+    Entry *entry = entry_list_get_entry(entry_list, index);
+    mem_free(entry->text);
+    entry->text = text;
+    entry->length = strlen(text);
+}
+
+/*
+The slot stays behind with only the ENTRY_REMOVED flag set, so removal is O(1)
+and doesn't move any other entry (see EntryIndex)
+*/
+void entry_list_tombstone(EntryList *entry_list, int index) {
+    Entry *entry = entry_list_get_entry(entry_list, index);
+    if (entry->flags & ENTRY_REMOVED) {
+        return;
+    }
+    entry_list_set_flags(entry_list, index, ENTRY_REMOVED);
+    mem_free(entry->text);
+    entry->text = NULL;
+    entry->length = 0;
+}
+
+void entry_list_compact(EntryList *entry_list) {
+    if (entry_list->removed_count == 0) {
+        return;
+    }
+    Entry *entries = entry_list->entries;
+    int kept = 0;
+    for (int i = 0; i < entry_list->size; i++) {
+        if (!(entries[i].flags & ENTRY_REMOVED)) {
+            entries[kept++] = entries[i];
+        }
+    }
+    entry_list->size = kept;
+    entry_list->removed_count = 0;
+}
+
+int entry_list_mark_read(EntryList *entry_list) {
+    int newly_read = entry_list_live_count(entry_list) - entry_list->read_count;
+    if (newly_read > 0) {
+        for (int i = 0; i < entry_list->size; i++) {
+            Entry *entry = &entry_list->entries[i];
+            if (!(entry->flags & ENTRY_REMOVED)) {
+                entry->flags |= ENTRY_READ;
+            }
+        }
+        entry_list->read_count = entry_list_live_count(entry_list);
+    }
+    entry_list->read_receipt = true;
+    return newly_read;
+}
+
+/*
+Moves every entry from src onto the end of dest (no strings are copied)
+If dest is empty it takes over src's buffer instead, so handing a whole list
+over costs nothing no matter how long it is.
+src is left empty and must not be used again without create_entry_list
+*/
+void entry_list_concat(EntryList *dest, EntryList *src) {
+    if (dest->size == 0) {
+        // keep the newer dates of the two lists
+        time_t send_date = dest->send_date > src->send_date ? dest->send_date : src->send_date;
+        time_t recv_date = dest->recv_date > src->recv_date ? dest->recv_date : src->recv_date;
+        mem_free(dest->entries);
+        *dest = *src;
+        dest->send_date = send_date;
+        dest->recv_date = recv_date;
+    } else {
+        for (int i = 0; i < src->size; i++) {
+            entry_list_push_entry(dest, src->entries[i]);
+        }
+        if (src->send_date > dest->send_date) dest->send_date = src->send_date;
+        if (src->recv_date > dest->recv_date) dest->recv_date = src->recv_date;
+        mem_free(src->entries);
+    }
+    src->entries = NULL;
+    src->size = 0;
+    src->capacity = 0;
+    src->read_count = 0;
+    src->done_count = 0;
+    src->removed_count = 0;
+}
+
+/*
+The flag counts let the common cases skip the scan: if no entry has the flag
+the whole list is handed over, and if every entry has it nothing moves.
+Otherwise the list is partitioned in place in one pass, only moving pointers.
+*/
+EntryList entry_list_take_unflagged(EntryList *entry_list, uint8_t flag) {
+    entry_list_compact(entry_list);
+    int flagged = flag == ENTRY_READ ? entry_list->read_count : entry_list->done_count;
+    if (flagged == entry_list->size) {
+        return create_entry_list();
+    }
+    if (flagged == 0) {
+        EntryList taken = *entry_list;
+        *entry_list = create_entry_list();
+        entry_list->send_date = taken.send_date;
+        entry_list->recv_date = taken.recv_date;
+        entry_list->read_receipt = taken.read_receipt;
+        return taken;
+    }
+    EntryList taken = create_entry_list();
+    taken.send_date = entry_list->send_date;
+    taken.recv_date = entry_list->recv_date;
+    Entry *entries = entry_list->entries;
+    int size = entry_list->size;
+    int kept = 0;
+    entry_list->size = 0;
+    entry_list->read_count = 0;
+    entry_list->done_count = 0;
+    for (int i = 0; i < size; i++) {
+        if (entries[i].flags & flag) {
+            entries[kept++] = entries[i];
+            if (entries[i].flags & ENTRY_READ) entry_list->read_count++;
+            if (entries[i].flags & ENTRY_DONE) entry_list->done_count++;
+        } else {
+            entry_list_push_entry(&taken, entries[i]);
+        }
+    }
+    entry_list->size = kept;
+    return taken;
+}
+
 /* HistoryQueue */
 HistoryQueue create_history_queue() {
     HistoryQueue history = {
@@ -101,15 +272,16 @@ void free_history_queue(HistoryQueue *history) {
 
 void history_queue_push(HistoryQueue *history, EntryList *entry_list) {
     EntryList *entry_lists = history->entry_lists;
-    int *head = &history->head;
-    int *size = &history->size;
+    uint8_t *head = &history->head;
+    uint8_t *size = &history->size;
     int tail_index = (*head + *size) % HISTORY_QUEUE_LENGTH;
-    if (*size == 3) {
-        // move head to make room
+    if (*size == HISTORY_QUEUE_LENGTH) {
+        // discard the oldest EntryList and move head to make room
+        free_entry_list(&entry_lists[tail_index]);
         *head = (*head + 1) % HISTORY_QUEUE_LENGTH;
     } else {
         // increase size
-        *size = (*size + 1) % HISTORY_QUEUE_LENGTH;
+        (*size)++;
     }
     entry_lists[tail_index] = *entry_list;
 }
@@ -117,8 +289,7 @@ void history_queue_push(HistoryQueue *history, EntryList *entry_list) {
 EntryList *history_queue_get(HistoryQueue *history, int index) {
     int size = history->size;
     if (index < 0 || index > size-1) {
-        fprintf(stderr, "Can't get entry at index %d from HistoryQueue of size %d\n", index, size);
-        exit(EXIT_FAILURE);
+        panic("Can't get entry at index %d from HistoryQueue of size %d\n", index, size);
     }
     int head = history->head;
     return &history->entry_lists[(head + index) % HISTORY_QUEUE_LENGTH];
@@ -14,8 +14,33 @@ Lesson: again don't cater the api to one use case. Let that use case write it's
 #define ENTRY_LIST_READ_RECEIPT "read_receipt"
 #define ENTRY_LIST_ENTRIES "entries"
 
+#define ENTRY_ID "id"
+#define ENTRY_CREATED "created"
+#define ENTRY_TEXT "text"
+#define ENTRY_FLAGS "flags"
+
 #define ENTRY_LIST_INIT_CAPACITY 8
 
+/* Entry flags */
+#define ENTRY_READ (1 << 0)
+#define ENTRY_DONE (1 << 1)
+/* tombstone left by a removal, dropped when the list is compacted or saved */
+#define ENTRY_REMOVED (1 << 2)
+
+/*
+Entry:
+An entry and its metadata. ids are assigned by Modulo, start at 1 and
+are never reused (0 means the entry hasn't been assigned an id yet)
+*/
+typedef struct Entry {
+    uint64_t id;
+    time_t created;
+    char *text;
+    /* strlen(text) */
+    uint32_t length;
+    uint8_t flags;
+} Entry;
+
 typedef struct EntryList {
     /* The last datetime in which the EntryList was modified */
     time_t send_date;
@@ -24,7 +49,12 @@ typedef struct EntryList {
     bool read_receipt;
     int capacity;
     int size;
-    char **entries;
+    /* number of entries flagged ENTRY_READ and ENTRY_DONE */
+    int read_count;
+    int done_count;
+    /* number of tombstones (entries flagged ENTRY_REMOVED) */
+    int removed_count;
+    Entry *entries;
 } EntryList;
 
 #define HISTORY_QUEUE_LENGTH 3
@@ -40,6 +70,10 @@ EntryList create_entry_list();
 void free_entry_list(EntryList *entry_list);
 
 bool entry_list_empty(EntryList *entry_list);
+// number of entries excluding tombstones
+int entry_list_live_count(EntryList *entry_list);
+// the number listings show for the entry at index, live entries are numbered from 1
+int entry_list_entry_number(EntryList *entry_list, int index);
 
 //setters
 void entry_list_set_send_date(EntryList *entry_list, time_t send_date);
@@ -53,10 +87,29 @@ bool entry_list_get_read_receipt(EntryList *entry_list);
 
 // push to entry list
 void entry_list_push(EntryList *entry_list, char *entry);
-// get entry at index
+void entry_list_push_entry(EntryList *entry_list, Entry entry);
+// get entry text at index
 char *entry_list_get(EntryList *entry_list, int index);
+// get entry record at index
+Entry *entry_list_get_entry(EntryList *entry_list, int index);
+// replace the text of the entry at index, the entry takes ownership of text
+void entry_list_set_text(EntryList *entry_list, int index, char *text);
 // remove entry at index
 void entry_list_remove(EntryList *entry_list, int index);
+// remove entry at index, leaving a tombstone so later entries keep their index
+void entry_list_tombstone(EntryList *entry_list, int index);
+// drop tombstones
+void entry_list_compact(EntryList *entry_list);
+
+// entry flags
+void entry_list_set_flags(EntryList *entry_list, int index, uint8_t flags);
+// flag every entry as read and set the read receipt. returns the number of newly read entries
+int entry_list_mark_read(EntryList *entry_list);
+
+// move all entries from src to the end of dest
+void entry_list_concat(EntryList *dest, EntryList *src);
+// move the entries without flag out of entry_list (preserving order) into the returned EntryList
+EntryList entry_list_take_unflagged(EntryList *entry_list, uint8_t flag);
 
 /* HistoryQueue */
 HistoryQueue create_history_queue();
@@ -1,8 +1,13 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 #include <cjson/cJSON.h>
 
@@ -10,8 +15,14 @@
 #include "filesystem.h"
 #include "json.h"
 #include "time.h"
+#include "trace.h"
+#include "mem.h"
+#include "panic.h"
 
 static char *path_join(char *path1, char *path2, char separator);
+static int write_modulo_json(char *json_str, OSContext *c);
+static int create_modulo_dir(OSContext *c);
+static OSContext *create_context_in(char *config_dir, char *user_env_var, char separator);
 
 /*
     Loads Modulo struct from config_dir/modulo.json file if it exists
@@ -19,51 +30,211 @@ static char *path_join(char *path1, char *path2, char separator);
 */
 Modulo *load_modulo(OSContext *c) {
     char *filepath = c->modulo_json_filepath;
-    char *json_str = read_text_data(filepath);
+    trace_ns_t span = trace_begin();
+    size_t size;
+    char *json_str = read_text_data(filepath, &size);
     if (json_str == NULL) {
+        trace_end("read_text_data", span);
         return NULL;
     } 
+    trace_end_bytes("read_text_data", span, size);
     // parse json string
+    span = trace_begin();
     cJSON *json = cJSON_Parse(json_str);
+    trace_end("json_parse", span);
+    if (json == NULL) {
+        mem_free(json_str);
+        return NULL;
+    }
     // json to Modulo
+    span = trace_begin();
     Modulo *modulo = json_to_modulo(json);
-    free(json_str);
+    trace_end("json_to_modulo", span);
+    mem_free(json_str);
     return modulo;
 }
 
 /*
     Saves the Modulo struct as json in config_dir/modulo.json 
-    Creates the necessary directories and files if config_dir/modulo.json doesn't exist
+    Creates the necessary directories if config_dir/modulo doesn't exist
 */
 int save_modulo(Modulo *modulo, OSContext *c) {
     // Modulo to json
+    trace_ns_t span = trace_begin();
     cJSON *json = modulo_to_json(modulo);
+    trace_end("modulo_to_json", span);
+    if (json == NULL) {
+        return -1;
+    }
     // serialize json string
+    span = trace_begin();
     char *json_str = cJSON_Print(json);
+    trace_end("json_print", span);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        return -1;
+    }
+    span = trace_begin();
+    if (write_modulo_json(json_str, c) == -1) {
+        cJSON_free(json_str);
+        return -1;
+    }
+    // cJSON_Print doesn't report the length, only measure it when it's reported
+    if (trace_enabled()) {
+        trace_end_bytes("write_text_data", span, strlen(json_str));
+    }
+    cJSON_free(json_str);
+    return 0;
+}
+
+/*
+    writes next to modulo.json and renames over it, so commands reading
+    the store without the lock never see a half written file.
+    Only a missing directory is created, a failed write or rename leaves modulo.json as it was
+*/
+int write_modulo_json(char *json_str, OSContext *c) {
     char *filepath = c->modulo_json_filepath;
-    if (write_text_data(json_str, filepath) == -1) {
-        // filepath doesn't exist
-        // create config_dir/modulo/modulo.json
-        if (create_modulo_dir(c) == -1) {
-            // failed to create modulo directory tree
-            return -1;
+    size_t length = strlen(filepath);
+    char *tmp_filepath = mem_alloc(MEM_CONTEXT, length + sizeof MODULO_TMP_SUFFIX);
+    memcpy(tmp_filepath, filepath, length);
+    memcpy(tmp_filepath + length, MODULO_TMP_SUFFIX, sizeof MODULO_TMP_SUFFIX);
+    int status = write_text_data(json_str, tmp_filepath);
+    if (status == -1 && errno == ENOENT && create_modulo_dir(c) == 0) {
+        // first save, config_dir/modulo doesn't exist yet
+        status = write_text_data(json_str, tmp_filepath);
+    }
+    if (status == 0 && rename(tmp_filepath, filepath) == -1) {
+        remove(tmp_filepath);
+        status = -1;
+    }
+    mem_free(tmp_filepath);
+    return status;
+}
+
+int lock_modulo(OSContext *c, void (*on_wait)(OSContext *c)) {
+    int fd = open(c->lock_filepath, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        // no modulo dir yet, nothing to protect
+        return -1;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        if (on_wait != NULL) {
+            on_wait(c);
         }
-        if (write_text_data(json_str, filepath) == -1) {
-            return -1;
+        if (flock(fd, LOCK_EX) == -1) {
+            close(fd);
+            return -2;
         }
     }
-    free(json_str);
-    return 0;
+    return fd;
+}
+
+void unlock_modulo(int fd) {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/*
+    Loads the completion vocabulary from config_dir/modulo/vocab.bin
+    Returns NULL if the file is missing or not a vocab this build can read,
+    the caller rebuilds it from the store
+*/
+Vocab *load_vocab(OSContext *c) {
+    trace_ns_t span = trace_begin();
+    size_t size;
+    char *data = read_binary_data(c->vocab_filepath, &size);
+    if (data == NULL) {
+        trace_end("load_vocab", span);
+        return NULL;
+    }
+    Vocab *vocab = vocab_deserialize(data, size);
+    mem_free(data);
+    trace_end_bytes("load_vocab", span, size);
+    return vocab;
+}
+
+/*
+    Saves the completion vocabulary next to modulo.json
+    Only called after the store itself was saved, so the directory exists
+*/
+int save_vocab(Vocab *vocab, OSContext *c) {
+    trace_ns_t span = trace_begin();
+    size_t size = vocab_serialized_size(vocab);
+    char *data = mem_alloc(MEM_VOCAB, size);
+    vocab_serialize(vocab, data);
+    int status = replace_binary_data(data, size, c->vocab_filepath);
+    mem_free(data);
+    trace_end_bytes("save_vocab", span, size);
+    if (status == 0) {
+        vocab->dirty = false;
+    }
+    return status;
+}
+
+/*
+    Loads the tag index from config_dir/modulo/tags.bin
+    Returns NULL if the file is missing or not an index this build can read
+*/
+TagIndex *load_tag_index(OSContext *c) {
+    trace_ns_t span = trace_begin();
+    size_t size;
+    char *data = read_binary_data(c->tags_filepath, &size);
+    if (data == NULL) {
+        trace_end("load_tag_index", span);
+        return NULL;
+    }
+    TagIndex *index = tag_index_deserialize(data, size);
+    mem_free(data);
+    trace_end_bytes("load_tag_index", span, size);
+    return index;
+}
+
+/*
+    Saves the tag index next to modulo.json
+    Read commands save it too and don't hold the store lock, so it's written
+    next to tags.bin and renamed over it
+*/
+int save_tag_index(TagIndex *index, OSContext *c) {
+    trace_ns_t span = trace_begin();
+    size_t size = tag_index_serialized_size(index);
+    char *data = mem_alloc(MEM_TAGS, size);
+    tag_index_serialize(index, data);
+    int status = replace_binary_data(data, size, c->tags_filepath);
+    mem_free(data);
+    trace_end_bytes("save_tag_index", span, size);
+    if (status == 0) {
+        index->dirty = false;
+    }
+    return status;
+}
+
+TagIndex *load_synced_tag_index(OSContext *c, Modulo *modulo) {
+    TagIndex *index = c != NULL ? load_tag_index(c) : NULL;
+    // ids only grow, an index ahead of the store belongs to a store that was replaced
+    if (index != NULL && index->next_entry_id > modulo_get_next_entry_id(modulo)) {
+        free_tag_index(index);
+        index = NULL;
+    }
+    if (index == NULL) {
+        index = create_tag_index();
+    }
+    trace_ns_t span = trace_begin();
+    tag_index_sync(index, modulo);
+    trace_end("tag_index_sync", span);
+    return index;
 }
 
 OSContext *get_context() {
+    trace_ns_t span = trace_begin();
     OS os = CURRENT_OS;
     char *config_dir;
     char *user_env_var = "USER";
     char separator = '/';
     switch (os) {
         case OS_WINDOWS:
-            config_dir = getenv("APPDATA");
+            // copied so free_context can release every path the same way
+            config_dir = mem_strdup(MEM_CONTEXT, getenv("APPDATA"));
             user_env_var = "USERNAME";
             separator = '\\';
             break;
@@ -76,50 +247,75 @@ OSContext *get_context() {
             config_dir = path_join(linux_home, ".config", separator);
             break;
         default:
-            printf("Unknown operating system detected\n");
-            printf("Program data will be written to the current directory.\n");
-            exit(-1);
+            panic("Unknown operating system detected\n");
     }
+    OSContext *c = create_context_in(config_dir, user_env_var, separator);
+    trace_end("get_context", span);
+    return c;
+}
+
+OSContext *create_context(const char *config_dir) {
+    char *user_env_var = CURRENT_OS == OS_WINDOWS ? "USERNAME" : "USER";
+    char separator = CURRENT_OS == OS_WINDOWS ? '\\' : '/';
+    return create_context_in(mem_strdup(MEM_CONTEXT, config_dir), user_env_var, separator);
+}
+
+/*
+    fills in the paths under config_dir, the context takes ownership of config_dir
+*/
+OSContext *create_context_in(char *config_dir, char *user_env_var, char separator) {
     char *modulo_dir = path_join(config_dir, "modulo", separator);
-    char *filepath = path_join(modulo_dir, "modulo.json", separator);
-    OSContext *c = malloc(sizeof(OSContext));
+    char *filepath = path_join(modulo_dir, MODULO_FILENAME, separator);
+    char *vocab_filepath = path_join(modulo_dir, VOCAB_FILENAME, separator);
+    char *tags_filepath = path_join(modulo_dir, TAGS_FILENAME, separator);
+    char *lock_filepath = path_join(modulo_dir, LOCK_FILENAME, separator);
+    OSContext *c = mem_alloc(MEM_CONTEXT, sizeof(OSContext));
     c->config_dir = config_dir;
     c->modulo_dir = modulo_dir;
     c->modulo_json_filepath = filepath;
+    c->vocab_filepath = vocab_filepath;
+    c->tags_filepath = tags_filepath;
+    c->lock_filepath = lock_filepath;
     c->user_env_var = user_env_var;
     c->path_separator = separator;
     return c;
 }
 
+void free_context(OSContext *c) {
+    mem_free(c->config_dir);
+    mem_free(c->modulo_dir);
+    mem_free(c->modulo_json_filepath);
+    mem_free(c->vocab_filepath);
+    mem_free(c->tags_filepath);
+    mem_free(c->lock_filepath);
+    mem_free(c);
+}
+
 /*
     Reads modulo data from user ~/.config directory
 
     returns pointer to Modulo struct
 */
-char *read_text_data(char *filepath) {
+char *read_text_data(char *filepath, size_t *size) {
     // read_text_from_file(filepath)
     FILE *fp = fopen(filepath, "r");
     if (fp == NULL) {
-        if (errno == ENOENT) {
-            // filepath doesn't exist
-            return NULL;
-        } else {
-            // unknown error
-            fprintf(stderr, "Unknown error occurred while opening %s\n", filepath);
-        }
+        // filepath doesn't exist or can't be read
+        return NULL;
     }
-    size_t size = 0;
+    *size = 0;
     size_t capacity = 1024; 
-    char *text = malloc(capacity);
+    char *text = mem_alloc(MEM_JSON, capacity);
+    text[0] = '\0';
 
     char buffer[1024];
     while (fgets(buffer, sizeof buffer, fp) != NULL) {
-        if (size + 1024 > capacity) {
+        if (*size + 1024 > capacity) {
             capacity *= 2;
-            text = realloc(text, capacity);
+            text = mem_realloc(MEM_JSON, text, capacity);
         }
-        strcpy(text + size, buffer);
-        size += strlen(buffer);
+        strcpy(text + *size, buffer);
+        *size += strlen(buffer);
     } 
     fclose(fp);
     return text;
@@ -133,23 +329,68 @@ char *read_text_data(char *filepath) {
 int write_text_data(char *text, char *filepath) {
     FILE *fp = fopen(filepath, "w");
     if (fp == NULL) {
-        if (errno == ENOENT) {
-            return -1;
-        } else {
-            // unknown error
-            fprintf(stderr, "Unknown error occurred while opening %s\n", filepath);
-            exit(1);
-        }
+        // errno says why, ENOENT if the directory doesn't exist
+        return -1;
     }
     int status = fputs(text, fp);
+    // buffered data is only written out (and can only fail) on close
+    if (fclose(fp) == EOF || status == EOF) {
+        return -1;
+    }
+    return 0;
+}
+
+char *read_binary_data(char *filepath, size_t *size) {
+    FILE *fp = fopen(filepath, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    long length;
+    if (fseek(fp, 0, SEEK_END) != 0 || (length = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return NULL;
+    }
+    char *data = mem_alloc(MEM_GENERAL, length > 0 ? length : 1);
+    if (fread(data, 1, length, fp) != (size_t)length) {
+        fclose(fp);
+        mem_free(data);
+        return NULL;
+    }
     fclose(fp);
-    if (status == EOF) {
-        perror("Failed to write text to file\n");
-        exit(EXIT_FAILURE);
+    *size = length;
+    return data;
+}
+
+int write_binary_data(char *data, size_t size, char *filepath) {
+    FILE *fp = fopen(filepath, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t written = fwrite(data, 1, size, fp);
+    if (fclose(fp) != 0 || written != size) {
+        return -1;
     }
     return 0;
 }
 
+/*
+    writes next to filepath and renames over it, so a reader never sees half
+    a file. A failed write or rename leaves filepath as it was
+*/
+int replace_binary_data(char *data, size_t size, char *filepath) {
+    size_t length = strlen(filepath);
+    char *tmp_filepath = mem_alloc(MEM_CONTEXT, length + sizeof MODULO_TMP_SUFFIX);
+    memcpy(tmp_filepath, filepath, length);
+    memcpy(tmp_filepath + length, MODULO_TMP_SUFFIX, sizeof MODULO_TMP_SUFFIX);
+    int status = write_binary_data(data, size, tmp_filepath);
+    if (status == 0 && rename(tmp_filepath, filepath) == -1) {
+        remove(tmp_filepath);
+        status = -1;
+    }
+    mem_free(tmp_filepath);
+    return status;
+}
+
 int create_modulo_dir(OSContext *c) {
     // create user config dir if it doesn't exist
     if (mkdir(c->config_dir, 0755) == -1 && errno != EEXIST) {
@@ -159,12 +400,7 @@ int create_modulo_dir(OSContext *c) {
     if (mkdir(c->modulo_dir, 0755) == -1 && errno != EEXIST) {
         return -1;
     }
-    // create modulo.json if it doesn't exist
-    FILE *fp;
-    if ((fp = fopen(c->modulo_json_filepath, "w")) == NULL) {
-        return -1;
-    }
-    fclose(fp);
+    // modulo.json is created by the save's rename
     return 0;
 }
 
@@ -175,7 +411,7 @@ char *get_system_username(OSContext *c) {
 char *path_join(char *path1, char *path2, char separator) {
     size_t length1 = strlen(path1);
     size_t length2 = strlen(path2);
-    char *joined = malloc(length1 + length2 + 2);
+    char *joined = mem_alloc(MEM_CONTEXT, length1 + length2 + 2);
     for (size_t i = 0; i < length1; i++) {
         joined[i] = path1[i];
     }
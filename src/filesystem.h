@@ -1,7 +1,11 @@
 #ifndef FILESYSTEM_H
 #define FILESYSTEM_H
 
+#include <stddef.h>
+
 #include "modulo.h"
+#include "vocab.h"
+#include "tags.h"
 
 typedef struct {
     /* os depdendent config directory */
@@ -10,6 +14,12 @@ typedef struct {
     char *modulo_dir;
     /* modulo_json_filepath -> config_dir/modulo/modulo.json */
     char *modulo_json_filepath;
+    /* vocab_filepath -> config_dir/modulo/vocab.bin */
+    char *vocab_filepath;
+    /* tags_filepath -> config_dir/modulo/tags.bin */
+    char *tags_filepath;
+    /* lock_filepath -> config_dir/modulo/modulo.lock */
+    char *lock_filepath;
     char *user_env_var;
     char path_separator;
 } OSContext;
@@ -18,6 +28,14 @@ typedef struct {
 #define MODULO_DIR "modulo"
 // app data filename
 #define MODULO_FILENAME "modulo.json"
+// editor completion vocabulary, a cache rebuilt from modulo.json when missing
+#define VOCAB_FILENAME "vocab.bin"
+// tag index, a cache rebuilt from modulo.json when missing
+#define TAGS_FILENAME "tags.bin"
+// flocked by commands that write the store, see lock_modulo
+#define LOCK_FILENAME "modulo.lock"
+// save_modulo writes here first, then renames over modulo.json
+#define MODULO_TMP_SUFFIX ".tmp"
 
 /*
 OS depdendent app data directories
@@ -49,13 +67,48 @@ typedef enum {
 Modulo *load_modulo(OSContext *c);
 // write program data to disk
 int save_modulo(Modulo *modulo, OSContext *c);
+/*
+    takes an exclusive flock on the lock file, waiting for any other
+    command holding it. on_wait (may be NULL) is called once before blocking.
+    The lock is held until unlock_modulo or the process exits.
+    returns -1 (and takes no lock) if modulo hasn't been initialized yet,
+    -2 if the lock can't be taken
+*/
+int lock_modulo(OSContext *c, void (*on_wait)(OSContext *c));
+// release a lock taken by lock_modulo before the process exits
+void unlock_modulo(int fd);
+
+// load the completion vocabulary, NULL if there is none or it can't be read
+Vocab *load_vocab(OSContext *c);
+// write the completion vocabulary, returns -1 if the write fails
+int save_vocab(Vocab *vocab, OSContext *c);
 
-// read text data from disk
-char *read_text_data(char *filepath);
-// write text data to disk
+// load the tag index, NULL if there is none or it can't be read
+TagIndex *load_tag_index(OSContext *c);
+// write the tag index, returns -1 if the write fails
+int save_tag_index(TagIndex *index, OSContext *c);
+/*
+    the tag index brought up to date with modulo: loaded from disk (unless c is NULL),
+    rebuilt if it's missing or was built for another store, then synced with new entries
+*/
+TagIndex *load_synced_tag_index(OSContext *c, Modulo *modulo);
+
+// read text data from disk, NULL if it doesn't exist or can't be read. *size is set to its length
+char *read_text_data(char *filepath, size_t *size);
+// write text data to disk, returns -1 (with errno set) if the write fails
 int write_text_data(char *text, char *filepath);
 
+// read a whole file, NULL if it doesn't exist or can't be read
+char *read_binary_data(char *filepath, size_t *size);
+// returns -1 if the write fails. returns 0 otherwise.
+int write_binary_data(char *data, size_t size, char *filepath);
+// write_binary_data through a temporary file renamed over filepath. returns -1 if the write fails
+int replace_binary_data(char *data, size_t size, char *filepath);
+
 OSContext *get_context();
+// a context for the store under config_dir/modulo instead of the os default
+OSContext *create_context(const char *config_dir);
+void free_context(OSContext *c);
 
 char *get_system_username(OSContext *c);
 
@@ -5,6 +5,8 @@
 
 #include "json.h"
 #include "modulo.h"
+#include "time_utils.h"
+#include "mem.h"
 
 
 /*
@@ -93,24 +95,33 @@ json {
 
 // json to modulo helpers
 static EntryList json_to_entry_list(cJSON *json);
+static Entry json_to_entry(cJSON *json);
 static HistoryQueue json_to_history_queue(cJSON *json);
 static char *get_string_from_object(cJSON *json, char *name);
 static int get_int_from_object(cJSON *json, char *name);
 static time_t get_time_t_from_object(cJSON *json, char *name);
 static EntryList get_entry_list_from_object(cJSON *json, char *name);
 static HistoryQueue get_history_queue_from_object(cJSON *json);
+static CalendarQueue get_calendar_queue_from_object(cJSON *json, day_t cursor);
+static RecurrenceHeap get_recurrence_heap_from_object(cJSON *json);
+static UsageStats get_usage_stats_from_object(cJSON *json);
 
 // modulo to json helpers
 static cJSON *entry_list_to_json(EntryList *entry_list);
 static cJSON *history_queue_to_json(HistoryQueue *history);
 static cJSON *add_entry_list_to_object(cJSON *json, const char *name, EntryList *entry_list);
 static cJSON *add_history_queue_to_object(cJSON *json, const char *name, HistoryQueue *history);
+static cJSON *calendar_queue_to_json(CalendarQueue *calendar);
+static cJSON *add_calendar_queue_to_object(cJSON *json, const char *name, CalendarQueue *calendar);
+static cJSON *recurrence_heap_to_json(RecurrenceHeap *heap);
+static cJSON *add_recurrence_heap_to_object(cJSON *json, const char *name, RecurrenceHeap *heap);
+static cJSON *usage_stats_to_json(UsageStats *stats);
 
 Modulo *json_to_modulo(cJSON *json) {
-    Modulo *modulo = malloc(sizeof(Modulo));
+    Modulo *modulo = mem_alloc(MEM_MODULO, sizeof(Modulo));
 
     char *username = get_string_from_object(json, MODULO_USERNAME);
-    if (username == NULL) {
+    if (username == NULL || modulo_set_username(modulo, username) == -1) {
         cJSON_Delete(json);
         return NULL;
     }
@@ -128,11 +139,22 @@ Modulo *json_to_modulo(cJSON *json) {
     }
 
     char *entry_delimiter = get_string_from_object(json, MODULO_ENTRY_DELIMITER);
-    if (username == NULL) {
+    if (entry_delimiter == NULL || modulo_set_entry_delimiter(modulo, entry_delimiter) == -1) {
         cJSON_Delete(json);
         return NULL;
     }
 
+    // carry_over is optional. stores written before it existed never carried entries over, they keep doing so
+    CarryOver carry_over = CARRY_NONE;
+    if (cJSON_GetObjectItemCaseSensitive(json, MODULO_CARRY_OVER) != NULL) {
+        char *carry_over_str = get_string_from_object(json, MODULO_CARRY_OVER);
+        carry_over = carry_over_str == NULL ? CARRY_INVALID : parse_carry_over(carry_over_str);
+        if (carry_over == CARRY_INVALID) {
+            cJSON_Delete(json);
+            return NULL;
+        }
+    }
+
     time_t day_ptr = get_time_t_from_object(json, MOUDLO_DAY_PTR);
     if (day_ptr == -1) {
         cJSON_Delete(json);
@@ -157,14 +179,59 @@ Modulo *json_to_modulo(cJSON *json) {
         return NULL;
     }
 
-    modulo_set_username(modulo, username);
+    CalendarQueue scheduled = get_calendar_queue_from_object(json, utc_to_day(day_ptr));
+    if (scheduled.size == -1) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    RecurrenceHeap recurring = get_recurrence_heap_from_object(json);
+    if (recurring.size == -1) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    UsageStats stats = get_usage_stats_from_object(json);
+    if (stats.size == -1) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
     modulo_set_wakeup_earliest(modulo, wakeup_earliest);
     modulo_set_wakeup_latest(modulo, wakeup_latest);
-    modulo_set_entry_delimiter(modulo, entry_delimiter);
+    modulo_set_carry_over(modulo, carry_over);
     modulo_set_day_ptr(modulo, day_ptr);
     modulo_set_today(modulo, today);
     modulo_set_tomorrow(modulo, tomorrow);
     modulo_set_history(modulo, history);
+    modulo_set_scheduled(modulo, scheduled);
+    modulo_set_recurring(modulo, recurring);
+    modulo_set_stats(modulo, stats);
+    modulo->index = (EntryIndex) { .capacity = 0 };
+    // next_entry_id is optional (stores written before entries had ids get them now)
+    if (cJSON_GetObjectItemCaseSensitive(json, MODULO_NEXT_ENTRY_ID) == NULL) {
+        modulo_set_next_entry_id(modulo, 1);
+        modulo_assign_entry_ids(modulo);
+    } else {
+        time_t next_entry_id = get_time_t_from_object(json, MODULO_NEXT_ENTRY_ID);
+        if (next_entry_id < 1) {
+            free_modulo(modulo);
+            cJSON_Delete(json);
+            return NULL;
+        }
+        modulo_set_next_entry_id(modulo, (uint64_t) next_entry_id);
+    }
+    // edit_generation is optional too, stores written before it had no in place edits
+    modulo_set_edit_generation(modulo, 0);
+    if (cJSON_GetObjectItemCaseSensitive(json, MODULO_EDIT_GENERATION) != NULL) {
+        time_t edit_generation = get_time_t_from_object(json, MODULO_EDIT_GENERATION);
+        if (edit_generation < 0) {
+            free_modulo(modulo);
+            cJSON_Delete(json);
+            return NULL;
+        }
+        modulo_set_edit_generation(modulo, (uint64_t) edit_generation);
+    }
     cJSON_Delete(json);
     return modulo;
 }
@@ -209,6 +276,160 @@ HistoryQueue get_history_queue_from_object(cJSON *json) {
     return json_to_history_queue(json_history_queue);
 }
 
+/*
+scheduled is optional (stores written before scheduling existed don't have it)
+[
+    {
+        deliver_day: number (days since 1970-01-01)
+        send_date: number
+        recv_date: number
+        read_receipt: bool
+        entries: []
+    }
+]
+*/
+CalendarQueue get_calendar_queue_from_object(cJSON *json, day_t cursor) {
+    CalendarQueue calendar = create_calendar_queue(cursor);
+    cJSON *json_array = cJSON_GetObjectItemCaseSensitive(json, MODULO_SCHEDULED);
+    if (json_array == NULL) {
+        return calendar;
+    }
+    if (!cJSON_IsArray(json_array)) {
+        return (CalendarQueue) { .size = -1 };
+    }
+    cJSON *json_obj;
+    cJSON_ArrayForEach(json_obj, json_array) {
+        int deliver_day = get_int_from_object(json_obj, CALENDAR_QUEUE_DELIVER_DAY);
+        if (deliver_day == -1) {
+            free_calendar_queue(&calendar);
+            return (CalendarQueue) { .size = -1 };
+        }
+        EntryList entry_list = json_to_entry_list(json_obj);
+        if (entry_list.size == -1) {
+            free_calendar_queue(&calendar);
+            return (CalendarQueue) { .size = -1 };
+        }
+        calendar_queue_insert(&calendar, deliver_day, &entry_list);
+    }
+    return calendar;
+}
+
+/*
+recurring is optional (stores written before recurring entries existed don't have it)
+[
+    {
+        entry: string
+        rule: "daily" | "weekly" | "monthly"
+        param: number
+        next_day: number (days since 1970-01-01)
+    }
+]
+*/
+RecurrenceHeap get_recurrence_heap_from_object(cJSON *json) {
+    RecurrenceHeap heap = create_recurrence_heap();
+    cJSON *json_array = cJSON_GetObjectItemCaseSensitive(json, MODULO_RECURRING);
+    if (json_array == NULL) {
+        return heap;
+    }
+    if (!cJSON_IsArray(json_array)) {
+        free_recurrence_heap(&heap);
+        return (RecurrenceHeap) { .size = -1 };
+    }
+    cJSON *json_obj;
+    cJSON_ArrayForEach(json_obj, json_array) {
+        char *entry = get_string_from_object(json_obj, RECURRENCE_ENTRY);
+        char *rule_str = get_string_from_object(json_obj, RECURRENCE_RULE);
+        RecurrenceRule rule = rule_str == NULL ? RECUR_INVALID : parse_recurrence_rule(rule_str);
+        int param = get_int_from_object(json_obj, RECURRENCE_PARAM);
+        int next_day = get_int_from_object(json_obj, RECURRENCE_NEXT_DAY);
+        // weekday_to_string and the monthly rule index with param, out of range it's as malformed as a missing one
+        if (entry == NULL || rule == RECUR_INVALID || param == -1 || !recurrence_param_valid(rule, param) || next_day == -1) {
+            free_recurrence_heap(&heap);
+            return (RecurrenceHeap) { .size = -1 };
+        }
+        char *entry_copy = mem_alloc(MEM_ENTRY_LIST, strlen(entry) + 1);
+        strcpy(entry_copy, entry);
+        Recurrence recurrence = {
+            .entry = entry_copy,
+            .rule = rule,
+            .param = param,
+            .next_day = next_day
+        };
+        recurrence_heap_push(&heap, recurrence);
+    }
+    return heap;
+}
+
+/*
+stats is optional (stores written before stats existed start counting now)
+{
+    written, length, delivered, read, received, latency: number
+    last_written_day, streak, longest_streak: number
+    days: [
+        [day, written, length, flags, received, latency]
+    ]
+}
+days are rows rather than objects, there's one for every day modulo was used
+*/
+UsageStats get_usage_stats_from_object(cJSON *json) {
+    UsageStats stats = create_usage_stats();
+    cJSON *json_stats = cJSON_GetObjectItemCaseSensitive(json, MODULO_STATS);
+    if (json_stats == NULL) {
+        return stats;
+    }
+    time_t totals[9];
+    char *names[9] = {
+        STATS_WRITTEN, STATS_LENGTH, STATS_DELIVERED, STATS_READ, STATS_RECEIVED, STATS_LATENCY,
+        STATS_LAST_WRITTEN_DAY, STATS_STREAK, STATS_LONGEST_STREAK
+    };
+    for (int i = 0; i < 9; i++) {
+        totals[i] = get_time_t_from_object(json_stats, names[i]);
+        if (totals[i] == -1) {
+            free_usage_stats(&stats);
+            return (UsageStats) { .size = -1 };
+        }
+    }
+    stats.written = totals[0];
+    stats.length = totals[1];
+    stats.delivered = totals[2];
+    stats.read = totals[3];
+    stats.received = totals[4];
+    stats.latency = totals[5];
+    stats.last_written_day = totals[6];
+    stats.streak = totals[7];
+    stats.longest_streak = totals[8];
+    cJSON *json_array = cJSON_GetObjectItemCaseSensitive(json_stats, STATS_DAYS);
+    if (json_array == NULL || !cJSON_IsArray(json_array)) {
+        free_usage_stats(&stats);
+        return (UsageStats) { .size = -1 };
+    }
+    cJSON *json_row;
+    cJSON_ArrayForEach(json_row, json_array) {
+        double row[6];
+        int columns = 0;
+        cJSON *json_number;
+        cJSON_ArrayForEach(json_number, json_row) {
+            if (columns == 6 || !cJSON_IsNumber(json_number)) {
+                break;
+            }
+            row[columns++] = json_number->valuedouble;
+        }
+        DayRollup rollup = {
+            .day = (day_t) row[0],
+            .written = (uint32_t) row[1],
+            .length = (uint64_t) row[2],
+            .flags = (uint8_t) row[3],
+            .received = (uint32_t) row[4],
+            .latency = (int64_t) row[5]
+        };
+        if (!cJSON_IsArray(json_row) || columns != 6 || cJSON_GetArraySize(json_row) != 6 || stats_push_day(&stats, rollup) == -1) {
+            free_usage_stats(&stats);
+            return (UsageStats) { .size = -1 };
+        }
+    }
+    return stats;
+}
+
 /*
 
 typedef struct EntryList {
@@ -249,20 +470,62 @@ EntryList json_to_entry_list(cJSON *json) {
     if (json_array == NULL || !cJSON_IsArray(json_array)) {
         return (EntryList) { .size = -1 };
     }
-    cJSON *string;
-    cJSON_ArrayForEach(string, json_array) {
-        // copy json entry string
-        char *entry = malloc(strlen(string->valuestring) + 1);
-        strcpy(entry, string->valuestring);
-        if (!cJSON_IsString(string) || entry == NULL) {
-            // Invalid string array element
+    cJSON *json_entry;
+    cJSON_ArrayForEach(json_entry, json_array) {
+        Entry entry = json_to_entry(json_entry);
+        if (entry.text == NULL) {
+            // Invalid entry array element
+            free_entry_list(&entry_list);
             return (EntryList) { .size = -1 };
         }
-        entry_list_push(&entry_list, entry);
+        entry_list_push_entry(&entry_list, entry);
     }
     return entry_list;
 }
 
+/*
+entries are either plain strings (stores written before entries had metadata) or
+{
+    id: number (missing in stores written before entries had ids)
+    created: number
+    text: string
+    flags: number
+}
+entries without an id get one from modulo_assign_entry_ids
+*/
+Entry json_to_entry(cJSON *json) {
+    Entry entry = { .id = 0, .created = 0, .text = NULL, .length = 0, .flags = 0 };
+    cJSON *json_text = json;
+    if (cJSON_IsObject(json)) {
+        json_text = cJSON_GetObjectItemCaseSensitive(json, ENTRY_TEXT);
+        int flags = get_int_from_object(json, ENTRY_FLAGS);
+        if (flags == -1) {
+            return entry;
+        }
+        // tombstones are never saved
+        entry.flags = (uint8_t) flags & ~ENTRY_REMOVED;
+        if (cJSON_GetObjectItemCaseSensitive(json, ENTRY_ID) != NULL) {
+            time_t id = get_time_t_from_object(json, ENTRY_ID);
+            time_t created = get_time_t_from_object(json, ENTRY_CREATED);
+            if (id < 1 || created == -1) {
+                return entry;
+            }
+            entry.id = (uint64_t) id;
+            entry.created = created;
+        }
+    }
+    if (json_text == NULL || !cJSON_IsString(json_text) || json_text->valuestring == NULL) {
+        return entry;
+    }
+    // copy json entry string
+    entry.length = strlen(json_text->valuestring);
+    entry.text = mem_alloc(MEM_ENTRY_LIST, entry.length + 1);
+    if (entry.text != NULL) {
+        strcpy(entry.text, json_text->valuestring);
+    }
+    return entry;
+}
+
 HistoryQueue json_to_history_queue(cJSON *json_array) {
     if (json_array == NULL || !cJSON_IsArray(json_array)) {
         return (HistoryQueue) { .size = -1 };
@@ -281,6 +544,9 @@ HistoryQueue json_to_history_queue(cJSON *json_array) {
 
 cJSON *modulo_to_json(Modulo *modulo) {
     cJSON *json = cJSON_CreateObject(); 
+    if (json == NULL) {
+        return NULL;
+    }
 
     // add username to JSON
     if (cJSON_AddStringToObject(json, MODULO_USERNAME, modulo->username) == NULL) {
@@ -306,6 +572,24 @@ cJSON *modulo_to_json(Modulo *modulo) {
         return NULL;
     }
 
+    // add carry_over to JSON
+    if (cJSON_AddStringToObject(json, MODULO_CARRY_OVER, carry_over_to_string(modulo->carry_over)) == NULL) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    // add next_entry_id to JSON
+    if (cJSON_AddNumberToObject(json, MODULO_NEXT_ENTRY_ID, modulo->next_entry_id) == NULL) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    // add edit_generation to JSON
+    if (cJSON_AddNumberToObject(json, MODULO_EDIT_GENERATION, modulo->edit_generation) == NULL) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
     // add day_ptr to JSON
     if (cJSON_AddNumberToObject(json, MOUDLO_DAY_PTR, modulo->day_ptr) == NULL) {
         cJSON_Delete(json);
@@ -330,6 +614,30 @@ cJSON *modulo_to_json(Modulo *modulo) {
         return NULL;
     }
 
+    // add scheduled entries to JSON
+    if (add_calendar_queue_to_object(json, MODULO_SCHEDULED, &modulo->scheduled) == NULL) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    // add recurring entries to JSON
+    if (add_recurrence_heap_to_object(json, MODULO_RECURRING, &modulo->recurring) == NULL) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    // add usage stats to JSON
+    cJSON *json_stats = usage_stats_to_json(&modulo->stats);
+    if (json_stats == NULL) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+    if (!cJSON_AddItemToObject(json, MODULO_STATS, json_stats)) {
+        cJSON_Delete(json_stats);
+        cJSON_Delete(json);
+        return NULL;
+    }
+
     return json;
 }
 
@@ -338,7 +646,10 @@ cJSON *add_entry_list_to_object(cJSON *json, const char *name, EntryList *entry_
     if (json_entry_list == NULL) {
         return NULL;
     }
-    cJSON_AddItemToObject(json, name, json_entry_list);
+    if (!cJSON_AddItemToObject(json, name, json_entry_list)) {
+        cJSON_Delete(json_entry_list);
+        return NULL;
+    }
     return json_entry_list;
 }
 
@@ -347,35 +658,86 @@ cJSON *add_history_queue_to_object(cJSON *json, const char *name, HistoryQueue *
     if (json_history_queue == NULL) {
         return NULL;
     }
-    cJSON_AddItemToObject(json, MODULO_HISTORY, json_history_queue);
+    if (!cJSON_AddItemToObject(json, MODULO_HISTORY, json_history_queue)) {
+        cJSON_Delete(json_history_queue);
+        return NULL;
+    }
     return json_history_queue;
 }
 
+cJSON *add_calendar_queue_to_object(cJSON *json, const char *name, CalendarQueue *calendar) {
+    cJSON *json_calendar_queue = calendar_queue_to_json(calendar);
+    if (json_calendar_queue == NULL) {
+        return NULL;
+    }
+    if (!cJSON_AddItemToObject(json, name, json_calendar_queue)) {
+        cJSON_Delete(json_calendar_queue);
+        return NULL;
+    }
+    return json_calendar_queue;
+}
+
+cJSON *add_recurrence_heap_to_object(cJSON *json, const char *name, RecurrenceHeap *heap) {
+    cJSON *json_recurrence_heap = recurrence_heap_to_json(heap);
+    if (json_recurrence_heap == NULL) {
+        return NULL;
+    }
+    if (!cJSON_AddItemToObject(json, name, json_recurrence_heap)) {
+        cJSON_Delete(json_recurrence_heap);
+        return NULL;
+    }
+    return json_recurrence_heap;
+}
+
+/*
+    The *_to_json helpers return NULL if cJSON can't allocate, having deleted
+    what they built. A tree with an item silently missing must never be saved
+*/
 cJSON *entry_list_to_json(EntryList *entry_list) {
     cJSON *json_obj = cJSON_CreateObject();
+    if (json_obj == NULL) {
+        return NULL;
+    }
 
     if (cJSON_AddNumberToObject(json_obj, ENTRY_LIST_SEND_DATE, entry_list->send_date) == NULL) {
+        cJSON_Delete(json_obj);
         return NULL;
     }
 
     if (cJSON_AddNumberToObject(json_obj, ENTRY_LIST_RECV_DATE, entry_list->recv_date) == NULL) {
+        cJSON_Delete(json_obj);
         return NULL;
     }
 
     if (cJSON_AddNumberToObject(json_obj, ENTRY_LIST_READ_RECEIPT, entry_list->read_receipt) == NULL) {
+        cJSON_Delete(json_obj);
         return NULL;
     }
 
     cJSON *json_array = cJSON_AddArrayToObject(json_obj, ENTRY_LIST_ENTRIES);
-    char **entries = entry_list->entries;
+    if (json_array == NULL) {
+        cJSON_Delete(json_obj);
+        return NULL;
+    }
     for (int i = 0; i < entry_list->size; i++) {
-        char *entry = entry_list_get(entry_list, i);
-        cJSON *string = cJSON_CreateString(entry);
-        if (string == NULL) {
-            // failed to create json string for entry
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->flags & ENTRY_REMOVED) {
+            // drop tombstones
+            continue;
+        }
+        cJSON *json_entry = cJSON_CreateObject();
+        if (
+            json_entry == NULL
+            || cJSON_AddNumberToObject(json_entry, ENTRY_ID, entry->id) == NULL
+            || cJSON_AddNumberToObject(json_entry, ENTRY_CREATED, entry->created) == NULL
+            || cJSON_AddStringToObject(json_entry, ENTRY_TEXT, entry->text) == NULL
+            || cJSON_AddNumberToObject(json_entry, ENTRY_FLAGS, entry->flags) == NULL
+            || !cJSON_AddItemToArray(json_array, json_entry)
+        ) {
+            cJSON_Delete(json_entry);
+            cJSON_Delete(json_obj);
             return NULL;
         }
-        cJSON_AddItemToArray(json_array, string);
     }
     return json_obj;
 
@@ -383,15 +745,104 @@ cJSON *entry_list_to_json(EntryList *entry_list) {
 
 cJSON *history_queue_to_json(HistoryQueue *history) {
     cJSON *json_array = cJSON_CreateArray();
+    if (json_array == NULL) {
+        return NULL;
+    }
 
     for (int i = 0; i < history->size; i++) {
         EntryList *entry_list = history_queue_get(history, i);
         cJSON *json_entry_list = entry_list_to_json(entry_list);
-        if (json_entry_list == NULL) {
+        if (json_entry_list == NULL || !cJSON_AddItemToArray(json_array, json_entry_list)) {
             // failed to created entry list from history
+            cJSON_Delete(json_entry_list);
+            cJSON_Delete(json_array);
+            return NULL;
+        }
+    }
+    return json_array;
+}
+
+cJSON *calendar_queue_to_json(CalendarQueue *calendar) {
+    cJSON *json_array = cJSON_CreateArray();
+    if (json_array == NULL) {
+        return NULL;
+    }
+
+    CalendarBucket *bucket;
+    for (bucket = calendar_queue_first(calendar); bucket != NULL; bucket = calendar_queue_next(calendar, bucket)) {
+        cJSON *json_entry_list = entry_list_to_json(&bucket->entry_list);
+        if (
+            json_entry_list == NULL
+            || cJSON_AddNumberToObject(json_entry_list, CALENDAR_QUEUE_DELIVER_DAY, bucket->day) == NULL
+            || !cJSON_AddItemToArray(json_array, json_entry_list)
+        ) {
+            // failed to create entry list from scheduled bucket
+            cJSON_Delete(json_entry_list);
+            cJSON_Delete(json_array);
             return NULL;
         }
-        cJSON_AddItemToArray(json_array, json_entry_list);
     }
     return json_array;
+}
+
+cJSON *recurrence_heap_to_json(RecurrenceHeap *heap) {
+    cJSON *json_array = cJSON_CreateArray();
+    if (json_array == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < heap->size; i++) {
+        Recurrence *recurrence = &heap->items[i];
+        cJSON *json_obj = cJSON_CreateObject();
+        if (
+            json_obj == NULL
+            || cJSON_AddStringToObject(json_obj, RECURRENCE_ENTRY, recurrence->entry) == NULL
+            || cJSON_AddStringToObject(json_obj, RECURRENCE_RULE, recurrence_rule_to_string(recurrence->rule)) == NULL
+            || cJSON_AddNumberToObject(json_obj, RECURRENCE_PARAM, recurrence->param) == NULL
+            || cJSON_AddNumberToObject(json_obj, RECURRENCE_NEXT_DAY, recurrence->next_day) == NULL
+            || !cJSON_AddItemToArray(json_array, json_obj)
+        ) {
+            cJSON_Delete(json_obj);
+            cJSON_Delete(json_array);
+            return NULL;
+        }
+    }
+    return json_array;
+}
+
+cJSON *usage_stats_to_json(UsageStats *stats) {
+    cJSON *json_obj = cJSON_CreateObject();
+    if (json_obj == NULL) {
+        return NULL;
+    }
+    double totals[9] = {
+        stats->written, stats->length, stats->delivered, stats->read, stats->received, stats->latency,
+        stats->last_written_day, stats->streak, stats->longest_streak
+    };
+    char *names[9] = {
+        STATS_WRITTEN, STATS_LENGTH, STATS_DELIVERED, STATS_READ, STATS_RECEIVED, STATS_LATENCY,
+        STATS_LAST_WRITTEN_DAY, STATS_STREAK, STATS_LONGEST_STREAK
+    };
+    for (int i = 0; i < 9; i++) {
+        if (cJSON_AddNumberToObject(json_obj, names[i], totals[i]) == NULL) {
+            cJSON_Delete(json_obj);
+            return NULL;
+        }
+    }
+    cJSON *json_array = cJSON_AddArrayToObject(json_obj, STATS_DAYS);
+    if (json_array == NULL) {
+        cJSON_Delete(json_obj);
+        return NULL;
+    }
+    for (int i = 0; i < stats->size; i++) {
+        DayRollup *rollup = &stats->days[i];
+        double row[6] = { rollup->day, rollup->written, rollup->length, rollup->flags, rollup->received, rollup->latency };
+        cJSON *json_row = cJSON_CreateDoubleArray(row, 6);
+        if (json_row == NULL || !cJSON_AddItemToArray(json_array, json_row)) {
+            cJSON_Delete(json_row);
+            cJSON_Delete(json_obj);
+            return NULL;
+        }
+    }
+    return json_obj;
 }
\ No newline at end of file
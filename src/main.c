@@ -5,8 +5,12 @@
 
 #include "command_router.h"
 #include "time_utils.h"
+#include "trace.h"
+#include "mem.h"
 
 int main(int argc, char **argv) {
+    mem_init();
+    trace_init(argc, argv);
     command_router(argc, argv);
     return 0;
 }
\ No newline at end of file
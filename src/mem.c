@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdalign.h>
+#include <cjson/cJSON.h>
+
+#include "mem.h"
+#include "panic.h"
+
+/*
+Sits in front of every block. Aligned like max_align_t so the pointer
+handed out after it is suitably aligned for any type.
+*/
+typedef struct MemHeader {
+    alignas(max_align_t) size_t size;
+    MemTag tag;
+} MemHeader;
+
+static MemStats stats[MEM_TAG_COUNT];
+/* peak of the sum over all tags, the per tag peaks don't add up to it */
+static size_t total_live_bytes = 0;
+static size_t total_peak_bytes = 0;
+
+static char *mem_tag_names[MEM_TAG_COUNT] = {
+    [MEM_GENERAL] = "general",
+    [MEM_CONTEXT] = "context",
+    [MEM_MODULO] = "modulo",
+    [MEM_ENTRY_LIST] = "entry_list",
+    [MEM_JSON] = "json",
+    [MEM_EDITOR] = "editor",
+    [MEM_TIME] = "time",
+    [MEM_VOCAB] = "vocab",
+    [MEM_TAGS] = "tags"
+};
+
+static void *json_malloc(size_t size);
+static void account_alloc(MemTag tag, size_t size);
+static void account_free(MemTag tag, size_t size);
+static void out_of_memory(size_t size);
+static void print_report_stderr();
+
+void mem_init() {
+    cJSON_Hooks hooks = {
+        .malloc_fn = json_malloc,
+        .free_fn = mem_free
+    };
+    cJSON_InitHooks(&hooks);
+}
+
+void *mem_alloc(MemTag tag, size_t size) {
+    MemHeader *header = malloc(sizeof(MemHeader) + size);
+    if (header == NULL) {
+        out_of_memory(size);
+    }
+    header->size = size;
+    header->tag = tag;
+    account_alloc(tag, size);
+    return header + 1;
+}
+
+void *mem_calloc(MemTag tag, size_t count, size_t size) {
+    if (size != 0 && count > ((size_t) -1 - sizeof(MemHeader)) / size) {
+        out_of_memory((size_t) -1);
+    }
+    void *ptr = mem_alloc(tag, count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void *mem_realloc(MemTag tag, void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return mem_alloc(tag, size);
+    }
+    MemHeader *header = (MemHeader *) ptr - 1;
+    MemTag block_tag = header->tag;
+    size_t old_size = header->size;
+    header = realloc(header, sizeof(MemHeader) + size);
+    if (header == NULL) {
+        out_of_memory(size);
+    }
+    header->size = size;
+    stats[block_tag].reallocs++;
+    // a realloc counts as freeing the old block and allocating the new one
+    // without bumping the alloc / free counts
+    account_free(block_tag, old_size);
+    stats[block_tag].frees--;
+    account_alloc(block_tag, size);
+    stats[block_tag].allocs--;
+    return header + 1;
+}
+
+void mem_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    MemHeader *header = (MemHeader *) ptr - 1;
+    account_free(header->tag, header->size);
+    free(header);
+}
+
+char *mem_strdup(MemTag tag, const char *string) {
+    size_t length = strlen(string);
+    char *copy = mem_alloc(tag, length + 1);
+    memcpy(copy, string, length + 1);
+    return copy;
+}
+
+MemStats mem_get_stats(MemTag tag) {
+    return stats[tag];
+}
+
+MemStats mem_get_total() {
+    MemStats total = { .peak_bytes = total_peak_bytes };
+    for (int tag = 0; tag < MEM_TAG_COUNT; tag++) {
+        total.allocs += stats[tag].allocs;
+        total.frees += stats[tag].frees;
+        total.reallocs += stats[tag].reallocs;
+        total.live_bytes += stats[tag].live_bytes;
+        total.total_bytes += stats[tag].total_bytes;
+    }
+    return total;
+}
+
+char *mem_tag_to_string(MemTag tag) {
+    if (tag < 0 || tag >= MEM_TAG_COUNT) {
+        return "unknown";
+    }
+    return mem_tag_names[tag];
+}
+
+/*
+e.g.
+tag            allocs     frees  reallocs    live_bytes    peak_bytes   total_bytes
+json             5012      5012         0             0        812044        812044
+...
+*/
+void mem_print_report(FILE *fp) {
+    char *row_format = "%-12s %9lld %9lld %9lld %13zu %13zu %13zu\n";
+    fprintf(
+        fp, "%-12s %9s %9s %9s %13s %13s %13s\n",
+        "tag", "allocs", "frees", "reallocs", "live_bytes", "peak_bytes", "total_bytes"
+    );
+    for (int tag = 0; tag < MEM_TAG_COUNT; tag++) {
+        MemStats *s = &stats[tag];
+        fprintf(
+            fp, row_format, mem_tag_names[tag],
+            s->allocs, s->frees, s->reallocs, s->live_bytes, s->peak_bytes, s->total_bytes
+        );
+    }
+    MemStats total = mem_get_total();
+    fprintf(
+        fp, row_format, "total",
+        total.allocs, total.frees, total.reallocs, total.live_bytes, total.peak_bytes, total.total_bytes
+    );
+    long long live_blocks = total.allocs - total.frees;
+    if (live_blocks != 0) {
+        fprintf(fp, "%lld blocks (%zu bytes) still live at exit\n", live_blocks, total.live_bytes);
+    }
+}
+
+void mem_report_at_exit() {
+    atexit(print_report_stderr);
+}
+
+void *json_malloc(size_t size) {
+    return mem_alloc(MEM_JSON, size);
+}
+
+void account_alloc(MemTag tag, size_t size) {
+    MemStats *s = &stats[tag];
+    s->allocs++;
+    s->total_bytes += size;
+    s->live_bytes += size;
+    if (s->live_bytes > s->peak_bytes) {
+        s->peak_bytes = s->live_bytes;
+    }
+    total_live_bytes += size;
+    if (total_live_bytes > total_peak_bytes) {
+        total_peak_bytes = total_live_bytes;
+    }
+}
+
+void account_free(MemTag tag, size_t size) {
+    stats[tag].frees++;
+    stats[tag].live_bytes -= size;
+    total_live_bytes -= size;
+}
+
+void out_of_memory(size_t size) {
+    panic("Error: out of memory allocating %zu bytes\n", size);
+}
+
+void print_report_stderr() {
+    fprintf(stderr, "\nmodulo-mem\n");
+    mem_print_report(stderr);
+}
\ No newline at end of file
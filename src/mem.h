@@ -0,0 +1,74 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+Counting allocator
+
+Every heap allocation modulo owns goes through mem_alloc / mem_realloc /
+mem_free with a tag naming the subsystem that owns it. Blocks carry a small
+header with their size and tag so mem_free can account for live bytes
+without the caller passing the size back in.
+
+Pointers from mem_alloc must be released with mem_free (not free) and
+vice versa. The cli hooks cJSON onto the same allocator with mem_init,
+libmodulo leaves cJSON's hooks to its host. Either way strings returned by
+cJSON_Print are released with cJSON_free, never mem_free.
+
+An allocation that fails panics (see panic.h), which prints an error and
+exits unless a panic handler is set.
+
+The counters are plain integer adds and always on. `modulo debug mem <command>`
+prints them when the command exits, live bytes at exit are leaks.
+*/
+
+typedef enum MemTag {
+    MEM_GENERAL,
+    /* OSContext paths */
+    MEM_CONTEXT,
+    /* Modulo struct and its containers (history, scheduled, recurring, index) */
+    MEM_MODULO,
+    /* entry arrays and entry text */
+    MEM_ENTRY_LIST,
+    /* cJSON trees, printed json and the raw file text */
+    MEM_JSON,
+    MEM_EDITOR,
+    MEM_TIME,
+    /* completion vocabulary trie */
+    MEM_VOCAB,
+    /* tag index, names and posting lists */
+    MEM_TAGS,
+    MEM_TAG_COUNT
+} MemTag;
+
+typedef struct MemStats {
+    long long allocs;
+    long long frees;
+    long long reallocs;
+    size_t live_bytes;
+    size_t peak_bytes;
+    /* bytes requested over the whole run */
+    size_t total_bytes;
+} MemStats;
+
+// hooks cJSON onto the allocator, call before any cJSON object is created
+void mem_init();
+
+void *mem_alloc(MemTag tag, size_t size);
+void *mem_calloc(MemTag tag, size_t count, size_t size);
+// a NULL ptr allocates with tag, otherwise the block keeps its original tag
+void *mem_realloc(MemTag tag, void *ptr, size_t size);
+void mem_free(void *ptr);
+char *mem_strdup(MemTag tag, const char *string);
+
+MemStats mem_get_stats(MemTag tag);
+MemStats mem_get_total();
+char *mem_tag_to_string(MemTag tag);
+
+void mem_print_report(FILE *fp);
+// print the report on stderr when the process exits
+void mem_report_at_exit();
+
+#endif
\ No newline at end of file
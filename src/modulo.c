@@ -6,6 +6,7 @@
 #include "entry_list.h"
 #include "json.h"
 #include "time_utils.h"
+#include "mem.h"
 
 /*
 
@@ -52,15 +53,24 @@ e.g. indexing outside the address boundary of an array, strcpy with strlen(src)
 
 static time_t default_wakeup();
 static void modulo_increment_day_ptr(Modulo *modulo, int days);
+static EntryList modulo_take_carry_over(Modulo *modulo, EntryList *entry_list);
+static void modulo_retire_entry_list(Modulo *modulo, EntryList *entry_list);
+static void assign_entry_list_ids(Modulo *modulo, EntryList *entry_list, void *arg);
+static void index_entry_list(Modulo *modulo, EntryList *entry_list, void *arg);
+static void modulo_index_entry(Modulo *modulo, EntryList *entry_list, int slot);
 
 Modulo *create_default_modulo(char *username) {
-    Modulo *modulo = malloc(sizeof(Modulo));
+    Modulo *modulo = mem_alloc(MEM_MODULO, sizeof(Modulo));
 
     // set preferences
-    modulo_set_username(modulo, username);
+    if (modulo_set_username(modulo, username) == -1) {
+        mem_free(modulo);
+        return NULL;
+    }
     modulo_set_wakeup_earliest(modulo, DEFAULT_WAKEUP_EARLIEST);
     modulo_set_wakeup_latest(modulo, DEFAULT_WAKEUP_LATEST);
     modulo_set_entry_delimiter(modulo, "%");
+    modulo_set_carry_over(modulo, DEFAULT_CARRY_OVER);
 
     // initialize day pointer
     time_t day_ptr_0 = time_to_utc_prev(DEFAULT_WAKEUP_LATEST, utc_now());
@@ -77,6 +87,22 @@ Modulo *create_default_modulo(char *username) {
     // initialize history
     HistoryQueue history = create_history_queue();
     modulo_set_history(modulo, history);
+
+    // initialize scheduled entries
+    CalendarQueue scheduled = create_calendar_queue(modulo_get_day(modulo));
+    modulo_set_scheduled(modulo, scheduled);
+
+    // initialize recurring entries
+    RecurrenceHeap recurring = create_recurrence_heap();
+    modulo_set_recurring(modulo, recurring);
+
+    // entry ids start at 1
+    modulo_set_next_entry_id(modulo, 1);
+    modulo_set_edit_generation(modulo, 0);
+    modulo->index = (EntryIndex) { .capacity = 0 };
+
+    // initialize usage stats
+    modulo_set_stats(modulo, create_usage_stats());
     return modulo;
 }
 
@@ -84,34 +110,60 @@ void free_modulo(Modulo *modulo) {
     free_entry_list(&modulo->today);
     free_entry_list(&modulo->tomorrow);
     free_history_queue(&modulo->history);
-    free(modulo);
+    free_calendar_queue(&modulo->scheduled);
+    free_recurrence_heap(&modulo->recurring);
+    free_entry_index(&modulo->index);
+    free_usage_stats(&modulo->stats);
+    mem_free(modulo);
+}
+
+void modulo_replace(Modulo *modulo, Modulo *latest) {
+    Modulo old = *modulo;
+    *modulo = *latest;
+    *latest = old;
+    free_modulo(latest);
+    // refs point at the lists inside the Modulo they were built in, the next lookup rebuilds it
+    free_entry_index(&modulo->index);
 }
 
-void modulo_set_username(Modulo *modulo, char *username) {
-    check_length(
-        username, 
-        USER_NAME_MAX_LEN, 
-        "Error: input string too long for username\n"
-    );
+int modulo_set_username(Modulo *modulo, char *username) {
+    if (strlen(username) > USER_NAME_MAX_LEN) {
+        return -1;
+    }
     strcpy(modulo->username, username);
+    return 0;
 }
 
 void modulo_set_wakeup_earliest(Modulo *modulo, clk_time_t wakeup) { modulo->wakeup_earliest = wakeup; }
 void modulo_set_wakeup_latest(Modulo *modulo, clk_time_t wakeup) { modulo->wakeup_latest = wakeup; }
 
-void modulo_set_entry_delimiter(Modulo *modulo, char *entry_delimiter) {
-    check_length(
-        entry_delimiter, 
-        DELIMITER_MAX_LEN, 
-        "Error: input string too long for entry_delimiter\n"
-    );
+int modulo_set_entry_delimiter(Modulo *modulo, char *entry_delimiter) {
+    if (strlen(entry_delimiter) > DELIMITER_MAX_LEN) {
+        return -1;
+    }
     strcpy(modulo->entry_delimiter, entry_delimiter);
+    return 0;
+}
+
+int modulo_set_carry_over(Modulo *modulo, CarryOver carry_over) {
+    if (carry_over < CARRY_NONE || carry_over >= CARRY_INVALID) {
+        return -1;
+    }
+    modulo->carry_over = carry_over;
+    return 0;
 }
 
 void modulo_set_day_ptr(Modulo *modulo, time_t day_ptr) {
     modulo->day_ptr = day_ptr;
 }
 
+void modulo_move_wakeup_latest(Modulo *modulo, clk_time_t wakeup_latest) {
+    modulo->wakeup_latest = wakeup_latest;
+    // new day_ptr is wakeup_latest occurring before next wakeup_earliest
+    time_t next_wakeup_earliest = time_to_utc_next(modulo->wakeup_earliest, modulo->day_ptr);
+    modulo->day_ptr = time_to_utc_prev(wakeup_latest, next_wakeup_earliest);
+}
+
 void modulo_set_today(Modulo *modulo, EntryList entry_list) {
     modulo->today = entry_list;
 }
@@ -123,6 +175,26 @@ void modulo_set_history(Modulo *modulo, HistoryQueue history) {
     modulo->history = history;
 }
 
+void modulo_set_scheduled(Modulo *modulo, CalendarQueue scheduled) {
+    modulo->scheduled = scheduled;
+}
+
+void modulo_set_recurring(Modulo *modulo, RecurrenceHeap recurring) {
+    modulo->recurring = recurring;
+}
+
+void modulo_set_next_entry_id(Modulo *modulo, uint64_t next_entry_id) {
+    modulo->next_entry_id = next_entry_id;
+}
+
+void modulo_set_edit_generation(Modulo *modulo, uint64_t edit_generation) {
+    modulo->edit_generation = edit_generation;
+}
+
+void modulo_set_stats(Modulo *modulo, UsageStats stats) {
+    modulo->stats = stats;
+}
+
 void modulo_push_history(Modulo *modulo, EntryList *entry_list) {
     history_queue_push(&modulo->history, entry_list);
 }
@@ -132,18 +204,135 @@ char *modulo_get_username(Modulo *modulo) { return modulo->username; }
 clk_time_t modulo_get_wakeup_earliest(Modulo *modulo) { return modulo->wakeup_earliest; }
 clk_time_t modulo_get_wakeup_latest(Modulo *modulo) { return modulo->wakeup_latest; }
 char *modulo_get_entry_delimiter(Modulo *modulo) { return modulo->entry_delimiter; }
+CarryOver modulo_get_carry_over(Modulo *modulo) { return modulo->carry_over; }
 
 time_t modulo_get_day_ptr(Modulo *modulo) { return modulo->day_ptr; }
 
 EntryList *modulo_get_today(Modulo *modulo) { return &modulo->today; }
 EntryList *modulo_get_tomorrow(Modulo *modulo) { return &modulo->tomorrow; }
 HistoryQueue *modulo_get_history(Modulo *modulo) { return &modulo->history; }
+CalendarQueue *modulo_get_scheduled(Modulo *modulo) { return &modulo->scheduled; }
+RecurrenceHeap *modulo_get_recurring(Modulo *modulo) { return &modulo->recurring; }
+uint64_t modulo_get_next_entry_id(Modulo *modulo) { return modulo->next_entry_id; }
+uint64_t modulo_get_edit_generation(Modulo *modulo) { return modulo->edit_generation; }
+UsageStats *modulo_get_stats(Modulo *modulo) { return &modulo->stats; }
+
+day_t modulo_get_day(Modulo *modulo) { return utc_to_day(modulo->day_ptr); }
+
+CarryOver parse_carry_over(char *str) {
+    if (strcmp(str, CARRY_OVER_NONE) == 0) {
+        return CARRY_NONE;
+    } else if (strcmp(str, CARRY_OVER_UNREAD) == 0) {
+        return CARRY_UNREAD;
+    } else if (strcmp(str, CARRY_OVER_UNFINISHED) == 0) {
+        return CARRY_UNFINISHED;
+    }
+    return CARRY_INVALID;
+}
+
+char *carry_over_to_string(CarryOver carry_over) {
+    switch (carry_over) {
+        case CARRY_NONE:
+            return CARRY_OVER_NONE;
+        case CARRY_UNREAD:
+            return CARRY_OVER_UNREAD;
+        case CARRY_UNFINISHED:
+            return CARRY_OVER_UNFINISHED;
+        default:
+            return NULL;
+    }
+}
+
+// Entries
+// every entry written goes through here (the editor, `modulo add`, libmodulo), so it's counted here
+Entry modulo_create_entry(Modulo *modulo, char *text) {
+    Entry entry = {
+        .id = modulo->next_entry_id++,
+        .created = utc_now(),
+        .text = text,
+        .length = strlen(text),
+        .flags = 0
+    };
+    stats_record_entry(&modulo->stats, modulo_get_day(modulo), entry.length);
+    return entry;
+}
+
+void modulo_assign_entry_ids(Modulo *modulo) {
+    modulo_for_each_entry_list(modulo, assign_entry_list_ids, NULL);
+}
+
+void assign_entry_list_ids(Modulo *modulo, EntryList *entry_list, void *arg) {
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->id == 0) {
+            entry->id = modulo->next_entry_id++;
+        }
+    }
+}
+
+/*
+The index is built from every list on the first lookup, after that
+lookups (and removals, which leave tombstones) are O(1)
+*/
+EntryRef modulo_find_entry(Modulo *modulo, uint64_t id) {
+    if (!entry_index_built(&modulo->index)) {
+        modulo->index = create_entry_index(ENTRY_INDEX_INIT_CAPACITY);
+        modulo_for_each_entry_list(modulo, index_entry_list, NULL);
+    }
+    EntryRef *ref = entry_index_get(&modulo->index, id);
+    if (ref == NULL || (entry_list_get_entry(ref->entry_list, ref->slot)->flags & ENTRY_REMOVED)) {
+        return (EntryRef) { .entry_list = NULL, .slot = -1 };
+    }
+    return *ref;
+}
+
+void index_entry_list(Modulo *modulo, EntryList *entry_list, void *arg) {
+    entry_index_put_list(&modulo->index, entry_list);
+}
+
+// keep a built index up to date with a newly pushed entry
+void modulo_index_entry(Modulo *modulo, EntryList *entry_list, int slot) {
+    if (entry_index_built(&modulo->index)) {
+        entry_index_put(&modulo->index, entry_list_get_entry(entry_list, slot)->id, entry_list, slot);
+    }
+}
+
+int modulo_remove_entry(Modulo *modulo, uint64_t id) {
+    EntryRef ref = modulo_find_entry(modulo, id);
+    if (ref.entry_list == NULL) {
+        return -1;
+    }
+    entry_list_tombstone(ref.entry_list, ref.slot);
+    return 0;
+}
+
+int modulo_set_entry_text(Modulo *modulo, uint64_t id, char *text) {
+    EntryRef ref = modulo_find_entry(modulo, id);
+    if (ref.entry_list == NULL) {
+        return -1;
+    }
+    entry_list_set_text(ref.entry_list, ref.slot, text);
+    modulo->edit_generation++;
+    return 0;
+}
+
+void modulo_for_each_entry_list(Modulo *modulo, void (*fn)(Modulo *, EntryList *, void *), void *arg) {
+    fn(modulo, &modulo->today, arg);
+    fn(modulo, &modulo->tomorrow, arg);
+    for (int i = 0; i < modulo->history.size; i++) {
+        fn(modulo, history_queue_get(&modulo->history, i), arg);
+    }
+    CalendarBucket *bucket;
+    for (bucket = calendar_queue_first(&modulo->scheduled); bucket != NULL; bucket = calendar_queue_next(&modulo->scheduled, bucket)) {
+        fn(modulo, &bucket->entry_list, arg);
+    }
+}
 
 // Tomorrow EntryList mutation
-// TODO: fix
 void modulo_push_tomorrow(Modulo *modulo, char *entry) {
     EntryList *tomorrow = modulo_get_tomorrow(modulo);
-    entry_list_push(tomorrow, entry);
+    entry_list_push_entry(tomorrow, modulo_create_entry(modulo, entry));
+    modulo_index_entry(modulo, tomorrow, tomorrow->size-1);
 }
 
 void modulo_remove_tomorrow(Modulo *modulo, int remove_index) {
@@ -151,6 +340,35 @@ void modulo_remove_tomorrow(Modulo *modulo, int remove_index) {
     entry_list_remove(tomorrow, remove_index);
 }
 
+/*
+Tomorrow's entries go straight to the tomorrow list,
+anything further out waits in the scheduled CalendarQueue
+*/
+void modulo_schedule(Modulo *modulo, char *entry, day_t delivery_day) {
+    day_t tomorrow_day = modulo_get_day(modulo) + 1;
+    if (delivery_day <= tomorrow_day) {
+        modulo_push_tomorrow(modulo, entry);
+        entry_list_set_send_date(modulo_get_tomorrow(modulo), utc_now());
+        return;
+    }
+    EntryList *scheduled = calendar_queue_get(&modulo->scheduled, delivery_day);
+    entry_list_push_entry(scheduled, modulo_create_entry(modulo, entry));
+    modulo_index_entry(modulo, scheduled, scheduled->size-1);
+    entry_list_set_send_date(scheduled, utc_now());
+}
+
+/*
+The first occurrence is the first matching day after today
+*/
+void modulo_add_recurring(Modulo *modulo, char *entry, RecurrenceRule rule, int param) {
+    Recurrence recurrence = create_recurrence(entry, rule, param, modulo_get_day(modulo));
+    recurrence_heap_push(&modulo->recurring, recurrence);
+}
+
+void modulo_remove_recurring(Modulo *modulo, int heap_index) {
+    recurrence_heap_remove(&modulo->recurring, heap_index);
+}
+
 // sync
 bool modulo_out_of_sync(Modulo *modulo) {
     return false;
@@ -164,28 +382,95 @@ bool modulo_check_sync(Modulo *modulo) {
     int days_out_of_sync = utc_to_offset(modulo, utc_now()) / (24*60*60);
     if (days_out_of_sync < 1) {
         // wakeup latest hasn't occurred today yet
-        return;
+        return false;
     }
     modulo_sync_forward(modulo, days_out_of_sync);
+    return true;
 }
 
+/*
+The new today list is built from
+    1. entries carried over from today (per the carry_over preference)
+    2. the tomorrow list, or when days were skipped and carry over is on, the
+       tomorrow list that nobody read (otherwise it goes straight to history)
+    3. scheduled and recurring entries due on or before the new day
+Entry lists are handed over whole wherever possible so carrying a long list
+forward doesn't depend on its length.
+*/
 void modulo_sync_forward(Modulo *modulo, int days) {
     if (days < 1) {
         return;
     }
+    time_t now = utc_now();
+    // lists are about to move, refs in the index would go stale
+    free_entry_index(&modulo->index);
+    entry_list_compact(&modulo->today);
+    entry_list_compact(&modulo->tomorrow);
     // set tomorrow.recv_date;
-    entry_list_set_recv_date(&modulo->tomorrow, utc_now());
-    // push today to history if non empty
+    entry_list_set_recv_date(&modulo->tomorrow, now);
+    day_t previous_day = modulo_get_day(modulo);
     if (!entry_list_empty(&modulo->today)) {
-        history_queue_push(&modulo->history, &modulo->today); 
+        stats_record_delivery(&modulo->stats, previous_day, entry_list_get_read_receipt(&modulo->today));
     }
-    if (days == 1) {
-        modulo_set_today(modulo, modulo->tomorrow);
+    // take the carried over entries before today goes to history
+    EntryList next_today = modulo_take_carry_over(modulo, &modulo->today);
+    modulo_retire_entry_list(modulo, &modulo->today);
+    bool tomorrow_received = !entry_list_empty(&modulo->tomorrow);
+    time_t tomorrow_send_date = entry_list_get_send_date(&modulo->tomorrow);
+    if (days == 1 || modulo->carry_over != CARRY_NONE) {
+        entry_list_concat(&next_today, &modulo->tomorrow);
     } else {
-        modulo_push_history(modulo, &modulo->tomorrow);
+        // nobody was around to read tomorrow's entries on the day they were for
+        if (tomorrow_received) {
+            stats_record_delivery(&modulo->stats, previous_day + 1, false);
+        }
+        tomorrow_received = false;
+        modulo_retire_entry_list(modulo, &modulo->tomorrow);
     }
+    // a new day hasn't been read yet
+    entry_list_set_read_receipt(&next_today, false);
+    modulo_set_today(modulo, next_today);
     modulo_set_tomorrow(modulo, create_entry_list());
     modulo_increment_day_ptr(modulo, days);
+    if (tomorrow_received) {
+        stats_record_receipt(&modulo->stats, modulo_get_day(modulo), tomorrow_send_date, now);
+    }
+
+    // deliver scheduled and recurring entries due on or before the new day
+    EntryList *today = &modulo->today;
+    day_t day = modulo_get_day(modulo);
+    int delivered = calendar_queue_advance(&modulo->scheduled, day, today);
+    int recurring_start = today->size;
+    delivered += recurrence_heap_deliver(&modulo->recurring, day, today);
+    // recurring occurrences are new entries
+    for (int i = recurring_start; i < today->size; i++) {
+        Entry *entry = entry_list_get_entry(today, i);
+        entry->id = modulo->next_entry_id++;
+        entry->created = now;
+    }
+    if (delivered > 0) {
+        entry_list_set_recv_date(today, now);
+    }
+}
+
+EntryList modulo_take_carry_over(Modulo *modulo, EntryList *entry_list) {
+    switch (modulo->carry_over) {
+        case CARRY_UNREAD:
+            return entry_list_take_unflagged(entry_list, ENTRY_READ);
+        case CARRY_UNFINISHED:
+            return entry_list_take_unflagged(entry_list, ENTRY_DONE);
+        default:
+            return create_entry_list();
+    }
+}
+
+// push entry_list to history if non empty
+void modulo_retire_entry_list(Modulo *modulo, EntryList *entry_list) {
+    if (!entry_list_empty(entry_list)) {
+        history_queue_push(&modulo->history, entry_list);
+    } else {
+        free_entry_list(entry_list);
+    }
 }
 
 void modulo_increment_day_ptr(Modulo *modulo, int days) {
@@ -194,9 +479,8 @@ void modulo_increment_day_ptr(Modulo *modulo, int days) {
     clk_time_t day_start = modulo->wakeup_latest;
     int day_start_hour = day_start / 60;
     int day_start_min = day_start % 60;
+    // a day_ptr off wakeup_latest (e.g. after a dst change) snaps back to it
     if (day_ptr_tm->tm_hour != day_start_hour || day_ptr_tm->tm_min != day_start_min) {
-        fprintf(stderr, "day ptr not synced with wakeup_latest\n");
-        fprintf(stderr, "day_ptr hour: %d, day_ptr min: %d\n", day_ptr_tm->tm_hour, day_ptr_tm->tm_min);
         day_ptr_tm->tm_hour = day_start_hour;
         day_ptr_tm->tm_min = day_start_min;
     }
@@ -209,15 +493,6 @@ void modulo_sync_with_timestamp(Modulo *modulo, time_t now) {
 
 }
 
-void check_length(char *string, int max_length, char *message) {
-    size_t length = strlen(string);
-    if (length > max_length) {
-        fprintf(stderr, message);
-        fprintf(stderr, "max length: %d, input length: %d\n", max_length, length);
-        exit(1);
-    }
-}
-
 time_t default_wakeup() {
     //TODO
     return 0;
@@ -6,6 +6,10 @@
 #include <time.h>
 
 #include "entry_list.h"
+#include "entry_index.h"
+#include "calendar_queue.h"
+#include "recurring.h"
+#include "stats.h"
 #include "time_types.h"
 
 
@@ -17,13 +21,38 @@
 #define MODULO_TODAY "today"
 #define MODULO_TOMORROW "tomorrow"
 #define MODULO_HISTORY "history"
+#define MODULO_SCHEDULED "scheduled"
+#define MODULO_RECURRING "recurring"
+#define MODULO_CARRY_OVER "carry_over"
+#define MODULO_NEXT_ENTRY_ID "next_entry_id"
+#define MODULO_EDIT_GENERATION "edit_generation"
+#define MODULO_STATS "stats"
+
+#define CARRY_OVER_NONE "none"
+#define CARRY_OVER_UNREAD "unread"
+#define CARRY_OVER_UNFINISHED "unfinished"
 
 #define DEFAULT_WAKEUP_EARLIEST (6*60)
 #define DEFAULT_WAKEUP_LATEST (9*60)
+/* for new stores, stores saved before carry_over existed load as CARRY_NONE */
+#define DEFAULT_CARRY_OVER CARRY_UNREAD
 
 #define USER_NAME_MAX_LEN 31
 #define DELIMITER_MAX_LEN 15
 
+/*
+Which of today's entries move forward into the next day when a day ends
+    CARRY_NONE:       today's entries all go to history
+    CARRY_UNREAD:     entries that were never shown by `modulo today`
+    CARRY_UNFINISHED: entries that haven't been marked with `modulo done`
+*/
+typedef enum CarryOver {
+    CARRY_NONE,
+    CARRY_UNREAD,
+    CARRY_UNFINISHED,
+    CARRY_INVALID
+} CarryOver;
+
 /* 
 Modulo defines days to start and end at the user specified wakeup_latest time
 
@@ -50,6 +79,8 @@ typedef struct Modulo {
     clk_time_t wakeup_latest; 
     /* the delimiter typed indicate the end of an entry */
     char entry_delimiter[DELIMITER_MAX_LEN + 1];
+    /* which entries carry over into the next day */
+    CarryOver carry_over;
     /*
     day_ptr:
     reference utc datetime to the "beginning" of the day 
@@ -76,6 +107,37 @@ typedef struct Modulo {
     (i.e. the most recent EntryLists written before yesterday)
     */
     HistoryQueue history;
+    /*
+    CalendarQueue scheduled:
+    EntryLists written for days after tomorrow, keyed by delivery day.
+    Due entries are delivered to the today list as days are synced.
+    */
+    CalendarQueue scheduled;
+    /*
+    RecurrenceHeap recurring:
+    Recurring entry templates ordered by next delivery day.
+    Due occurrences are copied into the today list as days are synced.
+    */
+    RecurrenceHeap recurring;
+    /* the id given to the next entry created (ids are never reused) */
+    uint64_t next_entry_id;
+    /*
+    bumped whenever an entry's text is replaced in place (`modulo edit`), so
+    caches built from entry text (the tag index) can tell they're stale
+    */
+    uint64_t edit_generation;
+    /*
+    EntryIndex index:
+    entry id -> (EntryList, slot) for every entry in today, tomorrow, history and scheduled.
+    Built on the first lookup and dropped whenever a sync moves lists around.
+    */
+    EntryIndex index;
+    /*
+    UsageStats stats:
+    Running totals and per-day rollups for `modulo stats`, updated as entries
+    are written and as days are synced.
+    */
+    UsageStats stats;
 } Modulo;
 
 /*
@@ -83,36 +145,80 @@ typedef struct Modulo {
 */
 
 
+// NULL if username is too long
 Modulo *create_default_modulo(char *username);
 void free_modulo(Modulo *modulo);
+// move latest's contents into modulo (keeping the pointer valid for whoever holds it) and free latest
+void modulo_replace(Modulo *modulo, Modulo *latest);
 
-// setters
-void modulo_set_username(Modulo *modulo, char *username);
+// setters, the ones that validate return -1 (and change nothing) for a bad value
+int modulo_set_username(Modulo *modulo, char *username);
 void modulo_set_wakeup_earliest(Modulo *modulo, clk_time_t wakeup_earliest);
 void modulo_set_wakeup_latest(Modulo *modulo, clk_time_t wakeup_latest);
-void modulo_set_entry_delimiter(Modulo *modulo, char *username);
+int modulo_set_entry_delimiter(Modulo *modulo, char *entry_delimiter);
+int modulo_set_carry_over(Modulo *modulo, CarryOver carry_over);
 
 void modulo_set_day_ptr(Modulo *modulo, time_t day_ptr);
+// set wakeup_latest and move day_ptr to it, the day frame still ends at the next wakeup_earliest
+void modulo_move_wakeup_latest(Modulo *modulo, clk_time_t wakeup_latest);
 
 void modulo_set_today(Modulo *modulo, EntryList entry_list);
 void modulo_set_tomorrow(Modulo *modulo, EntryList entry_list);
 void modulo_set_history(Modulo *modulo, HistoryQueue history);
+void modulo_set_scheduled(Modulo *modulo, CalendarQueue scheduled);
+void modulo_set_recurring(Modulo *modulo, RecurrenceHeap recurring);
+void modulo_set_next_entry_id(Modulo *modulo, uint64_t next_entry_id);
+void modulo_set_edit_generation(Modulo *modulo, uint64_t edit_generation);
+void modulo_set_stats(Modulo *modulo, UsageStats stats);
 
 // getters
 char *modulo_get_username(Modulo *modulo);
 clk_time_t modulo_get_wakeup_earliest(Modulo *modulo);
 clk_time_t modulo_get_wakeup_latest(Modulo *modulo);
 char *modulo_get_entry_delimiter(Modulo *modulo);
+CarryOver modulo_get_carry_over(Modulo *modulo);
 
 time_t modulo_get_day_ptr(Modulo *modulo);
 
 EntryList *modulo_get_today(Modulo *modulo);
 EntryList *modulo_get_tomorrow(Modulo *modulo);
 HistoryQueue *modulo_get_history(Modulo *modulo);
+CalendarQueue *modulo_get_scheduled(Modulo *modulo);
+RecurrenceHeap *modulo_get_recurring(Modulo *modulo);
+uint64_t modulo_get_next_entry_id(Modulo *modulo);
+uint64_t modulo_get_edit_generation(Modulo *modulo);
+UsageStats *modulo_get_stats(Modulo *modulo);
+
+// local calendar day of the current day frame (the day day_ptr starts)
+day_t modulo_get_day(Modulo *modulo);
+
+// carry over policy names. parse returns CARRY_INVALID for unknown names
+CarryOver parse_carry_over(char *str);
+char *carry_over_to_string(CarryOver carry_over);
+
+// Entries
+// create an Entry record for text with the next entry id
+Entry modulo_create_entry(Modulo *modulo, char *text);
+// give every entry without an id one (stores written before entries had ids)
+void modulo_assign_entry_ids(Modulo *modulo);
+// locate an entry by id. returns a ref with a NULL entry_list if there is no such entry
+EntryRef modulo_find_entry(Modulo *modulo, uint64_t id);
+// remove the entry with id. returns -1 if there is no such entry
+int modulo_remove_entry(Modulo *modulo, uint64_t id);
+// replace the text of the entry with id (takes ownership of text) and bump edit_generation. returns -1 if there is no such entry
+int modulo_set_entry_text(Modulo *modulo, uint64_t id, char *text);
+// call fn on today, tomorrow, every history list and every scheduled list
+void modulo_for_each_entry_list(Modulo *modulo, void (*fn)(Modulo *, EntryList *, void *), void *arg);
 
 // EntryList
 void modulo_push_tomorrow(Modulo *modulo, char *entry);
 void modulo_remove_tomorrow(Modulo *modulo, int remove_index);
+// schedule entry for delivery on a day after today
+void modulo_schedule(Modulo *modulo, char *entry, day_t delivery_day);
+
+// Recurring entries
+void modulo_add_recurring(Modulo *modulo, char *entry, RecurrenceRule rule, int param);
+void modulo_remove_recurring(Modulo *modulo, int heap_index);
 
 // sync
 bool modulo_check_sync(Modulo *modulo);
@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <setjmp.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "modulo_store.h"
+#include "modulo.h"
+#include "entry_list.h"
+#include "filesystem.h"
+#include "mem.h"
+#include "panic.h"
+
+/*
+ModuloStore:
+The loaded store and the identity of the modulo.json it was loaded from.
+Saves rename a new file over modulo.json, so a different inode (or mtime,
+for editors writing in place) means another process changed the store
+*/
+struct ModuloStore {
+    OSContext *context;
+    /* NULL after a failed allocation, until the next sync reloads it */
+    Modulo *modulo;
+    ino_t inode;
+    struct timespec mtime;
+    /* the store lock while a write holds it, -1 otherwise */
+    int lock;
+};
+
+/*
+The library never exits its host. An api call that can panic (see panic.h),
+e.g. when an allocation fails, sets recover_point with setjmp and installs
+store_panic, which jumps back to it; the call then returns MODULO_ERR_IO.
+There is one recover_point per process, so the api isn't thread safe
+*/
+static jmp_buf *recover_point = NULL;
+
+static ModuloStatus store_reload(ModuloStore *store);
+static ModuloStatus store_save(ModuloStore *store);
+static bool store_changed(ModuloStore *store);
+static EntryList *store_list(ModuloStore *store, ModuloList list, int item);
+static void store_guard(jmp_buf *recover);
+static void store_unguard();
+static void store_panic(const char *message);
+static ModuloStatus store_recover(ModuloStore *store);
+
+ModuloStore *modulo_store_open(const char *config_dir, ModuloStatus *status) {
+    jmp_buf recover;
+    if (setjmp(recover) != 0) {
+        // whatever was allocated so far is lost, there was no store to hand back yet
+        store_unguard();
+        if (status != NULL) {
+            *status = MODULO_ERR_IO;
+        }
+        return NULL;
+    }
+    store_guard(&recover);
+    ModuloStore *store = mem_alloc(MEM_CONTEXT, sizeof(ModuloStore));
+    store->context = config_dir == NULL ? get_context() : create_context(config_dir);
+    store->modulo = NULL;
+    store->lock = -1;
+    ModuloStatus result = store_reload(store);
+    store_unguard();
+    if (status != NULL) {
+        *status = result;
+    }
+    if (result != MODULO_OK) {
+        modulo_store_close(store);
+        return NULL;
+    }
+    return store;
+}
+
+void modulo_store_close(ModuloStore *store) {
+    if (store->modulo != NULL) {
+        free_modulo(store->modulo);
+    }
+    free_context(store->context);
+    mem_free(store);
+}
+
+ModuloStatus modulo_store_sync(ModuloStore *store) {
+    jmp_buf recover;
+    if (setjmp(recover) != 0) {
+        return store_recover(store);
+    }
+    store_guard(&recover);
+    if (store_changed(store)) {
+        ModuloStatus status = store_reload(store);
+        if (status != MODULO_OK) {
+            store_unguard();
+            return status;
+        }
+    }
+    if (!modulo_check_sync(store->modulo)) {
+        store_unguard();
+        return MODULO_OK;
+    }
+    // advanced a day. redo it on the latest store under the lock and write it back
+    store->lock = lock_modulo(store->context, NULL);
+    ModuloStatus status = store->lock == -2 ? MODULO_ERR_IO : store_reload(store);
+    if (status == MODULO_OK && modulo_check_sync(store->modulo)) {
+        status = store_save(store);
+    }
+    unlock_modulo(store->lock);
+    store->lock = -1;
+    store_unguard();
+    return status;
+}
+
+int modulo_store_query(ModuloStore *store, ModuloList list, int item, ModuloEntryFn fn, void *arg) {
+    if (store->modulo == NULL) {
+        return MODULO_ERR_IO;
+    }
+    EntryList *entry_list = store_list(store, list, item);
+    if (entry_list == NULL) {
+        return MODULO_ERR_INVALID;
+    }
+    int visited = 0;
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->flags & ENTRY_REMOVED) {
+            continue;
+        }
+        ModuloEntryView view = {
+            .id = entry->id,
+            .created = entry->created,
+            .text = entry->text,
+            .length = entry->length,
+            .read = (entry->flags & ENTRY_READ) != 0,
+            .done = (entry->flags & ENTRY_DONE) != 0
+        };
+        visited++;
+        if (fn(&view, arg) != 0) {
+            break;
+        }
+    }
+    return visited;
+}
+
+int modulo_store_count(ModuloStore *store, ModuloList list, int item) {
+    if (store->modulo == NULL) {
+        return MODULO_ERR_IO;
+    }
+    EntryList *entry_list = store_list(store, list, item);
+    if (entry_list == NULL) {
+        return MODULO_ERR_INVALID;
+    }
+    return entry_list_live_count(entry_list);
+}
+
+ModuloStatus modulo_store_add(ModuloStore *store, const char *text, uint64_t *id) {
+    if (text == NULL || text[0] == '\0') {
+        return MODULO_ERR_INVALID;
+    }
+    jmp_buf recover;
+    if (setjmp(recover) != 0) {
+        return store_recover(store);
+    }
+    store_guard(&recover);
+    store->lock = lock_modulo(store->context, NULL);
+    ModuloStatus status = store->lock == -2 ? MODULO_ERR_IO : MODULO_OK;
+    if (status == MODULO_OK && store_changed(store)) {
+        status = store_reload(store);
+    }
+    if (status == MODULO_OK) {
+        Modulo *modulo = store->modulo;
+        modulo_check_sync(modulo);
+        modulo_schedule(modulo, mem_strdup(MEM_ENTRY_LIST, text), modulo_get_day(modulo) + 1);
+        if (id != NULL) {
+            EntryList *tomorrow = modulo_get_tomorrow(modulo);
+            *id = entry_list_get_entry(tomorrow, tomorrow->size-1)->id;
+        }
+        status = store_save(store);
+    }
+    unlock_modulo(store->lock);
+    store->lock = -1;
+    store_unguard();
+    return status;
+}
+
+/*
+    replaces the loaded store with modulo.json, remembering which file it came from
+*/
+ModuloStatus store_reload(ModuloStore *store) {
+    struct stat st;
+    if (stat(store->context->modulo_json_filepath, &st) == -1) {
+        return MODULO_ERR_UNINITIALIZED;
+    }
+    Modulo *modulo = load_modulo(store->context);
+    if (modulo == NULL) {
+        return MODULO_ERR_IO;
+    }
+    if (store->modulo != NULL) {
+        free_modulo(store->modulo);
+    }
+    store->modulo = modulo;
+    store->inode = st.st_ino;
+    store->mtime = st.st_mtim;
+    return MODULO_OK;
+}
+
+ModuloStatus store_save(ModuloStore *store) {
+    if (save_modulo(store->modulo, store->context) == -1) {
+        return MODULO_ERR_IO;
+    }
+    struct stat st;
+    if (stat(store->context->modulo_json_filepath, &st) == 0) {
+        store->inode = st.st_ino;
+        store->mtime = st.st_mtim;
+    }
+    return MODULO_OK;
+}
+
+bool store_changed(ModuloStore *store) {
+    if (store->modulo == NULL) {
+        return true;
+    }
+    struct stat st;
+    if (stat(store->context->modulo_json_filepath, &st) == -1) {
+        return true;
+    }
+    return st.st_ino != store->inode
+        || st.st_mtim.tv_sec != store->mtime.tv_sec
+        || st.st_mtim.tv_nsec != store->mtime.tv_nsec;
+}
+
+EntryList *store_list(ModuloStore *store, ModuloList list, int item) {
+    Modulo *modulo = store->modulo;
+    switch (list) {
+        case MODULO_LIST_TODAY:
+            return modulo_get_today(modulo);
+        case MODULO_LIST_TOMORROW:
+            return modulo_get_tomorrow(modulo);
+        case MODULO_LIST_HISTORY: {
+            HistoryQueue *history = modulo_get_history(modulo);
+            if (item < 1 || item > history->size) {
+                return NULL;
+            }
+            return history_queue_get(history, item-1);
+        }
+        default:
+            return NULL;
+    }
+}
+
+void store_guard(jmp_buf *recover) {
+    recover_point = recover;
+    panic_set_handler(store_panic);
+}
+
+void store_unguard() {
+    recover_point = NULL;
+    panic_set_handler(NULL);
+}
+
+void store_panic(const char *message) {
+    longjmp(*recover_point, 1);
+}
+
+/*
+    an allocation failed or an invariant broke part way through an api call. The loaded store may be
+    half updated, so it's dropped (not freed, its containers may be inconsistent)
+    and the next modulo_store_sync reloads it. A lock taken by the call is released
+*/
+ModuloStatus store_recover(ModuloStore *store) {
+    store_unguard();
+    unlock_modulo(store->lock);
+    store->lock = -1;
+    store->modulo = NULL;
+    return MODULO_ERR_IO;
+}
\ No newline at end of file
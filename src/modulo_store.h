@@ -0,0 +1,75 @@
+#ifndef MODULO_STORE_H
+#define MODULO_STORE_H
+
+/*
+libmodulo public api
+
+A ModuloStore keeps the store loaded in process, so plugins and widgets
+can query it without running the modulo binary and reloading modulo.json
+on every call. modulo_store_sync picks up changes made by other processes.
+Writes take the same lock as the modulo commands and reload first, so they
+never overwrite another process's changes.
+
+Errors come back as a ModuloStatus, the library never prints or exits, and
+it leaves cJSON's allocation hooks to the host.
+
+The api isn't thread safe: calls share process wide state (the allocation
+counters and the point a failed call recovers to), so a host calling in
+from several threads must serialize the calls itself, even on different
+stores.
+
+This header only depends on the standard library, the rest of src/ is internal.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define MODULO_API_VERSION 1
+
+typedef struct ModuloStore ModuloStore;
+
+typedef enum {
+    MODULO_OK = 0,
+    /* there is no modulo.json yet, run `modulo init` */
+    MODULO_ERR_UNINITIALIZED = -1,
+    /* reading, locking or writing the store failed, or memory ran out */
+    MODULO_ERR_IO = -2,
+    /* bad argument, e.g. an empty entry or an unknown list */
+    MODULO_ERR_INVALID = -3
+} ModuloStatus;
+
+typedef enum {
+    MODULO_LIST_TODAY,
+    MODULO_LIST_TOMORROW,
+    /* item selects the list, numbered from 1 like `modulo history <n>` */
+    MODULO_LIST_HISTORY
+} ModuloList;
+
+/* an entry as seen by a query callback, only valid during the call */
+typedef struct ModuloEntryView {
+    uint64_t id;
+    time_t created;
+    const char *text;
+    uint32_t length;
+    bool read;
+    bool done;
+} ModuloEntryView;
+
+// return non-zero to stop the query
+typedef int (*ModuloEntryFn)(const ModuloEntryView *entry, void *arg);
+
+// open the store under config_dir/modulo, NULL for the os default. status may be NULL
+ModuloStore *modulo_store_open(const char *config_dir, ModuloStatus *status);
+void modulo_store_close(ModuloStore *store);
+
+// reload if another process changed the store, then advance to the current day
+ModuloStatus modulo_store_sync(ModuloStore *store);
+// call fn on each entry of list. returns the number of entries visited or a negative ModuloStatus
+int modulo_store_query(ModuloStore *store, ModuloList list, int item, ModuloEntryFn fn, void *arg);
+// number of entries in list, or a negative ModuloStatus
+int modulo_store_count(ModuloStore *store, ModuloList list, int item);
+// add text to tomorrow's list. id may be NULL
+ModuloStatus modulo_store_add(ModuloStore *store, const char *text, uint64_t *id);
+
+#endif
\ No newline at end of file
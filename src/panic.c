@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "panic.h"
+
+#define PANIC_MESSAGE_MAX 256
+
+static PanicFn panic_handler = NULL;
+
+void panic_set_handler(PanicFn handler) {
+    panic_handler = handler;
+}
+
+_Noreturn void panic(const char *format, ...) {
+    // formatted on the stack, the heap may be what ran out
+    char message[PANIC_MESSAGE_MAX];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (panic_handler != NULL) {
+        panic_handler(message);
+    }
+    fputs(message, stderr);
+    exit(EXIT_FAILURE);
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef PANIC_H
+#define PANIC_H
+
+/*
+Fatal errors
+
+panic is for states modulo can't continue from: a broken invariant, an
+unknown os or an allocation that failed. By default it prints the message
+on stderr and exits. A handler replaces that for code that must not exit
+its process (libmodulo sets one for the duration of each api call).
+*/
+
+// the message is passed without printing it, the handler must not return (i.e. it longjmps)
+typedef void (*PanicFn)(const char *message);
+
+// NULL prints and exits again
+void panic_set_handler(PanicFn handler);
+_Noreturn void panic(const char *format, ...);
+
+#endif
\ No newline at end of file
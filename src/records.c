@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "records.h"
+#include "time_utils.h"
+#include "calendar_queue.h"
+#include "recurring.h"
+#include "mem.h"
+
+static void write_entry_list(Writer *writer, char *list, char *item_key, int item, EntryList *entry_list, bool with_entries);
+static void write_list_fields(Writer *writer, char *list, char *item_key, int item);
+static void write_entry(Writer *writer, char *list, char *item_key, int item, int number, Entry *entry);
+
+void records_write_status(Writer *writer, Modulo *modulo) {
+    time_t day_ptr = modulo_get_day_ptr(modulo);
+    time_t next_wakeup_earliest = time_to_utc_next(modulo_get_wakeup_earliest(modulo), day_ptr);
+    time_t next_wakeup_latest = time_to_utc_next(modulo_get_wakeup_latest(modulo), next_wakeup_earliest);
+
+    writer_record_begin(writer, "status");
+    writer_field_int(writer, "now", utc_now());
+    writer_field_int(writer, "day_ptr", day_ptr);
+    writer_field_int(writer, "next_wakeup_earliest", next_wakeup_earliest);
+    writer_field_int(writer, "next_wakeup_latest", next_wakeup_latest);
+    writer_field_int(writer, "today", entry_list_live_count(modulo_get_today(modulo)));
+    writer_field_int(writer, "tomorrow", entry_list_live_count(modulo_get_tomorrow(modulo)));
+    writer_field_int(writer, "scheduled", calendar_queue_entry_count(modulo_get_scheduled(modulo)));
+    writer_field_int(writer, "recurring", modulo_get_recurring(modulo)->size);
+    writer_field_int(writer, "history", modulo_get_history(modulo)->size);
+    writer_record_end(writer);
+
+    records_write_entry_list(writer, RECORD_LIST_TODAY, 0, modulo_get_today(modulo), false);
+    records_write_entry_list(writer, RECORD_LIST_TOMORROW, 0, modulo_get_tomorrow(modulo), false);
+    records_write_history(writer, modulo_get_history(modulo), false);
+}
+
+void records_write_entry_list(Writer *writer, char *list, int item, EntryList *entry_list, bool with_entries) {
+    write_entry_list(writer, list, RECORD_KEY_ITEM, item, entry_list, with_entries);
+}
+
+void write_entry_list(Writer *writer, char *list, char *item_key, int item, EntryList *entry_list, bool with_entries) {
+    writer_record_begin(writer, "list");
+    write_list_fields(writer, list, item_key, item);
+    writer_field_int(writer, "send_date", entry_list_get_send_date(entry_list));
+    writer_field_int(writer, "recv_date", entry_list_get_recv_date(entry_list));
+    writer_field_bool(writer, "read_receipt", entry_list_get_read_receipt(entry_list));
+    writer_field_int(writer, "entries", entry_list_live_count(entry_list));
+    writer_record_end(writer);
+
+    if (!with_entries) {
+        return;
+    }
+    int entry_number = 0;
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->flags & ENTRY_REMOVED) {
+            continue;
+        }
+        write_entry(writer, list, item_key, item, ++entry_number, entry);
+    }
+}
+
+void records_write_entries(Writer *writer, char *list, int item, EntryList *entry_list, int *slots, int count) {
+    for (int i = 0; i < count; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, slots[i]);
+        write_entry(writer, list, RECORD_KEY_ITEM, item, entry_list_entry_number(entry_list, slots[i]), entry);
+    }
+}
+
+void write_entry(Writer *writer, char *list, char *item_key, int item, int number, Entry *entry) {
+    writer_record_begin(writer, "entry");
+    write_list_fields(writer, list, item_key, item);
+    writer_field_int(writer, "number", number);
+    writer_field_uint(writer, "id", entry->id);
+    writer_field_int(writer, "created", entry->created);
+    writer_field_bool(writer, "read", entry->flags & ENTRY_READ);
+    writer_field_bool(writer, "done", entry->flags & ENTRY_DONE);
+    writer_field_string_n(writer, "text", entry->text, entry->length);
+    writer_record_end(writer);
+}
+
+void records_write_history(Writer *writer, HistoryQueue *history, bool with_entries) {
+    for (int i = 0; i < history->size; i++) {
+        records_write_entry_list(writer, RECORD_LIST_HISTORY, i+1, history_queue_get(history, i), with_entries);
+    }
+}
+
+void records_write_scheduled(Writer *writer, CalendarQueue *scheduled, bool with_entries) {
+    for (CalendarBucket *bucket = calendar_queue_first(scheduled); bucket != NULL; bucket = calendar_queue_next(scheduled, bucket)) {
+        write_entry_list(writer, RECORD_LIST_SCHEDULED, RECORD_KEY_DELIVER_DAY, bucket->day, &bucket->entry_list, with_entries);
+    }
+}
+
+void records_write_export(Writer *writer, Modulo *modulo) {
+    records_write_entry_list(writer, RECORD_LIST_TODAY, 0, modulo_get_today(modulo), true);
+    records_write_entry_list(writer, RECORD_LIST_TOMORROW, 0, modulo_get_tomorrow(modulo), true);
+    records_write_history(writer, modulo_get_history(modulo), true);
+    records_write_scheduled(writer, modulo_get_scheduled(modulo), true);
+}
+
+void write_list_fields(Writer *writer, char *list, char *item_key, int item) {
+    writer_field_string(writer, "list", list);
+    if (item > 0) {
+        writer_field_int(writer, item_key, item);
+    }
+}
+
+void records_write_day(Writer *writer, time_t previous, time_t day_ptr) {
+    writer_record_begin(writer, "day");
+    writer_field_int(writer, "day_ptr", day_ptr);
+    writer_field_int(writer, "previous", previous);
+    writer_record_end(writer);
+}
+
+void records_write_entry_event(Writer *writer, char *type, RecordList *list, Entry *entry, RecordList *from) {
+    writer_record_begin(writer, type);
+    write_list_fields(writer, list->list, list->item_key, list->item);
+    if (from != NULL) {
+        writer_field_string(writer, "from", from->list);
+        if (from->item > 0) {
+            writer_field_int(writer, strcmp(from->item_key, RECORD_KEY_ITEM) == 0 ? "from_item" : "from_deliver_day", from->item);
+        }
+    }
+    writer_field_uint(writer, "id", entry->id);
+    writer_field_int(writer, "created", entry->created);
+    writer_field_bool(writer, "read", entry->flags & ENTRY_READ);
+    writer_field_bool(writer, "done", entry->flags & ENTRY_DONE);
+    writer_field_string_n(writer, "text", entry->text, entry->length);
+    writer_record_end(writer);
+}
+
+void records_write_preferences(Writer *writer, Modulo *modulo) {
+    writer_record_begin(writer, "preferences");
+    writer_field_string(writer, "username", modulo_get_username(modulo));
+    writer_field_int(writer, "wakeup_earliest", modulo_get_wakeup_earliest(modulo));
+    writer_field_int(writer, "wakeup_latest", modulo_get_wakeup_latest(modulo));
+    writer_field_string(writer, "entry_delimiter", modulo_get_entry_delimiter(modulo));
+    writer_field_string(writer, "carry_over", carry_over_to_string(modulo_get_carry_over(modulo)));
+    writer_record_end(writer);
+}
+
+void records_write_preference(Writer *writer, Modulo *modulo, Selection preference) {
+    writer_record_begin(writer, "preference");
+    switch (preference) {
+        case PREFERENCE_USERNAME:
+            writer_field_string(writer, "name", "username");
+            writer_field_string(writer, "value", modulo_get_username(modulo));
+            break;
+        case PREFERENCE_WAKEUP_EARLIEST:
+            writer_field_string(writer, "name", "wakeup_earliest");
+            writer_field_int(writer, "value", modulo_get_wakeup_earliest(modulo));
+            break;
+        case PREFERENCE_WAKEUP_LATEST:
+            writer_field_string(writer, "name", "wakeup_latest");
+            writer_field_int(writer, "value", modulo_get_wakeup_latest(modulo));
+            break;
+        case PREFERENCE_ENTRY_DELIMITER:
+            writer_field_string(writer, "name", "entry_delimiter");
+            writer_field_string(writer, "value", modulo_get_entry_delimiter(modulo));
+            break;
+        case PREFERENCE_CARRY_OVER:
+            writer_field_string(writer, "name", "carry_over");
+            writer_field_string(writer, "value", carry_over_to_string(modulo_get_carry_over(modulo)));
+            break;
+        default:
+            writer_field_null(writer, "name");
+            writer_field_null(writer, "value");
+    }
+    writer_record_end(writer);
+}
+
+void records_write_recurring(Writer *writer, Modulo *modulo) {
+    RecurrenceHeap *recurring = modulo_get_recurring(modulo);
+    int *indices = recurrence_heap_sorted_indices(recurring);
+    for (int i = 0; i < recurring->size; i++) {
+        Recurrence *recurrence = &recurring->items[indices[i]];
+        writer_record_begin(writer, "recurring");
+        writer_field_int(writer, "number", i+1);
+        writer_field_string(writer, "rule", recurrence_rule_to_string(recurrence->rule));
+        writer_field_int(writer, "param", recurrence->param);
+        writer_field_int(writer, "next_day", recurrence->next_day);
+        writer_field_int(writer, "next", day_to_utc(recurrence->next_day, modulo_get_wakeup_latest(modulo)));
+        writer_field_string(writer, "text", recurrence->entry);
+        writer_record_end(writer);
+    }
+    mem_free(indices);
+}
+
+void records_write_stats(Writer *writer, UsageStats *stats, day_t today, int days) {
+    writer_record_begin(writer, "stats");
+    if (stats->size > 0) {
+        writer_field_int(writer, "first_day", stats->days[0].day);
+    } else {
+        writer_field_null(writer, "first_day");
+    }
+    writer_field_uint(writer, "written", stats->written);
+    writer_field_uint(writer, "length", stats->length);
+    writer_field_uint(writer, "delivered", stats->delivered);
+    writer_field_uint(writer, "read", stats->read);
+    writer_field_uint(writer, "received", stats->received);
+    writer_field_int(writer, "latency", stats->latency);
+    writer_field_uint(writer, "streak", stats_current_streak(stats, today));
+    writer_field_uint(writer, "longest_streak", stats->longest_streak);
+    writer_record_end(writer);
+
+    int count;
+    DayRollup *rollup = stats_range(stats, today - days + 1, today, &count);
+    DayRollup *end = rollup + count;
+    for (day_t day = today - days + 1; day <= today; day++) {
+        DayRollup empty = { .day = day };
+        DayRollup *day_rollup = rollup < end && rollup->day == day ? rollup++ : &empty;
+        writer_record_begin(writer, "stats_day");
+        writer_field_int(writer, "day", day);
+        writer_field_uint(writer, "written", day_rollup->written);
+        writer_field_uint(writer, "length", day_rollup->length);
+        writer_field_bool(writer, "delivered", day_rollup->flags & STATS_DAY_DELIVERED);
+        writer_field_bool(writer, "read", day_rollup->flags & STATS_DAY_READ);
+        writer_field_uint(writer, "received", day_rollup->received);
+        writer_field_int(writer, "latency", day_rollup->latency);
+        writer_record_end(writer);
+    }
+}
\ No newline at end of file
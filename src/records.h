@@ -0,0 +1,86 @@
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <stdbool.h>
+
+#include "modulo.h"
+#include "entry_list.h"
+#include "calendar_queue.h"
+#include "command.h"
+#include "writer.h"
+
+/*
+Machine readable counterparts of the cli.c printers, used by the --json and
+--ndjson modes. Every record is a flat object tagged with a "type" field:
+
+    status      {now, day_ptr, next_wakeup_earliest, next_wakeup_latest,
+                 today, tomorrow, scheduled, recurring, history}
+    list        {list, item? | deliver_day?, send_date, recv_date, read_receipt, entries}
+    entry       {list, item? | deliver_day?, number, id, created, read, done, text}
+    preferences {username, wakeup_earliest, wakeup_latest, entry_delimiter, carry_over}
+    preference  {name, value}
+    recurring   {number, rule, param, next_day, next, text}
+    stats       {first_day, written, length, delivered, read, received, latency,
+                 streak, longest_streak}
+    stats_day   {day, written, length, delivered, read, received, latency}
+
+`modulo watch` adds change events:
+
+    day          {day_ptr, previous}
+    entry_added, entry_removed, entry_updated
+                 {list, item? | deliver_day?, id, created, read, done, text}
+    entry_moved  the same, plus {from, from_item? | from_deliver_day?}
+
+Datetimes are unix timestamps, wakeup times are minutes after midnight and
+list is one of "today", "tomorrow", "history" (item is the history queue
+item number, 1 being the most recent) or "scheduled" (deliver_day is the
+day the list will be delivered on, in days since the epoch). Entry numbers count live entries from
+1, as the text output does. Stats are the sums kept in stats.h: the average
+entry length is length / written and the average wait is latency / received
+(in seconds). streak is as of today, first_day is the first day with stats.
+*/
+
+#define RECORD_LIST_TODAY "today"
+#define RECORD_LIST_TOMORROW "tomorrow"
+#define RECORD_LIST_HISTORY "history"
+#define RECORD_LIST_SCHEDULED "scheduled"
+
+#define RECORD_KEY_ITEM "item"
+#define RECORD_KEY_DELIVER_DAY "deliver_day"
+
+#define RECORD_ENTRY_ADDED "entry_added"
+#define RECORD_ENTRY_REMOVED "entry_removed"
+#define RECORD_ENTRY_UPDATED "entry_updated"
+#define RECORD_ENTRY_MOVED "entry_moved"
+
+/* where an entry list sits in the store, written as the list fields of a record */
+typedef struct RecordList {
+    char *list;
+    /* RECORD_KEY_ITEM for history lists, RECORD_KEY_DELIVER_DAY for scheduled ones */
+    char *item_key;
+    /* 0 for today and tomorrow */
+    int item;
+} RecordList;
+
+// status record followed by a list record for today, tomorrow and each history item
+void records_write_status(Writer *writer, Modulo *modulo);
+// item is the history item number, 0 for lists outside the history queue
+void records_write_entry_list(Writer *writer, char *list, int item, EntryList *entry_list, bool with_entries);
+// entry records for the entries at slots only (see tag_index_select)
+void records_write_entries(Writer *writer, char *list, int item, EntryList *entry_list, int *slots, int count);
+void records_write_history(Writer *writer, HistoryQueue *history, bool with_entries);
+void records_write_scheduled(Writer *writer, CalendarQueue *scheduled, bool with_entries);
+// every entry list with its entries: today, tomorrow, the history queue and the scheduled days
+void records_write_export(Writer *writer, Modulo *modulo);
+void records_write_preferences(Writer *writer, Modulo *modulo);
+void records_write_preference(Writer *writer, Modulo *modulo, Selection preference);
+void records_write_recurring(Writer *writer, Modulo *modulo);
+// the stats record, then a stats_day record for each of the last days days (today included)
+void records_write_stats(Writer *writer, UsageStats *stats, day_t today, int days);
+
+// the day advanced from previous to day_ptr
+void records_write_day(Writer *writer, time_t previous, time_t day_ptr);
+// type is one of the RECORD_ENTRY_ events. from is where a moved entry was, NULL otherwise
+void records_write_entry_event(Writer *writer, char *type, RecordList *list, Entry *entry, RecordList *from);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "recurring.h"
+#include "entry_list.h"
+#include "time_utils.h"
+#include "mem.h"
+#include "panic.h"
+
+static void sift_up(RecurrenceHeap *heap, int index);
+static void sift_down(RecurrenceHeap *heap, int index);
+static void swap(Recurrence *a, Recurrence *b);
+static char *copy_string(char *string);
+
+static char *weekdays[7] = {
+    "sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"
+};
+
+/* Recurrence */
+Recurrence create_recurrence(char *entry, RecurrenceRule rule, int param, day_t today) {
+    Recurrence recurrence = {
+        .entry = entry,
+        .rule = rule,
+        .param = param
+    };
+    recurrence.next_day = recurrence_next_day(&recurrence, today);
+    return recurrence;
+}
+
+void free_recurrence(Recurrence *recurrence) {
+    mem_free(recurrence->entry);
+}
+
+day_t recurrence_next_day(Recurrence *recurrence, day_t day) {
+    switch (recurrence->rule) {
+        case RECUR_DAILY:
+            return day + 1;
+        case RECUR_WEEKLY: {
+            day_t next = day + 1;
+            int days_until = (recurrence->param - day_to_weekday(next) + 7) % 7;
+            return next + days_until;
+        }
+        case RECUR_MONTHLY: {
+            int year, month, mday;
+            day_to_date(day, &year, &month, &mday);
+            // occurrence this month (clamped for short months)
+            int target = recurrence->param;
+            int this_month = target < days_in_month(year, month) ? target : days_in_month(year, month);
+            if (this_month > mday) {
+                return date_to_day(year, month, this_month);
+            }
+            // occurrence next month
+            month = month % 12 + 1;
+            year += month == 1;
+            int next_month = target < days_in_month(year, month) ? target : days_in_month(year, month);
+            return date_to_day(year, month, next_month);
+        }
+        default:
+            panic("Unrecognized recurrence rule %d\n", recurrence->rule);
+    }
+}
+
+RecurrenceRule parse_recurrence_rule(char *rule_str) {
+    if (strcmp(rule_str, RECURRENCE_DAILY) == 0) {
+        return RECUR_DAILY;
+    } else if (strcmp(rule_str, RECURRENCE_WEEKLY) == 0) {
+        return RECUR_WEEKLY;
+    } else if (strcmp(rule_str, RECURRENCE_MONTHLY) == 0) {
+        return RECUR_MONTHLY;
+    }
+    return RECUR_INVALID;
+}
+
+char *recurrence_rule_to_string(RecurrenceRule rule) {
+    switch (rule) {
+        case RECUR_DAILY:
+            return RECURRENCE_DAILY;
+        case RECUR_WEEKLY:
+            return RECURRENCE_WEEKLY;
+        case RECUR_MONTHLY:
+            return RECURRENCE_MONTHLY;
+        default:
+            return NULL;
+    }
+}
+
+/*
+accepts full weekday names or any prefix of 3+ characters (case insensitive)
+*/
+int parse_weekday(char *weekday_str) {
+    size_t length = strlen(weekday_str);
+    if (length < 3) {
+        return -1;
+    }
+    for (int weekday = 0; weekday < 7; weekday++) {
+        char *name = weekdays[weekday];
+        if (length > strlen(name)) {
+            continue;
+        }
+        size_t i = 0;
+        while (i < length && tolower(weekday_str[i]) == name[i]) {
+            i++;
+        }
+        if (i == length) {
+            return weekday;
+        }
+    }
+    return -1;
+}
+
+bool recurrence_param_valid(RecurrenceRule rule, int param) {
+    switch (rule) {
+        case RECUR_DAILY:
+            return true;
+        case RECUR_WEEKLY:
+            return param >= 0 && param <= 6;
+        case RECUR_MONTHLY:
+            return param >= 1 && param <= 31;
+        default:
+            return false;
+    }
+}
+
+char *weekday_to_string(int weekday) {
+    return weekdays[weekday];
+}
+
+/* RecurrenceHeap */
+RecurrenceHeap create_recurrence_heap() {
+    RecurrenceHeap heap = {
+        .capacity = RECURRENCE_HEAP_INIT_CAPACITY,
+        .size = 0,
+        .items = mem_alloc(MEM_MODULO, RECURRENCE_HEAP_INIT_CAPACITY * sizeof(Recurrence))
+    };
+    return heap;
+}
+
+void free_recurrence_heap(RecurrenceHeap *heap) {
+    for (int i = 0; i < heap->size; i++) {
+        free_recurrence(&heap->items[i]);
+    }
+    mem_free(heap->items);
+}
+
+bool recurrence_heap_empty(RecurrenceHeap *heap) {
+    return heap->size == 0;
+}
+
+void recurrence_heap_push(RecurrenceHeap *heap, Recurrence recurrence) {
+    if (heap->size == heap->capacity) {
+        heap->capacity *= 2;
+        heap->items = mem_realloc(MEM_MODULO, heap->items, heap->capacity * sizeof(Recurrence));
+    }
+    heap->items[heap->size] = recurrence;
+    sift_up(heap, heap->size);
+    heap->size++;
+}
+
+Recurrence *recurrence_heap_peek(RecurrenceHeap *heap) {
+    if (heap->size == 0) {
+        return NULL;
+    }
+    return &heap->items[0];
+}
+
+void recurrence_heap_remove(RecurrenceHeap *heap, int index) {
+    if (index < 0 || index >= heap->size) {
+        panic("Can't remove recurrence at index %d from heap of size %d\n", index, heap->size);
+    }
+    free_recurrence(&heap->items[index]);
+    heap->size--;
+    if (index == heap->size) {
+        return;
+    }
+    // fill the hole with the last item and restore heap order
+    heap->items[index] = heap->items[heap->size];
+    sift_up(heap, index);
+    sift_down(heap, index);
+}
+
+/*
+Insertion sort of heap indices by next_day
+Only used for listing, where n is the number of recurring entries a person maintains
+*/
+int *recurrence_heap_sorted_indices(RecurrenceHeap *heap) {
+    int *indices = mem_alloc(MEM_MODULO, (heap->size + 1) * sizeof(int));
+    for (int i = 0; i < heap->size; i++) {
+        int j = i;
+        day_t next_day = heap->items[i].next_day;
+        while (j > 0 && heap->items[indices[j-1]].next_day > next_day) {
+            indices[j] = indices[j-1];
+            j--;
+        }
+        indices[j] = i;
+    }
+    return indices;
+}
+
+int recurrence_heap_deliver(RecurrenceHeap *heap, day_t day, EntryList *dest) {
+    int delivered = 0;
+    Recurrence *top;
+    while ((top = recurrence_heap_peek(heap)) != NULL && top->next_day <= day) {
+        entry_list_push(dest, copy_string(top->entry));
+        top->next_day = recurrence_next_day(top, day);
+        sift_down(heap, 0);
+        delivered++;
+    }
+    return delivered;
+}
+
+void sift_up(RecurrenceHeap *heap, int index) {
+    Recurrence *items = heap->items;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (items[parent].next_day <= items[index].next_day) {
+            break;
+        }
+        swap(&items[parent], &items[index]);
+        index = parent;
+    }
+}
+
+void sift_down(RecurrenceHeap *heap, int index) {
+    Recurrence *items = heap->items;
+    int size = heap->size;
+    while (true) {
+        int left = 2*index + 1;
+        int right = left + 1;
+        int smallest = index;
+        if (left < size && items[left].next_day < items[smallest].next_day) {
+            smallest = left;
+        }
+        if (right < size && items[right].next_day < items[smallest].next_day) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        swap(&items[smallest], &items[index]);
+        index = smallest;
+    }
+}
+
+void swap(Recurrence *a, Recurrence *b) {
+    Recurrence tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+char *copy_string(char *string) {
+    char *copy = mem_alloc(MEM_ENTRY_LIST, strlen(string) + 1);
+    strcpy(copy, string);
+    return copy;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef RECURRING_H
+#define RECURRING_H
+
+#include <stdbool.h>
+
+#include "entry_list.h"
+#include "time_types.h"
+
+#define RECURRENCE_ENTRY "entry"
+#define RECURRENCE_RULE "rule"
+#define RECURRENCE_PARAM "param"
+#define RECURRENCE_NEXT_DAY "next_day"
+
+#define RECURRENCE_DAILY "daily"
+#define RECURRENCE_WEEKLY "weekly"
+#define RECURRENCE_MONTHLY "monthly"
+
+#define RECURRENCE_HEAP_INIT_CAPACITY 8
+
+typedef enum RecurrenceRule {
+    RECUR_DAILY,
+    RECUR_WEEKLY,
+    RECUR_MONTHLY,
+    RECUR_INVALID
+} RecurrenceRule;
+
+/*
+Recurrence:
+A template entry delivered to the today list on every day matching rule
+*/
+typedef struct Recurrence {
+    char *entry;
+    RecurrenceRule rule;
+    /* 
+    RECUR_DAILY:   unused
+    RECUR_WEEKLY:  day of the week (0 = sunday, 6 = saturday)
+    RECUR_MONTHLY: day of the month (1-31, clamped to the length of short months)
+    */
+    int param;
+    /* the next day this entry will be delivered */
+    day_t next_day;
+} Recurrence;
+
+/*
+RecurrenceHeap:
+Binary min-heap of Recurrences keyed by next_day. 
+Delivering the k recurrences due after a sync costs O(k log n) no matter
+how many days were skipped: each due recurrence is delivered once and
+rescheduled directly to its first occurrence after the new day.
+*/
+typedef struct RecurrenceHeap {
+    int capacity;
+    int size;
+    Recurrence *items;
+} RecurrenceHeap;
+
+Recurrence create_recurrence(char *entry, RecurrenceRule rule, int param, day_t today);
+void free_recurrence(Recurrence *recurrence);
+// first day after day matching the recurrence rule
+day_t recurrence_next_day(Recurrence *recurrence, day_t day);
+
+RecurrenceRule parse_recurrence_rule(char *rule_str);
+char *recurrence_rule_to_string(RecurrenceRule rule);
+// param is in range for rule (see Recurrence)
+bool recurrence_param_valid(RecurrenceRule rule, int param);
+// parse weekday name (e.g. monday, mon) to 0-6, -1 if invalid
+int parse_weekday(char *weekday_str);
+char *weekday_to_string(int weekday);
+
+RecurrenceHeap create_recurrence_heap();
+void free_recurrence_heap(RecurrenceHeap *heap);
+
+bool recurrence_heap_empty(RecurrenceHeap *heap);
+void recurrence_heap_push(RecurrenceHeap *heap, Recurrence recurrence);
+Recurrence *recurrence_heap_peek(RecurrenceHeap *heap);
+// remove (and free) the recurrence at heap index
+void recurrence_heap_remove(RecurrenceHeap *heap, int index);
+// heap indices ordered by next_day (caller frees)
+int *recurrence_heap_sorted_indices(RecurrenceHeap *heap);
+
+/*
+Pushes a copy of every recurrence due on or before day onto dest
+and reschedules it to its next occurrence after day
+returns the number of entries delivered
+*/
+int recurrence_heap_deliver(RecurrenceHeap *heap, day_t day, EntryList *dest);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+#include "mem.h"
+
+static DayRollup *stats_get_day(UsageStats *stats, day_t day);
+static int stats_lower_bound(UsageStats *stats, day_t day);
+static void stats_extend_streak(UsageStats *stats, day_t day);
+
+UsageStats create_usage_stats() {
+    UsageStats stats = {
+        .capacity = STATS_INIT_CAPACITY,
+        .size = 0,
+        .days = mem_alloc(MEM_MODULO, STATS_INIT_CAPACITY * sizeof(DayRollup))
+    };
+    return stats;
+}
+
+void free_usage_stats(UsageStats *stats) {
+    mem_free(stats->days);
+    stats->days = NULL;
+    stats->size = 0;
+    stats->capacity = 0;
+}
+
+void stats_record_entry(UsageStats *stats, day_t day, uint32_t length) {
+    DayRollup *rollup = stats_get_day(stats, day);
+    rollup->written++;
+    rollup->length += length;
+    stats->written++;
+    stats->length += length;
+    stats_extend_streak(stats, day);
+}
+
+void stats_record_delivery(UsageStats *stats, day_t day, bool read) {
+    DayRollup *rollup = stats_get_day(stats, day);
+    // a day is counted once however many lists it ended with
+    if (!(rollup->flags & STATS_DAY_DELIVERED)) {
+        rollup->flags |= STATS_DAY_DELIVERED;
+        stats->delivered++;
+    }
+    if (read && !(rollup->flags & STATS_DAY_READ)) {
+        rollup->flags |= STATS_DAY_READ;
+        stats->read++;
+    }
+}
+
+void stats_record_receipt(UsageStats *stats, day_t day, time_t send_date, time_t recv_date) {
+    // lists that were never sent (or a clock that went backwards) don't say anything about latency
+    if (send_date <= 0 || recv_date < send_date) {
+        return;
+    }
+    DayRollup *rollup = stats_get_day(stats, day);
+    rollup->received++;
+    rollup->latency += recv_date - send_date;
+    stats->received++;
+    stats->latency += recv_date - send_date;
+}
+
+int stats_push_day(UsageStats *stats, DayRollup rollup) {
+    if (stats->size > 0 && stats->days[stats->size-1].day >= rollup.day) {
+        return -1;
+    }
+    *stats_get_day(stats, rollup.day) = rollup;
+    return 0;
+}
+
+DayRollup *stats_range(UsageStats *stats, day_t first_day, day_t last_day, int *count) {
+    int first = stats_lower_bound(stats, first_day);
+    int end = stats_lower_bound(stats, last_day + 1);
+    *count = end - first;
+    return stats->days + first;
+}
+
+uint32_t stats_current_streak(UsageStats *stats, day_t day) {
+    if (stats->streak == 0 || stats->last_written_day < day - 1) {
+        return 0;
+    }
+    return stats->streak;
+}
+
+/*
+The rollup for day, created if the day has none yet. That's almost always
+the last rollup or a new one after it, anything else is found by binary search
+*/
+DayRollup *stats_get_day(UsageStats *stats, day_t day) {
+    int index = stats->size;
+    if (stats->size > 0 && stats->days[stats->size-1].day >= day) {
+        index = stats_lower_bound(stats, day);
+        if (stats->days[index].day == day) {
+            return &stats->days[index];
+        }
+    }
+    if (stats->size == stats->capacity) {
+        stats->capacity = stats->capacity == 0 ? STATS_INIT_CAPACITY : stats->capacity * 2;
+        stats->days = mem_realloc(MEM_MODULO, stats->days, stats->capacity * sizeof(DayRollup));
+    }
+    memmove(&stats->days[index+1], &stats->days[index], (stats->size - index) * sizeof(DayRollup));
+    stats->days[index] = (DayRollup) { .day = day };
+    stats->size++;
+    return &stats->days[index];
+}
+
+// index of the first rollup on or after day
+int stats_lower_bound(UsageStats *stats, day_t day) {
+    int low = 0;
+    int high = stats->size;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (stats->days[mid].day < day) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void stats_extend_streak(UsageStats *stats, day_t day) {
+    if (stats->streak > 0 && day <= stats->last_written_day) {
+        return;
+    }
+    if (stats->streak > 0 && day == stats->last_written_day + 1) {
+        stats->streak++;
+    } else {
+        stats->streak = 1;
+    }
+    stats->last_written_day = day;
+    if (stats->streak > stats->longest_streak) {
+        stats->longest_streak = stats->streak;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "time_types.h"
+
+/*
+UsageStats:
+What `modulo stats` reports, kept up to date as the store changes instead of
+being recomputed from entries (history only keeps the last few lists anyway).
+
+The totals are running aggregates over every day ever recorded. Next to them
+is one DayRollup per day that saw any activity, in an array sorted by day.
+Days only ever move forward, so a rollup is either the last one or appended
+after it, and the rollups for a range of days are found with one binary
+search: a report costs O(log days + days requested), whatever the number of
+entries written.
+
+    written          entries created (the editor, `modulo add`, libmodulo),
+                     length is their length as submitted
+    delivered / read a today list with entries ended the day (delivered),
+                     with its read receipt set (read)
+    received         tomorrow lists handed to a new today list, latency sums
+                     the seconds from their send_date to their recv_date
+
+The streak is the run of consecutive days with something written, kept with
+the day it was last extended so it never has to walk the rollups.
+*/
+
+#define STATS_WRITTEN "written"
+#define STATS_LENGTH "length"
+#define STATS_DELIVERED "delivered"
+#define STATS_READ "read"
+#define STATS_RECEIVED "received"
+#define STATS_LATENCY "latency"
+#define STATS_LAST_WRITTEN_DAY "last_written_day"
+#define STATS_STREAK "streak"
+#define STATS_LONGEST_STREAK "longest_streak"
+#define STATS_DAYS "days"
+
+#define STATS_INIT_CAPACITY 32
+/* days `modulo stats` shows by default */
+#define STATS_REPORT_DAYS 7
+
+/* DayRollup flags */
+#define STATS_DAY_DELIVERED (1 << 0)
+#define STATS_DAY_READ (1 << 1)
+
+typedef struct DayRollup {
+    day_t day;
+    uint32_t written;
+    uint64_t length;
+    uint8_t flags;
+    uint32_t received;
+    int64_t latency;
+} DayRollup;
+
+typedef struct UsageStats {
+    uint64_t written;
+    uint64_t length;
+    uint32_t delivered;
+    uint32_t read;
+    uint32_t received;
+    int64_t latency;
+    /* streak ends on last_written_day (0 when nothing was ever written) */
+    day_t last_written_day;
+    uint32_t streak;
+    uint32_t longest_streak;
+    int capacity;
+    int size;
+    /* sorted by day */
+    DayRollup *days;
+} UsageStats;
+
+UsageStats create_usage_stats();
+void free_usage_stats(UsageStats *stats);
+
+// an entry of length was written on day
+void stats_record_entry(UsageStats *stats, day_t day, uint32_t length);
+// the today list of day ended, read or not
+void stats_record_delivery(UsageStats *stats, day_t day, bool read);
+// a list sent at send_date was received on day at recv_date
+void stats_record_receipt(UsageStats *stats, day_t day, time_t send_date, time_t recv_date);
+// append the rollup of a day after the last one (loading a store). returns -1 if it's out of order
+int stats_push_day(UsageStats *stats, DayRollup rollup);
+
+// the rollups of the days first_day through last_day, *count is set to how many there are
+DayRollup *stats_range(UsageStats *stats, day_t first_day, day_t last_day, int *count);
+// the streak as of day: 0 once a whole day has passed without writing
+uint32_t stats_current_streak(UsageStats *stats, day_t day);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,517 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tags.h"
+#include "vocab.h"
+#include "mem.h"
+
+/* no such tag */
+#define TAG_NONE UINT32_MAX
+
+static uint32_t tag_hash(const char *name, size_t length);
+static uint32_t tag_find(TagIndex *index, const char *name, size_t length);
+static uint32_t tag_intern(TagIndex *index, const char *name);
+static void tag_rehash(TagIndex *index, uint32_t slot_count);
+static void tag_slot_insert(TagIndex *index, uint32_t tag_id);
+
+static uint32_t find_tagged_entry(TagIndex *index, uint64_t entry_id, bool *found);
+static void append_tagged_entry(TagIndex *index, uint64_t entry_id, const char *text);
+static void posting_reserve(Tag *tag);
+static void posting_insert(Tag *tag, uint64_t entry_id);
+static void posting_remove(Tag *tag, uint64_t entry_id);
+static uint32_t posting_position(Tag *tag, uint64_t entry_id);
+static void sync_entry_list(Modulo *modulo, EntryList *entry_list, void *arg);
+static void tag_index_clear(TagIndex *index);
+
+static int compare_tagged_entries(const void *a, const void *b);
+static int compare_ids(const void *a, const void *b);
+static int compare_slots(const void *a, const void *b);
+static char ascii_lower(char c);
+
+TagIndex *create_tag_index() {
+    TagIndex *index = mem_alloc(MEM_TAGS, sizeof(TagIndex));
+    index->tag_count = 0;
+    index->tag_capacity = TAG_INIT_CAP;
+    index->tags = mem_alloc(MEM_TAGS, index->tag_capacity * sizeof(Tag));
+    index->slot_count = 2 * TAG_INIT_CAP;
+    index->slots = mem_calloc(MEM_TAGS, index->slot_count, sizeof(uint32_t));
+    index->entry_count = 0;
+    index->entry_capacity = TAG_ENTRIES_INIT_CAP;
+    index->entries = mem_alloc(MEM_TAGS, index->entry_capacity * sizeof(TaggedEntry));
+    index->next_entry_id = 1;
+    index->edit_generation = 0;
+    index->dirty = false;
+    return index;
+}
+
+void free_tag_index(TagIndex *index) {
+    if (index == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < index->tag_count; i++) {
+        mem_free(index->tags[i].postings);
+    }
+    mem_free(index->tags);
+    mem_free(index->slots);
+    mem_free(index->entries);
+    mem_free(index);
+}
+
+int tags_parse(const char *text, char tags[][TAG_MAX_LENGTH + 1]) {
+    int count = 0;
+    char previous = ' ';
+    const char *p = text;
+    while (*p != '\0' && count < TAG_MAX_PER_ENTRY) {
+        bool sigil = *p == TAG_SIGIL_HASH || *p == TAG_SIGIL_MENTION;
+        if (!sigil || vocab_is_word_byte(previous) || !vocab_is_word_byte(p[1])) {
+            previous = *p++;
+            continue;
+        }
+        const char *end = p + 1;
+        while (vocab_is_word_byte(*end)) {
+            end++;
+        }
+        size_t length = end - p;
+        if (length <= TAG_MAX_LENGTH) {
+            char *name = tags[count];
+            for (size_t i = 0; i < length; i++) {
+                name[i] = ascii_lower(p[i]);
+            }
+            name[length] = '\0';
+            bool seen = false;
+            for (int i = 0; i < count && !seen; i++) {
+                seen = strcmp(tags[i], name) == 0;
+            }
+            if (!seen) {
+                count++;
+            }
+        }
+        previous = end[-1];
+        p = end;
+    }
+    return count;
+}
+
+void tag_index_set_entry(TagIndex *index, uint64_t entry_id, const char *text) {
+    char names[TAG_MAX_PER_ENTRY][TAG_MAX_LENGTH + 1];
+    int count = tags_parse(text, names);
+    bool found;
+    uint32_t position = find_tagged_entry(index, entry_id, &found);
+    if (!found && count == 0) {
+        return;
+    }
+    if (found) {
+        TaggedEntry *entry = &index->entries[position];
+        for (uint32_t i = 0; i < entry->tag_count; i++) {
+            posting_remove(&index->tags[entry->tags[i]], entry_id);
+        }
+        if (count == 0) {
+            memmove(entry, entry + 1, (index->entry_count - position - 1) * sizeof(TaggedEntry));
+            index->entry_count--;
+            index->dirty = true;
+            return;
+        }
+    } else {
+        if (index->entry_count == index->entry_capacity) {
+            index->entry_capacity *= 2;
+            index->entries = mem_realloc(MEM_TAGS, index->entries, index->entry_capacity * sizeof(TaggedEntry));
+        }
+        TaggedEntry *entries = index->entries;
+        memmove(&entries[position + 1], &entries[position], (index->entry_count - position) * sizeof(TaggedEntry));
+        index->entry_count++;
+    }
+    TaggedEntry *entry = &index->entries[position];
+    // zeroed, the unused tag slots are written to the file
+    *entry = (TaggedEntry) { .entry_id = entry_id, .tag_count = count };
+    for (int i = 0; i < count; i++) {
+        uint32_t tag_id = tag_intern(index, names[i]);
+        entry->tags[i] = tag_id;
+        posting_insert(&index->tags[tag_id], entry_id);
+    }
+    index->dirty = true;
+}
+
+/*
+Entries are visited list by list, not in id order (history holds the oldest),
+so they're appended as found and the arrays that came out of order are sorted
+once at the end instead of inserting every entry in place
+*/
+void tag_index_sync(TagIndex *index, Modulo *modulo) {
+    // an entry's text changed without going through tag_index_set_entry, its old tags are unknown
+    if (index->edit_generation != modulo_get_edit_generation(modulo)) {
+        tag_index_clear(index);
+        index->edit_generation = modulo_get_edit_generation(modulo);
+        index->dirty = true;
+    }
+    uint32_t indexed = index->entry_count;
+    modulo_for_each_entry_list(modulo, sync_entry_list, index);
+    if (index->entry_count != indexed) {
+        qsort(index->entries, index->entry_count, sizeof(TaggedEntry), compare_tagged_entries);
+        for (uint32_t i = 0; i < index->tag_count; i++) {
+            Tag *tag = &index->tags[i];
+            for (uint32_t j = 1; j < tag->posting_count; j++) {
+                if (tag->postings[j-1] > tag->postings[j]) {
+                    qsort(tag->postings, tag->posting_count, sizeof(uint64_t), compare_ids);
+                    break;
+                }
+            }
+        }
+        index->dirty = true;
+    }
+    uint64_t next_entry_id = modulo_get_next_entry_id(modulo);
+    if (next_entry_id > index->next_entry_id) {
+        index->next_entry_id = next_entry_id;
+        index->dirty = true;
+    }
+}
+
+void sync_entry_list(Modulo *modulo, EntryList *entry_list, void *arg) {
+    TagIndex *index = arg;
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->id >= index->next_entry_id && !(entry->flags & ENTRY_REMOVED)) {
+            append_tagged_entry(index, entry->id, entry->text);
+        }
+    }
+}
+
+// back to an empty index, keeping the allocations
+void tag_index_clear(TagIndex *index) {
+    for (uint32_t i = 0; i < index->tag_count; i++) {
+        mem_free(index->tags[i].postings);
+    }
+    index->tag_count = 0;
+    memset(index->slots, 0, index->slot_count * sizeof(uint32_t));
+    index->entry_count = 0;
+    index->next_entry_id = 1;
+}
+
+// unsorted, see tag_index_sync
+void append_tagged_entry(TagIndex *index, uint64_t entry_id, const char *text) {
+    char names[TAG_MAX_PER_ENTRY][TAG_MAX_LENGTH + 1];
+    int count = tags_parse(text, names);
+    if (count == 0) {
+        return;
+    }
+    if (index->entry_count == index->entry_capacity) {
+        index->entry_capacity *= 2;
+        index->entries = mem_realloc(MEM_TAGS, index->entries, index->entry_capacity * sizeof(TaggedEntry));
+    }
+    TaggedEntry *entry = &index->entries[index->entry_count++];
+    *entry = (TaggedEntry) { .entry_id = entry_id, .tag_count = count };
+    for (int i = 0; i < count; i++) {
+        uint32_t tag_id = tag_intern(index, names[i]);
+        entry->tags[i] = tag_id;
+        Tag *tag = &index->tags[tag_id];
+        posting_reserve(tag);
+        tag->postings[tag->posting_count++] = entry_id;
+    }
+}
+
+Tag *tag_index_get(TagIndex *index, const char *name) {
+    uint32_t tag_id = tag_find(index, name, strlen(name));
+    if (tag_id == TAG_NONE || index->tags[tag_id].posting_count == 0) {
+        return NULL;
+    }
+    return &index->tags[tag_id];
+}
+
+int tag_index_resolve(TagIndex *index, const char *query, Tag *tags[TAG_QUERY_MAX]) {
+    char name[TAG_MAX_LENGTH + 1];
+    bool bare = query[0] != TAG_SIGIL_HASH && query[0] != TAG_SIGIL_MENTION;
+    size_t offset = bare ? 1 : 0;
+    size_t length = strlen(query);
+    if (length == 0 || length + offset > TAG_MAX_LENGTH) {
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        name[i + offset] = ascii_lower(query[i]);
+    }
+    name[length + offset] = '\0';
+    if (!bare) {
+        tags[0] = tag_index_get(index, name);
+        return tags[0] != NULL ? 1 : 0;
+    }
+    int count = 0;
+    char sigils[] = { TAG_SIGIL_HASH, TAG_SIGIL_MENTION };
+    for (size_t i = 0; i < sizeof sigils; i++) {
+        name[0] = sigils[i];
+        Tag *tag = tag_index_get(index, name);
+        if (tag != NULL) {
+            tags[count++] = tag;
+        }
+    }
+    return count;
+}
+
+int *tag_index_select(TagIndex *index, Modulo *modulo, const char *query, EntryList *entry_list, int *count) {
+    Tag *tags[TAG_QUERY_MAX];
+    int tag_count = tag_index_resolve(index, query, tags);
+    size_t capacity = 1;
+    for (int i = 0; i < tag_count; i++) {
+        capacity += tags[i]->posting_count;
+    }
+    int *slots = mem_alloc(MEM_TAGS, capacity * sizeof(int));
+    int size = 0;
+    for (int i = 0; i < tag_count; i++) {
+        for (uint32_t j = 0; j < tags[i]->posting_count; j++) {
+            EntryRef ref = modulo_find_entry(modulo, tags[i]->postings[j]);
+            if (ref.entry_list == entry_list) {
+                slots[size++] = ref.slot;
+            }
+        }
+    }
+    qsort(slots, size, sizeof(int), compare_slots);
+    // an entry tagged both #x and @x is in both posting lists
+    int unique = 0;
+    for (int i = 0; i < size; i++) {
+        if (unique == 0 || slots[unique-1] != slots[i]) {
+            slots[unique++] = slots[i];
+        }
+    }
+    *count = unique;
+    return slots;
+}
+
+uint32_t tag_hash(const char *name, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+uint32_t tag_find(TagIndex *index, const char *name, size_t length) {
+    uint32_t mask = index->slot_count - 1;
+    for (uint32_t i = tag_hash(name, length) & mask; index->slots[i] != 0; i = (i + 1) & mask) {
+        Tag *tag = &index->tags[index->slots[i] - 1];
+        if (tag->length == length && memcmp(tag->name, name, length) == 0) {
+            return index->slots[i] - 1;
+        }
+    }
+    return TAG_NONE;
+}
+
+// callers hold tag ids across this, never pointers, the array moves when it grows
+uint32_t tag_intern(TagIndex *index, const char *name) {
+    size_t length = strlen(name);
+    uint32_t tag_id = tag_find(index, name, length);
+    if (tag_id != TAG_NONE) {
+        return tag_id;
+    }
+    if (index->tag_count == index->tag_capacity) {
+        index->tag_capacity *= 2;
+        index->tags = mem_realloc(MEM_TAGS, index->tags, index->tag_capacity * sizeof(Tag));
+    }
+    tag_id = index->tag_count++;
+    Tag *tag = &index->tags[tag_id];
+    memcpy(tag->name, name, length + 1);
+    tag->length = length;
+    tag->posting_count = 0;
+    tag->posting_capacity = 0;
+    tag->postings = NULL;
+    // at most half full
+    if (2 * index->tag_count > index->slot_count) {
+        tag_rehash(index, 2 * index->slot_count);
+    } else {
+        tag_slot_insert(index, tag_id);
+    }
+    return tag_id;
+}
+
+void tag_rehash(TagIndex *index, uint32_t slot_count) {
+    mem_free(index->slots);
+    index->slot_count = slot_count;
+    index->slots = mem_calloc(MEM_TAGS, slot_count, sizeof(uint32_t));
+    for (uint32_t i = 0; i < index->tag_count; i++) {
+        tag_slot_insert(index, i);
+    }
+}
+
+void tag_slot_insert(TagIndex *index, uint32_t tag_id) {
+    Tag *tag = &index->tags[tag_id];
+    uint32_t mask = index->slot_count - 1;
+    uint32_t i = tag_hash(tag->name, tag->length) & mask;
+    while (index->slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    index->slots[i] = tag_id + 1;
+}
+
+// position of entry_id in index->entries, or where it would be inserted
+uint32_t find_tagged_entry(TagIndex *index, uint64_t entry_id, bool *found) {
+    uint32_t low = 0;
+    uint32_t high = index->entry_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (index->entries[mid].entry_id < entry_id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *found = low < index->entry_count && index->entries[low].entry_id == entry_id;
+    return low;
+}
+
+void posting_reserve(Tag *tag) {
+    if (tag->posting_count < tag->posting_capacity) {
+        return;
+    }
+    tag->posting_capacity = tag->posting_capacity == 0 ? TAG_POSTINGS_INIT_CAP : 2 * tag->posting_capacity;
+    tag->postings = mem_realloc(MEM_TAGS, tag->postings, tag->posting_capacity * sizeof(uint64_t));
+}
+
+void posting_insert(Tag *tag, uint64_t entry_id) {
+    uint32_t position = posting_position(tag, entry_id);
+    if (position < tag->posting_count && tag->postings[position] == entry_id) {
+        return;
+    }
+    posting_reserve(tag);
+    memmove(&tag->postings[position + 1], &tag->postings[position], (tag->posting_count - position) * sizeof(uint64_t));
+    tag->postings[position] = entry_id;
+    tag->posting_count++;
+}
+
+void posting_remove(Tag *tag, uint64_t entry_id) {
+    uint32_t position = posting_position(tag, entry_id);
+    if (position == tag->posting_count || tag->postings[position] != entry_id) {
+        return;
+    }
+    memmove(&tag->postings[position], &tag->postings[position + 1], (tag->posting_count - position - 1) * sizeof(uint64_t));
+    tag->posting_count--;
+}
+
+uint32_t posting_position(Tag *tag, uint64_t entry_id) {
+    uint32_t low = 0;
+    uint32_t high = tag->posting_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (tag->postings[mid] < entry_id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+size_t tag_index_serialized_size(TagIndex *index) {
+    size_t posting_count = 0;
+    for (uint32_t i = 0; i < index->tag_count; i++) {
+        posting_count += index->tags[i].posting_count;
+    }
+    return sizeof(TagFileHeader)
+        + (size_t)index->tag_count * sizeof(TagFileRecord)
+        + posting_count * sizeof(uint64_t)
+        + (size_t)index->entry_count * sizeof(TaggedEntry);
+}
+
+void tag_index_serialize(TagIndex *index, char *buffer) {
+    TagFileHeader header = {
+        .magic = TAGS_FILE_MAGIC,
+        .version = TAGS_FILE_VERSION,
+        .tag_count = index->tag_count,
+        .entry_count = index->entry_count,
+        .posting_count = 0,
+        .next_entry_id = index->next_entry_id,
+        .edit_generation = index->edit_generation
+    };
+    char *p = buffer + sizeof(header);
+    for (uint32_t i = 0; i < index->tag_count; i++) {
+        Tag *tag = &index->tags[i];
+        TagFileRecord record = { .length = tag->length, .posting_count = tag->posting_count };
+        memcpy(record.name, tag->name, tag->length + 1);
+        memcpy(p, &record, sizeof(record));
+        p += sizeof(record);
+        header.posting_count += tag->posting_count;
+    }
+    for (uint32_t i = 0; i < index->tag_count; i++) {
+        Tag *tag = &index->tags[i];
+        memcpy(p, tag->postings, tag->posting_count * sizeof(uint64_t));
+        p += tag->posting_count * sizeof(uint64_t);
+    }
+    memcpy(p, index->entries, (size_t)index->entry_count * sizeof(TaggedEntry));
+    memcpy(buffer, &header, sizeof(header));
+}
+
+TagIndex *tag_index_deserialize(const char *buffer, size_t size) {
+    TagFileHeader header;
+    if (size < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    if (header.magic != TAGS_FILE_MAGIC || header.version != TAGS_FILE_VERSION) {
+        return NULL;
+    }
+    size_t expected = sizeof(header)
+        + (size_t)header.tag_count * sizeof(TagFileRecord)
+        + header.posting_count * sizeof(uint64_t)
+        + (size_t)header.entry_count * sizeof(TaggedEntry);
+    if (header.posting_count > size || size != expected) {
+        return NULL;
+    }
+    TagIndex *index = create_tag_index();
+    index->next_entry_id = header.next_entry_id;
+    index->edit_generation = header.edit_generation;
+    const char *records = buffer + sizeof(header);
+    const char *postings = records + (size_t)header.tag_count * sizeof(TagFileRecord);
+    uint64_t posting_total = 0;
+    // a truncated or foreign file must not send lookups out of bounds
+    for (uint32_t i = 0; i < header.tag_count; i++) {
+        TagFileRecord record;
+        memcpy(&record, records + i * sizeof(TagFileRecord), sizeof(record));
+        posting_total += record.posting_count;
+        if (record.length == 0 || record.length > TAG_MAX_LENGTH || record.name[record.length] != '\0'
+            || posting_total > header.posting_count || tag_intern(index, record.name) != i) {
+            free_tag_index(index);
+            return NULL;
+        }
+        Tag *tag = &index->tags[i];
+        tag->posting_count = record.posting_count;
+        tag->posting_capacity = record.posting_count;
+        if (record.posting_count > 0) {
+            tag->postings = mem_alloc(MEM_TAGS, record.posting_count * sizeof(uint64_t));
+            memcpy(tag->postings, postings, record.posting_count * sizeof(uint64_t));
+            postings += record.posting_count * sizeof(uint64_t);
+        }
+    }
+    index->entry_capacity = header.entry_count > TAG_ENTRIES_INIT_CAP ? header.entry_count : TAG_ENTRIES_INIT_CAP;
+    index->entries = mem_realloc(MEM_TAGS, index->entries, index->entry_capacity * sizeof(TaggedEntry));
+    index->entry_count = header.entry_count;
+    memcpy(index->entries, postings, (size_t)header.entry_count * sizeof(TaggedEntry));
+    for (uint32_t i = 0; i < index->entry_count; i++) {
+        TaggedEntry *entry = &index->entries[i];
+        bool valid = entry->tag_count > 0 && entry->tag_count <= TAG_MAX_PER_ENTRY;
+        for (uint32_t j = 0; valid && j < entry->tag_count; j++) {
+            valid = entry->tags[j] < index->tag_count;
+        }
+        if (!valid) {
+            free_tag_index(index);
+            return NULL;
+        }
+    }
+    return index;
+}
+
+int compare_tagged_entries(const void *a, const void *b) {
+    uint64_t id_a = ((const TaggedEntry *)a)->entry_id;
+    uint64_t id_b = ((const TaggedEntry *)b)->entry_id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+int compare_ids(const void *a, const void *b) {
+    uint64_t id_a = *(const uint64_t *)a;
+    uint64_t id_b = *(const uint64_t *)b;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+int compare_slots(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
\ No newline at end of file
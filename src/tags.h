@@ -0,0 +1,132 @@
+#ifndef TAGS_H
+#define TAGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "modulo.h"
+#include "entry_list.h"
+
+/*
+TagIndex:
+The #tags and @mentions written in entries, for `modulo today --tag` and
+`modulo history --tag`.
+
+Tag names are interned once: a Tag holds the name (lowercased, sigil
+included) and a posting list of the ids of the entries that use it, kept
+ascending. Each tagged entry keeps the ids of its tags, so an edited entry
+can be taken out of the postings it no longer belongs to. Looking a tag up
+goes through a small open addressing table of name hashes that's rebuilt on
+load rather than stored.
+
+A query never reads entry text: it merges the posting lists of the tags it
+names and finds each entry through the store's id index (modulo_find_entry).
+Entries removed since they were indexed simply aren't found.
+
+Like the vocab, the index is a cache of the store saved next to it:
+next_entry_id records how far it got, tag_index_sync indexes the entries
+written since (e.g. by `modulo add`), the editor indexes its own entries as
+they're submitted, and a missing or unreadable file is rebuilt.
+edit_generation is the store's edit_generation as of the last sync, an
+entry edited since by a process that didn't update this index makes it
+differ and the sync rebuilds the index from scratch.
+*/
+
+#define TAGS_FILE_MAGIC 0x5347544d /* "MTGS" */
+#define TAGS_FILE_VERSION 2
+
+#define TAG_SIGIL_HASH '#'
+#define TAG_SIGIL_MENTION '@'
+/* sigil included, the rest are vocab word bytes (see vocab_is_word_byte) */
+#define TAG_MAX_LENGTH 32
+#define TAG_MAX_PER_ENTRY 8
+/* a bare query ("work") names the tag under either sigil */
+#define TAG_QUERY_MAX 2
+
+#define TAG_INIT_CAP 16
+#define TAG_POSTINGS_INIT_CAP 4
+#define TAG_ENTRIES_INIT_CAP 64
+
+typedef struct Tag {
+    char name[TAG_MAX_LENGTH + 1];
+    uint8_t length;
+    uint32_t posting_count;
+    uint32_t posting_capacity;
+    /* entry ids, ascending */
+    uint64_t *postings;
+} Tag;
+
+/* an entry with at least one tag */
+typedef struct TaggedEntry {
+    uint64_t entry_id;
+    uint32_t tag_count;
+    uint32_t tags[TAG_MAX_PER_ENTRY];
+} TaggedEntry;
+
+typedef struct TagFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t tag_count;
+    uint32_t entry_count;
+    uint64_t posting_count;
+    uint64_t next_entry_id;
+    uint64_t edit_generation;
+} TagFileHeader;
+
+/* a tag in the file, its postings follow the tag records in tag order */
+typedef struct TagFileRecord {
+    char name[TAG_MAX_LENGTH + 1];
+    uint8_t length;
+    uint8_t padding[2];
+    uint32_t posting_count;
+} TagFileRecord;
+
+typedef struct TagIndex {
+    uint32_t tag_count;
+    uint32_t tag_capacity;
+    Tag *tags;
+    /* tag id + 1 by name hash, 0 for an empty slot. slot_count is a power of 2 */
+    uint32_t slot_count;
+    uint32_t *slots;
+    /* ascending by entry_id */
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+    TaggedEntry *entries;
+    /* entries with a lower id have been indexed */
+    uint64_t next_entry_id;
+    /* the store's edit_generation the index is up to date with */
+    uint64_t edit_generation;
+    /* changed since it was loaded */
+    bool dirty;
+} TagIndex;
+
+TagIndex *create_tag_index();
+void free_tag_index(TagIndex *index);
+
+/*
+    the tags in text, each once and in order of appearance, at most TAG_MAX_PER_ENTRY.
+    A tag is a sigil at the start of a word followed by word bytes, e.g. #work or @alice
+    (but not the @ of an email address or the # of C#)
+*/
+int tags_parse(const char *text, char tags[][TAG_MAX_LENGTH + 1]);
+
+// index the tags in text for entry_id, replacing whatever was indexed for it before
+void tag_index_set_entry(TagIndex *index, uint64_t entry_id, const char *text);
+// index the entries the index hasn't seen yet (ids from index->next_entry_id on), or all of them if an entry was edited since
+void tag_index_sync(TagIndex *index, Modulo *modulo);
+
+// the tag named name (sigil included), NULL if no entry has it
+Tag *tag_index_get(TagIndex *index, const char *name);
+// the tags query names: "#work" or "@alice" as written, a bare "work" is #work and @work
+int tag_index_resolve(TagIndex *index, const char *query, Tag *tags[TAG_QUERY_MAX]);
+// slots of the entries in entry_list tagged with query, ascending. the caller frees them
+int *tag_index_select(TagIndex *index, Modulo *modulo, const char *query, EntryList *entry_list, int *count);
+
+// the file image: a TagFileHeader, a TagFileRecord per tag, every posting list, then the tagged entries
+size_t tag_index_serialized_size(TagIndex *index);
+void tag_index_serialize(TagIndex *index, char *buffer);
+// NULL if buffer isn't a tag index this build can read
+TagIndex *tag_index_deserialize(const char *buffer, size_t size);
+
+#endif
\ No newline at end of file
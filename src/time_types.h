@@ -7,4 +7,7 @@ typedef int clk_time_t;
 /* offset from day_ptr in seconds */
 typedef int offset_t;
 
+/* local calendar day number (days since 1970-01-01) */
+typedef int day_t;
+
 #endif
\ No newline at end of file
@@ -2,17 +2,38 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 
 #include "time_utils.h"
 #include "modulo.h"
 
 static int parse_12_time(int hour, int minute, char *am_pm);
 static int parse_24_time(int hour, int minute);
-static char *tm_to_date_string(struct tm *date, struct tm *ref_date, bool use_relative_labels);
-static char *tm_to_time_string(struct tm *time_data);
+static char *tm_to_date_string(char *buf, size_t buf_size, struct tm *date, bool use_relative_labels);
+static char *tm_to_time_string(char *buf, size_t buf_size, struct tm *time_data);
+static const char *relative_label(struct tm *date);
+static void check_label_cache(time_t now_utc);
 static struct tm increment_days(struct tm date, int days);
 static bool same_day(struct tm *date1, struct tm *date2);
 
+/*
+Relative labels (today, yesterday, tomorrow) only depend on the local date of "now".
+Rather than recomputing yesterday and tomorrow (mktime + localtime each) for every
+formatted date, they're computed once per local date and reused until midnight.
+*/
+typedef struct LabelCache {
+    bool valid;
+    /* utc start of the cached local date (inclusive) */
+    time_t start;
+    /* utc start of the following local date (exclusive) */
+    time_t end;
+    struct tm yesterday;
+    struct tm today;
+    struct tm tomorrow;
+} LabelCache;
+
+static LabelCache label_cache = { .valid = false };
+
 /*
 API
 ---
@@ -107,9 +128,8 @@ offset_t time_to_offset(Modulo *modulo, clk_time_t time_minutes) {
 }
 
 void printf_time(char *format, int time_minutes) {
-    char *format_str = time_to_string(time_minutes);
-    printf(format, format_str);
-    free(format_str);
+    char format_str[FORMAT_TIME_BUF_SIZE];
+    printf(format, time_to_string(format_str, sizeof format_str, time_minutes));
 }
 
 clk_time_t utc_to_time(time_t time_utc) {
@@ -176,41 +196,153 @@ clk_time_t parse_time(char *time_str) {
     return -1;
 }
 
+/*
+Calendar day numbers
+
+day_t counts local calendar days since 1970-01-01. Day arithmetic
+(tomorrow, 7 days from now, ...) is then plain integer arithmetic.
+Conversions use the proleptic gregorian calendar (days_from_civil).
+month: 1-12, mday: 1-31
+*/
+day_t date_to_day(int year, int month, int mday) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + mday - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+void day_to_date(day_t day, int *year, int *month, int *mday) {
+    day += 719468;
+    int era = (day >= 0 ? day : day - 146096) / 146097;
+    int day_of_era = day - era * 146097;
+    int year_of_era = (day_of_era - day_of_era/1460 + day_of_era/36524 - day_of_era/146096) / 365;
+    int day_of_year = day_of_era - (365*year_of_era + year_of_era/4 - year_of_era/100);
+    int mp = (5*day_of_year + 2) / 153;
+    *mday = day_of_year - (153*mp + 2)/5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = year_of_era + era * 400 + (*month <= 2);
+}
+
+/*
+returns the day of the week for day (0 = sunday, 6 = saturday)
+1970-01-01 was a thursday
+*/
+int day_to_weekday(day_t day) {
+    return ((day + 4) % 7 + 7) % 7;
+}
+
+day_t utc_to_day(time_t time_utc) {
+    struct tm *local_time = localtime(&time_utc);
+    return date_to_day(local_time->tm_year + 1900, local_time->tm_mon + 1, local_time->tm_mday);
+}
+
+/*
+returns the utc time at time_minutes (local clock time) on the given day
+*/
+time_t day_to_utc(day_t day, clk_time_t time_minutes) {
+    int year, month, mday;
+    day_to_date(day, &year, &month, &mday);
+    struct tm local_time = {
+        .tm_year = year - 1900,
+        .tm_mon = month - 1,
+        .tm_mday = mday,
+        .tm_hour = time_minutes / 60,
+        .tm_min = time_minutes % 60,
+        .tm_isdst = -1
+    };
+    return mktime(&local_time);
+}
+
+/*
+Parses a relative day offset like "7d", "2w" or "7" (days)
+returns the number of days or -1 if the input doesn't match.
+Nothing may follow the unit, "3dxyz" or "3 days" are rejected like trailing input to parse_date
+*/
+int parse_day_offset(char *offset_str) {
+    char *end;
+    if (offset_str[0] < '0' || offset_str[0] > '9') {
+        return -1;
+    }
+    long count = strtol(offset_str, &end, 10);
+    if (count > INT_MAX) {
+        return -1;
+    }
+    char unit = tolower((unsigned char) end[0]);
+    if (unit != '\0' && end[1] != '\0') {
+        return -1;
+    }
+    if (unit == '\0' || unit == 'd') {
+        return (int) count;
+    }
+    if (unit == 'w' && count <= INT_MAX / 7) {
+        return 7 * (int) count;
+    }
+    return -1;
+}
+
+/*
+Parses a date in YYYY-MM-DD format
+returns the day number or -1 if the input isn't a valid date
+*/
+day_t parse_date(char *date_str) {
+    int year, month, mday;
+    char trailing;
+    if (sscanf(date_str, "%d-%d-%d%c", &year, &month, &mday, &trailing) != 3) {
+        return -1;
+    }
+    if (month < 1 || month > 12 || mday < 1 || mday > days_in_month(year, month)) {
+        return -1;
+    }
+    return date_to_day(year, month, mday);
+}
+
+int days_in_month(int year, int month) {
+    static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (month == 2 && leap) {
+        return 29;
+    }
+    return days[month - 1];
+}
 
-char *time_to_string(clk_time_t time_minutes) {
+/*
+The formatting functions below write into a caller provided buffer
+and return it, so they can be used inline as printf arguments
+e.g. printf("%s", time_to_string(buf, sizeof buf, wakeup))
+Output is truncated to fit buf_size.
+*/
+char *time_to_string(char *buf, size_t buf_size, clk_time_t time_minutes) {
     // hh:mm AM (hh:mm)
-    char *formatted = malloc(FORMAT_TIME_LENGTH+1);
     int hours_24 = time_minutes / 60;
     int hours_12 = (12 + hours_24 - 1) % 12 + 1;
     int minutes = time_minutes % 60;
     char *am_pm = hours_24 < 12 ? "AM" : "PM";
-    sprintf(formatted, "%02d:%02d %s (%02d:%02d)", hours_12, minutes, am_pm, hours_24, minutes);
-    return formatted;
+    snprintf(buf, buf_size, "%02d:%02d %s (%02d:%02d)", hours_12, minutes, am_pm, hours_24, minutes);
+    return buf;
 }
 
-char *utc_to_string(time_t time_utc, bool use_relative_labels) {
-    static char fmt_string[FORMAT_TIME_BUF_SIZE];
-
-    time_t ref_point_utc = time(NULL);
-    struct tm ref_point;
-    memcpy(&ref_point, localtime(&ref_point_utc), sizeof(struct tm));
-    
+char *utc_to_string(char *buf, size_t buf_size, time_t time_utc, bool use_relative_labels) {
     struct tm date;
     memcpy(&date, localtime(&time_utc), sizeof(struct tm));
-    sprintf(fmt_string, "%s %s", tm_to_date_string(&date, &ref_point, use_relative_labels), tm_to_time_string(&date));
-    return fmt_string;
+
+    char date_string[FORMAT_TIME_BUF_SIZE];
+    char time_string[FORMAT_TIME_BUF_SIZE];
+    tm_to_date_string(date_string, sizeof date_string, &date, use_relative_labels);
+    tm_to_time_string(time_string, sizeof time_string, &date);
+    snprintf(buf, buf_size, "%s %s", date_string, time_string);
+    return buf;
 }
 
-char *wakeup_range_to_string(Modulo *modulo) {
+char *wakeup_range_to_string(char *buf, size_t buf_size, Modulo *modulo) {
     time_t day_ptr = modulo->day_ptr;
     time_t next_wakeup_earliest = time_to_utc_next(modulo->wakeup_earliest, day_ptr);
     time_t next_wakeup_latest = time_to_utc_next(modulo->wakeup_latest, next_wakeup_earliest);
-    return utc_range_to_string(next_wakeup_earliest, next_wakeup_latest);
+    return utc_range_to_string(buf, buf_size, next_wakeup_earliest, next_wakeup_latest);
 }
 
-char *utc_range_to_string(time_t start_utc, time_t end_utc) {
-    // static wakeup range string
-    static char range_fmt_string[FORMAT_TIME_BUF_SIZE];
+char *utc_range_to_string(char *buf, size_t buf_size, time_t start_utc, time_t end_utc) {
     /*
     day(start) != day(start) -> individual dates
     day(start) == day(end)   -> converge dates
@@ -221,34 +353,28 @@ char *utc_range_to_string(time_t start_utc, time_t end_utc) {
     otherwise         -> date
     */
 
-    // calculate local time now
-    time_t now_utc = time(NULL);
-    struct tm now;
-    memcpy(&now, localtime(&now_utc), sizeof(struct tm));
-
     // calculate start and end local time
     struct tm start, end;
     memcpy(&start, localtime(&start_utc), sizeof(struct tm));
     memcpy(&end, localtime(&end_utc), sizeof(struct tm));
 
     // build start format string
-    char start_fmt_string[FORMAT_TIME_BUF_SIZE];
-    char *start_date = tm_to_date_string(&start, &now, true);
-    char *start_time = tm_to_time_string(&start);
-    sprintf(start_fmt_string, "%s %s", start_date, start_time);
-
-    // build end format string
-    char end_fmt_string[FORMAT_TIME_BUF_SIZE];
-    char *end_time = tm_to_time_string(&end);
+    char start_date[FORMAT_TIME_BUF_SIZE];
+    char start_time[FORMAT_TIME_BUF_SIZE];
+    tm_to_date_string(start_date, sizeof start_date, &start, true);
+    tm_to_time_string(start_time, sizeof start_time, &start);
+
+    // build end format string and combine into range format string
+    char end_time[FORMAT_TIME_BUF_SIZE];
+    tm_to_time_string(end_time, sizeof end_time, &end);
     if (!same_day(&start, &end)) {
-        char *end_date = tm_to_date_string(&end, &now, true);
-        sprintf(end_fmt_string, "%s %s", end_date, end_time);
+        char end_date[FORMAT_TIME_BUF_SIZE];
+        tm_to_date_string(end_date, sizeof end_date, &end, true);
+        snprintf(buf, buf_size, "%s %s - %s %s", start_date, start_time, end_date, end_time);
     } else {
-        strcpy(end_fmt_string, end_time);
+        snprintf(buf, buf_size, "%s %s - %s", start_date, start_time, end_time);
     }
-    // combine start and end strings into range format string
-    sprintf(range_fmt_string, "%s - %s", start_fmt_string, end_fmt_string);
-    return range_fmt_string;
+    return buf;
 }
 
 bool same_day(struct tm *time1, struct tm *time2) {
@@ -282,27 +408,56 @@ clk_time_t parse_24_time(int hour, int minute) {
 /*
 use_relative_labels: whether or not to use date labels like yesterday, today, tomorrow
 */
-char *tm_to_date_string(struct tm *date, struct tm *ref_date, bool use_relative_labels) {
-    static char fmt_string[FORMAT_TIME_BUF_SIZE];
-    if (!use_relative_labels) {
-        // return explicit date
-        strftime(fmt_string, sizeof fmt_string, "%A, %B %d", date);
-        return fmt_string;
-    }
+char *tm_to_date_string(char *buf, size_t buf_size, struct tm *date, bool use_relative_labels) {
     // convert to relative date if applicable (e.g today, yesterday, tomorrow)
-    struct tm *today = ref_date;
-    struct tm yesterday = increment_days(*today, -1);
-    struct tm tomorrow = increment_days(*today, 1);
-    if (same_day(date, today)) {
-        strcpy(fmt_string, TODAY);
-    } else if (same_day(date, &yesterday)) {
-        strcpy(fmt_string, YESTERDAY);
-    } else if (same_day(date, &tomorrow)) {
-        strcpy(fmt_string, TOMORROW);
+    const char *label = use_relative_labels ? relative_label(date) : NULL;
+    if (label != NULL) {
+        snprintf(buf, buf_size, "%s", label);
     } else {
-        strftime(fmt_string, sizeof fmt_string, "%A, %B %d", date);
+        strftime(buf, buf_size, "%A, %B %d", date);
     }
-    return fmt_string;
+    return buf;
+}
+
+/*
+returns TODAY, YESTERDAY or TOMORROW if date falls on one of those local dates
+NULL otherwise
+*/
+const char *relative_label(struct tm *date) {
+    check_label_cache(time(NULL));
+    if (same_day(date, &label_cache.today)) {
+        return TODAY;
+    } else if (same_day(date, &label_cache.yesterday)) {
+        return YESTERDAY;
+    } else if (same_day(date, &label_cache.tomorrow)) {
+        return TOMORROW;
+    }
+    return NULL;
+}
+
+/*
+Rebuilds the label cache if now_utc falls outside the cached local date
+*/
+void check_label_cache(time_t now_utc) {
+    if (label_cache.valid && now_utc >= label_cache.start && now_utc < label_cache.end) {
+        return;
+    }
+    struct tm today;
+    memcpy(&today, localtime(&now_utc), sizeof(struct tm));
+    // local midnight at the start of today
+    today.tm_hour = 0;
+    today.tm_min = 0;
+    today.tm_sec = 0;
+    today.tm_isdst = -1;
+    label_cache.start = mktime(&today);
+    label_cache.today = today;
+    label_cache.yesterday = increment_days(today, -1);
+    label_cache.tomorrow = increment_days(today, 1);
+    // local midnight at the start of tomorrow
+    struct tm next_midnight = label_cache.tomorrow;
+    next_midnight.tm_isdst = -1;
+    label_cache.end = mktime(&next_midnight);
+    label_cache.valid = true;
 }
 
 struct tm increment_days(struct tm date, int days) {
@@ -314,8 +469,7 @@ struct tm increment_days(struct tm date, int days) {
     return *incremented;
 }
 
-char *tm_to_time_string(struct tm *date) {
-    static char fmt_string[FORMAT_TIME_BUF_SIZE];
-    strftime(fmt_string, sizeof fmt_string, "%I:%M %p", date);
-    return fmt_string;
-}
+char *tm_to_time_string(char *buf, size_t buf_size, struct tm *date) {
+    strftime(buf, buf_size, "%I:%M %p", date);
+    return buf;
+}
\ No newline at end of file
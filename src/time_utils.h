@@ -13,6 +13,7 @@
 
 #define FORMAT_TIME_LENGTH 16
 #define FORMAT_TIME_BUF_SIZE 64
+#define FORMAT_RANGE_BUF_SIZE (2*FORMAT_TIME_BUF_SIZE + 4)
 
 offset_t utc_to_offset(Modulo *modulo, time_t time_utc);
 offset_t time_to_offset(Modulo *modulo, clk_time_t time_minutes);
@@ -25,9 +26,20 @@ time_t time_to_utc_next(int time_minutes, time_t ref_point);
 time_t time_to_utc_prev(int time_minutes, time_t ref_point);
 time_t utc_now();
 
-char *time_to_string(clk_time_t time_minutes);
-char *utc_to_string(time_t time_utc, bool use_relative_labels);
-char *utc_range_to_string(time_t start_utc, time_t end_utc);
-char *wakeup_range_to_string(Modulo *modulo);
+// calendar day numbers
+day_t date_to_day(int year, int month, int mday);
+void day_to_date(day_t day, int *year, int *month, int *mday);
+int day_to_weekday(day_t day);
+int days_in_month(int year, int month);
+day_t utc_to_day(time_t time_utc);
+time_t day_to_utc(day_t day, clk_time_t time_minutes);
+int parse_day_offset(char *offset_str);
+day_t parse_date(char *date_str);
+
+// formatting (writes into buf and returns it)
+char *time_to_string(char *buf, size_t buf_size, clk_time_t time_minutes);
+char *utc_to_string(char *buf, size_t buf_size, time_t time_utc, bool use_relative_labels);
+char *utc_range_to_string(char *buf, size_t buf_size, time_t start_utc, time_t end_utc);
+char *wakeup_range_to_string(char *buf, size_t buf_size, Modulo *modulo);
 
 #endif
\ No newline at end of file
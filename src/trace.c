@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+#include "mem.h"
+
+#define TRACE_STDERR "1"
+#define TRACE_JSON_SUFFIX ".json"
+#define TRACE_COMMAND_MAX_LEN 31
+
+typedef struct TraceSpan {
+    const char *name;
+    trace_ns_t start;
+    trace_ns_t duration;
+    /* bytes read or written, -1 if the span doesn't do I/O */
+    long long bytes;
+} TraceSpan;
+
+typedef struct Trace {
+    bool enabled;
+    /* NULL for stderr */
+    char *path;
+    bool chrome_json;
+    char command[TRACE_COMMAND_MAX_LEN + 1];
+    trace_ns_t start;
+    int span_count;
+    TraceSpan spans[TRACE_MAX_SPANS];
+} Trace;
+
+static Trace trace = { .enabled = false };
+
+static trace_ns_t now_ns();
+static void trace_finish();
+static void write_compact_line(FILE *fp, trace_ns_t end);
+static void write_chrome_json(FILE *fp, trace_ns_t end);
+
+void trace_init(int argc, char **argv) {
+    char *value = getenv(TRACE_ENV_VAR);
+    if (value == NULL || value[0] == '\0' || strcmp(value, "0") == 0) {
+        return;
+    }
+    trace.enabled = true;
+    trace.start = now_ns();
+    if (strcmp(value, TRACE_STDERR) != 0) {
+        trace.path = value;
+        size_t length = strlen(value);
+        size_t suffix_length = strlen(TRACE_JSON_SUFFIX);
+        trace.chrome_json = length > suffix_length && strcmp(value + length - suffix_length, TRACE_JSON_SUFFIX) == 0;
+    }
+    snprintf(trace.command, sizeof trace.command, "%s", argc > 1 ? argv[1] : "root");
+    // the command ends up in json and key=value output
+    for (char *c = trace.command; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\' || *c == ' ' || *c < 0x20) {
+            *c = '_';
+        }
+    }
+    atexit(trace_finish);
+}
+
+bool trace_enabled() {
+    return trace.enabled;
+}
+
+trace_ns_t trace_begin() {
+    if (!trace.enabled) {
+        return 0;
+    }
+    return now_ns();
+}
+
+void trace_end(const char *name, trace_ns_t start) {
+    if (!trace.enabled) {
+        return;
+    }
+    trace_end_bytes(name, start, (size_t) -1);
+}
+
+void trace_end_bytes(const char *name, trace_ns_t start, size_t bytes) {
+    if (!trace.enabled || trace.span_count == TRACE_MAX_SPANS) {
+        return;
+    }
+    TraceSpan *span = &trace.spans[trace.span_count++];
+    span->name = name;
+    span->start = start;
+    span->duration = now_ns() - start;
+    span->bytes = bytes == (size_t) -1 ? -1 : (long long) bytes;
+}
+
+trace_ns_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (trace_ns_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void trace_finish() {
+    trace_ns_t end = now_ns();
+    FILE *fp = stderr;
+    if (trace.path != NULL) {
+        fp = fopen(trace.path, trace.chrome_json ? "w" : "a");
+        if (fp == NULL) {
+            fprintf(stderr, "modulo-trace: can't open %s\n", trace.path);
+            return;
+        }
+    }
+    if (trace.chrome_json) {
+        write_chrome_json(fp, end);
+    } else {
+        write_compact_line(fp, end);
+    }
+    if (fp != stderr) {
+        fclose(fp);
+    }
+}
+
+// durations in microseconds
+void write_compact_line(FILE *fp, trace_ns_t end) {
+    fprintf(fp, "modulo-trace cmd=%s total_us=%lld", trace.command, (end - trace.start) / 1000);
+    for (int i = 0; i < trace.span_count; i++) {
+        TraceSpan *span = &trace.spans[i];
+        fprintf(fp, " %s=%lld", span->name, span->duration / 1000);
+        if (span->bytes >= 0) {
+            fprintf(fp, "(%lldB)", span->bytes);
+        }
+    }
+    MemStats json = mem_get_stats(MEM_JSON);
+    fprintf(fp, " json_allocs=%lld json_frees=%lld json_alloc_bytes=%zu\n", json.allocs, json.frees, json.total_bytes);
+}
+
+/*
+Trace Event Format complete ("X") events,
+timestamps in microseconds from the start of the run
+*/
+void write_chrome_json(FILE *fp, trace_ns_t end) {
+    int pid = (int) getpid();
+    MemStats json = mem_get_stats(MEM_JSON);
+    fprintf(fp, "{\"traceEvents\":[\n");
+    fprintf(
+        fp,
+        "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":0,\"dur\":%.3f,\"pid\":%d,\"tid\":1,"
+        "\"args\":{\"json_allocs\":%lld,\"json_frees\":%lld,\"json_alloc_bytes\":%zu}}",
+        trace.command,
+        (end - trace.start) / 1000.0,
+        pid,
+        json.allocs,
+        json.frees,
+        json.total_bytes
+    );
+    for (int i = 0; i < trace.span_count; i++) {
+        TraceSpan *span = &trace.spans[i];
+        fprintf(
+            fp,
+            ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":1",
+            span->name,
+            (span->start - trace.start) / 1000.0,
+            span->duration / 1000.0,
+            pid
+        );
+        if (span->bytes >= 0) {
+            fprintf(fp, ",\"args\":{\"bytes\":%lld}", span->bytes);
+        }
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n]}\n");
+}
\ No newline at end of file
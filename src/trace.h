@@ -0,0 +1,37 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+Phase level tracing, enabled with the MODULO_TRACE environment variable
+
+    MODULO_TRACE=1            one compact line on stderr per run
+    MODULO_TRACE=<file>       the same line appended to file
+    MODULO_TRACE=<file>.json  Chrome trace event JSON (chrome://tracing, Perfetto)
+
+e.g.
+modulo-trace cmd=today total_us=812 get_context=4 read_text_data=61(48211B) json_parse=240 ...
+
+Spans are timed with a monotonic clock and the cJSON allocation counts come
+from the MEM_JSON tag of the counting allocator (see mem.h). When
+MODULO_TRACE isn't set trace_begin and trace_end return straight away.
+*/
+
+#define TRACE_ENV_VAR "MODULO_TRACE"
+#define TRACE_MAX_SPANS 64
+
+typedef long long trace_ns_t;
+
+// reads MODULO_TRACE and registers the report to run at exit
+void trace_init(int argc, char **argv);
+bool trace_enabled();
+
+// returns the span start time (0 when tracing is disabled)
+trace_ns_t trace_begin();
+void trace_end(const char *name, trace_ns_t start);
+// end a span that read or wrote bytes
+void trace_end_bytes(const char *name, trace_ns_t start, size_t bytes);
+
+#endif
\ No newline at end of file
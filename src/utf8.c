@@ -0,0 +1,118 @@
+#define _XOPEN_SOURCE 700
+
+#include <string.h>
+#include <wchar.h>
+
+#include "utf8.h"
+
+int utf8_encode(uint32_t code_point, char *buf) {
+    if (code_point < 0x80) {
+        buf[0] = (char) code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        buf[0] = (char) (0xC0 | (code_point >> 6));
+        buf[1] = (char) (0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+        // surrogates aren't code points on their own
+        return 0;
+    }
+    if (code_point < 0x10000) {
+        buf[0] = (char) (0xE0 | (code_point >> 12));
+        buf[1] = (char) (0x80 | ((code_point >> 6) & 0x3F));
+        buf[2] = (char) (0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    if (code_point < 0x110000) {
+        buf[0] = (char) (0xF0 | (code_point >> 18));
+        buf[1] = (char) (0x80 | ((code_point >> 12) & 0x3F));
+        buf[2] = (char) (0x80 | ((code_point >> 6) & 0x3F));
+        buf[3] = (char) (0x80 | (code_point & 0x3F));
+        return 4;
+    }
+    return 0;
+}
+
+uint32_t utf8_decode(const char *s, size_t length, int *size) {
+    const unsigned char *u = (const unsigned char *) s;
+    *size = 1;
+    if (u[0] < 0x80) {
+        return u[0];
+    }
+    int count;
+    uint32_t code_point;
+    uint32_t min;
+    if ((u[0] & 0xE0) == 0xC0) {
+        count = 2;
+        code_point = u[0] & 0x1F;
+        min = 0x80;
+    } else if ((u[0] & 0xF0) == 0xE0) {
+        count = 3;
+        code_point = u[0] & 0x0F;
+        min = 0x800;
+    } else if ((u[0] & 0xF8) == 0xF0) {
+        count = 4;
+        code_point = u[0] & 0x07;
+        min = 0x10000;
+    } else {
+        return UTF8_REPLACEMENT;
+    }
+    if ((size_t) count > length) {
+        return UTF8_REPLACEMENT;
+    }
+    for (int i = 1; i < count; i++) {
+        if (!UTF8_IS_CONTINUATION(u[i])) {
+            return UTF8_REPLACEMENT;
+        }
+        code_point = (code_point << 6) | (u[i] & 0x3F);
+    }
+    // overlong encodings and out of range values
+    if (code_point < min || code_point > 0x10FFFF) {
+        return UTF8_REPLACEMENT;
+    }
+    *size = count;
+    return code_point;
+}
+
+size_t utf8_next(const char *s, size_t length, size_t index) {
+    if (index >= length) {
+        return length;
+    }
+    int size;
+    utf8_decode(&s[index], length - index, &size);
+    return index + size;
+}
+
+size_t utf8_prev(const char *s, size_t index) {
+    if (index == 0) {
+        return 0;
+    }
+    size_t prev = index - 1;
+    // at most 3 continuation bytes belong to one code point
+    for (int i = 0; i < UTF8_MAX_BYTES - 1 && prev > 0 && UTF8_IS_CONTINUATION(s[prev]); i++) {
+        prev--;
+    }
+    // a stray continuation byte is its own (invalid) code point
+    int size;
+    utf8_decode(&s[prev], index - prev, &size);
+    if (prev + size != index) {
+        return index - 1;
+    }
+    return prev;
+}
+
+size_t utf8_code_point_count(const char *s) {
+    size_t length = strlen(s);
+    size_t count = 0;
+    for (size_t i = 0; i < length; i = utf8_next(s, length, i)) {
+        count++;
+    }
+    return count;
+}
+
+int utf8_code_point_width(uint32_t code_point) {
+    int width = wcwidth((wchar_t) code_point);
+    return width < 0 ? 1 : width;
+}
\ No newline at end of file
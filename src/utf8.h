@@ -0,0 +1,33 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+UTF-8 helpers for text that is stored as bytes (entries, editor lines).
+
+Invalid or truncated sequences decode one byte at a time as
+UTF8_REPLACEMENT so walking malformed text always makes progress.
+*/
+
+#define UTF8_MAX_BYTES 4
+#define UTF8_REPLACEMENT 0xFFFD
+
+// true for the 10xxxxxx bytes inside a multi-byte sequence
+#define UTF8_IS_CONTINUATION(byte) (((unsigned char) (byte) & 0xC0) == 0x80)
+
+// writes code_point into buf, returns the number of bytes (0 if code_point isn't valid)
+int utf8_encode(uint32_t code_point, char *buf);
+// decodes the code point at s[0..length), the number of bytes read goes in size
+uint32_t utf8_decode(const char *s, size_t length, int *size);
+
+// byte index of the code point after / before the one at index
+size_t utf8_next(const char *s, size_t length, size_t index);
+size_t utf8_prev(const char *s, size_t index);
+
+size_t utf8_code_point_count(const char *s);
+// display columns of a code point, 1 for anything wcwidth can't measure
+int utf8_code_point_width(uint32_t code_point);
+
+#endif
\ No newline at end of file
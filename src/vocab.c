@@ -0,0 +1,278 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "vocab.h"
+#include "entry_list.h"
+#include "mem.h"
+
+static uint32_t vocab_new_node(Vocab *vocab, uint8_t byte);
+static uint32_t vocab_find_child(Vocab *vocab, uint32_t node, uint8_t byte);
+static uint32_t vocab_best_child(Vocab *vocab, uint32_t node, uint32_t best);
+static void sync_entry_list(Modulo *modulo, EntryList *entry_list, void *arg);
+static bool vocab_links_valid(Vocab *vocab);
+static void vocab_scan_text(Vocab *vocab, const char *text, void (*fn)(Vocab *vocab, const char *word, size_t length));
+
+Vocab *create_vocab() {
+    Vocab *vocab = mem_alloc(MEM_VOCAB, sizeof(Vocab));
+    vocab->capacity = VOCAB_INIT_NODE_CAP;
+    vocab->nodes = mem_alloc(MEM_VOCAB, vocab->capacity * sizeof(VocabNode));
+    vocab->node_count = 0;
+    vocab->word_count = 0;
+    vocab->next_entry_id = 1;
+    vocab->dirty = false;
+    // root
+    vocab_new_node(vocab, 0);
+    return vocab;
+}
+
+void free_vocab(Vocab *vocab) {
+    if (vocab == NULL) {
+        return;
+    }
+    mem_free(vocab->nodes);
+    mem_free(vocab);
+}
+
+// callers hold node indices across this, never pointers, the array moves when it grows
+uint32_t vocab_new_node(Vocab *vocab, uint8_t byte) {
+    if (vocab->node_count == vocab->capacity) {
+        vocab->capacity *= 2;
+        vocab->nodes = mem_realloc(MEM_VOCAB, vocab->nodes, vocab->capacity * sizeof(VocabNode));
+    }
+    uint32_t index = vocab->node_count++;
+    vocab->nodes[index] = (VocabNode) { .byte = byte };
+    return index;
+}
+
+uint32_t vocab_find_child(Vocab *vocab, uint32_t node, uint8_t byte) {
+    uint32_t child = vocab->nodes[node].first_child;
+    while (child != 0 && vocab->nodes[child].byte != byte) {
+        child = vocab->nodes[child].next_sibling;
+    }
+    return child;
+}
+
+uint32_t vocab_best_child(Vocab *vocab, uint32_t node, uint32_t best) {
+    uint32_t child = vocab->nodes[node].first_child;
+    while (child != 0 && vocab->nodes[child].best != best) {
+        child = vocab->nodes[child].next_sibling;
+    }
+    return child;
+}
+
+bool vocab_is_word_byte(char c) {
+    unsigned char u = (unsigned char)c;
+    return u >= 0x80 || u == '_'
+        || (u >= '0' && u <= '9')
+        || (u >= 'a' && u <= 'z')
+        || (u >= 'A' && u <= 'Z');
+}
+
+void vocab_add_word(Vocab *vocab, const char *word, size_t length) {
+    if (length < VOCAB_MIN_WORD || length > VOCAB_MAX_WORD) {
+        return;
+    }
+    uint32_t path[VOCAB_MAX_WORD + 1];
+    uint32_t node = 0;
+    path[0] = node;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = (uint8_t)word[i];
+        uint32_t child = vocab_find_child(vocab, node, byte);
+        if (child == 0) {
+            child = vocab_new_node(vocab, byte);
+            vocab->nodes[child].next_sibling = vocab->nodes[node].first_child;
+            vocab->nodes[node].first_child = child;
+        }
+        node = child;
+        path[i + 1] = node;
+    }
+    if (vocab->nodes[node].count == 0) {
+        vocab->word_count++;
+    }
+    uint32_t count = ++vocab->nodes[node].count;
+    // adding only grows counts, so best is a running max along the path
+    for (size_t i = 0; i <= length; i++) {
+        VocabNode *n = &vocab->nodes[path[i]];
+        if (n->best < count) {
+            n->best = count;
+        }
+    }
+    vocab->dirty = true;
+}
+
+void vocab_remove_word(Vocab *vocab, const char *word, size_t length) {
+    if (length < VOCAB_MIN_WORD || length > VOCAB_MAX_WORD) {
+        return;
+    }
+    uint32_t path[VOCAB_MAX_WORD + 1];
+    uint32_t node = 0;
+    path[0] = node;
+    for (size_t i = 0; i < length; i++) {
+        node = vocab_find_child(vocab, node, (uint8_t)word[i]);
+        if (node == 0) {
+            return;
+        }
+        path[i + 1] = node;
+    }
+    if (vocab->nodes[node].count == 0) {
+        return;
+    }
+    if (--vocab->nodes[node].count == 0) {
+        vocab->word_count--;
+    }
+    // the best on the path may have been this word's, recount it bottom up. nodes stay, count 0 is no word
+    for (size_t i = length + 1; i-- > 0;) {
+        VocabNode *n = &vocab->nodes[path[i]];
+        uint32_t best = n->count;
+        for (uint32_t child = n->first_child; child != 0; child = vocab->nodes[child].next_sibling) {
+            if (vocab->nodes[child].best > best) {
+                best = vocab->nodes[child].best;
+            }
+        }
+        n->best = best;
+    }
+    vocab->dirty = true;
+}
+
+void vocab_add_text(Vocab *vocab, const char *text) {
+    vocab_scan_text(vocab, text, vocab_add_word);
+}
+
+void vocab_remove_text(Vocab *vocab, const char *text) {
+    vocab_scan_text(vocab, text, vocab_remove_word);
+}
+
+void vocab_scan_text(Vocab *vocab, const char *text, void (*fn)(Vocab *vocab, const char *word, size_t length)) {
+    const char *p = text;
+    while (*p != '\0') {
+        while (*p != '\0' && !vocab_is_word_byte(*p)) {
+            p++;
+        }
+        const char *start = p;
+        while (vocab_is_word_byte(*p)) {
+            p++;
+        }
+        fn(vocab, start, p - start);
+    }
+}
+
+void vocab_sync(Vocab *vocab, Modulo *modulo) {
+    modulo_for_each_entry_list(modulo, sync_entry_list, vocab);
+    uint64_t next_entry_id = modulo_get_next_entry_id(modulo);
+    if (next_entry_id > vocab->next_entry_id) {
+        vocab->next_entry_id = next_entry_id;
+        vocab->dirty = true;
+    }
+}
+
+void sync_entry_list(Modulo *modulo, EntryList *entry_list, void *arg) {
+    Vocab *vocab = arg;
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->id >= vocab->next_entry_id && !(entry->flags & ENTRY_REMOVED)) {
+            vocab_add_text(vocab, entry->text);
+        }
+    }
+}
+
+/*
+Walks down the prefix, then follows whichever child holds the subtree's best
+count until reaching the word that has it. At the prefix node itself the
+word ending there (if any) doesn't count, only longer ones do.
+*/
+size_t vocab_complete(Vocab *vocab, const char *prefix, size_t length, char *out) {
+    if (length < VOCAB_MIN_PREFIX || length >= VOCAB_MAX_WORD) {
+        return 0;
+    }
+    uint32_t node = 0;
+    for (size_t i = 0; i < length; i++) {
+        node = vocab_find_child(vocab, node, (uint8_t)prefix[i]);
+        if (node == 0) {
+            return 0;
+        }
+    }
+    uint32_t best = 0;
+    for (uint32_t child = vocab->nodes[node].first_child; child != 0; child = vocab->nodes[child].next_sibling) {
+        if (vocab->nodes[child].best > best) {
+            best = vocab->nodes[child].best;
+        }
+    }
+    if (best == 0) {
+        return 0;
+    }
+    memcpy(out, prefix, length);
+    size_t out_length = length;
+    do {
+        node = vocab_best_child(vocab, node, best);
+        out[out_length++] = (char)vocab->nodes[node].byte;
+    } while (vocab->nodes[node].count != best && out_length < VOCAB_MAX_WORD);
+    out[out_length] = '\0';
+    return out_length;
+}
+
+size_t vocab_serialized_size(Vocab *vocab) {
+    return sizeof(VocabFileHeader) + (size_t)vocab->node_count * sizeof(VocabNode);
+}
+
+void vocab_serialize(Vocab *vocab, char *buffer) {
+    VocabFileHeader header = {
+        .magic = VOCAB_FILE_MAGIC,
+        .version = VOCAB_FILE_VERSION,
+        .node_count = vocab->node_count,
+        .word_count = vocab->word_count,
+        .next_entry_id = vocab->next_entry_id
+    };
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), vocab->nodes, (size_t)vocab->node_count * sizeof(VocabNode));
+}
+
+Vocab *vocab_deserialize(const char *buffer, size_t size) {
+    VocabFileHeader header;
+    if (size < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    if (header.magic != VOCAB_FILE_MAGIC || header.version != VOCAB_FILE_VERSION || header.node_count == 0) {
+        return NULL;
+    }
+    if (size - sizeof(header) != (size_t)header.node_count * sizeof(VocabNode)) {
+        return NULL;
+    }
+    Vocab *vocab = mem_alloc(MEM_VOCAB, sizeof(Vocab));
+    vocab->node_count = header.node_count;
+    vocab->capacity = header.node_count;
+    vocab->word_count = header.word_count;
+    vocab->next_entry_id = header.next_entry_id;
+    vocab->dirty = false;
+    vocab->nodes = mem_alloc(MEM_VOCAB, (size_t)vocab->capacity * sizeof(VocabNode));
+    memcpy(vocab->nodes, buffer + sizeof(header), (size_t)header.node_count * sizeof(VocabNode));
+    if (!vocab_links_valid(vocab)) {
+        free_vocab(vocab);
+        return NULL;
+    }
+    return vocab;
+}
+
+/*
+    a truncated or foreign file must not send lookups out of bounds or round a
+    cycle. In a trie every node but the root is linked to exactly once (as a
+    first child or a next sibling), so no node reachable from the root is on a cycle
+*/
+bool vocab_links_valid(Vocab *vocab) {
+    uint32_t node_count = vocab->node_count;
+    uint8_t *linked = mem_calloc(MEM_VOCAB, node_count, sizeof(uint8_t));
+    bool valid = true;
+    for (uint32_t i = 0; i < node_count && valid; i++) {
+        uint32_t links[2] = { vocab->nodes[i].first_child, vocab->nodes[i].next_sibling };
+        for (int j = 0; j < 2 && valid; j++) {
+            if (links[j] >= node_count || (links[j] != 0 && linked[links[j]])) {
+                valid = false;
+            } else {
+                linked[links[j]] = 1;
+            }
+        }
+    }
+    mem_free(linked);
+    return valid;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef VOCAB_H
+#define VOCAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "modulo.h"
+
+/*
+Vocab:
+Every word written in the store with how often it was seen, for completion
+in the entry editor.
+
+The words live in a trie stored as one array of nodes linked first-child /
+next-sibling, so the whole thing is a single allocation that's written to
+disk as is (see load_vocab in filesystem.h) and read back with one fread.
+Node 0 is the root, index 0 also stands for "no node" in the links since
+the root is never anyone's child or sibling.
+
+best is the highest count of any word in a node's subtree, so the most
+frequent completion of a prefix is found by following the best child down
+from the prefix node, never visiting the rest of the subtree. Lookups cost
+O(word length * alphabet) whatever the vocabulary size.
+
+The vocab is a cache of the store: next_entry_id records how far it got,
+vocab_sync adds the entries written since (e.g. by `modulo add`), and a
+missing or unreadable file is simply rebuilt.
+*/
+
+#define VOCAB_FILE_MAGIC 0x434f564d /* "MVOC" */
+#define VOCAB_FILE_VERSION 1
+#define VOCAB_INIT_NODE_CAP 1024
+
+/* words are runs of letters, digits, '_' and non-ASCII characters */
+#define VOCAB_MIN_WORD 3
+#define VOCAB_MAX_WORD 32
+/* shortest prefix worth completing */
+#define VOCAB_MIN_PREFIX 2
+
+typedef struct VocabNode {
+    uint32_t first_child;
+    uint32_t next_sibling;
+    /* times the word ending at this node was seen, 0 if no word ends here */
+    uint32_t count;
+    uint32_t best;
+    uint8_t byte;
+    uint8_t padding[3];
+} VocabNode;
+
+typedef struct VocabFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t word_count;
+    uint64_t next_entry_id;
+} VocabFileHeader;
+
+typedef struct Vocab {
+    uint32_t node_count;
+    uint32_t capacity;
+    uint32_t word_count;
+    /* entries with a lower id have been added */
+    uint64_t next_entry_id;
+    /* changed since it was loaded */
+    bool dirty;
+    VocabNode *nodes;
+} Vocab;
+
+Vocab *create_vocab();
+void free_vocab(Vocab *vocab);
+
+bool vocab_is_word_byte(char c);
+
+void vocab_add_word(Vocab *vocab, const char *word, size_t length);
+// takes one off the word's count, words that aren't in the vocab are ignored
+void vocab_remove_word(Vocab *vocab, const char *word, size_t length);
+// adds every word in text
+void vocab_add_text(Vocab *vocab, const char *text);
+// removes every word in text, e.g. the old text of an edited entry
+void vocab_remove_text(Vocab *vocab, const char *text);
+// adds the entries the vocab hasn't seen yet (ids from vocab->next_entry_id on)
+void vocab_sync(Vocab *vocab, Modulo *modulo);
+
+/*
+    most frequent word starting with prefix and longer than it
+    copies it into out (null terminated) and returns its length, 0 if there is none
+    out must hold VOCAB_MAX_WORD+1 bytes
+*/
+size_t vocab_complete(Vocab *vocab, const char *prefix, size_t length, char *out);
+
+// the file image: a VocabFileHeader followed by the node array
+size_t vocab_serialized_size(Vocab *vocab);
+void vocab_serialize(Vocab *vocab, char *buffer);
+// NULL if buffer isn't a vocab file this build can read
+Vocab *vocab_deserialize(const char *buffer, size_t size);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#include "watch.h"
+#include "records.h"
+#include "entry_list.h"
+#include "calendar_queue.h"
+#include "mem.h"
+
+/*
+Section:
+An entry list and its place in the store.
+changed is cleared for lists found unchanged in the other copy
+*/
+typedef struct Section {
+    RecordList where;
+    EntryList *entry_list;
+    bool changed;
+} Section;
+
+static Section *collect_sections(Modulo *modulo, int *count);
+static Section *find_section(Section *sections, int count, Section *section);
+static Section *section_of(Section *sections, int count, EntryList *entry_list);
+static bool same_section(Section *a, Section *b);
+static bool entry_list_changed(EntryList *a, EntryList *b);
+static bool entry_changed(Entry *a, Entry *b);
+static void diff_preferences(Writer *writer, Modulo *previous, Modulo *latest);
+static void diff_arrivals(Writer *writer, Modulo *previous, Section *sections, int count, Section *section);
+static void diff_departures(Writer *writer, Modulo *latest, Section *section);
+
+int watch_store(OSContext *c, Modulo *modulo, Writer *writer) {
+#if defined(__linux__)
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd == -1) {
+        fprintf(stderr, "Failed to start watching %s: %s\n", c->modulo_dir, strerror(errno));
+        free_modulo(modulo);
+        return -1;
+    }
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(fd, c->modulo_dir, mask) == -1) {
+        fprintf(stderr, "Failed to watch %s: %s\n", c->modulo_dir, strerror(errno));
+        close(fd);
+        free_modulo(modulo);
+        return -1;
+    }
+    records_write_status(writer, modulo);
+    writer_flush(writer);
+
+    _Alignas(struct inotify_event) char buffer[WATCH_EVENT_BUFFER_SIZE];
+    while (!writer->failed) {
+        ssize_t length = read(fd, buffer, sizeof buffer);
+        if (length == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Failed to read changes to %s: %s\n", c->modulo_dir, strerror(errno));
+            break;
+        }
+        // a batch can hold several saves, one reload covers them all
+        bool store_changed = false;
+        bool dir_gone = false;
+        struct inotify_event *event;
+        for (char *p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + event->len) {
+            event = (struct inotify_event *)p;
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                dir_gone = true;
+            } else if (event->len > 0 && strcmp(event->name, MODULO_FILENAME) == 0) {
+                store_changed = true;
+            }
+        }
+        if (dir_gone) {
+            fprintf(stderr, "%s was removed, stopped watching\n", c->modulo_dir);
+            break;
+        }
+        if (!store_changed) {
+            continue;
+        }
+        Modulo *latest = load_modulo(c);
+        if (latest == NULL) {
+            continue;
+        }
+        watch_diff(writer, modulo, latest);
+        writer_flush(writer);
+        free_modulo(modulo);
+        modulo = latest;
+    }
+    close(fd);
+    free_modulo(modulo);
+    return 0;
+#else
+    fprintf(stderr, "modulo watch needs inotify, it's only available on linux\n");
+    free_modulo(modulo);
+    return -1;
+#endif
+}
+
+void watch_diff(Writer *writer, Modulo *previous, Modulo *latest) {
+    time_t previous_day = modulo_get_day_ptr(previous);
+    time_t latest_day = modulo_get_day_ptr(latest);
+    if (latest_day != previous_day) {
+        records_write_day(writer, previous_day, latest_day);
+    }
+    diff_preferences(writer, previous, latest);
+
+    int previous_count, latest_count;
+    Section *previous_sections = collect_sections(previous, &previous_count);
+    Section *latest_sections = collect_sections(latest, &latest_count);
+    for (int i = 0; i < latest_count; i++) {
+        Section *section = &latest_sections[i];
+        Section *match = find_section(previous_sections, previous_count, section);
+        if (match != NULL && !entry_list_changed(match->entry_list, section->entry_list)) {
+            match->changed = false;
+            continue;
+        }
+        diff_arrivals(writer, previous, previous_sections, previous_count, section);
+    }
+    // entries that left a changed list and aren't anywhere in latest
+    for (int i = 0; i < previous_count; i++) {
+        if (previous_sections[i].changed) {
+            diff_departures(writer, latest, &previous_sections[i]);
+        }
+    }
+    mem_free(previous_sections);
+    mem_free(latest_sections);
+}
+
+/*
+    entries in section that are new, came from another list or were edited
+*/
+void diff_arrivals(Writer *writer, Modulo *previous, Section *sections, int count, Section *section) {
+    EntryList *entry_list = section->entry_list;
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->flags & ENTRY_REMOVED) {
+            continue;
+        }
+        EntryRef ref = modulo_find_entry(previous, entry->id);
+        if (ref.entry_list == NULL) {
+            records_write_entry_event(writer, RECORD_ENTRY_ADDED, &section->where, entry, NULL);
+            continue;
+        }
+        Section *from = section_of(sections, count, ref.entry_list);
+        if (from != NULL && !same_section(from, section)) {
+            records_write_entry_event(writer, RECORD_ENTRY_MOVED, &section->where, entry, &from->where);
+        } else if (entry_changed(entry_list_get_entry(ref.entry_list, ref.slot), entry)) {
+            records_write_entry_event(writer, RECORD_ENTRY_UPDATED, &section->where, entry, NULL);
+        }
+    }
+}
+
+void diff_departures(Writer *writer, Modulo *latest, Section *section) {
+    EntryList *entry_list = section->entry_list;
+    for (int i = 0; i < entry_list->size; i++) {
+        Entry *entry = entry_list_get_entry(entry_list, i);
+        if (entry->flags & ENTRY_REMOVED) {
+            continue;
+        }
+        if (modulo_find_entry(latest, entry->id).entry_list == NULL) {
+            records_write_entry_event(writer, RECORD_ENTRY_REMOVED, &section->where, entry, NULL);
+        }
+    }
+}
+
+void diff_preferences(Writer *writer, Modulo *previous, Modulo *latest) {
+    if (strcmp(modulo_get_username(previous), modulo_get_username(latest)) != 0) {
+        records_write_preference(writer, latest, PREFERENCE_USERNAME);
+    }
+    if (modulo_get_wakeup_earliest(previous) != modulo_get_wakeup_earliest(latest)) {
+        records_write_preference(writer, latest, PREFERENCE_WAKEUP_EARLIEST);
+    }
+    if (modulo_get_wakeup_latest(previous) != modulo_get_wakeup_latest(latest)) {
+        records_write_preference(writer, latest, PREFERENCE_WAKEUP_LATEST);
+    }
+    if (strcmp(modulo_get_entry_delimiter(previous), modulo_get_entry_delimiter(latest)) != 0) {
+        records_write_preference(writer, latest, PREFERENCE_ENTRY_DELIMITER);
+    }
+    if (modulo_get_carry_over(previous) != modulo_get_carry_over(latest)) {
+        records_write_preference(writer, latest, PREFERENCE_CARRY_OVER);
+    }
+}
+
+/*
+    today, tomorrow, the history queue and the scheduled days, in the order
+    the export writes them
+*/
+Section *collect_sections(Modulo *modulo, int *count) {
+    HistoryQueue *history = modulo_get_history(modulo);
+    CalendarQueue *scheduled = modulo_get_scheduled(modulo);
+    int capacity = 2 + history->size;
+    for (CalendarBucket *bucket = calendar_queue_first(scheduled); bucket != NULL; bucket = calendar_queue_next(scheduled, bucket)) {
+        capacity++;
+    }
+    Section *sections = mem_alloc(MEM_MODULO, capacity * sizeof(Section));
+    int size = 0;
+    sections[size++] = (Section) { { RECORD_LIST_TODAY, RECORD_KEY_ITEM, 0 }, modulo_get_today(modulo), true };
+    sections[size++] = (Section) { { RECORD_LIST_TOMORROW, RECORD_KEY_ITEM, 0 }, modulo_get_tomorrow(modulo), true };
+    for (int i = 0; i < history->size; i++) {
+        sections[size++] = (Section) { { RECORD_LIST_HISTORY, RECORD_KEY_ITEM, i+1 }, history_queue_get(history, i), true };
+    }
+    for (CalendarBucket *bucket = calendar_queue_first(scheduled); bucket != NULL; bucket = calendar_queue_next(scheduled, bucket)) {
+        sections[size++] = (Section) { { RECORD_LIST_SCHEDULED, RECORD_KEY_DELIVER_DAY, bucket->day }, &bucket->entry_list, true };
+    }
+    *count = size;
+    return sections;
+}
+
+Section *find_section(Section *sections, int count, Section *section) {
+    for (int i = 0; i < count; i++) {
+        if (same_section(&sections[i], section)) {
+            return &sections[i];
+        }
+    }
+    return NULL;
+}
+
+Section *section_of(Section *sections, int count, EntryList *entry_list) {
+    for (int i = 0; i < count; i++) {
+        if (sections[i].entry_list == entry_list) {
+            return &sections[i];
+        }
+    }
+    return NULL;
+}
+
+bool same_section(Section *a, Section *b) {
+    if (strcmp(a->where.list, b->where.list) != 0) {
+        return false;
+    }
+    if (strcmp(a->where.list, RECORD_LIST_HISTORY) == 0) {
+        // history items are renumbered every day, the dates stay with the list
+        return entry_list_get_send_date(a->entry_list) == entry_list_get_send_date(b->entry_list)
+            && entry_list_get_recv_date(a->entry_list) == entry_list_get_recv_date(b->entry_list);
+    }
+    return a->where.item == b->where.item;
+}
+
+/*
+    cheap checks first, lists that are the same size with the same counts
+    are compared entry by entry
+*/
+bool entry_list_changed(EntryList *a, EntryList *b) {
+    if (a->size != b->size
+        || a->read_count != b->read_count
+        || a->done_count != b->done_count
+        || a->removed_count != b->removed_count
+        || a->send_date != b->send_date
+        || a->recv_date != b->recv_date
+        || a->read_receipt != b->read_receipt) {
+        return true;
+    }
+    for (int i = 0; i < a->size; i++) {
+        Entry *entry_a = entry_list_get_entry(a, i);
+        Entry *entry_b = entry_list_get_entry(b, i);
+        if (entry_a->id != entry_b->id || entry_changed(entry_a, entry_b)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool entry_changed(Entry *a, Entry *b) {
+    return a->flags != b->flags
+        || a->length != b->length
+        || memcmp(a->text, b->text, a->length) != 0;
+}
\ No newline at end of file
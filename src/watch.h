@@ -0,0 +1,31 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "modulo.h"
+#include "filesystem.h"
+#include "writer.h"
+
+/*
+modulo watch:
+Streams store changes as records (see records.h) for status bars and sync
+scripts that would otherwise poll the cli.
+
+The watch sits on an inotify watch of modulo_dir and blocks in read(), so it
+costs nothing while the store is idle and wakes as soon as a command renames
+its save over modulo.json. Each change is reloaded and diffed against the
+previous copy: lists whose entries compare equal are skipped, only the lists
+that changed are matched up entry by entry (through the entry id index).
+
+Lists are matched by where they are, except history lists, which are matched
+by their send and receive dates since a new day renumbers the whole queue.
+*/
+
+#define WATCH_EVENT_BUFFER_SIZE 4096
+
+// write a status record, then events for every change until the store's directory goes away.
+// takes ownership of modulo, the store as currently on disk. returns -1 if the watch can't be set up
+int watch_store(OSContext *c, Modulo *modulo, Writer *writer);
+// write change events for everything that differs between previous and latest
+void watch_diff(Writer *writer, Modulo *previous, Modulo *latest);
+
+#endif
\ No newline at end of file
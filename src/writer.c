@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "writer.h"
+#include "mem.h"
+
+static void writer_putc(Writer *writer, char c);
+static void writer_key(Writer *writer, char *key);
+static void writer_escaped(Writer *writer, char *value, size_t length);
+static void queue_segment(Writer *writer);
+static void queue_ref(Writer *writer, char *data, size_t length);
+static void write_queue(Writer *writer);
+static size_t format_uint(char *buf, uint64_t value);
+
+static const char hex_digits[] = "0123456789abcdef";
+
+Writer *create_writer(FILE *fp, OutputFormat format) {
+    Writer *writer = mem_alloc(MEM_GENERAL, sizeof(Writer));
+    writer->fp = fp;
+    writer->fd = fileno(fp);
+    writer->format = format;
+    writer->record_count = 0;
+    writer->first_field = true;
+    writer->failed = false;
+    writer->segment_start = 0;
+    writer->length = 0;
+    writer->iov_count = 0;
+    return writer;
+}
+
+void free_writer(Writer *writer) {
+    if (writer->format == OUTPUT_JSON) {
+        if (writer->record_count == 0) {
+            writer_write(writer, "[]\n", 3);
+        } else {
+            writer_write(writer, "\n]\n", 3);
+        }
+    }
+    writer_flush(writer);
+    mem_free(writer);
+}
+
+void writer_flush(Writer *writer) {
+    queue_segment(writer);
+    write_queue(writer);
+}
+
+/*
+    moves the buffer's open segment onto the iovec queue
+    (writing the queue out first if it's full)
+*/
+void queue_segment(Writer *writer) {
+    if (writer->length == writer->segment_start) {
+        return;
+    }
+    if (writer->iov_count == WRITER_IOV_COUNT) {
+        write_queue(writer);
+    }
+    struct iovec *iov = &writer->iov[writer->iov_count++];
+    iov->iov_base = writer->buffer + writer->segment_start;
+    iov->iov_len = writer->length - writer->segment_start;
+    writer->segment_start = writer->length;
+}
+
+void queue_ref(Writer *writer, char *data, size_t length) {
+    queue_segment(writer);
+    if (writer->iov_count == WRITER_IOV_COUNT) {
+        write_queue(writer);
+    }
+    struct iovec *iov = &writer->iov[writer->iov_count++];
+    iov->iov_base = data;
+    iov->iov_len = length;
+}
+
+/*
+    writes out every queued iovec, picking up after short writes.
+    The buffer is reused from the start once nothing in it is left unwritten
+*/
+void write_queue(Writer *writer) {
+    fflush(writer->fp);
+    struct iovec *iov = writer->iov;
+    int count = writer->iov_count;
+    while (count > 0 && !writer->failed) {
+        ssize_t written = writev(writer->fd, iov, count);
+        if (written < 0) {
+            if (errno != EINTR) {
+                writer->failed = true;
+            }
+            continue;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    writer->iov_count = 0;
+    if (writer->segment_start == writer->length) {
+        writer->segment_start = 0;
+        writer->length = 0;
+    }
+}
+
+void writer_write(Writer *writer, char *data, size_t length) {
+    while (length > 0) {
+        if (writer->length == WRITER_BUFFER_SIZE) {
+            writer_flush(writer);
+        }
+        size_t space = WRITER_BUFFER_SIZE - writer->length;
+        size_t chunk = length < space ? length : space;
+        memcpy(writer->buffer + writer->length, data, chunk);
+        writer->length += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void writer_write_ref(Writer *writer, char *data, size_t length) {
+    if (length < WRITER_REF_MIN) {
+        writer_write(writer, data, length);
+    } else {
+        queue_ref(writer, data, length);
+    }
+}
+
+void writer_write_string(Writer *writer, char *string) {
+    writer_write(writer, string, strlen(string));
+}
+
+void writer_write_uint(Writer *writer, uint64_t value) {
+    char buf[24];
+    writer_write(writer, buf, format_uint(buf, value));
+}
+
+void writer_putc(Writer *writer, char c) {
+    if (writer->length == WRITER_BUFFER_SIZE) {
+        writer_flush(writer);
+    }
+    writer->buffer[writer->length++] = c;
+}
+
+void writer_record_begin(Writer *writer, char *type) {
+    if (writer->format == OUTPUT_JSON) {
+        writer_write(writer, writer->record_count == 0 ? "[\n" : ",\n", 2);
+    }
+    writer->record_count++;
+    writer_putc(writer, '{');
+    writer->first_field = true;
+    writer_field_string(writer, "type", type);
+}
+
+void writer_record_end(Writer *writer) {
+    writer_putc(writer, '}');
+    if (writer->format == OUTPUT_NDJSON) {
+        writer_putc(writer, '\n');
+    }
+}
+
+void writer_key(Writer *writer, char *key) {
+    if (!writer->first_field) {
+        writer_putc(writer, ',');
+    }
+    writer->first_field = false;
+    writer_putc(writer, '"');
+    writer_write(writer, key, strlen(key));
+    writer_write(writer, "\":", 2);
+}
+
+void writer_field_string(Writer *writer, char *key, char *value) {
+    if (value == NULL) {
+        writer_field_null(writer, key);
+        return;
+    }
+    writer_field_string_n(writer, key, value, strlen(value));
+}
+
+void writer_field_string_n(Writer *writer, char *key, char *value, size_t length) {
+    writer_key(writer, key);
+    writer_putc(writer, '"');
+    writer_escaped(writer, value, length);
+    writer_putc(writer, '"');
+}
+
+/*
+    passes the runs of bytes that don't need escaping on in one go,
+    only '"', '\' and control characters are escaped (utf-8 passes through)
+*/
+void writer_escaped(Writer *writer, char *value, size_t length) {
+    size_t run_start = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = value[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        writer_write_ref(writer, value + run_start, i - run_start);
+        run_start = i + 1;
+
+        char escape[6] = {'\\', 0};
+        size_t escape_length = 2;
+        switch (c) {
+            case '"':  escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\t': escape[1] = 't'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex_digits[c >> 4];
+                escape[5] = hex_digits[c & 0xf];
+                escape_length = 6;
+        }
+        writer_write(writer, escape, escape_length);
+    }
+    writer_write_ref(writer, value + run_start, length - run_start);
+}
+
+void writer_field_int(Writer *writer, char *key, long long value) {
+    writer_key(writer, key);
+    if (value < 0) {
+        writer_putc(writer, '-');
+        // negated as unsigned so LLONG_MIN doesn't overflow
+        writer_write_uint(writer, -(uint64_t)value);
+    } else {
+        writer_write_uint(writer, (uint64_t)value);
+    }
+}
+
+void writer_field_uint(Writer *writer, char *key, uint64_t value) {
+    writer_key(writer, key);
+    writer_write_uint(writer, value);
+}
+
+void writer_field_bool(Writer *writer, char *key, bool value) {
+    writer_key(writer, key);
+    if (value) {
+        writer_write(writer, "true", 4);
+    } else {
+        writer_write(writer, "false", 5);
+    }
+}
+
+void writer_field_null(Writer *writer, char *key) {
+    writer_key(writer, key);
+    writer_write(writer, "null", 4);
+}
+
+/* writes the decimal digits of value to the start of buf, returns their count */
+size_t format_uint(char *buf, uint64_t value) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (size_t i = 0; i < count; i++) {
+        buf[i] = digits[count - 1 - i];
+    }
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/uio.h>
+
+/*
+Writer:
+Buffered output for the bulk listing commands and the --json and --ndjson
+modes of the read commands.
+
+Small pieces (numbers, labels, separators) are formatted straight into a
+fixed buffer. Long strings (entry text) aren't copied at all: they're queued
+as an iovec pointing at the caller's memory, between the buffer segments
+around them. The queue goes out with one writev whenever the buffer or the
+iovec array fills up, so dumping a large history costs a few syscalls per
+thousand entries rather than a few per entry.
+
+Because of that, text passed to writer_write_ref or a writer_field_string
+must stay alive until the writer is flushed or freed.
+
+Anything printed to fp with stdio before the writer is flushed comes out
+first: fp is flushed before every writev.
+
+OUTPUT_NDJSON writes one record per line. OUTPUT_JSON writes the same records
+as the elements of a single array (closed by free_writer), for consumers that
+want one document. OUTPUT_TEXT is plain text written with writer_write*.
+*/
+
+#define WRITER_BUFFER_SIZE (64 * 1024)
+/* iovecs per writev, well under IOV_MAX (1024 on linux and the BSDs) */
+#define WRITER_IOV_COUNT 128
+/* strings shorter than this are copied, a reference isn't worth an iovec */
+#define WRITER_REF_MIN 256
+
+typedef enum OutputFormat {
+    OUTPUT_TEXT,
+    OUTPUT_JSON,
+    OUTPUT_NDJSON
+} OutputFormat;
+
+typedef struct Writer {
+    FILE *fp;
+    int fd;
+    OutputFormat format;
+    /* records started so far, OUTPUT_JSON separates them with commas */
+    long long record_count;
+    /* the record being written has no fields yet */
+    bool first_field;
+    /* a write failed (e.g. closed pipe), everything after it is dropped */
+    bool failed;
+    /* buffer[segment_start, length) is written but not queued in iov yet */
+    size_t segment_start;
+    size_t length;
+    int iov_count;
+    struct iovec iov[WRITER_IOV_COUNT];
+    char buffer[WRITER_BUFFER_SIZE];
+} Writer;
+
+Writer *create_writer(FILE *fp, OutputFormat format);
+// flushes the buffer (closing the array for OUTPUT_JSON) and frees the writer
+void free_writer(Writer *writer);
+void writer_flush(Writer *writer);
+
+// plain output
+void writer_write(Writer *writer, char *data, size_t length);
+// data may be referenced rather than copied, see above
+void writer_write_ref(Writer *writer, char *data, size_t length);
+void writer_write_string(Writer *writer, char *string);
+void writer_write_uint(Writer *writer, uint64_t value);
+
+// type is written as the first field of every record: {"type":"<type>"
+void writer_record_begin(Writer *writer, char *type);
+void writer_record_end(Writer *writer);
+
+// keys are written as is, they're expected to be plain identifiers
+// a NULL value is written as null
+void writer_field_string(Writer *writer, char *key, char *value);
+void writer_field_string_n(Writer *writer, char *key, char *value, size_t length);
+void writer_field_int(Writer *writer, char *key, long long value);
+void writer_field_uint(Writer *writer, char *key, uint64_t value);
+void writer_field_bool(Writer *writer, char *key, bool value);
+void writer_field_null(Writer *writer, char *key);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,404 @@
+/*
+modulo-bench: microbenchmarks for the core data paths
+
+    make bench
+    modulo-bench [--out <file>] [--filter <name>] [--quick]
+
+Each case runs a number of samples and every sample times a batch of
+operations. ns/op for a sample is its elapsed time divided by the batch
+size, and the percentiles are taken over samples. Setup and teardown
+(building stores, loading the modulo a sync runs on...) happen outside
+the timed region.
+
+Results are printed as a table and written as JSON to --out so runs can
+be diffed:
+{
+    "results": [
+        {
+            name: string
+            param: number
+            batch: number
+            samples: number
+            ns_per_op: { min, p50, p90, p99, max, mean }
+        }
+    ]
+}
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cjson/cJSON.h>
+
+#include "modulo.h"
+#include "entry_list.h"
+#include "filesystem.h"
+#include "editor/entry_doc.h"
+#include "store_gen.h"
+#include "mem.h"
+
+#define BENCH_SAMPLES 50
+#define BENCH_QUICK_SAMPLES 5
+#define BENCH_MAX_STORES 8
+
+#define DOC_LINES 2000
+#define DOC_LINE_LENGTH 200
+
+typedef struct BenchState {
+    OSContext *c;
+    Modulo *modulo;
+    EntryList entry_list;
+    EntryDoc *entry_doc;
+} BenchState;
+
+typedef struct BenchCase {
+    char *name;
+    /* store or list size the case runs against */
+    int param;
+    /* operations timed per sample */
+    int batch;
+    void (*setup)(BenchState *state, int param);
+    void (*run)(BenchState *state, int batch);
+    void (*teardown)(BenchState *state);
+} BenchCase;
+
+typedef struct BenchResult {
+    BenchCase *bench_case;
+    int samples;
+    double min;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    double mean;
+} BenchResult;
+
+/* generated store files, one per size */
+typedef struct Store {
+    int entry_count;
+    OSContext c;
+} Store;
+
+static char tmp_dir[] = "/tmp/modulo-bench-XXXXXX";
+static Store stores[BENCH_MAX_STORES];
+static int store_count = 0;
+/* generates every entry the benchmarks use */
+static StoreGen gen;
+
+static OSContext *get_store(int entry_count);
+static void remove_stores();
+
+static long long now_ns();
+static int compare_doubles(const void *a, const void *b);
+static double percentile(double *sorted, int count, double p);
+static BenchResult run_case(BenchCase *bench_case, int samples);
+static void print_result(BenchResult *result);
+static cJSON *result_to_json(BenchResult *result);
+
+// cases
+static void setup_store(BenchState *state, int param);
+static void setup_loaded(BenchState *state, int param);
+static void setup_entry_list(BenchState *state, int param);
+static void setup_entry_doc(BenchState *state, int param);
+static void teardown_modulo(BenchState *state);
+static void teardown_entry_list(BenchState *state);
+static void teardown_entry_doc(BenchState *state);
+static void teardown_none(BenchState *state);
+
+static void run_load(BenchState *state, int batch);
+static void run_save(BenchState *state, int batch);
+static void run_sync_forward(BenchState *state, int batch);
+static void run_entry_list_push(BenchState *state, int batch);
+static void run_entry_list_remove(BenchState *state, int batch);
+static void run_entry_doc_insert_char(BenchState *state, int batch);
+static void run_entry_doc_enter(BenchState *state, int batch);
+
+static BenchCase cases[] = {
+    { "load_modulo", 100, 1, setup_store, run_load, teardown_none },
+    { "load_modulo", 1000, 1, setup_store, run_load, teardown_none },
+    { "load_modulo", 10000, 1, setup_store, run_load, teardown_none },
+    { "save_modulo", 100, 1, setup_loaded, run_save, teardown_modulo },
+    { "save_modulo", 1000, 1, setup_loaded, run_save, teardown_modulo },
+    { "save_modulo", 10000, 1, setup_loaded, run_save, teardown_modulo },
+    { "modulo_sync_forward", 1000, 1, setup_loaded, run_sync_forward, teardown_modulo },
+    { "modulo_sync_forward", 10000, 1, setup_loaded, run_sync_forward, teardown_modulo },
+    { "entry_list_push", 0, 10000, setup_entry_list, run_entry_list_push, teardown_entry_list },
+    { "entry_list_remove", 10000, 1000, setup_entry_list, run_entry_list_remove, teardown_entry_list },
+    { "entry_doc_insert_char", DOC_LINES, 1000, setup_entry_doc, run_entry_doc_insert_char, teardown_entry_doc },
+    { "entry_doc_enter", DOC_LINES, 100, setup_entry_doc, run_entry_doc_enter, teardown_entry_doc },
+};
+
+int main(int argc, char **argv) {
+    mem_init();
+    char *out_path = NULL;
+    char *filter = NULL;
+    int samples = BENCH_SAMPLES;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i+1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--filter") == 0 && i+1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            samples = BENCH_QUICK_SAMPLES;
+        } else {
+            fprintf(stderr, "usage: %s [--out <file>] [--filter <name>] [--quick]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    gen = create_store_gen(default_store_gen_params());
+    if (mkdtemp(tmp_dir) == NULL) {
+        perror("Failed to create benchmark directory");
+        exit(EXIT_FAILURE);
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON *json_results = cJSON_AddArrayToObject(json, "results");
+    printf("%-24s %8s %8s %12s %12s %12s %12s\n", "case", "param", "samples", "p50 ns/op", "p90 ns/op", "p99 ns/op", "mean ns/op");
+    int case_count = sizeof cases / sizeof cases[0];
+    for (int i = 0; i < case_count; i++) {
+        if (filter != NULL && strstr(cases[i].name, filter) == NULL) {
+            continue;
+        }
+        BenchResult result = run_case(&cases[i], samples);
+        print_result(&result);
+        cJSON_AddItemToArray(json_results, result_to_json(&result));
+    }
+    remove_stores();
+
+    if (out_path != NULL) {
+        char *json_str = cJSON_Print(json);
+        FILE *fp = fopen(out_path, "w");
+        if (fp == NULL) {
+            perror("Failed to open benchmark output");
+            exit(EXIT_FAILURE);
+        }
+        fputs(json_str, fp);
+        fputc('\n', fp);
+        fclose(fp);
+        cJSON_free(json_str);
+        printf("\nResults written to %s\n", out_path);
+    }
+    cJSON_Delete(json);
+    return 0;
+}
+
+/* Timing */
+long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+BenchResult run_case(BenchCase *bench_case, int samples) {
+    double *ns_per_op = malloc(samples * sizeof(double));
+    double total = 0;
+    for (int i = 0; i < samples; i++) {
+        BenchState state = { 0 };
+        bench_case->setup(&state, bench_case->param);
+        long long start = now_ns();
+        bench_case->run(&state, bench_case->batch);
+        long long elapsed = now_ns() - start;
+        bench_case->teardown(&state);
+        ns_per_op[i] = (double) elapsed / bench_case->batch;
+        total += ns_per_op[i];
+    }
+    qsort(ns_per_op, samples, sizeof(double), compare_doubles);
+    BenchResult result = {
+        .bench_case = bench_case,
+        .samples = samples,
+        .min = ns_per_op[0],
+        .p50 = percentile(ns_per_op, samples, 0.50),
+        .p90 = percentile(ns_per_op, samples, 0.90),
+        .p99 = percentile(ns_per_op, samples, 0.99),
+        .max = ns_per_op[samples-1],
+        .mean = total / samples
+    };
+    free(ns_per_op);
+    return result;
+}
+
+int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// nearest rank percentile of a sorted array
+double percentile(double *sorted, int count, double p) {
+    int rank = (int) (p * count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank-1];
+}
+
+void print_result(BenchResult *result) {
+    BenchCase *bench_case = result->bench_case;
+    printf(
+        "%-24s %8d %8d %12.0f %12.0f %12.0f %12.0f\n",
+        bench_case->name,
+        bench_case->param,
+        result->samples,
+        result->p50,
+        result->p90,
+        result->p99,
+        result->mean
+    );
+}
+
+cJSON *result_to_json(BenchResult *result) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "name", result->bench_case->name);
+    cJSON_AddNumberToObject(json, "param", result->bench_case->param);
+    cJSON_AddNumberToObject(json, "batch", result->bench_case->batch);
+    cJSON_AddNumberToObject(json, "samples", result->samples);
+    cJSON *json_ns = cJSON_AddObjectToObject(json, "ns_per_op");
+    cJSON_AddNumberToObject(json_ns, "min", result->min);
+    cJSON_AddNumberToObject(json_ns, "p50", result->p50);
+    cJSON_AddNumberToObject(json_ns, "p90", result->p90);
+    cJSON_AddNumberToObject(json_ns, "p99", result->p99);
+    cJSON_AddNumberToObject(json_ns, "max", result->max);
+    cJSON_AddNumberToObject(json_ns, "mean", result->mean);
+    return json;
+}
+
+/* Stores */
+OSContext *get_store(int entry_count) {
+    for (int i = 0; i < store_count; i++) {
+        if (stores[i].entry_count == entry_count) {
+            return &stores[i].c;
+        }
+    }
+    if (store_count == BENCH_MAX_STORES) {
+        fprintf(stderr, "Too many benchmark stores\n");
+        exit(EXIT_FAILURE);
+    }
+    Store *store = &stores[store_count++];
+    store->entry_count = entry_count;
+    char *filepath = malloc(strlen(tmp_dir) + 32);
+    sprintf(filepath, "%s/store-%d.json", tmp_dir, entry_count);
+    store->c = (OSContext) {
+        .config_dir = tmp_dir,
+        .modulo_dir = tmp_dir,
+        .modulo_json_filepath = filepath,
+        .user_env_var = "USER",
+        .path_separator = '/'
+    };
+    StoreGenParams params = default_store_gen_params();
+    params.entry_count = entry_count;
+    StoreGen store_gen = create_store_gen(params);
+    Modulo *modulo = store_gen_modulo(&store_gen, "bench");
+    if (save_modulo(modulo, &store->c) == -1) {
+        fprintf(stderr, "Failed to write benchmark store %s\n", filepath);
+        exit(EXIT_FAILURE);
+    }
+    free_modulo(modulo);
+    return &store->c;
+}
+
+void remove_stores() {
+    for (int i = 0; i < store_count; i++) {
+        remove(stores[i].c.modulo_json_filepath);
+        free(stores[i].c.modulo_json_filepath);
+    }
+    rmdir(tmp_dir);
+}
+
+/* Setup and teardown */
+void setup_store(BenchState *state, int param) {
+    state->c = get_store(param);
+}
+
+void setup_loaded(BenchState *state, int param) {
+    state->c = get_store(param);
+    state->modulo = load_modulo(state->c);
+}
+
+void setup_entry_list(BenchState *state, int param) {
+    state->entry_list = create_entry_list();
+    for (int i = 0; i < param; i++) {
+        entry_list_push(&state->entry_list, store_gen_entry(&gen));
+    }
+}
+
+// a document of DOC_LINES lines with the cursor in the middle of the middle line
+void setup_entry_doc(BenchState *state, int param) {
+    Modulo *modulo = create_default_modulo("bench");
+    EntryDoc *entry_doc = create_entry_doc(modulo);
+    for (int i = 0; i < param; i++) {
+        for (int j = 0; j < DOC_LINE_LENGTH; j++) {
+            entry_doc_insert_char(entry_doc, 'a' + j % 26);
+        }
+        if (i < param-1) {
+            entry_doc_enter(entry_doc);
+        }
+    }
+    entry_doc->cursor.i = param / 2;
+    entry_doc->cursor.j = DOC_LINE_LENGTH / 2;
+    free_modulo(modulo);
+    state->entry_doc = entry_doc;
+}
+
+void teardown_modulo(BenchState *state) {
+    free_modulo(state->modulo);
+}
+
+void teardown_entry_list(BenchState *state) {
+    free_entry_list(&state->entry_list);
+}
+
+void teardown_entry_doc(BenchState *state) {
+    free_entry_doc(state->entry_doc);
+}
+
+void teardown_none(BenchState *state) {
+}
+
+/* Timed operations */
+void run_load(BenchState *state, int batch) {
+    for (int i = 0; i < batch; i++) {
+        free_modulo(load_modulo(state->c));
+    }
+}
+
+void run_save(BenchState *state, int batch) {
+    for (int i = 0; i < batch; i++) {
+        save_modulo(state->modulo, state->c);
+    }
+}
+
+void run_sync_forward(BenchState *state, int batch) {
+    for (int i = 0; i < batch; i++) {
+        modulo_sync_forward(state->modulo, 1);
+    }
+}
+
+void run_entry_list_push(BenchState *state, int batch) {
+    static char entry[] = "benchmark entry";
+    for (int i = 0; i < batch; i++) {
+        entry_list_push(&state->entry_list, entry);
+    }
+    // the pushed string is static, drop the entries before teardown frees them
+    state->entry_list.size = 0;
+}
+
+// removes from the middle of the list, the worst case for a shifting removal
+void run_entry_list_remove(BenchState *state, int batch) {
+    for (int i = 0; i < batch; i++) {
+        entry_list_remove(&state->entry_list, state->entry_list.size / 2);
+    }
+}
+
+void run_entry_doc_insert_char(BenchState *state, int batch) {
+    for (int i = 0; i < batch; i++) {
+        entry_doc_insert_char(state->entry_doc, 'x');
+    }
+}
+
+void run_entry_doc_enter(BenchState *state, int batch) {
+    for (int i = 0; i < batch; i++) {
+        entry_doc_enter(state->entry_doc);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+/*
+modulo-gen: writes synthetic modulo.json stores for benchmarks and soak tests
+
+    make gen
+    modulo-gen [options]
+
+Stores are built through the Modulo api and written with save_modulo,
+so they always match the current schema. The same options and seed
+always generate the same entries.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "store_gen.h"
+#include "modulo.h"
+#include "filesystem.h"
+#include "mem.h"
+
+#define GEN_DEFAULT_OUT "modulo.json"
+#define GEN_DEFAULT_USER "gen"
+
+static void print_usage(char *program);
+static int parse_int_option(char *option, char *value, int min);
+static OSContext context_for_path(char *filepath);
+
+int main(int argc, char **argv) {
+    mem_init();
+    StoreGenParams params = default_store_gen_params();
+    char *out_path = GEN_DEFAULT_OUT;
+    char *username = GEN_DEFAULT_USER;
+    for (int i = 1; i < argc; i++) {
+        char *option = argv[i];
+        if (strcmp(option, "--help") == 0 || strcmp(option, "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (i+1 >= argc) {
+            fprintf(stderr, "Error: option %s requires a value\n", option);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        char *value = argv[++i];
+        if (strcmp(option, "--out") == 0) {
+            out_path = value;
+        } else if (strcmp(option, "--user") == 0) {
+            username = value;
+        } else if (strcmp(option, "--entries") == 0) {
+            params.entry_count = parse_int_option(option, value, 0);
+        } else if (strcmp(option, "--min-length") == 0) {
+            params.min_length = parse_int_option(option, value, 1);
+        } else if (strcmp(option, "--max-length") == 0) {
+            params.max_length = parse_int_option(option, value, 1);
+        } else if (strcmp(option, "--length-dist") == 0) {
+            params.length_dist = parse_length_dist(value);
+            if (params.length_dist == LENGTH_INVALID) {
+                fprintf(stderr, "Error: --length-dist must be uniform or exponential\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(option, "--multiline") == 0) {
+            params.multiline_percent = parse_int_option(option, value, 0);
+        } else if (strcmp(option, "--escaped") == 0) {
+            params.escaped_percent = parse_int_option(option, value, 0);
+        } else if (strcmp(option, "--history") == 0) {
+            params.history_depth = parse_int_option(option, value, 0);
+        } else if (strcmp(option, "--spread") == 0) {
+            params.day_spread = parse_int_option(option, value, 1);
+        } else if (strcmp(option, "--scheduled") == 0) {
+            params.scheduled_count = parse_int_option(option, value, 0);
+        } else if (strcmp(option, "--recurring") == 0) {
+            params.recurring_count = parse_int_option(option, value, 0);
+        } else if (strcmp(option, "--seed") == 0) {
+            params.seed = (uint32_t) parse_int_option(option, value, 0);
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", option);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (params.min_length > params.max_length) {
+        fprintf(stderr, "Error: --min-length can't be larger than --max-length\n");
+        exit(EXIT_FAILURE);
+    }
+    if (params.multiline_percent > 100) {
+        fprintf(stderr, "Error: --multiline is a percentage, at most 100\n");
+        exit(EXIT_FAILURE);
+    }
+    if (params.escaped_percent > 100) {
+        fprintf(stderr, "Error: --escaped is a percentage, at most 100\n");
+        exit(EXIT_FAILURE);
+    }
+    if (params.history_depth > HISTORY_QUEUE_LENGTH) {
+        fprintf(stderr, "Error: --history can be at most %d\n", HISTORY_QUEUE_LENGTH);
+        exit(EXIT_FAILURE);
+    }
+    if (strlen(username) > USER_NAME_MAX_LEN) {
+        fprintf(stderr, "Error: --user must be %d characters or less\n", USER_NAME_MAX_LEN);
+        exit(EXIT_FAILURE);
+    }
+
+    StoreGen gen = create_store_gen(params);
+    Modulo *modulo = store_gen_modulo(&gen, username);
+    OSContext c = context_for_path(out_path);
+    if (save_modulo(modulo, &c) == -1) {
+        fprintf(stderr, "Error: failed to write %s\n", out_path);
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    long long bytes = stat(out_path, &st) == 0 ? (long long) st.st_size : -1;
+    printf(
+        "Wrote %s (%lld bytes): %d today, %d tomorrow, %d history lists, %d scheduled, %d recurring\n",
+        out_path,
+        bytes,
+        entry_list_live_count(modulo_get_today(modulo)),
+        entry_list_live_count(modulo_get_tomorrow(modulo)),
+        modulo_get_history(modulo)->size,
+        calendar_queue_entry_count(modulo_get_scheduled(modulo)),
+        modulo_get_recurring(modulo)->size
+    );
+    free_modulo(modulo);
+    free(c.modulo_dir);
+    return 0;
+}
+
+void print_usage(char *program) {
+    StoreGenParams defaults = default_store_gen_params();
+    fprintf(stderr, "usage: %s [options]\n\n", program);
+    fprintf(stderr, "    --out <file>           output path (default %s)\n", GEN_DEFAULT_OUT);
+    fprintf(stderr, "    --user <name>          username (default %s)\n", GEN_DEFAULT_USER);
+    fprintf(stderr, "    --entries <n>          entries across today, tomorrow and history (default %d)\n", defaults.entry_count);
+    fprintf(stderr, "    --min-length <n>       shortest entry (default %d)\n", defaults.min_length);
+    fprintf(stderr, "    --max-length <n>       longest entry (default %d)\n", defaults.max_length);
+    fprintf(stderr, "    --length-dist <dist>   uniform or exponential (default uniform)\n");
+    fprintf(stderr, "    --multiline <percent>  entries with line breaks (default %d)\n", defaults.multiline_percent);
+    fprintf(stderr, "    --escaped <percent>    entries with quotes, backslashes, tabs and utf-8 (default %d)\n", defaults.escaped_percent);
+    fprintf(stderr, "    --history <n>          history lists, at most %d (default %d)\n", HISTORY_QUEUE_LENGTH, defaults.history_depth);
+    fprintf(stderr, "    --spread <days>        days between entry lists (default %d)\n", defaults.day_spread);
+    fprintf(stderr, "    --scheduled <n>        entries scheduled for later days (default %d)\n", defaults.scheduled_count);
+    fprintf(stderr, "    --recurring <n>        recurring entries (default %d)\n", defaults.recurring_count);
+    fprintf(stderr, "    --seed <n>             random seed (default %u)\n", defaults.seed);
+}
+
+int parse_int_option(char *option, char *value, int min) {
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (*end != '\0' || end == value || n < min) {
+        fprintf(stderr, "Error: %s expects a number >= %d, got %s\n", option, min, value);
+        exit(EXIT_FAILURE);
+    }
+    return (int) n;
+}
+
+// save_modulo writes to modulo_json_filepath and creates modulo_dir if it's missing
+OSContext context_for_path(char *filepath) {
+    char *dir;
+    char *separator = strrchr(filepath, '/');
+    if (separator == NULL) {
+        dir = malloc(2);
+        strcpy(dir, ".");
+    } else {
+        size_t length = separator - filepath;
+        dir = malloc(length + 1);
+        memcpy(dir, filepath, length);
+        dir[length] = '\0';
+    }
+    OSContext c = {
+        .config_dir = dir,
+        .modulo_dir = dir,
+        .modulo_json_filepath = filepath,
+        .user_env_var = "USER",
+        .path_separator = '/'
+    };
+    return c;
+}
\ No newline at end of file
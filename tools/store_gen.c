@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "store_gen.h"
+#include "modulo.h"
+#include "entry_list.h"
+#include "recurring.h"
+#include "time_utils.h"
+#include "mem.h"
+
+#define EXPONENTIAL_MEAN_DIVISOR 4
+#define SCHEDULE_MAX_DAYS 90
+
+static uint32_t rng_next(StoreGen *gen);
+static int rng_range(StoreGen *gen, int lo, int hi);
+static bool rng_percent(StoreGen *gen, int percent);
+static int entry_length(StoreGen *gen);
+static void fill_tomorrow(StoreGen *gen, Modulo *modulo, int count, time_t day_utc);
+
+static char *words[] = {
+    "finish", "the", "draft", "call", "about", "tomorrow", "review", "notes",
+    "from", "meeting", "remember", "to", "water", "plants", "before", "lunch",
+    "ask", "for", "feedback", "on", "proposal", "gym", "after", "work"
+};
+
+// inserted into escaped entries
+static char *escaped_words[] = {
+    "\"quoted\"", "back\\slash", "tab\tstop", "caf\xc3\xa9", "na\xc3\xafve", "\xe2\x9c\x93", "{json: [1, 2]}"
+};
+
+StoreGenParams default_store_gen_params() {
+    StoreGenParams params = {
+        .entry_count = 1000,
+        .min_length = 20,
+        .max_length = 200,
+        .length_dist = LENGTH_UNIFORM,
+        .multiline_percent = 10,
+        .escaped_percent = 5,
+        .history_depth = HISTORY_QUEUE_LENGTH,
+        .day_spread = 1,
+        .scheduled_count = 0,
+        .recurring_count = 0,
+        .seed = 2463534242u
+    };
+    return params;
+}
+
+StoreGen create_store_gen(StoreGenParams params) {
+    StoreGen gen = {
+        .params = params,
+        // xorshift state must be non zero
+        .rng = params.seed != 0 ? params.seed : 1
+    };
+    return gen;
+}
+
+LengthDist parse_length_dist(char *str) {
+    if (strcmp(str, "uniform") == 0) {
+        return LENGTH_UNIFORM;
+    } else if (strcmp(str, "exponential") == 0) {
+        return LENGTH_EXPONENTIAL;
+    }
+    return LENGTH_INVALID;
+}
+
+// xorshift32, the same seed always generates the same store
+uint32_t rng_next(StoreGen *gen) {
+    uint32_t x = gen->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gen->rng = x;
+    return x;
+}
+
+// uniform in [lo, hi]
+int rng_range(StoreGen *gen, int lo, int hi) {
+    if (hi <= lo) {
+        return lo;
+    }
+    return lo + rng_next(gen) % (uint32_t) (hi - lo + 1);
+}
+
+bool rng_percent(StoreGen *gen, int percent) {
+    return (int) (rng_next(gen) % 100) < percent;
+}
+
+int entry_length(StoreGen *gen) {
+    StoreGenParams *params = &gen->params;
+    if (params->length_dist == LENGTH_UNIFORM) {
+        return rng_range(gen, params->min_length, params->max_length);
+    }
+    // geometric (discrete exponential) with the given mean, clamped to max_length
+    int mean = (params->max_length - params->min_length) / EXPONENTIAL_MEAN_DIVISOR;
+    int length = params->min_length;
+    while (rng_next(gen) % (uint32_t) (mean + 1) != 0 && length < params->max_length) {
+        length++;
+    }
+    return length;
+}
+
+char *store_gen_entry(StoreGen *gen) {
+    int length = entry_length(gen);
+    bool multiline = rng_percent(gen, gen->params.multiline_percent);
+    bool escaped = rng_percent(gen, gen->params.escaped_percent);
+    int word_count = sizeof words / sizeof words[0];
+    int escaped_count = sizeof escaped_words / sizeof escaped_words[0];
+    // longest word plus separator fits in the slack
+    char *entry = mem_alloc(MEM_ENTRY_LIST, length + 32);
+    int size = 0;
+    while (size < length) {
+        char *word = words[rng_next(gen) % word_count];
+        if (escaped && rng_percent(gen, 20)) {
+            word = escaped_words[rng_next(gen) % escaped_count];
+        }
+        if (size > 0) {
+            entry[size++] = (multiline && rng_percent(gen, 15)) ? '\n' : ' ';
+        }
+        strcpy(entry + size, word);
+        size += strlen(word);
+    }
+    return entry;
+}
+
+void fill_tomorrow(StoreGen *gen, Modulo *modulo, int count, time_t day_utc) {
+    EntryList *tomorrow = modulo_get_tomorrow(modulo);
+    for (int i = 0; i < count; i++) {
+        modulo_push_tomorrow(modulo, store_gen_entry(gen));
+        // written at some point during the (simulated) day
+        Entry *entry = entry_list_get_entry(tomorrow, tomorrow->size-1);
+        entry->created = day_utc + rng_range(gen, 0, 16*60*60);
+    }
+    if (count > 0) {
+        entry_list_set_send_date(tomorrow, day_utc + 16*60*60);
+    }
+}
+
+/*
+Entry lists are filled oldest first, a day at a time:
+
+    day:   start                                           current
+           | history[0] | ... | history[n-1] |   today    | tomorrow
+             ^ filled then synced forward (day_spread days each)
+
+sync_forward stamps lists with the real time, those dates are
+rewritten to the simulated days so the store reads like a real one
+*/
+Modulo *store_gen_modulo(StoreGen *gen, char *username) {
+    StoreGenParams *params = &gen->params;
+    Modulo *modulo = create_default_modulo(username);
+    CarryOver carry_over = modulo_get_carry_over(modulo);
+    modulo_set_carry_over(modulo, CARRY_NONE);
+
+    int history_depth = params->history_depth;
+    if (history_depth > HISTORY_QUEUE_LENGTH) history_depth = HISTORY_QUEUE_LENGTH;
+    if (history_depth < 0) history_depth = 0;
+    int day_spread = params->day_spread < 1 ? 1 : params->day_spread;
+    int list_count = history_depth + 2;
+    int per_list = params->entry_count / list_count;
+    // today gets whatever doesn't divide evenly
+    int today_count = params->entry_count - per_list * (list_count - 1);
+
+    clk_time_t wakeup = modulo_get_wakeup_latest(modulo);
+    day_t current_day = modulo_get_day(modulo);
+    day_t day = current_day - day_spread * (history_depth + 1);
+    modulo_set_day_ptr(modulo, day_to_utc(day, wakeup));
+
+    for (int i = 0; i <= history_depth; i++) {
+        int count = i == history_depth ? today_count : per_list;
+        fill_tomorrow(gen, modulo, count, day_to_utc(day, wakeup));
+        // the list written yesterday was read today
+        entry_list_mark_read(modulo_get_today(modulo));
+        modulo_sync_forward(modulo, 1);
+        day += day_spread;
+        modulo_set_day_ptr(modulo, day_to_utc(day, wakeup));
+        entry_list_set_recv_date(modulo_get_today(modulo), day_to_utc(day, wakeup));
+    }
+    fill_tomorrow(gen, modulo, per_list, day_to_utc(day, wakeup));
+
+    for (int i = 0; i < params->scheduled_count; i++) {
+        day_t delivery_day = current_day + rng_range(gen, 2, SCHEDULE_MAX_DAYS);
+        modulo_schedule(modulo, store_gen_entry(gen), delivery_day);
+    }
+    for (int i = 0; i < params->recurring_count; i++) {
+        RecurrenceRule rule = rng_next(gen) % 3;
+        int param = 0;
+        if (rule == RECUR_WEEKLY) param = rng_range(gen, 0, 6);
+        if (rule == RECUR_MONTHLY) param = rng_range(gen, 1, 31);
+        modulo_add_recurring(modulo, store_gen_entry(gen), rule, param);
+    }
+    modulo_set_carry_over(modulo, carry_over);
+    return modulo;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef STORE_GEN_H
+#define STORE_GEN_H
+
+#include <stdint.h>
+
+#include "modulo.h"
+
+typedef enum LengthDist {
+    /* entry lengths uniform in [min_length, max_length] */
+    LENGTH_UNIFORM,
+    /* mostly short entries with a long tail up to max_length */
+    LENGTH_EXPONENTIAL,
+    LENGTH_INVALID
+} LengthDist;
+
+typedef struct StoreGenParams {
+    /* entries spread over today, tomorrow and the history lists */
+    int entry_count;
+    int min_length;
+    int max_length;
+    LengthDist length_dist;
+    /* percent of entries with line breaks */
+    int multiline_percent;
+    /* percent of entries with characters json has to escape (quotes, backslashes, tabs, utf-8) */
+    int escaped_percent;
+    /* number of history lists (at most HISTORY_QUEUE_LENGTH) */
+    int history_depth;
+    /* days between consecutive entry lists */
+    int day_spread;
+    /* entries scheduled for later days */
+    int scheduled_count;
+    int recurring_count;
+    uint32_t seed;
+} StoreGenParams;
+
+typedef struct StoreGen {
+    StoreGenParams params;
+    uint32_t rng;
+} StoreGen;
+
+StoreGenParams default_store_gen_params();
+StoreGen create_store_gen(StoreGenParams params);
+
+LengthDist parse_length_dist(char *str);
+
+// a newly allocated entry following the length and content parameters
+char *store_gen_entry(StoreGen *gen);
+/*
+Builds a store through the Modulo api, as if it had been used for
+(history_depth + 1) * day_spread days, synced up to the current day
+*/
+Modulo *store_gen_modulo(StoreGen *gen, char *username);
+
+#endif
\ No newline at end of file